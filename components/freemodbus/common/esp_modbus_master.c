@@ -277,6 +277,15 @@ esp_err_t mbc_master_get_transaction_info(mb_trans_info_t *ptinfo)
     return ESP_OK;
 }
 
+/**
+ * Set the response timeout of the next requests
+ */
+esp_err_t mbc_master_set_response_timeout(uint32_t timeout_ms)
+{
+    vMBMasterPortTimersSetRespondTimeout((ULONG)timeout_ms);
+    return ESP_OK;
+}
+
 // Helper function to set parameter buffer according to its type
 esp_err_t mbc_master_set_param_data(void* dest, void* src, mb_descr_type_t param_type, size_t param_size)
 {
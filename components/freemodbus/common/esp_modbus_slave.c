@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdlib.h>                 // for qsort()
+#include <string.h>                 // for memcpy()
 #include "esp_err.h"                // for esp_err_t
 #include "esp_timer.h"              // for esp_timer_get_time()
 #include "sdkconfig.h"              // for KConfig defines
@@ -33,41 +35,176 @@ static uint8_t mb_slave_id[] = { MB_ID_BYTE0(MB_CONTROLLER_SLAVE_ID),
 
 #define REG_SIZE(type, nregs) ((type == MB_PARAM_INPUT) || (type == MB_PARAM_HOLDING)) ? (nregs >> 1) : (nregs << 3)
 
-// Common interface pointer for slave port
+// Interfaces of the slave ports by port type, each port serves its own stack instance
+static mb_slave_interface_t* slave_interfaces[MB_PORT_COUNT] = { NULL };
+// Interface of the functions without the handler, the last initialized one
 static mb_slave_interface_t* slave_interface_ptr = NULL;
 static const char TAG[] __attribute__((unused)) = "MB_CONTROLLER_SLAVE";
 
+// Returns the address following the last register (bit) of the area, the areas without storage are empty
+static uint32_t mbc_slave_descr_end(const mb_descr_entry_t* descr)
+{
+    uint32_t reg_size = (descr->p_data) ? (uint32_t)(REG_SIZE(descr->type, descr->size)) : 0;
+    return (uint32_t)descr->start_offset + reg_size;
+}
+
+// Returns the index of the first range starting above the address
+static uint32_t mbc_slave_index_upper(const mb_descr_index_t* index, uint32_t addr)
+{
+    if (!index->count || (addr < index->ranges[0].start)) {
+        return 0;
+    }
+    uint32_t lo = 0;
+    uint32_t hi = index->count;
+    if (index->pages) {
+        // Narrow the search to the ranges which start within the page of the address
+        uint32_t page = (addr - index->page_base) >> MB_DESCR_PAGE_SHIFT;
+        if (page < index->page_count) {
+            lo = index->pages[page];
+            hi = index->pages[page + 1];
+        } else {
+            lo = hi = index->count;
+        }
+    }
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) >> 1;
+        if (index->ranges[mid].start <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
 // Searches the register in the area specified by type, returns descriptor if found, else NULL
-static mb_descr_entry_t* mbc_slave_find_reg_descriptor(mb_param_type_t type, uint16_t addr, size_t regs)
+static mb_descr_entry_t* mbc_slave_find_reg_descriptor(mb_slave_options_t* mbs_opts, mb_param_type_t type,
+                                                        uint16_t addr, size_t regs)
 {
-    mb_descr_entry_t* it;
-    uint16_t reg_size = 0;
+    const mb_descr_index_t* index = &mbs_opts->mbs_descr_index[type];
 
-    mb_slave_options_t* mbs_opts = &slave_interface_ptr->opts;
+    if (regs < 1) {
+        return NULL;
+    }
 
-    if (LIST_EMPTY(&mbs_opts->mbs_area_descriptors[type])) {
+    if (!mbs_opts->mbs_descr_frozen) {
+        // The descriptors are not indexed yet, search for the register in each area
+        mb_descr_entry_t* it;
+        LIST_FOREACH(it, &mbs_opts->mbs_area_descriptors[type], entries) {
+            if ((addr >= it->start_offset) && ((addr + regs) <= mbc_slave_descr_end(it))) {
+                return it;
+            }
+        }
         return NULL;
     }
 
-    // search for the register in each area
-    for (it = LIST_FIRST(&mbs_opts->mbs_area_descriptors[type]); it != NULL; it = LIST_NEXT(it, entries)) {
-        reg_size = REG_SIZE(type, it->size);
-        if ((addr >= it->start_offset)
-            && (it->p_data)
-            && (regs >= 1)
-            && ((addr + regs) <= (it->start_offset + reg_size))
-            && (reg_size >= 1)) {
-            return it;
+    // The area is the one before the first range starting above the address
+    uint32_t upper = mbc_slave_index_upper(index, addr);
+    if (!upper) {
+        return NULL;
+    }
+    const mb_descr_range_t* range = &index->ranges[upper - 1];
+    return (((uint32_t)addr + regs) <= range->end) ? range->descr : NULL;
+}
+
+static int mbc_slave_descr_range_cmp(const void* a, const void* b)
+{
+    const mb_descr_range_t* range_a = (const mb_descr_range_t*)a;
+    const mb_descr_range_t* range_b = (const mb_descr_range_t*)b;
+    return (range_a->start > range_b->start) - (range_a->start < range_b->start);
+}
+
+static void mbc_slave_free_descr_index(mb_slave_options_t* mbs_opts)
+{
+    for (int descr_type = 0; descr_type < MB_PARAM_COUNT; descr_type++) {
+        mb_descr_index_t* index = &mbs_opts->mbs_descr_index[descr_type];
+        free(index->ranges);
+        free(index->pages);
+        memset(index, 0, sizeof(mb_descr_index_t));
+    }
+    mbs_opts->mbs_descr_frozen = false;
+}
+
+// Builds the sorted ranges and the optional page index of the descriptors of one type
+static esp_err_t mbc_slave_build_descr_index(mb_slave_options_t* mbs_opts, mb_param_type_t type)
+{
+    mb_descr_index_t* index = &mbs_opts->mbs_descr_index[type];
+    mb_descr_entry_t* it;
+    uint16_t count = 0;
+
+    LIST_FOREACH(it, &mbs_opts->mbs_area_descriptors[type], entries) {
+        count += (mbc_slave_descr_end(it) > it->start_offset) ? 1 : 0;
+    }
+    if (!count) {
+        return ESP_OK;
+    }
+    index->ranges = (mb_descr_range_t*) heap_caps_malloc(count * sizeof(mb_descr_range_t),
+                                            MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
+    MB_SLAVE_CHECK((index->ranges != NULL), ESP_ERR_NO_MEM, "mb can not allocate memory for descriptor index.");
+    LIST_FOREACH(it, &mbs_opts->mbs_area_descriptors[type], entries) {
+        uint32_t end = mbc_slave_descr_end(it);
+        if (end > it->start_offset) {
+            index->ranges[index->count].start = it->start_offset;
+            index->ranges[index->count].end = end;
+            index->ranges[index->count].descr = it;
+            index->count++;
+        }
+    }
+    qsort(index->ranges, index->count, sizeof(mb_descr_range_t), mbc_slave_descr_range_cmp);
+
+    // The page index is built for the dense areas only
+    uint32_t page_base = index->ranges[0].start;
+    uint32_t span_end = 0;
+    for (int i = 0; i < index->count; i++) {
+        span_end = (index->ranges[i].end > span_end) ? index->ranges[i].end : span_end;
+    }
+    uint32_t page_count = (span_end - page_base + (1 << MB_DESCR_PAGE_SHIFT) - 1) >> MB_DESCR_PAGE_SHIFT;
+    if (page_count > MB_DESCR_PAGES_MAX) {
+        ESP_LOGD(TAG, "Descriptors of type %d span %" PRIu32 " pages, the page index is not used.",
+                    (int)type, page_count);
+        return ESP_OK;
+    }
+    index->pages = (uint16_t*) heap_caps_malloc((page_count + 1) * sizeof(uint16_t),
+                                            MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
+    MB_SLAVE_CHECK((index->pages != NULL), ESP_ERR_NO_MEM, "mb can not allocate memory for descriptor index.");
+    uint16_t range_idx = 0;
+    for (uint32_t page = 0; page < page_count; page++) {
+        uint32_t page_start = page_base + (page << MB_DESCR_PAGE_SHIFT);
+        while ((range_idx < index->count) && (index->ranges[range_idx].start <= page_start)) {
+            range_idx++;
         }
+        index->pages[page] = range_idx;
+    }
+    index->pages[page_count] = index->count;
+    index->page_base = page_base;
+    index->page_count = (uint16_t)page_count;
+    return ESP_OK;
+}
+
+// Freezes the descriptors into the lookup index, the descriptors can not be added afterwards
+static esp_err_t mbc_slave_freeze_descriptors(mb_slave_options_t* mbs_opts)
+{
+    esp_err_t error = ESP_OK;
+
+    if (mbs_opts->mbs_descr_frozen) {
+        return ESP_OK;
     }
-    return NULL;
+    for (int descr_type = 0; (descr_type < MB_PARAM_COUNT) && (error == ESP_OK); descr_type++) {
+        error = mbc_slave_build_descr_index(mbs_opts, (mb_param_type_t)descr_type);
+    }
+    if (error != ESP_OK) {
+        mbc_slave_free_descr_index(mbs_opts);
+        return error;
+    }
+    mbs_opts->mbs_descr_frozen = true;
+    return ESP_OK;
 }
 
-static void mbc_slave_free_descriptors(void) {
+static void mbc_slave_free_descriptors(mb_slave_options_t* mbs_opts) {
 
     mb_descr_entry_t* it;
-    mb_slave_options_t* mbs_opts = &slave_interface_ptr->opts;
 
+    mbc_slave_free_descr_index(mbs_opts);
     for (int descr_type = 0; descr_type < MB_PARAM_COUNT; descr_type++) {
         while ((it = LIST_FIRST(&mbs_opts->mbs_area_descriptors[descr_type]))) {
             LIST_REMOVE(it, entries);
@@ -78,55 +215,89 @@ static void mbc_slave_free_descriptors(void) {
 
 void mbc_slave_init_iface(void* handler)
 {
-    slave_interface_ptr = (mb_slave_interface_t*) handler;
-    mb_slave_options_t* mbs_opts = &slave_interface_ptr->opts;
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
+    mb_slave_options_t* mbs_opts = &iface->opts;
     // Initialize list head for register areas
     LIST_INIT(&mbs_opts->mbs_area_descriptors[MB_PARAM_INPUT]);
     LIST_INIT(&mbs_opts->mbs_area_descriptors[MB_PARAM_HOLDING]);
     LIST_INIT(&mbs_opts->mbs_area_descriptors[MB_PARAM_COIL]);
     LIST_INIT(&mbs_opts->mbs_area_descriptors[MB_PARAM_DISCRETE]);
+    memset(mbs_opts->mbs_descr_index, 0, sizeof(mbs_opts->mbs_descr_index));
+    memset(mbs_opts->mbs_gap_fill, 0, sizeof(mbs_opts->mbs_gap_fill));
+    mbs_opts->mbs_descr_frozen = false;
+    if (mbs_opts->port_type < MB_PORT_COUNT) {
+        slave_interfaces[mbs_opts->port_type] = iface;
+    }
+    slave_interface_ptr = iface;
+}
+
+// Returns the interface of the stack instance which executes the request, the register
+// callbacks of the stack do not carry the instance
+static mb_slave_interface_t* mbc_slave_get_exec_iface(void)
+{
+    xMBHandle stack_handle = xMBGetExecHdl();
+    for (int port = 0; stack_handle && (port < MB_PORT_COUNT); port++) {
+        if (slave_interfaces[port] && (slave_interfaces[port]->opts.mbs_stack_handle == stack_handle)) {
+            return slave_interfaces[port];
+        }
+    }
+    return slave_interface_ptr;
 }
 
 /**
  * Modbus controller destroy function
  */
-esp_err_t mbc_slave_destroy(void)
+esp_err_t mbc_slave_destroy_hdl(void* handler)
 {
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
     esp_err_t error = ESP_OK;
     // Is initialization done?
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
+    MB_SLAVE_CHECK((iface != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
     // Check if interface has been initialized
-    MB_SLAVE_CHECK((slave_interface_ptr->destroy != NULL),
+    MB_SLAVE_CHECK((iface->destroy != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
     // Call the slave port destroy function
-    error = slave_interface_ptr->destroy();
+    error = iface->destroy();
     MB_SLAVE_CHECK((error == ESP_OK),
                     ESP_ERR_INVALID_STATE,
                     "Slave destroy failure error=(0x%x).",
                     (int)error);
     // Destroy all opened descriptors
-    mbc_slave_free_descriptors();
-    free(slave_interface_ptr);
-    slave_interface_ptr = NULL;
+    mbc_slave_free_descriptors(&iface->opts);
+    for (int port = 0; port < MB_PORT_COUNT; port++) {
+        if (slave_interfaces[port] == iface) {
+            slave_interfaces[port] = NULL;
+        }
+    }
+    if (slave_interface_ptr == iface) {
+        slave_interface_ptr = NULL;
+    }
+    free(iface);
     return error;
 }
 
+esp_err_t mbc_slave_destroy(void)
+{
+    return mbc_slave_destroy_hdl(slave_interface_ptr);
+}
+
 /**
  * Setup Modbus controller parameters
  */
-esp_err_t mbc_slave_setup(void* comm_info)
+esp_err_t mbc_slave_setup_hdl(void* handler, void* comm_info)
 {
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
     esp_err_t error = ESP_OK;
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
+    MB_SLAVE_CHECK((iface != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
-    MB_SLAVE_CHECK((slave_interface_ptr->setup != NULL),
+    MB_SLAVE_CHECK((iface->setup != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
-    error = slave_interface_ptr->setup(comm_info);
+    error = iface->setup(comm_info);
     MB_SLAVE_CHECK((error == ESP_OK),
                     ESP_ERR_INVALID_STATE,
                     "Slave setup failure error=(0x%x).",
@@ -134,16 +305,22 @@ esp_err_t mbc_slave_setup(void* comm_info)
     return error;
 }
 
+esp_err_t mbc_slave_setup(void* comm_info)
+{
+    return mbc_slave_setup_hdl(slave_interface_ptr, comm_info);
+}
+
 /**
  * Start Modbus controller start function
  */
-esp_err_t mbc_slave_start(void)
+esp_err_t mbc_slave_start_hdl(void* handler)
 {
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
     esp_err_t error = ESP_OK;
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
+    MB_SLAVE_CHECK((iface != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
-    MB_SLAVE_CHECK((slave_interface_ptr->start != NULL),
+    MB_SLAVE_CHECK((iface->start != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
 #ifdef CONFIG_FMB_CONTROLLER_SLAVE_ID_SUPPORT
@@ -151,7 +328,9 @@ esp_err_t mbc_slave_start(void)
     eMBErrorCode status = eMBSetSlaveID(MB_SLAVE_ID_SHORT, TRUE, (UCHAR*)mb_slave_id, sizeof(mb_slave_id));
     MB_SLAVE_CHECK((status == MB_ENOERR), ESP_ERR_INVALID_STATE, "mb stack set slave ID failure.");
 #endif
-    error = slave_interface_ptr->start();
+    error = mbc_slave_freeze_descriptors(&iface->opts);
+    MB_SLAVE_CHECK((error == ESP_OK), error, "mb descriptor index failure error=(0x%x).", (int)error);
+    error = iface->start();
     MB_SLAVE_CHECK((error == ESP_OK),
                     ESP_ERR_INVALID_STATE,
                     "Slave start failure error=(0x%x).",
@@ -159,34 +338,46 @@ esp_err_t mbc_slave_start(void)
     return error;
 }
 
+esp_err_t mbc_slave_start(void)
+{
+    return mbc_slave_start_hdl(slave_interface_ptr);
+}
+
 /**
  * Blocking function to get event on parameter group change for application task
  */
-mb_event_group_t mbc_slave_check_event(mb_event_group_t group)
+mb_event_group_t mbc_slave_check_event_hdl(void* handler, mb_event_group_t group)
 {
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
+    MB_SLAVE_CHECK((iface != NULL),
                     MB_EVENT_NO_EVENTS,
                     "Slave interface is not correctly initialized.");
-    MB_SLAVE_CHECK((slave_interface_ptr->check_event != NULL),
+    MB_SLAVE_CHECK((iface->check_event != NULL),
                     MB_EVENT_NO_EVENTS,
                     "Slave interface is not correctly initialized.");
-    mb_event_group_t event = slave_interface_ptr->check_event(group);
+    mb_event_group_t event = iface->check_event(group);
     return event;
 }
 
+mb_event_group_t mbc_slave_check_event(mb_event_group_t group)
+{
+    return mbc_slave_check_event_hdl(slave_interface_ptr, group);
+}
+
 /**
  * Function to get notification about parameter change from application task
  */
-esp_err_t mbc_slave_get_param_info(mb_param_info_t* reg_info, uint32_t timeout)
+esp_err_t mbc_slave_get_param_info_hdl(void* handler, mb_param_info_t* reg_info, uint32_t timeout)
 {
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
     esp_err_t error = ESP_OK;
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
+    MB_SLAVE_CHECK((iface != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
-    MB_SLAVE_CHECK((slave_interface_ptr->get_param_info != NULL),
+    MB_SLAVE_CHECK((iface->get_param_info != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
-    error = slave_interface_ptr->get_param_info(reg_info, timeout);
+    error = iface->get_param_info(reg_info, timeout);
     MB_SLAVE_CHECK((error == ESP_OK),
                     ESP_ERR_INVALID_STATE,
                     "Slave get parameter info failure error=(0x%x).",
@@ -194,27 +385,142 @@ esp_err_t mbc_slave_get_param_info(mb_param_info_t* reg_info, uint32_t timeout)
     return error;
 }
 
+esp_err_t mbc_slave_get_param_info(mb_param_info_t* reg_info, uint32_t timeout)
+{
+    return mbc_slave_get_param_info_hdl(slave_interface_ptr, reg_info, timeout);
+}
+
+/**
+ * Function to get all pending notifications about parameter access from application task
+ */
+esp_err_t mbc_slave_get_param_info_batch_hdl(void* handler, mb_param_info_t* reg_info, size_t max_count,
+                                                size_t* count, uint32_t timeout)
+{
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
+    MB_SLAVE_CHECK((iface != NULL),
+                    ESP_ERR_INVALID_STATE,
+                    "Slave interface is not correctly initialized.");
+    MB_SLAVE_CHECK(((reg_info != NULL) && (max_count > 0) && (count != NULL)),
+                    ESP_ERR_INVALID_ARG, "mb register information is invalid.");
+    mb_param_ring_t* ring = &iface->opts.mbs_notify_ring;
+    MB_SLAVE_CHECK((ring->entries != NULL), ESP_ERR_INVALID_STATE, "mb notify ring is not created.");
+    *count = mbc_slave_notify_ring_get(ring, reg_info, max_count, timeout);
+    return (*count > 0) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t mbc_slave_get_param_info_batch(mb_param_info_t* reg_info, size_t max_count,
+                                            size_t* count, uint32_t timeout)
+{
+    return mbc_slave_get_param_info_batch_hdl(slave_interface_ptr, reg_info, max_count, count, timeout);
+}
+
+/**
+ * Function to select the access events notified to the application task
+ */
+esp_err_t mbc_slave_set_notify_mask_hdl(void* handler, mb_event_group_t event_mask)
+{
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
+    MB_SLAVE_CHECK((iface != NULL),
+                    ESP_ERR_INVALID_STATE,
+                    "Slave interface is not correctly initialized.");
+    mb_param_ring_t* ring = &iface->opts.mbs_notify_ring;
+    atomic_store_explicit(&ring->event_mask, (unsigned)(event_mask & MB_EVENT_ACCESS_MASK),
+                            memory_order_relaxed);
+    return ESP_OK;
+}
+
+esp_err_t mbc_slave_set_notify_mask(mb_event_group_t event_mask)
+{
+    return mbc_slave_set_notify_mask_hdl(slave_interface_ptr, event_mask);
+}
+
+/**
+ * Function to get the statistic of parameter access notifications
+ */
+esp_err_t mbc_slave_get_notify_stats_hdl(void* handler, mb_param_notify_stats_t* stats)
+{
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
+    MB_SLAVE_CHECK((iface != NULL),
+                    ESP_ERR_INVALID_STATE,
+                    "Slave interface is not correctly initialized.");
+    MB_SLAVE_CHECK((stats != NULL), ESP_ERR_INVALID_ARG, "mb statistic pointer is invalid.");
+    mb_param_ring_t* ring = &iface->opts.mbs_notify_ring;
+    stats->queued = atomic_load_explicit(&ring->queued, memory_order_relaxed);
+    stats->coalesced = atomic_load_explicit(&ring->coalesced, memory_order_relaxed);
+    stats->overflows = atomic_load_explicit(&ring->overflows, memory_order_relaxed);
+    stats->pending = atomic_load_explicit(&ring->head, memory_order_acquire)
+                        - atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return ESP_OK;
+}
+
+esp_err_t mbc_slave_get_notify_stats(mb_param_notify_stats_t* stats)
+{
+    return mbc_slave_get_notify_stats_hdl(slave_interface_ptr, stats);
+}
+
+/**
+ * Function to set the value read from the unmapped registers between the areas
+ */
+esp_err_t mbc_slave_set_gap_fill_hdl(void* handler, mb_param_type_t type, bool enable, uint16_t fill_value)
+{
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
+    MB_SLAVE_CHECK((iface != NULL),
+                    ESP_ERR_INVALID_STATE,
+                    "Slave interface is not correctly initialized.");
+    MB_SLAVE_CHECK(((type == MB_PARAM_HOLDING) || (type == MB_PARAM_INPUT)),
+                    ESP_ERR_INVALID_ARG, "mb gap fill is supported for registers only.");
+    mb_slave_options_t* mbs_opts = &iface->opts;
+    mbs_opts->mbs_gap_fill[type].value = fill_value;
+    mbs_opts->mbs_gap_fill[type].enable = enable;
+    return ESP_OK;
+}
+
+esp_err_t mbc_slave_set_gap_fill(mb_param_type_t type, bool enable, uint16_t fill_value)
+{
+    return mbc_slave_set_gap_fill_hdl(slave_interface_ptr, type, enable, fill_value);
+}
+
 /**
  * Function to set area descriptors for modbus parameters
  */
-esp_err_t mbc_slave_set_descriptor(mb_register_area_descriptor_t descr_data)
+esp_err_t mbc_slave_set_descriptor_hdl(void* handler, mb_register_area_descriptor_t descr_data)
 {
+    mb_slave_interface_t* iface = (mb_slave_interface_t*) handler;
     esp_err_t error = ESP_OK;
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
+    MB_SLAVE_CHECK((iface != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
 
-    if (slave_interface_ptr->set_descriptor != NULL) {
-        error = slave_interface_ptr->set_descriptor(descr_data);
+    if (iface->set_descriptor != NULL) {
+        error = iface->set_descriptor(descr_data);
         MB_SLAVE_CHECK((error == ESP_OK),
                         ESP_ERR_INVALID_STATE,
                         "Slave set descriptor failure error=(0x%x).",
                         (int)error);
     } else {
-        mb_slave_options_t* mbs_opts = &slave_interface_ptr->opts;
-        // Check if the address is already in the descriptor list
-        mb_descr_entry_t* it = mbc_slave_find_reg_descriptor(descr_data.type, descr_data.start_offset, 1);
-        MB_SLAVE_CHECK((it == NULL), ESP_ERR_INVALID_ARG, "mb incorrect descriptor or already defined.");
+        mb_slave_options_t* mbs_opts = &iface->opts;
+        MB_SLAVE_CHECK((descr_data.type < MB_PARAM_COUNT), ESP_ERR_INVALID_ARG, "mb incorrect descriptor type.");
+        uint8_t elem_size = mb_get_elem_size(descr_data.elem_type);
+        bool is_typed = (descr_data.elem_type != MB_ELEM_U16) || (descr_data.word_order != MB_WORD_ORDER_ABCD);
+        MB_SLAVE_CHECK((elem_size && ((unsigned)descr_data.word_order < MB_WORD_ORDER_COUNT)),
+                        ESP_ERR_INVALID_ARG, "mb incorrect descriptor element type.");
+        MB_SLAVE_CHECK((!is_typed || (((descr_data.type == MB_PARAM_HOLDING) || (descr_data.type == MB_PARAM_INPUT))
+                        && !(descr_data.size % elem_size))),
+                        ESP_ERR_INVALID_ARG, "mb typed area must be holding or input with whole elements.");
+        MB_SLAVE_CHECK((!mbs_opts->mbs_descr_frozen), ESP_ERR_INVALID_STATE,
+                        "mb descriptors can not be changed after start.");
+        // Check if the area overlaps the areas in the descriptor list
+        mb_descr_entry_t new_area = { .start_offset = descr_data.start_offset, .type = descr_data.type,
+                                        .p_data = descr_data.address, .size = descr_data.size };
+        mb_descr_entry_t* it;
+        LIST_FOREACH(it, &mbs_opts->mbs_area_descriptors[descr_data.type], entries) {
+            bool is_overlapped = (new_area.start_offset < mbc_slave_descr_end(it))
+                                    && (it->start_offset < mbc_slave_descr_end(&new_area));
+            bool is_inside = (new_area.start_offset >= it->start_offset)
+                                    && (new_area.start_offset < mbc_slave_descr_end(it));
+            MB_SLAVE_CHECK(!(is_overlapped || is_inside), ESP_ERR_INVALID_ARG,
+                            "mb incorrect descriptor or already defined.");
+        }
 
         mb_descr_entry_t* new_descr = (mb_descr_entry_t*) heap_caps_malloc(sizeof(mb_descr_entry_t),
                                             MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
@@ -223,12 +529,20 @@ esp_err_t mbc_slave_set_descriptor(mb_register_area_descriptor_t descr_data)
         new_descr->type = descr_data.type;
         new_descr->p_data = descr_data.address;
         new_descr->size = descr_data.size;
+        new_descr->elem_size = elem_size;
+        new_descr->word_order = descr_data.word_order;
+        new_descr->seqlock = descr_data.seqlock;
         LIST_INSERT_HEAD(&mbs_opts->mbs_area_descriptors[descr_data.type], new_descr, entries);
         error = ESP_OK;
     }
     return error;
 }
 
+esp_err_t mbc_slave_set_descriptor(mb_register_area_descriptor_t descr_data)
+{
+    return mbc_slave_set_descriptor_hdl(slave_interface_ptr, descr_data);
+}
+
 // The helper function to get time stamp in microseconds
 static uint64_t mbc_slave_get_time_stamp(void)
 {
@@ -236,37 +550,124 @@ static uint64_t mbc_slave_get_time_stamp(void)
     return time_stamp;
 }
 
+esp_err_t mbc_slave_notify_ring_create(mb_param_ring_t* ring, size_t size)
+{
+    MB_SLAVE_CHECK((ring != NULL), ESP_ERR_INVALID_ARG, "mb notify ring is invalid.");
+    size_t ring_size = 1;
+    while (ring_size < size) {
+        ring_size <<= 1;
+    }
+    memset(ring, 0, sizeof(mb_param_ring_t));
+    ring->entries = (mb_param_ring_entry_t*) heap_caps_calloc(ring_size, sizeof(mb_param_ring_entry_t),
+                                                                MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
+    MB_SLAVE_CHECK((ring->entries != NULL), ESP_ERR_NO_MEM, "mb notify ring allocation error.");
+    ring->ready = xSemaphoreCreateBinary();
+    if (ring->ready == NULL) {
+        free(ring->entries);
+        ring->entries = NULL;
+        MB_SLAVE_CHECK(false, ESP_ERR_NO_MEM, "mb notify ring semaphore creation error.");
+    }
+    ring->mask = (uint32_t)(ring_size - 1);
+    atomic_init(&ring->event_mask, (unsigned)MB_EVENT_ACCESS_MASK);
+    return ESP_OK;
+}
+
+void mbc_slave_notify_ring_delete(mb_param_ring_t* ring)
+{
+    if (ring->ready) {
+        vSemaphoreDelete(ring->ready);
+    }
+    free(ring->entries);
+    memset(ring, 0, sizeof(mb_param_ring_t));
+}
+
+// Takes the pending entries without waiting, the hits of an entry are claimed before the tail moves
+static size_t mbc_slave_notify_ring_take(mb_param_ring_t* ring, mb_param_info_t* reg_info, size_t max_count)
+{
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t count = 0;
+    while ((tail != head) && (count < max_count)) {
+        mb_param_ring_entry_t* entry = &ring->entries[tail & ring->mask];
+        reg_info[count] = entry->info;
+        reg_info[count].hits = atomic_exchange_explicit(&entry->hits, 0, memory_order_acq_rel);
+        count++;
+        tail++;
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    return count;
+}
+
+size_t mbc_slave_notify_ring_get(mb_param_ring_t* ring, mb_param_info_t* reg_info, size_t max_count, uint32_t timeout)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t wait_ticks = pdMS_TO_TICKS(timeout);
+    size_t count = 0;
+    // The semaphore can be left given by the entries taken earlier, so wait until the timeout expires
+    while (!(count = mbc_slave_notify_ring_take(ring, reg_info, max_count))) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if ((elapsed >= wait_ticks) || (xSemaphoreTake(ring->ready, wait_ticks - elapsed) != pdTRUE)) {
+            break;
+        }
+    }
+    return count;
+}
+
 // Helper function to send parameter information to application task
-static esp_err_t mbc_slave_send_param_info(mb_event_group_t par_type, uint16_t mb_offset,
-                                    uint8_t* par_address, uint16_t par_size)
-{
-    MB_SLAVE_ASSERT(slave_interface_ptr != NULL);
-    mb_slave_options_t* mbs_opts = &slave_interface_ptr->opts;
-    esp_err_t error = ESP_FAIL;
-    mb_param_info_t par_info;
-    // Check if queue is not full the send parameter information
-    par_info.type = par_type;
-    par_info.size = par_size;
-    par_info.address = par_address;
-    par_info.time_stamp = mbc_slave_get_time_stamp();
-    par_info.mb_offset = mb_offset;
-    BaseType_t status = xQueueSend(mbs_opts->mbs_notification_queue_handle, &par_info, MB_PAR_INFO_TOUT);
-    if (pdTRUE == status) {
-        ESP_LOGD(TAG, "Queue send parameter info (type, address, size): %d, 0x%" PRIx32 ", %u",
-                    (int)par_type, (uint32_t)par_address, (unsigned)par_size);
-        error = ESP_OK;
-    } else if (errQUEUE_FULL == status) {
-        ESP_LOGD(TAG, "Parameter queue is overflowed.");
+static esp_err_t mbc_slave_send_param_info(mb_slave_options_t* mbs_opts, mb_event_group_t par_type,
+                                    uint16_t mb_offset, uint8_t* par_address, uint16_t par_size)
+{
+    mb_param_ring_t* ring = &mbs_opts->mbs_notify_ring;
+    if (!ring->entries
+        || !(atomic_load_explicit(&ring->event_mask, memory_order_relaxed) & (unsigned)par_type)) {
+        return ESP_OK;
     }
-    return error;
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    unsigned pending = head - tail;
+    // Merge the access into the pending entry of the same area if the consumer did not take it yet
+    for (unsigned i = 1; (i <= pending) && (i <= MB_NOTIFY_COALESCE_DEPTH); i++) {
+        mb_param_ring_entry_t* entry = &ring->entries[(head - i) & ring->mask];
+        if ((entry->info.type == par_type) && (entry->info.mb_offset == mb_offset)
+            && (entry->info.address == par_address) && (entry->info.size == par_size)) {
+            unsigned hits = atomic_load_explicit(&entry->hits, memory_order_relaxed);
+            while (hits && !atomic_compare_exchange_weak_explicit(&entry->hits, &hits, hits + 1,
+                                                    memory_order_relaxed, memory_order_relaxed)) {
+            }
+            if (hits) {
+                atomic_fetch_add_explicit(&ring->coalesced, 1, memory_order_relaxed);
+                return ESP_OK;
+            }
+            break;
+        }
+    }
+    if (pending > ring->mask) {
+        atomic_fetch_add_explicit(&ring->overflows, 1, memory_order_relaxed);
+        ESP_LOGD(TAG, "Parameter notification ring is overflowed.");
+        return ESP_FAIL;
+    }
+    mb_param_ring_entry_t* entry = &ring->entries[head & ring->mask];
+    entry->info.type = par_type;
+    entry->info.size = par_size;
+    entry->info.address = par_address;
+    entry->info.time_stamp = mbc_slave_get_time_stamp();
+    entry->info.mb_offset = mb_offset;
+    atomic_store_explicit(&entry->hits, 1, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    atomic_fetch_add_explicit(&ring->queued, 1, memory_order_relaxed);
+    (void)xSemaphoreGive(ring->ready);
+    ESP_LOGD(TAG, "Ring put parameter info (type, address, size): %d, 0x%" PRIx32 ", %u",
+                (int)par_type, (uint32_t)par_address, (unsigned)par_size);
+    return ESP_OK;
 }
 
 // Helper function to send notification
-static esp_err_t mbc_slave_send_param_access_notification(mb_event_group_t event)
+static esp_err_t mbc_slave_send_param_access_notification(mb_slave_options_t* mbs_opts, mb_event_group_t event)
 {
-    MB_SLAVE_ASSERT(slave_interface_ptr != NULL);
-    mb_slave_options_t* mbs_opts = &slave_interface_ptr->opts;
     esp_err_t err = ESP_FAIL;
+    if (!(atomic_load_explicit(&mbs_opts->mbs_notify_ring.event_mask, memory_order_relaxed) & (unsigned)event)) {
+        return ESP_OK;
+    }
     mb_event_group_t bits = (mb_event_group_t)xEventGroupSetBits(mbs_opts->mbs_event_group, (EventBits_t)event);
     if (bits & event) {
         ESP_LOGD(TAG, "The MB_REG_CHANGE_EVENT = 0x%.2x is set.", (int)event);
@@ -275,141 +676,229 @@ static esp_err_t mbc_slave_send_param_access_notification(mb_event_group_t event
     return err;
 }
 
+// Transfers the registers of the area between the request buffer and the area values.
+// The raw areas are swap copied as a block, the typed ones are converted per value,
+// the values partially covered by the request are converted through a temporary buffer.
+static void mbc_slave_copy_regs(const mb_descr_entry_t* descr, uint16_t reg_offset,
+                                    UCHAR* reg_buffer, uint16_t n_regs, eMBRegisterMode mode)
+{
+    uint8_t* reg_data = (uint8_t*)descr->p_data + (reg_offset << 1);
+    if ((descr->elem_size == 2) && (descr->word_order == MB_WORD_ORDER_ABCD)) {
+        if (mode == MB_REG_READ) {
+            mb_swap_copy_regs(reg_buffer, reg_data, n_regs);
+        } else {
+            mb_swap_copy_regs(reg_data, reg_buffer, n_regs);
+        }
+        return;
+    }
+    uint16_t elem_regs = descr->elem_size >> 1;
+    uint16_t skip = reg_offset % elem_regs;
+    uint8_t* elem_data = reg_data - (skip << 1);
+    uint8_t temp[sizeof(uint64_t)];
+    while (n_regs > 0) {
+        if (!skip && (n_regs >= elem_regs)) {
+            size_t count = n_regs / elem_regs;
+            size_t bytes = count * descr->elem_size;
+            if (mode == MB_REG_READ) {
+                mb_set_regs_ordered(reg_buffer, elem_data, count, descr->elem_size, descr->word_order);
+            } else {
+                mb_get_regs_ordered(elem_data, reg_buffer, count, descr->elem_size, descr->word_order);
+            }
+            reg_buffer += bytes;
+            elem_data += bytes;
+            n_regs -= (uint16_t)(count * elem_regs);
+        } else {
+            uint16_t regs = ((elem_regs - skip) < n_regs) ? (elem_regs - skip) : n_regs;
+            mb_set_regs_ordered(temp, elem_data, 1, descr->elem_size, descr->word_order);
+            if (mode == MB_REG_READ) {
+                memcpy(reg_buffer, &temp[skip << 1], regs << 1);
+            } else {
+                memcpy(&temp[skip << 1], reg_buffer, regs << 1);
+                mb_get_regs_ordered(elem_data, temp, 1, descr->elem_size, descr->word_order);
+            }
+            reg_buffer += (regs << 1);
+            elem_data += descr->elem_size;
+            n_regs -= regs;
+            skip = 0;
+        }
+    }
+}
+
+// The shared areas are written under the sequence lock and read again if a write has interrupted the copy
+static void mbc_slave_xfer_regs(const mb_descr_entry_t* descr, uint16_t reg_offset,
+                                    UCHAR* reg_buffer, uint16_t n_regs, eMBRegisterMode mode)
+{
+    if (!descr->seqlock) {
+        mbc_slave_copy_regs(descr, reg_offset, reg_buffer, n_regs, mode);
+    } else if (mode == MB_REG_READ) {
+        uint32_t seq;
+        do {
+            seq = mb_seqlock_read_begin(descr->seqlock);
+            mbc_slave_copy_regs(descr, reg_offset, reg_buffer, n_regs, mode);
+        } while (mb_seqlock_read_retry(descr->seqlock, seq));
+    } else {
+        mb_seqlock_write_begin(descr->seqlock);
+        mbc_slave_copy_regs(descr, reg_offset, reg_buffer, n_regs, mode);
+        mb_seqlock_write_end(descr->seqlock);
+    }
+}
+
+// Transfers the registers of a request spanning several adjacent areas. The unmapped registers
+// between the areas are read as the fill value if enabled, the writes must be covered by the areas.
+static eMBErrorCode mbc_slave_gather_regs(mb_slave_options_t* mbs_opts, mb_param_type_t type,
+                                            mb_event_group_t event, UCHAR* reg_buffer, uint16_t address,
+                                            uint16_t n_regs, eMBRegisterMode mode)
+{
+    const mb_descr_index_t* index = &mbs_opts->mbs_descr_index[type];
+    const mb_gap_fill_t* gap_fill = &mbs_opts->mbs_gap_fill[type];
+    uint32_t end = (uint32_t)address + n_regs;
+
+    if (!mbs_opts->mbs_descr_frozen || !index->count || !n_regs) {
+        return MB_ENOREG;
+    }
+    // The first range which ends above the address
+    uint32_t first = mbc_slave_index_upper(index, address);
+    if (first && (index->ranges[first - 1].end > address)) {
+        first--;
+    }
+    // Check the whole request before any register is transferred
+    uint32_t pos = address;
+    uint16_t areas = 0;
+    for (uint32_t i = first; pos < end; ) {
+        if ((i < index->count) && (index->ranges[i].start <= pos)) {
+            pos = index->ranges[i++].end;
+            areas++;
+        } else {
+            // Only the gaps between two areas are filled
+            if ((mode != MB_REG_READ) || !gap_fill->enable || !i || (i >= index->count)) {
+                return MB_ENOREG;
+            }
+            pos = index->ranges[i].start;
+        }
+    }
+    if (!areas) {
+        return MB_ENOREG;
+    }
+    pos = address;
+    for (uint32_t i = first; pos < end; ) {
+        if ((i < index->count) && (index->ranges[i].start <= pos)) {
+            const mb_descr_range_t* range = &index->ranges[i++];
+            uint32_t seg_end = (range->end < end) ? range->end : end;
+            uint16_t regs = (uint16_t)(seg_end - pos);
+            uint8_t* buffer_start = (uint8_t*)range->descr->p_data + ((pos - range->start) << 1);
+            mbc_slave_xfer_regs(range->descr, (uint16_t)(pos - range->start), reg_buffer, regs, mode);
+            reg_buffer += (regs << 1);
+            (void)mbc_slave_send_param_info(mbs_opts, event, (uint16_t)pos, buffer_start, regs);
+            pos = seg_end;
+        } else {
+            uint32_t gap_end = (index->ranges[i].start < end) ? index->ranges[i].start : end;
+            for (; pos < gap_end; pos++) {
+                *reg_buffer++ = (UCHAR)(gap_fill->value >> 8);
+                *reg_buffer++ = (UCHAR)(gap_fill->value & 0xFF);
+            }
+        }
+    }
+    (void)mbc_slave_send_param_access_notification(mbs_opts, event);
+    return MB_ENOERR;
+}
+
 /*
  * Below are the common slave read/write register callback functions
  * The concrete slave port can override them using interface function pointers
  */
 
 // Callback function for reading of MB Input Registers
-eMBErrorCode mbc_reg_input_slave_cb(UCHAR * reg_buffer, USHORT address, USHORT n_regs)
+static eMBErrorCode mbc_reg_input_slave_cb(mb_slave_options_t* mbs_opts, UCHAR * reg_buffer, USHORT address, USHORT n_regs)
 {
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
-                    MB_EILLSTATE, "Slave stack uninitialized.");
     MB_SLAVE_CHECK((reg_buffer != NULL),
                     MB_EINVAL, "Slave stack call failed.");
     eMBErrorCode status = MB_ENOERR;
     address--; // address of register is already +1
-    mb_descr_entry_t* it = mbc_slave_find_reg_descriptor(MB_PARAM_INPUT, address, n_regs);
+    mb_descr_entry_t* it = mbc_slave_find_reg_descriptor(mbs_opts, MB_PARAM_INPUT, address, n_regs);
     if (it != NULL) {
         uint16_t input_reg_start = (uint16_t)it->start_offset; // Get Modbus start address
-        uint8_t* input_buffer = (uint8_t*)it->p_data; // Get instance address
-        uint16_t regs = n_regs;
-        uint16_t reg_index;
-        // If input or configuration parameters are incorrect then return an error to stack layer
-        reg_index = (uint16_t)(address - input_reg_start);
-        reg_index <<= 1; // register Address to byte address
-        input_buffer += reg_index;
-        uint8_t* buffer_start = input_buffer;
-        while (regs > 0) {
-            _XFER_2_RD(reg_buffer, input_buffer);
-            reg_index += 2;
-            regs -= 1;
-        }
+        uint16_t reg_index = (uint16_t)(address - input_reg_start);
+        uint8_t* buffer_start = (uint8_t*)it->p_data + (reg_index << 1); // register Address to byte address
+        mbc_slave_xfer_regs(it, reg_index, reg_buffer, n_regs, MB_REG_READ);
         // Send access notification
-        (void)mbc_slave_send_param_access_notification(MB_EVENT_INPUT_REG_RD);
+        (void)mbc_slave_send_param_access_notification(mbs_opts, MB_EVENT_INPUT_REG_RD);
         // Send parameter info to application task
-        (void)mbc_slave_send_param_info(MB_EVENT_INPUT_REG_RD, (uint16_t)address,
+        (void)mbc_slave_send_param_info(mbs_opts, MB_EVENT_INPUT_REG_RD, (uint16_t)address,
                         (uint8_t*)buffer_start, (uint16_t)n_regs);
     } else {
-        status = MB_ENOREG;
+        // The request can span several adjacent areas
+        status = mbc_slave_gather_regs(mbs_opts, MB_PARAM_INPUT, MB_EVENT_INPUT_REG_RD,
+                                        reg_buffer, address, n_regs, MB_REG_READ);
     }
     return status;
 }
 
 // Callback function for reading of MB Holding Registers
 // Executed by stack when request to read/write holding registers is received
-eMBErrorCode mbc_reg_holding_slave_cb(UCHAR * reg_buffer, USHORT address, USHORT n_regs, eMBRegisterMode mode)
+static eMBErrorCode mbc_reg_holding_slave_cb(mb_slave_options_t* mbs_opts, UCHAR * reg_buffer, USHORT address, USHORT n_regs, eMBRegisterMode mode)
 {
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
-                    MB_EILLSTATE, "Slave stack uninitialized.");
     MB_SLAVE_CHECK((reg_buffer != NULL),
                     MB_EINVAL, "Slave stack call failed.");
     eMBErrorCode status = MB_ENOERR;
     uint16_t reg_index;
     address--; // address of register is already +1
-    mb_descr_entry_t* it = mbc_slave_find_reg_descriptor(MB_PARAM_HOLDING, address, n_regs);
+    mb_descr_entry_t* it = mbc_slave_find_reg_descriptor(mbs_opts, MB_PARAM_HOLDING, address, n_regs);
     if (it != NULL) {
         uint16_t reg_holding_start = (uint16_t)it->start_offset; // Get Modbus start address
-        uint8_t* holding_buffer = (uint8_t*)it->p_data; // Get instance address
-        uint16_t regs = n_regs;
         reg_index = (uint16_t) (address - reg_holding_start);
-        reg_index <<= 1; // register Address to byte address
-        holding_buffer += reg_index;
-        uint8_t* buffer_start = holding_buffer;
+        uint8_t* buffer_start = (uint8_t*)it->p_data + (reg_index << 1); // register Address to byte address
+        mbc_slave_xfer_regs(it, reg_index, reg_buffer, n_regs, mode);
         switch (mode) {
             case MB_REG_READ:
-                while (regs > 0) {
-                    _XFER_2_RD(reg_buffer, holding_buffer);
-                    reg_index += 2;
-                    regs -= 1;
-                };
                 // Send access notification
-                (void)mbc_slave_send_param_access_notification(MB_EVENT_HOLDING_REG_RD);
+                (void)mbc_slave_send_param_access_notification(mbs_opts, MB_EVENT_HOLDING_REG_RD);
                 // Send parameter info
-                (void)mbc_slave_send_param_info(MB_EVENT_HOLDING_REG_RD, (uint16_t)address,
+                (void)mbc_slave_send_param_info(mbs_opts, MB_EVENT_HOLDING_REG_RD, (uint16_t)address,
                                 (uint8_t*)buffer_start, (uint16_t)n_regs);
                 break;
             case MB_REG_WRITE:
-                while (regs > 0) {
-                    _XFER_2_WR(holding_buffer, reg_buffer);
-                    holding_buffer += 2;
-                    reg_index += 2;
-                    regs -= 1;
-                };
                 // Send access notification
-                (void)mbc_slave_send_param_access_notification(MB_EVENT_HOLDING_REG_WR);
+                (void)mbc_slave_send_param_access_notification(mbs_opts, MB_EVENT_HOLDING_REG_WR);
                 // Send parameter info
-                (void)mbc_slave_send_param_info(MB_EVENT_HOLDING_REG_WR, (uint16_t)address,
+                (void)mbc_slave_send_param_info(mbs_opts, MB_EVENT_HOLDING_REG_WR, (uint16_t)address,
                                 (uint8_t*)buffer_start, (uint16_t)n_regs);
                 break;
         }
     } else {
-        status = MB_ENOREG;
+        // The request can span several adjacent areas
+        status = mbc_slave_gather_regs(mbs_opts, MB_PARAM_HOLDING,
+                                        (mode == MB_REG_READ) ? MB_EVENT_HOLDING_REG_RD : MB_EVENT_HOLDING_REG_WR,
+                                        reg_buffer, address, n_regs, mode);
     }
     return status;
 }
 
 // Callback function for reading of MB Coils Registers
-eMBErrorCode mbc_reg_coils_slave_cb(UCHAR* reg_buffer, USHORT address, USHORT n_coils, eMBRegisterMode mode)
+static eMBErrorCode mbc_reg_coils_slave_cb(mb_slave_options_t* mbs_opts, UCHAR* reg_buffer, USHORT address, USHORT n_coils, eMBRegisterMode mode)
 {
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
-                    MB_EILLSTATE, "Slave stack uninitialized.");
     MB_SLAVE_CHECK((reg_buffer != NULL),
                     MB_EINVAL, "Slave stack call failed.");
     eMBErrorCode status = MB_ENOERR;
     uint16_t reg_index;
-    uint16_t coils = n_coils;
     address--; // The address is already +1
-    mb_descr_entry_t* it = mbc_slave_find_reg_descriptor(MB_PARAM_COIL, address, n_coils);
+    mb_descr_entry_t* it = mbc_slave_find_reg_descriptor(mbs_opts, MB_PARAM_COIL, address, n_coils);
     if (it != NULL) {
-        uint16_t reg_coils_start = (uint16_t)it->start_offset; // MB offset of coils
         uint8_t* reg_coils_buf = (uint8_t*)it->p_data;
         reg_index = (uint16_t) (address - it->start_offset);
         CHAR* coils_data_buf = (CHAR*)(reg_coils_buf + (reg_index >> 3));
         switch (mode) {
             case MB_REG_READ:
-                while (coils > 0) {
-                    uint8_t result = xMBUtilGetBits((uint8_t*)reg_coils_buf, reg_index, 1);
-                    xMBUtilSetBits(reg_buffer, reg_index - (address - reg_coils_start), 1, result);
-                    reg_index++;
-                    coils--;
-                }
+                vMBUtilCopyBits(reg_buffer, 0, reg_coils_buf, reg_index, n_coils);
                 // Send an event to notify application task about event
-                (void)mbc_slave_send_param_access_notification(MB_EVENT_COILS_RD);
-                (void)mbc_slave_send_param_info(MB_EVENT_COILS_RD, (uint16_t)address,
+                (void)mbc_slave_send_param_access_notification(mbs_opts, MB_EVENT_COILS_RD);
+                (void)mbc_slave_send_param_info(mbs_opts, MB_EVENT_COILS_RD, (uint16_t)address,
                                 (uint8_t*)(coils_data_buf), (uint16_t)n_coils);
                 break;
             case MB_REG_WRITE:
-                while (coils > 0) {
-                    uint8_t result = xMBUtilGetBits(reg_buffer,
-                            reg_index - (address - reg_coils_start), 1);
-                    xMBUtilSetBits((uint8_t*)reg_coils_buf, reg_index, 1, result);
-                    reg_index++;
-                    coils--;
-                }
+                vMBUtilCopyBits(reg_coils_buf, reg_index, reg_buffer, 0, n_coils);
                 // Send an event to notify application task about event
-                (void)mbc_slave_send_param_access_notification(MB_EVENT_COILS_WR);
-                (void)mbc_slave_send_param_info(MB_EVENT_COILS_WR, (uint16_t)address,
+                (void)mbc_slave_send_param_access_notification(mbs_opts, MB_EVENT_COILS_WR);
+                (void)mbc_slave_send_param_info(mbs_opts, MB_EVENT_COILS_WR, (uint16_t)address,
                                 (uint8_t*)coils_data_buf, (uint16_t)n_coils);
                 break;
         } // switch ( eMode )
@@ -421,42 +910,25 @@ eMBErrorCode mbc_reg_coils_slave_cb(UCHAR* reg_buffer, USHORT address, USHORT n_
 }
 
 // Callback function for reading of MB Discrete Input Registers
-eMBErrorCode mbc_reg_discrete_slave_cb(UCHAR* reg_buffer, USHORT address, USHORT n_discrete)
+static eMBErrorCode mbc_reg_discrete_slave_cb(mb_slave_options_t* mbs_opts, UCHAR* reg_buffer, USHORT address, USHORT n_discrete)
 {
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
-                    MB_EILLSTATE, "Slave stack uninitialized.");
     MB_SLAVE_CHECK((reg_buffer != NULL),
                     MB_EINVAL, "Slave stack call failed.");
 
     eMBErrorCode status = MB_ENOERR;
     uint16_t reg_index;
-    uint16_t reg_bit_index;
-    uint16_t n_reg;
     uint8_t* discrete_input_buf;
     // It already plus one in modbus function method.
     address--;
-    mb_descr_entry_t* it = mbc_slave_find_reg_descriptor(MB_PARAM_DISCRETE, address, n_discrete);
+    mb_descr_entry_t* it = mbc_slave_find_reg_descriptor(mbs_opts, MB_PARAM_DISCRETE, address, n_discrete);
     if (it != NULL) {
-        uint16_t reg_discrete_start = (uint16_t)it->start_offset; // MB offset of registers
-        n_reg = (n_discrete >> 3) + 1;
         discrete_input_buf = (uint8_t*)it->p_data; // the storage address
-        reg_index = (uint16_t) (address - reg_discrete_start) / 8; // Get register index in the buffer for bit number
-        reg_bit_index = (uint16_t)(address - reg_discrete_start) % 8; // Get bit index
-        uint8_t* temp_buf = &discrete_input_buf[reg_index];
-        while (n_reg > 0) {
-            *reg_buffer++ = xMBUtilGetBits(&discrete_input_buf[reg_index++], reg_bit_index, 8);
-            n_reg--;
-        }
-        reg_buffer--;
-        // Last discrete
-        n_discrete = n_discrete % 8;
-        // Filling zero to high bit
-        *reg_buffer = *reg_buffer << (8 - n_discrete);
-        *reg_buffer = *reg_buffer >> (8 - n_discrete);
+        reg_index = (uint16_t)(address - it->start_offset); // Get bit number in the buffer
+        vMBUtilCopyBits(reg_buffer, 0, discrete_input_buf, reg_index, n_discrete);
         // Send an event to notify application task about event
-        (void)mbc_slave_send_param_access_notification(MB_EVENT_DISCRETE_RD);
-        (void)mbc_slave_send_param_info(MB_EVENT_DISCRETE_RD, (uint16_t)address,
-                            (uint8_t*)temp_buf, (uint16_t)n_discrete);
+        (void)mbc_slave_send_param_access_notification(mbs_opts, MB_EVENT_DISCRETE_RD);
+        (void)mbc_slave_send_param_info(mbs_opts, MB_EVENT_DISCRETE_RD, (uint16_t)address,
+                            &discrete_input_buf[reg_index >> 3], (uint16_t)n_discrete);
     } else {
         status = MB_ENOREG;
     }
@@ -469,14 +941,15 @@ eMBErrorCode mbc_reg_discrete_slave_cb(UCHAR* reg_buffer, USHORT address, USHORT
 eMBErrorCode eMBRegDiscreteCB(UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNDiscrete)
 {
     eMBErrorCode error = MB_ENOERR;
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
+    mb_slave_interface_t* iface = mbc_slave_get_exec_iface();
+    MB_SLAVE_CHECK((iface != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
     // Check if the callback is overridden in concrete port
-    if (slave_interface_ptr->slave_reg_cb_discrete) {
-        error = slave_interface_ptr->slave_reg_cb_discrete(pucRegBuffer, usAddress, usNDiscrete);
+    if (iface->slave_reg_cb_discrete) {
+        error = iface->slave_reg_cb_discrete(pucRegBuffer, usAddress, usNDiscrete);
     } else {
-        error = mbc_reg_discrete_slave_cb(pucRegBuffer, usAddress, usNDiscrete);
+        error = mbc_reg_discrete_slave_cb(&iface->opts, pucRegBuffer, usAddress, usNDiscrete);
     }
 
     return error;
@@ -486,14 +959,15 @@ eMBErrorCode eMBRegCoilsCB(UCHAR* pucRegBuffer, USHORT usAddress,
                             USHORT usNCoils, eMBRegisterMode eMode)
 {
     eMBErrorCode error = MB_ENOERR;
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
+    mb_slave_interface_t* iface = mbc_slave_get_exec_iface();
+    MB_SLAVE_CHECK((iface != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
 
-    if (slave_interface_ptr->slave_reg_cb_coils) {
-        error = slave_interface_ptr->slave_reg_cb_coils(pucRegBuffer, usAddress, usNCoils, eMode);
+    if (iface->slave_reg_cb_coils) {
+        error = iface->slave_reg_cb_coils(pucRegBuffer, usAddress, usNCoils, eMode);
     } else {
-        error = mbc_reg_coils_slave_cb(pucRegBuffer, usAddress, usNCoils, eMode);
+        error = mbc_reg_coils_slave_cb(&iface->opts, pucRegBuffer, usAddress, usNCoils, eMode);
     }
     return error;
 }
@@ -502,14 +976,15 @@ eMBErrorCode eMBRegHoldingCB(UCHAR * pucRegBuffer, USHORT usAddress,
                                 USHORT usNRegs, eMBRegisterMode eMode)
 {
     eMBErrorCode error = MB_ENOERR;
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
+    mb_slave_interface_t* iface = mbc_slave_get_exec_iface();
+    MB_SLAVE_CHECK((iface != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
 
-    if (slave_interface_ptr->slave_reg_cb_holding) {
-        error = slave_interface_ptr->slave_reg_cb_holding(pucRegBuffer, usAddress, usNRegs, eMode);
+    if (iface->slave_reg_cb_holding) {
+        error = iface->slave_reg_cb_holding(pucRegBuffer, usAddress, usNRegs, eMode);
     } else {
-        error = mbc_reg_holding_slave_cb(pucRegBuffer, usAddress, usNRegs, eMode);
+        error = mbc_reg_holding_slave_cb(&iface->opts, pucRegBuffer, usAddress, usNRegs, eMode);
     }
     return error;
 }
@@ -517,14 +992,15 @@ eMBErrorCode eMBRegHoldingCB(UCHAR * pucRegBuffer, USHORT usAddress,
 eMBErrorCode eMBRegInputCB(UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs)
 {
     eMBErrorCode error = ESP_ERR_INVALID_STATE;
-    MB_SLAVE_CHECK((slave_interface_ptr != NULL),
+    mb_slave_interface_t* iface = mbc_slave_get_exec_iface();
+    MB_SLAVE_CHECK((iface != NULL),
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
 
-    if (slave_interface_ptr->slave_reg_cb_input) {
-        error = slave_interface_ptr->slave_reg_cb_input(pucRegBuffer, usAddress, usNRegs);
+    if (iface->slave_reg_cb_input) {
+        error = iface->slave_reg_cb_input(pucRegBuffer, usAddress, usNRegs);
     } else {
-        error = mbc_reg_input_slave_cb(pucRegBuffer, usAddress, usNRegs);
+        error = mbc_reg_input_slave_cb(&iface->opts, pucRegBuffer, usAddress, usNRegs);
     }
     return error;
 }
@@ -344,6 +344,16 @@ esp_err_t mbc_master_set_param_data(void* dest, void* src, mb_descr_type_t param
 */
 esp_err_t mbc_master_get_transaction_info(mb_trans_info_t *ptinfo);
 
+/**
+ * @brief Set the time the master waits for the response of the next requests
+ *
+ * @param[in] timeout_ms response timeout in milliseconds, 0 restores CONFIG_FMB_MASTER_TIMEOUT_MS_RESPOND
+ *
+ * @return
+ *     - esp_err_t ESP_OK - the timeout is applied to the next requests
+*/
+esp_err_t mbc_master_set_response_timeout(uint32_t timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 /**
  * @brief Defines the constant values based on native compiler byte ordering.
@@ -32,6 +33,36 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Element types of the typed register areas
+ */
+typedef enum {
+    MB_ELEM_U16 = 0,                        /*!< Unsigned 16-bit value, one register (raw register area) */
+    MB_ELEM_I16,                            /*!< Signed 16-bit value, one register */
+    MB_ELEM_U32,                            /*!< Unsigned 32-bit value, two registers */
+    MB_ELEM_I32,                            /*!< Signed 32-bit value, two registers */
+    MB_ELEM_FLOAT,                          /*!< IEEE754 single precision value, two registers */
+    MB_ELEM_U64,                            /*!< Unsigned 64-bit value, four registers */
+    MB_ELEM_I64,                            /*!< Signed 64-bit value, four registers */
+    MB_ELEM_DOUBLE,                         /*!< IEEE754 double precision value, four registers */
+    MB_ELEM_COUNT
+} mb_elem_type_t;
+
+/**
+ * @brief Order of the value bytes in the registers as transferred over the wire.
+ *
+ * The letters name the value bytes from the most significant one (A), the 64-bit values
+ * use the same rules (ABCDEFGH, GHEFCDAB, BADCFEHG, HGFEDCBA). The 16-bit values are sent
+ * big endian with ABCD and CDAB and little endian with BADC and DCBA.
+ */
+typedef enum {
+    MB_WORD_ORDER_ABCD = 0,                 /*!< Big endian registers in big endian order */
+    MB_WORD_ORDER_CDAB,                     /*!< Big endian registers, the least significant register first */
+    MB_WORD_ORDER_BADC,                     /*!< Byte swapped registers in big endian order */
+    MB_WORD_ORDER_DCBA,                     /*!< Little endian value */
+    MB_WORD_ORDER_COUNT
+} mb_word_order_t;
+
 /**
  * @brief The sized array types used for mapping of extended values
  */
@@ -551,6 +582,48 @@ uint64_t mb_get_uint64_badcfehg(val_64_arr *pui);
  */
 uint64_t mb_set_uint64_badcfehg(val_64_arr *pui, uint64_t ui);
 
+/**
+ * @brief Get the size of the element type in bytes
+ *
+ * @return
+ *     - the size of element (2, 4 or 8), 0 if the type is incorrect
+ */
+uint8_t mb_get_elem_size(mb_elem_type_t type);
+
+/**
+ * @brief Copy the registers swapping the bytes of each one (native to big endian and back)
+ *
+ * Two registers are processed per step, the buffers can have any alignment and
+ * must not overlap unless they are the same buffer.
+ *
+ * @param pdest destination buffer, count * 2 bytes
+ * @param psrc source buffer, count * 2 bytes
+ * @param count number of registers
+ */
+void mb_swap_copy_regs(uint8_t *pdest, const uint8_t *psrc, size_t count);
+
+/**
+ * @brief Convert native values to the register bytes in the wire order
+ *
+ * @param pregs destination register bytes, count * elem_size bytes
+ * @param pvalues source native values, may be unaligned
+ * @param count number of values
+ * @param elem_size size of one value in bytes (2, 4 or 8)
+ * @param order word order of the values in the registers
+ */
+void mb_set_regs_ordered(uint8_t *pregs, const void *pvalues, size_t count, uint8_t elem_size, mb_word_order_t order);
+
+/**
+ * @brief Convert the register bytes in the wire order to native values
+ *
+ * @param pvalues destination native values, may be unaligned
+ * @param pregs source register bytes, count * elem_size bytes
+ * @param count number of values
+ * @param elem_size size of one value in bytes (2, 4 or 8)
+ * @param order word order of the values in the registers
+ */
+void mb_get_regs_ordered(void *pvalues, const uint8_t *pregs, size_t count, uint8_t elem_size, mb_word_order_t order);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: 2026 ModbusTCP project contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/lock.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sequence lock of the data shared by the Modbus stack and the application tasks
+ *
+ * The writers are serialized by the write lock and keep the sequence odd while the data changes.
+ * The readers copy the data without locking and repeat the copy if the sequence has changed,
+ * so a snapshot of several registers is always consistent. A reader which finds a write in
+ * progress waits on the write lock instead of spinning, so a preempted lower priority writer
+ * always completes.
+ *
+ * The zero initialized structure is ready to use.
+ */
+typedef struct {
+    uint32_t seq;                           /*!< Sequence counter, odd while a write is in progress */
+    _lock_t write_lock;                     /*!< Lock serializing the writers */
+} mb_seqlock_t;
+
+/**
+ * @brief Start the lock free read of the data
+ *
+ * @param[in] lock pointer to the sequence lock
+ *
+ * @return the sequence to pass to mb_seqlock_read_retry()
+ */
+static inline uint32_t mb_seqlock_read_begin(mb_seqlock_t *lock)
+{
+    uint32_t seq;
+    while ((seq = __atomic_load_n(&lock->seq, __ATOMIC_ACQUIRE)) & 1) {
+        // Wait until the writer releases the lock
+        _lock_acquire(&lock->write_lock);
+        _lock_release(&lock->write_lock);
+    }
+    return seq;
+}
+
+/**
+ * @brief Check whether the data read after mb_seqlock_read_begin() must be read again
+ *
+ * @param[in] lock pointer to the sequence lock
+ * @param[in] seq sequence returned by mb_seqlock_read_begin()
+ *
+ * @return true if the data was changed during the read
+ */
+static inline bool mb_seqlock_read_retry(mb_seqlock_t *lock, uint32_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (__atomic_load_n(&lock->seq, __ATOMIC_RELAXED) != seq);
+}
+
+/**
+ * @brief Start the change of the data, the readers retry until mb_seqlock_write_end()
+ *
+ * @param[in] lock pointer to the sequence lock
+ */
+static inline void mb_seqlock_write_begin(mb_seqlock_t *lock)
+{
+    _lock_acquire(&lock->write_lock);
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Complete the change of the data
+ *
+ * @param[in] lock pointer to the sequence lock
+ */
+static inline void mb_seqlock_write_end(mb_seqlock_t *lock)
+{
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELEASE);
+    _lock_release(&lock->write_lock);
+}
+
+#ifdef __cplusplus
+}
+#endif
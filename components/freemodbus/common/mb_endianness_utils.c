@@ -5,7 +5,9 @@
  */
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
+#include "sdkconfig.h"
 #include "mb_endianness_utils.h"
 
 #define INLINE inline __attribute__((always_inline))
@@ -681,3 +683,113 @@ uint64_t ui;
 {
     return mb_set_uint64_generic(1, 0, 3, 2, 5, 4, 7, 6, pui, ui);
 }
+
+#define MB_SWAP_BYTES_32 0x00FF00FFUL
+#define MB_SWAP_BYTES_64 0x00FF00FF00FF00FFULL
+
+// Swaps the bytes inside of each 16-bit word of the value
+static INLINE uint32_t mb_swap_words_bytes32(uint32_t val)
+{
+    return ((val & MB_SWAP_BYTES_32) << 8) | ((val >> 8) & MB_SWAP_BYTES_32);
+}
+
+static INLINE uint64_t mb_swap_words_bytes64(uint64_t val)
+{
+    return ((val & MB_SWAP_BYTES_64) << 8) | ((val >> 8) & MB_SWAP_BYTES_64);
+}
+
+void mb_swap_copy_regs(uint8_t *pdest, const uint8_t *psrc, size_t count)
+{
+    size_t words = count >> 1;
+    uint32_t val;
+    // Indexed loops over fixed base pointers, so the compiler can also vectorize them
+    if (!(((uintptr_t)pdest | (uintptr_t)psrc) & 3)) {
+        // Both buffers are word aligned, two registers per step
+        const uint8_t *psrc_al = __builtin_assume_aligned(psrc, 4);
+        uint8_t *pdest_al = __builtin_assume_aligned(pdest, 4);
+        for (size_t i = 0; i < words; i++) {
+            memcpy(&val, &psrc_al[i << 2], sizeof(val));
+            val = mb_swap_words_bytes32(val);
+            memcpy(&pdest_al[i << 2], &val, sizeof(val));
+        }
+    } else {
+        for (size_t i = 0; i < words; i++) {
+            memcpy(&val, &psrc[i << 2], sizeof(val));
+            val = mb_swap_words_bytes32(val);
+            memcpy(&pdest[i << 2], &val, sizeof(val));
+        }
+    }
+    psrc += (words << 2);
+    pdest += (words << 2);
+    if (count & 1) {
+        uint8_t byte = psrc[0];
+        pdest[0] = psrc[1];
+        pdest[1] = byte;
+    }
+}
+
+// The byte permutation of every word order is its own inverse,
+// so the same conversion is used in both directions
+static void mb_convert_ordered(uint8_t *pdest, const uint8_t *psrc, size_t count, uint8_t elem_size, mb_word_order_t order)
+{
+    if ((order == MB_WORD_ORDER_DCBA) || ((elem_size == 2) && (order == MB_WORD_ORDER_BADC))) {
+        // Native little endian layout is sent as is
+        memmove(pdest, psrc, count * elem_size);
+        return;
+    }
+    switch (elem_size) {
+        case 2:
+            mb_swap_copy_regs(pdest, psrc, count);
+            break;
+        case 4:
+            for (size_t i = 0; i < count; i++, psrc += 4, pdest += 4) {
+                uint32_t val;
+                memcpy(&val, psrc, sizeof(val));
+                if (order == MB_WORD_ORDER_ABCD) {
+                    val = __builtin_bswap32(val);
+                } else if (order == MB_WORD_ORDER_CDAB) {
+                    val = mb_swap_words_bytes32(val);
+                } else {
+                    val = (val << 16) | (val >> 16);
+                }
+                memcpy(pdest, &val, sizeof(val));
+            }
+            break;
+        case 8:
+            for (size_t i = 0; i < count; i++, psrc += 8, pdest += 8) {
+                uint64_t val;
+                memcpy(&val, psrc, sizeof(val));
+                if (order == MB_WORD_ORDER_ABCD) {
+                    val = __builtin_bswap64(val);
+                } else if (order == MB_WORD_ORDER_CDAB) {
+                    val = mb_swap_words_bytes64(val);
+                } else {
+                    val = mb_swap_words_bytes64(__builtin_bswap64(val));
+                }
+                memcpy(pdest, &val, sizeof(val));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+uint8_t mb_get_elem_size(mb_elem_type_t type)
+{
+    static const uint8_t elem_sizes[MB_ELEM_COUNT] = {
+        [MB_ELEM_U16] = 2, [MB_ELEM_I16] = 2,
+        [MB_ELEM_U32] = 4, [MB_ELEM_I32] = 4, [MB_ELEM_FLOAT] = 4,
+        [MB_ELEM_U64] = 8, [MB_ELEM_I64] = 8, [MB_ELEM_DOUBLE] = 8
+    };
+    return ((unsigned)type < MB_ELEM_COUNT) ? elem_sizes[type] : 0;
+}
+
+void mb_set_regs_ordered(uint8_t *pregs, const void *pvalues, size_t count, uint8_t elem_size, mb_word_order_t order)
+{
+    mb_convert_ordered(pregs, (const uint8_t *)pvalues, count, elem_size, order);
+}
+
+void mb_get_regs_ordered(void *pvalues, const uint8_t *pregs, size_t count, uint8_t elem_size, mb_word_order_t order)
+{
+    mb_convert_ordered((uint8_t *)pvalues, pregs, count, elem_size, order);
+}
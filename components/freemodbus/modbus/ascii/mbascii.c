@@ -76,10 +76,6 @@ typedef enum
     BYTE_LOW_NIBBLE             /*!< Character for low nibble of byte. */
 } eMBBytePos;
 
-/* ----------------------- Shared variables ---------------------------------*/
-/* We reuse the Modbus RTU buffer because only one driver is active */
-extern volatile UCHAR ucMbSlaveBuf[];
-
 /* ----------------------- Static functions ---------------------------------*/
 static UCHAR    prvucMBCHAR2BIN( UCHAR ucCharacter );
 
@@ -91,7 +87,8 @@ static UCHAR    prvucMBLRC( UCHAR * pucFrame, USHORT usLen );
 static volatile eMBSndState eSndState;
 static volatile eMBRcvState eRcvState;
 
-static volatile UCHAR *ucASCIIBuf = ucMbSlaveBuf;
+/* The frame buffer of the instance, as the RTU one. */
+static volatile UCHAR *ucASCIIBuf;
 
 static volatile USHORT usRcvBufferPos;
 static volatile eMBBytePos eBytePos;
@@ -102,14 +99,19 @@ static volatile USHORT usSndBufferCount;
 static volatile UCHAR ucLRC;
 static volatile UCHAR ucMBLFCharacter;
 
+/* The stack instance the transport is bound to. */
+static xMBHandle xASCIIHdl = NULL;
+
 /* ----------------------- Start implementation -----------------------------*/
 eMBErrorCode
-eMBASCIIInit( UCHAR ucSlaveAddress, UCHAR ucPort, ULONG ulBaudRate, eMBParity eParity )
+eMBASCIIInit( xMBHandle xHdl, UCHAR ucSlaveAddress, UCHAR ucPort, ULONG ulBaudRate, eMBParity eParity )
 {
     eMBErrorCode    eStatus = MB_ENOERR;
     ( void )ucSlaveAddress;
 
     ENTER_CRITICAL_SECTION(  );
+    xASCIIHdl = xHdl;
+    ucASCIIBuf = pucMBSerialBuf( xHdl );
     ucMBLFCharacter = MB_ASCII_DEFAULT_LF;
 
     if( xMBPortSerialInit( ucPort, ulBaudRate, MB_ASCII_BITS_PER_SYMB, eParity ) != TRUE )
@@ -135,7 +137,7 @@ eMBASCIIStart( void )
     EXIT_CRITICAL_SECTION(  );
 
     /* No special startup required for ASCII. */
-    ( void )xMBPortEventPost( EV_READY );
+    ( void )xMBEventPost( xASCIIHdl, EV_READY );
 }
 
 void
@@ -306,7 +308,7 @@ xMBASCIIReceiveFSM( void )
 
             /* Notify the caller of eMBASCIIReceive that a new frame
              * was received. */
-            (void)xMBPortEventPost( EV_FRAME_RECEIVED );
+            (void)xMBEventPost( xASCIIHdl, EV_FRAME_RECEIVED );
         }
         else if( ucByte == ':' )
         {
@@ -402,7 +404,7 @@ xMBASCIITransmitFSM( void )
          * been sent. */
     case STATE_TX_NOTIFY:
         eSndState = STATE_TX_IDLE;
-        xMBPortEventPost( EV_FRAME_TRANSMIT );
+        xMBEventPost( xASCIIHdl, EV_FRAME_TRANSMIT );
         xNeedPoll = FALSE;
         break;
 
@@ -50,7 +50,7 @@ PR_BEGIN_EXTERN_C
 /* ----------------------- Function declaration -----------------------------*/
 
 #if MB_SLAVE_ASCII_ENABLED > 0
-eMBErrorCode    eMBASCIIInit( UCHAR slaveAddress, UCHAR ucPort,
+eMBErrorCode    eMBASCIIInit( xMBHandle xHdl, UCHAR slaveAddress, UCHAR ucPort,
                               ULONG ulBaudRate, eMBParity eParity );
 void            eMBASCIIStart( void );
 void            eMBASCIIStop( void );
@@ -108,6 +108,9 @@ eMBFuncReadDiscreteInputs( UCHAR * pucFrame, USHORT * usLen )
             *pucFrameCur++ = ucNBytes;
             *usLen += 1;
 
+            /* The callback copies the bits only, clear the unused ones. */
+            pucFrameCur[ucNBytes - 1] = 0;
+
             eRegStatus =
                 eMBRegDiscreteCB( pucFrameCur, usRegAddress, usDiscreteCnt );
 
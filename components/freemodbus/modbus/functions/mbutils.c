@@ -48,6 +48,85 @@
 
 /* ----------------------- Defines ------------------------------------------*/
 #define BITS_UCHAR      8U
+#define BITS_WORD       32U
+
+/* ----------------------- Static functions ---------------------------------*/
+
+/* Loads four bytes as the little endian word, the first bit is the LSB. */
+static inline uint32_t
+prvulMBUtilLoadWord( const UCHAR * pucBuf )
+{
+    uint32_t        ulValue;
+#if defined( __BYTE_ORDER__ ) && ( __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ )
+    memcpy( &ulValue, pucBuf, sizeof( ulValue ) );
+#else
+    ulValue = ( uint32_t )pucBuf[0] | ( ( uint32_t )pucBuf[1] << 8 ) |
+        ( ( uint32_t )pucBuf[2] << 16 ) | ( ( uint32_t )pucBuf[3] << 24 );
+#endif
+    return ulValue;
+}
+
+static inline void
+prvvMBUtilStoreWord( UCHAR * pucBuf, uint32_t ulValue )
+{
+#if defined( __BYTE_ORDER__ ) && ( __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ )
+    memcpy( pucBuf, &ulValue, sizeof( ulValue ) );
+#else
+    pucBuf[0] = ( UCHAR )ulValue;
+    pucBuf[1] = ( UCHAR )( ulValue >> 8 );
+    pucBuf[2] = ( UCHAR )( ulValue >> 16 );
+    pucBuf[3] = ( UCHAR )( ulValue >> 24 );
+#endif
+}
+
+/* Reads 32 bits starting at any bit offset. Only the bytes holding the bits
+ * are accessed, so the read never passes the end of the bit field. */
+static inline uint32_t
+prvulMBUtilReadWordBits( const UCHAR * pucBuf, ULONG ulBitOffset )
+{
+    const UCHAR    *pucByte = pucBuf + ( ulBitOffset / BITS_UCHAR );
+    UCHAR           ucShift = ( UCHAR )( ulBitOffset % BITS_UCHAR );
+    uint32_t        ulValue = prvulMBUtilLoadWord( pucByte );
+
+    if( ucShift != 0 )
+    {
+        ulValue = ( ulValue >> ucShift ) | ( ( uint32_t )pucByte[4] << ( BITS_WORD - ucShift ) );
+    }
+    return ulValue;
+}
+
+/* Reads up to 8 bits starting at any bit offset. */
+static inline UCHAR
+prvucMBUtilReadBits( const UCHAR * pucBuf, ULONG ulBitOffset, UCHAR ucNBits )
+{
+    const UCHAR    *pucByte = pucBuf + ( ulBitOffset / BITS_UCHAR );
+    UCHAR           ucShift = ( UCHAR )( ulBitOffset % BITS_UCHAR );
+    USHORT          usValue = pucByte[0];
+
+    if( ( ucShift + ucNBits ) > BITS_UCHAR )
+    {
+        usValue |= ( USHORT )( pucByte[1] << BITS_UCHAR );
+    }
+    return ( UCHAR )( ( usValue >> ucShift ) & ( ( 1U << ucNBits ) - 1 ) );
+}
+
+/* Writes up to 8 bits starting at any bit offset, the other bits are kept. */
+static inline void
+prvvMBUtilWriteBits( UCHAR * pucBuf, ULONG ulBitOffset, UCHAR ucNBits, UCHAR ucValue )
+{
+    UCHAR          *pucByte = pucBuf + ( ulBitOffset / BITS_UCHAR );
+    UCHAR           ucShift = ( UCHAR )( ulBitOffset % BITS_UCHAR );
+    USHORT          usMask = ( USHORT )( ( ( 1U << ucNBits ) - 1 ) << ucShift );
+    USHORT          usValue = ( USHORT )( ucValue << ucShift );
+
+    pucByte[0] = ( UCHAR )( ( pucByte[0] & ~usMask ) | ( usValue & usMask ) );
+    if( ( ucShift + ucNBits ) > BITS_UCHAR )
+    {
+        usMask >>= BITS_UCHAR;
+        usValue >>= BITS_UCHAR;
+        pucByte[1] = ( UCHAR )( ( pucByte[1] & ~usMask ) | ( usValue & usMask ) );
+    }
+}
 
 /* ----------------------- Start implementation -----------------------------*/
 void
@@ -120,6 +199,49 @@ xMBUtilGetBits( UCHAR * ucByteBuf, USHORT usBitOffset, UCHAR ucNBits )
     return ( UCHAR ) usWordBuf;
 }
 
+void
+vMBUtilCopyBits( UCHAR * pucDst, USHORT usDstOffset, const UCHAR * pucSrc,
+                 USHORT usSrcOffset, USHORT usNBits )
+{
+    ULONG           ulSrcOffset = usSrcOffset;
+    UCHAR           ucNHead;
+
+    /* Bring the destination to the byte boundary, the words are stored aligned
+     * to it and the source bits are shifted into place while loading. */
+    ucNHead = ( UCHAR )( ( BITS_UCHAR - ( usDstOffset % BITS_UCHAR ) ) % BITS_UCHAR );
+    if( ucNHead > usNBits )
+    {
+        ucNHead = ( UCHAR )usNBits;
+    }
+    if( ucNHead != 0 )
+    {
+        prvvMBUtilWriteBits( pucDst, usDstOffset, ucNHead,
+                             prvucMBUtilReadBits( pucSrc, ulSrcOffset, ucNHead ) );
+        ulSrcOffset += ucNHead;
+        usNBits -= ucNHead;
+    }
+    pucDst += ( usDstOffset + ucNHead ) / BITS_UCHAR;
+
+    while( usNBits >= BITS_WORD )
+    {
+        prvvMBUtilStoreWord( pucDst, prvulMBUtilReadWordBits( pucSrc, ulSrcOffset ) );
+        pucDst += sizeof( uint32_t );
+        ulSrcOffset += BITS_WORD;
+        usNBits -= BITS_WORD;
+    }
+    while( usNBits >= BITS_UCHAR )
+    {
+        *pucDst++ = prvucMBUtilReadBits( pucSrc, ulSrcOffset, BITS_UCHAR );
+        ulSrcOffset += BITS_UCHAR;
+        usNBits -= BITS_UCHAR;
+    }
+    if( usNBits != 0 )
+    {
+        prvvMBUtilWriteBits( pucDst, 0, ( UCHAR )usNBits,
+                             prvucMBUtilReadBits( pucSrc, ulSrcOffset, ( UCHAR )usNBits ) );
+    }
+}
+
 eMBException
 prveMBError2Exception( eMBErrorCode eErrorCode )
 {
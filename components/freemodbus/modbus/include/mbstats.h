@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: 2026 ModbusTCP project contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// mbstats.h
+// Request latency histograms of the Modbus slave stack
+
+#ifndef _MB_STATS_H
+#define _MB_STATS_H
+
+#include <stdint.h>
+#include "port.h"
+#include "mbconfig.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+
+/* ----------------------- Defines ------------------------------------------*/
+
+// Number of log2 buckets of the histogram, the bucket N counts the latencies of
+// [2^(N-1), 2^N) microseconds, the last one collects everything above 2^(N-1)
+#define MB_STATS_BUCKETS            (22)
+
+// Slot of the function codes without a dedicated histogram
+#define MB_STATS_FUNC_OTHER         (0)
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef enum {
+    MB_STATS_TRANSPORT_SERIAL = 0,  /*!< RTU and ASCII frames */
+    MB_STATS_TRANSPORT_TCP,         /*!< Modbus TCP frames */
+    MB_STATS_TRANSPORT_COUNT
+} eMBStatsTransport;
+
+typedef enum {
+    MB_STATS_STAGE_QUEUE = 0,       /*!< Frame received until the stack takes it */
+    MB_STATS_STAGE_EXEC,            /*!< Function code handler execution */
+    MB_STATS_STAGE_SEND,            /*!< Handler done until the response is sent */
+    MB_STATS_STAGE_TOTAL,           /*!< Frame received until the response is sent */
+    MB_STATS_STAGE_COUNT
+} eMBStatsStage;
+
+typedef struct {
+    ULONG ulCount;                  /*!< Number of the recorded requests */
+    ULONG ulP50Us;                  /*!< Median latency, upper bound of the bucket */
+    ULONG ulP99Us;                  /*!< 99th percentile latency, upper bound of the bucket */
+    ULONG ulMaxUs;                  /*!< Maximum latency */
+} xMBStatsSummary;
+
+/* ----------------------- Function prototypes ------------------------------*/
+#if MB_STATS_ENABLED
+
+/**
+ * Current time stamp in microseconds used for the latency measurements
+ */
+int64_t xMBStatsTimeStamp(void);
+
+/**
+ * Set the time stamp of the frame posted to the stack by the port,
+ * called by the port right before the EV_FRAME_RECEIVED event is posted
+ *
+ * @param eTransport transport of the frame
+ * @param xTimeStamp time the frame was completely received
+ */
+void vMBStatsFrameReceived(eMBStatsTransport eTransport, int64_t xTimeStamp);
+
+/**
+ * Take the receive time stamp set by the port
+ *
+ * @param eTransport transport of the frame
+ * @param xDefault value returned if the port did not set the time stamp
+ *
+ * @return receive time stamp of the current frame
+ */
+int64_t xMBStatsTakeReceived(eMBStatsTransport eTransport, int64_t xDefault);
+
+/**
+ * Record the processed request, the function does not allocate memory
+ *
+ * @param eTransport transport of the request
+ * @param ucFunctionCode function code of the request
+ * @param xReceived frame received time stamp
+ * @param xDispatched frame taken by the stack time stamp
+ * @param xExecuted handler done time stamp
+ * @param xSent response sent time stamp
+ */
+void vMBStatsRecord(eMBStatsTransport eTransport, UCHAR ucFunctionCode, int64_t xReceived,
+                        int64_t xDispatched, int64_t xExecuted, int64_t xSent);
+
+/**
+ * Get the summary of the histogram
+ *
+ * @param eTransport transport of the requests
+ * @param ucFunctionCode function code, the codes without the dedicated histogram
+ *                       share the MB_STATS_FUNC_OTHER one
+ * @param eStage processing stage
+ * @param pxSummary pointer to the summary
+ *
+ * @return TRUE if the arguments are correct
+ */
+BOOL xMBStatsGetSummary(eMBStatsTransport eTransport, UCHAR ucFunctionCode,
+                            eMBStatsStage eStage, xMBStatsSummary* pxSummary);
+
+/**
+ * Get the function codes which have the dedicated histograms
+ *
+ * @param pucFunctionCodes pointer to set to the list of function codes
+ *
+ * @return number of function codes in the list
+ */
+USHORT usMBStatsGetFunctions(const UCHAR** pucFunctionCodes);
+
+/**
+ * Clear all histograms
+ */
+void vMBStatsReset(void);
+
+#endif
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -107,6 +107,29 @@ void            xMBUtilSetBits( UCHAR * ucByteBuf, USHORT usBitOffset,
 UCHAR           xMBUtilGetBits( UCHAR * ucByteBuf, USHORT usBitOffset,
                                 UCHAR ucNBits );
 
+/*! \brief Function to copy a range of bits between byte buffers.
+ *
+ * The bits are copied 32 at a time, both offsets can be any bit position,
+ * so the function also shifts a bit field to a new position. The bits of the
+ * destination outside of the range are kept and only the bytes holding the
+ * bits of the range are accessed in both buffers. The buffers must not
+ * overlap.
+ *
+ * \param pucDst A buffer where the bits are copied to.
+ * \param usDstOffset The offset of the first bit in the destination buffer.
+ * \param pucSrc A buffer where the bits are copied from.
+ * \param usSrcOffset The offset of the first bit in the source buffer.
+ * \param usNBits Number of bits to copy.
+ *
+ * \code
+ * // Pack 2000 coils starting at the bit 5 of the storage to the response.
+ * vMBUtilCopyBits( pucFrameCur, 0, ucCoils, 5, 2000 );
+ * \endcode
+ */
+void            vMBUtilCopyBits( UCHAR * pucDst, USHORT usDstOffset,
+                                 const UCHAR * pucSrc, USHORT usSrcOffset,
+                                 USHORT usNBits );
+
 /*! @} */
 
 #ifdef __cplusplus
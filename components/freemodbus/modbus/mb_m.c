@@ -124,39 +124,39 @@ BOOL( *pxMBMasterFrameCBReceiveFSMCur ) ( void );
 
 BOOL( *pxMBMasterFrameCBTransmitFSMCur ) ( void );
 
-/* An array of Modbus functions handlers which associates Modbus function
- * codes with implementing functions.
+/* The Modbus function handlers indexed by the function code, so the handler
+ * of a request is found with a single lookup. Unsupported codes are NULL.
  */
-static xMBFunctionHandler xMasterFuncHandlers[MB_FUNC_HANDLERS_MAX] = {
+static pxMBFunctionHandler xMasterFuncHandlers[MB_FUNC_TABLE_SIZE] = {
 #if MB_FUNC_OTHER_REP_SLAVEID_ENABLED > 0
-    {MB_FUNC_OTHER_REPORT_SLAVEID, eMBMasterFuncReportSlaveID},
+    [MB_FUNC_OTHER_REPORT_SLAVEID] = eMBMasterFuncReportSlaveID,
 #endif
 #if MB_FUNC_READ_INPUT_ENABLED > 0
-    {MB_FUNC_READ_INPUT_REGISTER, eMBMasterFuncReadInputRegister},
+    [MB_FUNC_READ_INPUT_REGISTER] = eMBMasterFuncReadInputRegister,
 #endif
 #if MB_FUNC_READ_HOLDING_ENABLED > 0
-    {MB_FUNC_READ_HOLDING_REGISTER, eMBMasterFuncReadHoldingRegister},
+    [MB_FUNC_READ_HOLDING_REGISTER] = eMBMasterFuncReadHoldingRegister,
 #endif
 #if MB_FUNC_WRITE_MULTIPLE_HOLDING_ENABLED > 0
-    {MB_FUNC_WRITE_MULTIPLE_REGISTERS, eMBMasterFuncWriteMultipleHoldingRegister},
+    [MB_FUNC_WRITE_MULTIPLE_REGISTERS] = eMBMasterFuncWriteMultipleHoldingRegister,
 #endif
 #if MB_FUNC_WRITE_HOLDING_ENABLED > 0
-    {MB_FUNC_WRITE_REGISTER, eMBMasterFuncWriteHoldingRegister},
+    [MB_FUNC_WRITE_REGISTER] = eMBMasterFuncWriteHoldingRegister,
 #endif
 #if MB_FUNC_READWRITE_HOLDING_ENABLED > 0
-    {MB_FUNC_READWRITE_MULTIPLE_REGISTERS, eMBMasterFuncReadWriteMultipleHoldingRegister},
+    [MB_FUNC_READWRITE_MULTIPLE_REGISTERS] = eMBMasterFuncReadWriteMultipleHoldingRegister,
 #endif
 #if MB_FUNC_READ_COILS_ENABLED > 0
-    {MB_FUNC_READ_COILS, eMBMasterFuncReadCoils},
+    [MB_FUNC_READ_COILS] = eMBMasterFuncReadCoils,
 #endif
 #if MB_FUNC_WRITE_COIL_ENABLED > 0
-    {MB_FUNC_WRITE_SINGLE_COIL, eMBMasterFuncWriteCoil},
+    [MB_FUNC_WRITE_SINGLE_COIL] = eMBMasterFuncWriteCoil,
 #endif
 #if MB_FUNC_WRITE_MULTIPLE_COILS_ENABLED > 0
-    {MB_FUNC_WRITE_MULTIPLE_COILS, eMBMasterFuncWriteMultipleCoils},
+    [MB_FUNC_WRITE_MULTIPLE_COILS] = eMBMasterFuncWriteMultipleCoils,
 #endif
 #if MB_FUNC_READ_DISCRETE_INPUTS_ENABLED > 0
-    {MB_FUNC_READ_DISCRETE_INPUTS, eMBMasterFuncReadDiscreteInputs},
+    [MB_FUNC_READ_DISCRETE_INPUTS] = eMBMasterFuncReadDiscreteInputs,
 #endif
 };
 
@@ -344,8 +344,8 @@ eMBMasterDisable( void )
 eMBErrorCode
 eMBMasterPoll( void )
 {
-    int                     i;
     int                     j;
+    pxMBFunctionHandler     pxHandler;
     eMBErrorCode            eStatus = MB_ENOERR;
     xMBMasterEventType      xEvent;
     eMBMasterErrorEventType errorType = EV_ERROR_INIT;
@@ -432,30 +432,23 @@ eMBMasterPoll( void )
                     if (ucFunctionCode & MB_FUNC_ERROR) {
                         eException = (eMBException)pucMBRecvFrame[MB_PDU_DATA_OFF];
                     } else {
-                        for ( i = 0; i < MB_FUNC_HANDLERS_MAX; i++ )
-                        {
-                            /* No more function handlers registered. Abort. */
-                            if (xMasterFuncHandlers[i].ucFunctionCode == 0) {
-                                break;
-                            }
-                            if (xMasterFuncHandlers[i].ucFunctionCode == ucFunctionCode) {
-                                vMBMasterSetCBRunInMasterMode(TRUE);
-                                /* If master request is broadcast,
-                                * the master need execute function for all slave.
-                                */
-                                if ( xMBMasterRequestIsBroadcast() ) {
-                                    USHORT usLength = usMBMasterGetPDUSndLength();
-                                    for(j = 1; j <= MB_MASTER_TOTAL_SLAVE_NUM; j++)
-                                    {
-                                        vMBMasterSetDestAddress(j);
-                                        eException = xMasterFuncHandlers[i].pxHandler(pucMBRecvFrame, &usLength);
-                                    }
-                                } else {
-                                    eException = xMasterFuncHandlers[i].pxHandler(pucMBRecvFrame, &usRecvLength);
+                        pxHandler = xMasterFuncHandlers[ucFunctionCode];
+                        if (pxHandler != NULL) {
+                            vMBMasterSetCBRunInMasterMode(TRUE);
+                            /* If master request is broadcast,
+                            * the master need execute function for all slave.
+                            */
+                            if ( xMBMasterRequestIsBroadcast() ) {
+                                USHORT usLength = usMBMasterGetPDUSndLength();
+                                for(j = 1; j <= MB_MASTER_TOTAL_SLAVE_NUM; j++)
+                                {
+                                    vMBMasterSetDestAddress(j);
+                                    eException = pxHandler(pucMBRecvFrame, &usLength);
                                 }
-                                vMBMasterSetCBRunInMasterMode( FALSE );
-                                break;
+                            } else {
+                                eException = pxHandler(pucMBRecvFrame, &usRecvLength);
                             }
+                            vMBMasterSetCBRunInMasterMode( FALSE );
                         }
                     }
                     /* If master has exception, will send error process event. Otherwise the master is idle.*/
@@ -49,6 +49,7 @@
 
 #include "mbcrc.h"
 #include "mbport.h"
+#include "mbstats.h"
 
 #if MB_SLAVE_RTU_ENABLED > 0
 
@@ -67,9 +68,6 @@ typedef enum
     STATE_TX_XMIT               /*!< Transmitter is in transfer state. */
 } eMBSndState;
 
-/* ----------------------- Shared variables ---------------------------------*/
-extern volatile UCHAR ucMbSlaveBuf[];
-
 /* ----------------------- Static variables ---------------------------------*/
 static volatile eMBSndState eSndState;
 static volatile eMBRcvState eRcvState;
@@ -78,17 +76,25 @@ static volatile UCHAR *pucSndBufferCur;
 static volatile USHORT usSndBufferCount;
 
 static volatile USHORT usRcvBufferPos;
-static volatile UCHAR *ucRTUBuf = ucMbSlaveBuf;
+static volatile UCHAR *ucRTUBuf;
+
+/* Running CRC16 of the received bytes, zero for a complete correct frame. */
+static volatile USHORT usRcvCRC16;
+
+/* The stack instance the transport is bound to. */
+static xMBHandle xRTUHdl = NULL;
 
 /* ----------------------- Start implementation -----------------------------*/
 eMBErrorCode
-eMBRTUInit( UCHAR ucSlaveAddress, UCHAR ucPort, ULONG ulBaudRate, eMBParity eParity )
+eMBRTUInit( xMBHandle xHdl, UCHAR ucSlaveAddress, UCHAR ucPort, ULONG ulBaudRate, eMBParity eParity )
 {
     eMBErrorCode    eStatus = MB_ENOERR;
     ULONG           usTimerT35_50us;
 
     ( void )ucSlaveAddress;
     ENTER_CRITICAL_SECTION(  );
+    xRTUHdl = xHdl;
+    ucRTUBuf = pucMBSerialBuf( xHdl );
 
     /* Modbus RTU uses 8 Databits. */
     if( xMBPortSerialInit( ucPort, ulBaudRate, 8, eParity ) != TRUE )
@@ -140,7 +146,7 @@ eMBRTUStart( void )
 #if CONFIG_FMB_TIMER_PORT_ENABLED
     vMBPortTimersEnable( );
 #else
-    pxMBPortCBTimerExpired();
+    ( void )xMBRTUTimerT35Expired(  );
 #endif
     EXIT_CRITICAL_SECTION(  );
 }
@@ -160,6 +166,7 @@ eMBRTUReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLength )
     eMBErrorCode    eStatus = MB_ENOERR;
     UCHAR          *pucMBRTUFrame = ( UCHAR* ) ucRTUBuf;
     USHORT          usFrameLength = usRcvBufferPos;
+    USHORT          usFrameCRC16;
 
     if( xMBPortSerialGetRequest( &pucMBRTUFrame, &usFrameLength ) == FALSE )
     {
@@ -169,9 +176,20 @@ eMBRTUReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLength )
     ENTER_CRITICAL_SECTION(  );
     assert( usFrameLength < MB_SER_PDU_SIZE_MAX );
 
+    /* The CRC is already calculated while the bytes arrive, the frame
+     * is recalculated only if the port has replaced the received one.
+     */
+    if( ( pucMBRTUFrame == ucRTUBuf ) && ( usFrameLength == usRcvBufferPos ) )
+    {
+        usFrameCRC16 = usRcvCRC16;
+    }
+    else
+    {
+        usFrameCRC16 = usMBCRC16( ( UCHAR * ) pucMBRTUFrame, usFrameLength );
+    }
+
     /* Length and CRC check */
-    if( ( usFrameLength >= MB_SER_PDU_SIZE_MIN )
-        && ( usMBCRC16( ( UCHAR * ) pucMBRTUFrame, usFrameLength ) == 0 ) )
+    if( ( usFrameLength >= MB_SER_PDU_SIZE_MIN ) && ( usFrameCRC16 == 0 ) )
     {
         /* Save the address field. All frames are passed to the upper layed
          * and the decision if a frame is used is done there.
@@ -275,6 +293,7 @@ xMBRTUReceiveFSM( void )
     case STATE_RX_IDLE:
         usRcvBufferPos = 0;
         ucRTUBuf[usRcvBufferPos++] = ucByte;
+        usRcvCRC16 = usMBCRC16UpdateByte( MB_CRC16_INIT, ucByte );
         eRcvState = STATE_RX_RCV;
 
         /* Enable t3.5 timers. */
@@ -291,6 +310,7 @@ xMBRTUReceiveFSM( void )
         {
             if( xStatus ) {
                 ucRTUBuf[usRcvBufferPos++] = ucByte;
+                usRcvCRC16 = usMBCRC16UpdateByte( usRcvCRC16, ucByte );
             }
         }
         else
@@ -304,6 +324,46 @@ xMBRTUReceiveFSM( void )
     return xStatus;
 }
 
+BOOL
+xMBRTUReceiveFrame( const UCHAR * pucData, USHORT usLength )
+{
+    if ( eSndState != STATE_TX_IDLE  ) {
+        return FALSE;
+    }
+
+    switch ( eRcvState )
+    {
+        /* The bytes of the startup phase and of a damaged frame are dropped,
+         * the t3.5 expiration below moves the receiver to the idle state.
+         */
+    case STATE_RX_INIT:
+    case STATE_RX_ERROR:
+        break;
+
+    case STATE_RX_IDLE:
+        usRcvBufferPos = 0;
+        usRcvCRC16 = MB_CRC16_INIT;
+        eRcvState = STATE_RX_RCV;
+        /* fall through */
+
+    case STATE_RX_RCV:
+        if( ( usRcvBufferPos + usLength ) <= MB_SER_PDU_SIZE_MAX )
+        {
+            memcpy( ( UCHAR * ) &ucRTUBuf[usRcvBufferPos], pucData, usLength );
+            usRcvCRC16 = usMBCRC16Update( usRcvCRC16, pucData, usLength );
+            usRcvBufferPos += usLength;
+        }
+        else
+        {
+            eRcvState = STATE_RX_ERROR;
+        }
+        break;
+    }
+
+    /* The port has already measured the t3.5 silence after the data. */
+    return xMBRTUTimerT35Expired(  );
+}
+
 BOOL
 xMBRTUTransmitFSM( void )
 {
@@ -330,7 +390,7 @@ xMBRTUTransmitFSM( void )
         }
         else
         {
-            xMBPortEventPost( EV_FRAME_TRANSMIT );
+            xMBEventPost( xRTUHdl, EV_FRAME_TRANSMIT );
             xNeedPoll = FALSE;
             eSndState = STATE_TX_IDLE;
             vMBPortTimersEnable(  );
@@ -345,18 +405,29 @@ BOOL MB_PORT_ISR_ATTR
 xMBRTUTimerT35Expired( void )
 {
     BOOL xNeedPoll = FALSE;
+    eMBRcvState eState = eRcvState;
 
-    switch ( eRcvState )
+    /* The receiver is idle before the event is posted: with the whole frame
+     * path this runs in the serial task, and the polling task may answer
+     * the frame before this function returns.
+     */
+    vMBPortTimersDisable(  );
+    eRcvState = STATE_RX_IDLE;
+
+    switch ( eState )
     {
         /* Timer t35 expired. Startup phase is finished. */
     case STATE_RX_INIT:
-        xNeedPoll = xMBPortEventPost( EV_READY );
+        xNeedPoll = xMBEventPost( xRTUHdl, EV_READY );
         break;
 
         /* A frame was received and t35 expired. Notify the listener that
          * a new frame was received. */
     case STATE_RX_RCV:
-        xNeedPoll = xMBPortEventPost( EV_FRAME_RECEIVED );
+#if MB_STATS_ENABLED
+        vMBStatsFrameReceived( MB_STATS_TRANSPORT_SERIAL, xMBStatsTimeStamp( ) );
+#endif
+        xNeedPoll = xMBEventPost( xRTUHdl, EV_FRAME_RECEIVED );
         break;
 
         /* An error occured while receiving the frame. */
@@ -365,12 +436,9 @@ xMBRTUTimerT35Expired( void )
 
         /* Function called in an illegal state. */
     default:
-        assert( ( eRcvState == STATE_RX_IDLE ) || ( eRcvState == STATE_RX_ERROR ) );
+        assert( ( eState == STATE_RX_IDLE ) || ( eState == STATE_RX_ERROR ) );
     }
 
-    vMBPortTimersDisable(  );
-    eRcvState = STATE_RX_IDLE;
-
     return xNeedPoll;
 }
 #endif
@@ -47,13 +47,14 @@ PR_BEGIN_EXTERN_C
 #define MB_SER_PDU_SIZE_MIN     4       /*!< Minimum size of a Modbus RTU frame. */
 
 #if MB_SLAVE_RTU_ENABLED
-eMBErrorCode eMBRTUInit( UCHAR slaveAddress, UCHAR ucPort, ULONG ulBaudRate,
-                             eMBParity eParity );
+eMBErrorCode eMBRTUInit( xMBHandle xHdl, UCHAR slaveAddress, UCHAR ucPort,
+                             ULONG ulBaudRate, eMBParity eParity );
 void            eMBRTUStart( void );
 void            eMBRTUStop( void );
 eMBErrorCode    eMBRTUReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLength );
 eMBErrorCode    eMBRTUSend( UCHAR slaveAddress, const UCHAR * pucFrame, USHORT usLength );
 BOOL            xMBRTUReceiveFSM( void );
+BOOL            xMBRTUReceiveFrame( const UCHAR * pucData, USHORT usLength );
 BOOL            xMBRTUTransmitFSM( void );
 BOOL            xMBRTUTimerT15Expired( void );
 BOOL            xMBRTUTimerT35Expired( void );
@@ -14,11 +14,20 @@
 #define CONFIG_FMB_EVENT_QUEUE_TIMEOUT             20
 #define CONFIG_FMB_CONTROLLER_NOTIFY_QUEUE_SIZE    20
 #define CONFIG_FMB_CONTROLLER_NOTIFY_TIMEOUT       20
+#define CONFIG_FMB_CONTROLLER_SLAVE_DESCR_PAGES    128
 
 /* TCP settings */
 #define CONFIG_FMB_TCP_PORT_DEFAULT                502
 #define CONFIG_FMB_TCP_PORT_MAX_CONN               16
 #define CONFIG_FMB_TCP_CONNECTION_TOUT_SEC         20
+#define CONFIG_FMB_TCP_PIPELINE_DEPTH              4
+#define CONFIG_FMB_TCP_LRU_EVICT_IDLE_MS           1000
+#define CONFIG_FMB_TCP_KEEPALIVE_IDLE_SEC          5
+#define CONFIG_FMB_TCP_KEEPALIVE_INTVL_SEC         2
+#define CONFIG_FMB_TCP_KEEPALIVE_COUNT             3
+
+/* RTU CRC16 */
+#define CONFIG_FMB_CRC16_BYTEWISE                  1
 
 /* Timer settings */
 #define CONFIG_FMB_TIMER_USE_ISR_DISPATCH_METHOD   1
@@ -91,8 +91,44 @@
 #define MB_TCP_READ_TIMEOUT             (pdMS_TO_TICKS(MB_TCP_READ_TIMEOUT_MS))
 #define MB_TCP_SEND_TIMEOUT_MS          (500) // send event timeout in mS
 #define MB_TCP_SEND_TIMEOUT             (pdMS_TO_TICKS(MB_TCP_SEND_TIMEOUT_MS))
+#define MB_TCP_RESP_TIMEOUT_MS          (CONFIG_FMB_MASTER_TIMEOUT_MS_RESPOND - 1) // slave response time limit
 #define MB_TCP_PORT_MAX_CONN            (CONFIG_FMB_TCP_PORT_MAX_CONN)
 
+// Number of MBAP transactions queued per client while the stack processes the previous one
+#ifdef CONFIG_FMB_TCP_PIPELINE_DEPTH
+#define MB_TCP_PIPELINE_DEPTH           (CONFIG_FMB_TCP_PIPELINE_DEPTH)
+#else
+#define MB_TCP_PIPELINE_DEPTH           (4)
+#endif
+#define MB_TCP_PIPELINE_POLL_MS         (10) // poll time of the clients with full transaction queue without the wake socket
+
+// Minimum idle time of the client replaced by the new connection when all slots are in use
+#ifdef CONFIG_FMB_TCP_LRU_EVICT_IDLE_MS
+#define MB_TCP_LRU_EVICT_IDLE_MS        (CONFIG_FMB_TCP_LRU_EVICT_IDLE_MS)
+#else
+#define MB_TCP_LRU_EVICT_IDLE_MS        (1000)
+#endif
+
+// Keepalive of the client connections, the idle time 0 disables keepalive
+#ifdef CONFIG_FMB_TCP_KEEPALIVE_IDLE_SEC
+#define MB_TCP_KEEPALIVE_IDLE_SEC       (CONFIG_FMB_TCP_KEEPALIVE_IDLE_SEC)
+#else
+#define MB_TCP_KEEPALIVE_IDLE_SEC       (5)
+#endif
+#ifdef CONFIG_FMB_TCP_KEEPALIVE_INTVL_SEC
+#define MB_TCP_KEEPALIVE_INTVL_SEC      (CONFIG_FMB_TCP_KEEPALIVE_INTVL_SEC)
+#else
+#define MB_TCP_KEEPALIVE_INTVL_SEC      (2)
+#endif
+#ifdef CONFIG_FMB_TCP_KEEPALIVE_COUNT
+#define MB_TCP_KEEPALIVE_COUNT          (CONFIG_FMB_TCP_KEEPALIVE_COUNT)
+#else
+#define MB_TCP_KEEPALIVE_COUNT          (3)
+#endif
+
+// Receive ring of the client, holds several coalesced frames read out by one recv()
+#define MB_TCP_RX_RING_SIZE             (MB_TCP_BUF_SIZE * 2)
+
 // Set the API unlock time to maximum response time
 // The actual release time will be dependent on the timer time
 #define MB_MAX_RESPONSE_TIME_MS         (5000)
@@ -198,6 +234,16 @@ typedef enum {
     MB_PORT_IPV6 = 1                      /*!< TCP IPV6 addressing */
 } eMBPortIpVer;
 
+// The events of the slave stack instance are the bits of the notification value
+// of the task which polls it, the task is known on its first wait.
+struct xMBPortEventStruct {
+    portMUX_TYPE xLock;             /*!< Lock of the fields shared with the posting tasks and ISRs */
+    TaskHandle_t xTask;             /*!< Task which polls the stack instance */
+    uint32_t ulEventsEarly;         /*!< Events posted before the task is known */
+    uint32_t ulEventsPending;       /*!< Events taken by the task and not returned yet */
+    BOOL xInit;                     /*!< The channel accepts the events */
+};
+
 typedef struct {
     esp_timer_handle_t xTimerIntHandle;
     USHORT usT35Ticks;
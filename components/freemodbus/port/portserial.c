@@ -62,6 +62,11 @@ static UCHAR ucUartNumber = UART_NUM_MAX - 1;
 static BOOL bRxStateEnabled = FALSE; // Receiver enabled flag
 static BOOL bTxStateEnabled = FALSE; // Transmitter enabled flag
 
+#if !CONFIG_FMB_TIMER_PORT_ENABLED
+// The bytes received before the TOUT event (T3.5 silence), passed to the stack as one frame
+static UCHAR ucRxFrameBuf[MB_SERIAL_BUF_SIZE];
+#endif
+
 void vMBPortSerialEnable(BOOL bRxEnable, BOOL bTxEnable)
 {
     // This function can be called from xMBRTUTransmitFSM() of different task
@@ -84,17 +89,33 @@ static USHORT usMBPortSerialRxPoll(size_t xEventSize)
 {
     BOOL xReadStatus = TRUE;
     USHORT usCnt = 0;
+    xMBSerialFrameCB* pxFrameCB = pxMBSerialFrameCB();
 
+    if (!pxFrameCB) {
+        return 0;
+    }
+#if !CONFIG_FMB_TIMER_PORT_ENABLED
+    // The UART TOUT has measured the T3.5 time, so the whole frame is read at once
+    if (bRxStateEnabled && pxFrameCB->pxFrameReceived) {
+        size_t xFrameSize = (xEventSize < sizeof(ucRxFrameBuf)) ? xEventSize : sizeof(ucRxFrameBuf);
+        int xReadSize = uart_read_bytes(ucUartNumber, ucRxFrameBuf, xFrameSize, 0);
+        usCnt = (xReadSize > 0) ? (USHORT)xReadSize : 0;
+        uart_flush_input(ucUartNumber);
+        (void)pxFrameCB->pxFrameReceived(ucRxFrameBuf, usCnt);
+        ESP_LOGD(TAG, "RX frame: %u bytes\n", (unsigned)usCnt);
+        return usCnt;
+    }
+#endif
     if (bRxStateEnabled) {
         // Get received packet into Rx buffer
         while(xReadStatus && (usCnt++ <= xEventSize)) {
             // Call the Modbus stack callback function and let it fill the buffers.
-            xReadStatus = pxMBFrameCBByteReceived(); // callback to execute receive FSM
+            xReadStatus = pxFrameCB->pxByteReceived(); // callback to execute receive FSM
         }
         uart_flush_input(ucUartNumber);
         // Send event EV_FRAME_RECEIVED to allow stack process packet
 #if !CONFIG_FMB_TIMER_PORT_ENABLED
-        pxMBPortCBTimerExpired();
+        pxFrameCB->pxTimerExpired();
 #endif
         ESP_LOGD(TAG, "RX: %u bytes\n", (unsigned)usCnt);
     }
@@ -105,12 +126,13 @@ BOOL xMBPortSerialTxPoll(void)
 {
     USHORT usCount = 0;
     BOOL bNeedPoll = TRUE;
+    xMBSerialFrameCB* pxFrameCB = pxMBSerialFrameCB();
 
-    if( bTxStateEnabled ) {
+    if( bTxStateEnabled && pxFrameCB ) {
         // Continue while all response bytes put in buffer or out of buffer
         while((bNeedPoll) && (usCount++ < MB_SERIAL_BUF_SIZE)) {
             // Calls the modbus stack callback function to let it fill the UART transmit buffer.
-            bNeedPoll = pxMBFrameCBTransmitterEmpty( ); // callback to transmit FSM
+            bNeedPoll = pxFrameCB->pxTransmitterEmpty( ); // callback to transmit FSM
         }
         ESP_LOGD(TAG, "MB_TX_buffer send: (%u) bytes\n", (unsigned)usCount);
         // Waits while UART sending the packet
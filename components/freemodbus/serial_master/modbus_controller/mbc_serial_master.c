@@ -517,10 +517,7 @@ eMBErrorCode eMBRegInputCBSerialMaster(UCHAR * pucRegBuffer, USHORT usAddress,
     if ((pucInputBuffer != NULL)
             && (usNRegs >= 1)
             && ((usRegInputNregs == usRegs) || (!usAddress))) {
-        while (usRegs > 0) {
-            _XFER_2_RD(pucInputBuffer, pucRegBuffer);
-            usRegs -= 1;
-        }
+        mb_swap_copy_regs(pucInputBuffer, pucRegBuffer, usRegs);
     } else {
         eStatus = MB_ENOREG;
     }
@@ -558,17 +555,10 @@ eMBErrorCode eMBRegHoldingCBSerialMaster(UCHAR * pucRegBuffer, USHORT usAddress,
             && (usNRegs >= 1)) {
         switch (eMode) {
             case MB_REG_WRITE:
-                while (usRegs > 0) {
-                    _XFER_2_RD(pucRegBuffer, pucHoldingBuffer);
-                    usRegs -= 1;
-                };
+                mb_swap_copy_regs(pucRegBuffer, pucHoldingBuffer, usRegs);
                 break;
             case MB_REG_READ:
-                while (usRegs > 0) {
-                    _XFER_2_WR(pucHoldingBuffer, pucRegBuffer);
-                    pucHoldingBuffer += 2;
-                    usRegs -= 1;
-                };
+                mb_swap_copy_regs(pucHoldingBuffer, pucRegBuffer, usRegs);
                 break;
         }
     } else {
@@ -599,29 +589,16 @@ eMBErrorCode eMBRegCoilsCBSerialMaster(UCHAR* pucRegBuffer, USHORT usAddress,
     USHORT usRegCoilNregs = (USHORT)mbm_opts->mbm_reg_buffer_size;
     UCHAR* pucRegCoilsBuf = (UCHAR*)mbm_opts->mbm_reg_buffer_ptr;
     eMBErrorCode eStatus = MB_ENOERR;
-    USHORT iRegIndex;
-    USHORT usCoils = usNCoils;
     usAddress--; // The address is already + 1
     if ((usRegCoilNregs >= 1)
             && (pucRegCoilsBuf != NULL)
             && (usNCoils == usRegCoilNregs)) {
-        iRegIndex = (usAddress % 8);
         switch (eMode) {
             case MB_REG_WRITE:
-                while (usCoils > 0) {
-                    UCHAR ucResult = xMBUtilGetBits(pucRegCoilsBuf, iRegIndex - (usAddress % 8), 1);
-                    xMBUtilSetBits(pucRegBuffer, iRegIndex - (usAddress % 8) , 1, ucResult);
-                    iRegIndex++;
-                    usCoils--;
-                }
+                vMBUtilCopyBits(pucRegBuffer, 0, pucRegCoilsBuf, 0, usNCoils);
                 break;
             case MB_REG_READ:
-                while (usCoils > 0) {
-                    UCHAR ucResult = xMBUtilGetBits(pucRegBuffer, iRegIndex - (usAddress % 8), 1);
-                    xMBUtilSetBits(pucRegCoilsBuf, iRegIndex - (usAddress % 8), 1, ucResult);
-                    iRegIndex++;
-                    usCoils--;
-                }
+                vMBUtilCopyBits(pucRegCoilsBuf, 0, pucRegBuffer, 0, usNCoils);
                 break;
         } // switch ( eMode )
     } else {
@@ -652,28 +629,12 @@ eMBErrorCode eMBRegDiscreteCBSerialMaster(UCHAR * pucRegBuffer, USHORT usAddress
     USHORT usRegDiscreteNregs = (USHORT)mbm_opts->mbm_reg_buffer_size;
     UCHAR* pucRegDiscreteBuf = (UCHAR*)mbm_opts->mbm_reg_buffer_ptr;
     eMBErrorCode eStatus = MB_ENOERR;
-    USHORT iRegBitIndex, iNReg;
-    UCHAR* pucDiscreteInputBuf;
-    iNReg = usNDiscrete / 8 + 1;
-    pucDiscreteInputBuf = (UCHAR*) pucRegDiscreteBuf;
     // It is already plus one in Modbus function method.
     usAddress--;
     if ((usRegDiscreteNregs >= 1)
             && (pucRegDiscreteBuf != NULL)
             && (usNDiscrete >= 1)) {
-        iRegBitIndex = (USHORT)(usAddress) % 8; // Get bit index
-        while (iNReg > 1)
-        {
-            xMBUtilSetBits(pucDiscreteInputBuf++, iRegBitIndex - (usAddress % 8), 8, *pucRegBuffer++);
-            iNReg--;
-        }
-        // last discrete
-        usNDiscrete = usNDiscrete % 8;
-        // xMBUtilSetBits has bug when ucNBits is zero
-        if (usNDiscrete != 0)
-        {
-            xMBUtilSetBits(pucDiscreteInputBuf, iRegBitIndex - (usAddress % 8), usNDiscrete, *pucRegBuffer++);
-        }
+        vMBUtilCopyBits(pucRegDiscreteBuf, 0, pucRegBuffer, 0, usNDiscrete);
     } else {
         eStatus = MB_ENOREG;
     }
@@ -9,6 +9,7 @@
 #include <sys/time.h>               // for calculation of time stamp in milliseconds
 #include "esp_log.h"                // for log_write
 #include "mb.h"                     // for mb types definition
+#include "mbframe.h"                // for stack event posting
 #include "mbutils.h"                // for mbutils functions definition for stack callback
 #include "sdkconfig.h"              // for KConfig values
 #include "esp_modbus_common.h"      // for common defines
@@ -38,11 +39,11 @@ static void modbus_slave_task(void *pvParameters)
                                                 portMAX_DELAY);
         // Check if stack started then poll for data
         if (status & MB_EVENT_STACK_STARTED) {
-            (void)eMBPoll(); // allow stack to process data
+            (void)eMBPollHdl(mbs_opts->mbs_stack_handle); // allow stack to process data
             // Send response buffer
             BOOL xSentState = xMBPortSerialTxPoll();
             if (xSentState) {
-                (void)xMBPortEventPost( EV_FRAME_SENT );
+                (void)xMBEventPost(mbs_opts->mbs_stack_handle, EV_FRAME_SENT);
             }
         }
     }
@@ -84,7 +85,8 @@ static esp_err_t mbc_serial_slave_start(void)
     const mb_communication_info_t* comm_info = (mb_communication_info_t*)&mbs_opts->mbs_comm;
 
     // Initialize Modbus stack using mbcontroller parameters
-    status = eMBInit((eMBMode)comm_info->mode,
+    status = eMBInitHdl(&mbs_opts->mbs_stack_handle,
+                         (eMBMode)comm_info->mode,
                          (UCHAR)comm_info->slave_addr,
                          (UCHAR)comm_info->port,
                          (ULONG)comm_info->baudrate,
@@ -92,7 +94,7 @@ static esp_err_t mbc_serial_slave_start(void)
 
     MB_SLAVE_CHECK((status == MB_ENOERR), ESP_ERR_INVALID_STATE,
                     "mb stack initialization failure, eMBInit() returns (0x%x).", (int)status);
-    status = eMBEnable();
+    status = eMBEnableHdl(mbs_opts->mbs_stack_handle);
     MB_SLAVE_CHECK((status == MB_ENOERR), ESP_ERR_INVALID_STATE,
                     "mb stack set slave ID failure, eMBEnable() returned (0x%x).", (int)status);
     // Set the mbcontroller start flag
@@ -123,16 +125,11 @@ static esp_err_t mbc_serial_slave_get_param_info(mb_param_info_t* reg_info, uint
                     ESP_ERR_INVALID_STATE,
                     "Slave interface is not correctly initialized.");
     mb_slave_options_t* mbs_opts = &mbs_interface_ptr->opts;
-    esp_err_t err = ESP_ERR_TIMEOUT;
-    MB_SLAVE_CHECK((mbs_opts->mbs_notification_queue_handle != NULL),
-                ESP_ERR_INVALID_ARG, "mb queue handle is invalid.");
+    MB_SLAVE_CHECK((mbs_opts->mbs_notify_ring.entries != NULL),
+                ESP_ERR_INVALID_ARG, "mb notify ring is invalid.");
     MB_SLAVE_CHECK((reg_info != NULL), ESP_ERR_INVALID_ARG, "mb register information is invalid.");
-    BaseType_t status = xQueueReceive(mbs_opts->mbs_notification_queue_handle,
-                                        reg_info, pdMS_TO_TICKS(timeout));
-    if (status == pdTRUE) {
-        err = ESP_OK;
-    }
-    return err;
+    size_t count = mbc_slave_notify_ring_get(&mbs_opts->mbs_notify_ring, reg_info, 1, timeout);
+    return (count > 0) ? ESP_OK : ESP_ERR_TIMEOUT;
 }
 
 /* ----------------------- Callback functions for Modbus stack ---------------------------------*/
@@ -155,14 +152,15 @@ static esp_err_t mbc_serial_slave_destroy(void)
     MB_SLAVE_CHECK((flag & MB_EVENT_STACK_STARTED),
                         ESP_ERR_INVALID_STATE, "mb stack stop event failure.");
     // Disable and then destroy the Modbus stack
-    mb_error = eMBDisable();
+    mb_error = eMBDisableHdl(mbs_opts->mbs_stack_handle);
     MB_SLAVE_CHECK((mb_error == MB_ENOERR), ESP_ERR_INVALID_STATE, "mb stack disable failure.");
     (void)vTaskDelete(mbs_opts->mbs_task_handle);
-    (void)vQueueDelete(mbs_opts->mbs_notification_queue_handle);
+    mbc_slave_notify_ring_delete(&mbs_opts->mbs_notify_ring);
     (void)vEventGroupDelete(mbs_opts->mbs_event_group);
-    mb_error = eMBClose();
+    mb_error = eMBCloseHdl(mbs_opts->mbs_stack_handle);
     MB_SLAVE_CHECK((mb_error == MB_ENOERR), ESP_ERR_INVALID_STATE,
                         "mb stack close failure returned (0x%x).", (int)mb_error);
+    mbs_opts->mbs_stack_handle = NULL;
     mbs_interface_ptr = NULL;
     vMBPortSetMode((UCHAR)MB_PORT_INACTIVE);
     return ESP_OK;
@@ -195,12 +193,9 @@ esp_err_t mbc_serial_slave_create(void** handler)
     mbs_opts->mbs_event_group = xEventGroupCreate();
     MB_SLAVE_CHECK((mbs_opts->mbs_event_group != NULL),
             ESP_ERR_NO_MEM, "mb event group error.");
-    // Parameter change notification queue
-    mbs_opts->mbs_notification_queue_handle = xQueueCreate(
-                                                MB_CONTROLLER_NOTIFY_QUEUE_SIZE,
-                                                sizeof(mb_param_info_t));
-    MB_SLAVE_CHECK((mbs_opts->mbs_notification_queue_handle != NULL),
-                        ESP_ERR_NO_MEM, "mb notify queue creation error.");
+    // Parameter change notification ring
+    esp_err_t err = mbc_slave_notify_ring_create(&mbs_opts->mbs_notify_ring, MB_CONTROLLER_NOTIFY_QUEUE_SIZE);
+    MB_SLAVE_CHECK((err == ESP_OK), ESP_ERR_NO_MEM, "mb notify ring creation error.");
     // Create Modbus controller task
     status = xTaskCreatePinnedToCore((void*)&modbus_slave_task,
                             "modbus_slave_task",
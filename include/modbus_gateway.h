@@ -0,0 +1,141 @@
+/**
+ * @file modbus_gateway.h
+ * @brief Gateway Modbus TCP → RTU
+ *
+ * Encaminha as requisições recebidas pelo servidor TCP para unit IDs
+ * diferentes do slave_id local aos dispositivos do barramento RS485,
+ * usando o master serial do ESP-IDF. A resposta volta ao cliente TCP
+ * com o Transaction ID original.
+ *
+ * FUNCIONAMENTO:
+ * -------------
+ * 1. A porta TCP entrega a requisição ao callback (sem bloquear)
+ * 2. A requisição entra na fila FIFO do gateway
+ * 3. A task do gateway envia as requisições ao barramento uma após a outra
+ * 4. A resposta (ou exceção) é devolvida ao cliente TCP
+ *
+ * Toda requisição encaminhada é respondida pelo gateway, nunca pelo slave
+ * local: com a fila cheia a resposta é a exceção 0x06 (ocupado) e a
+ * requisição que não obtém resposta do barramento dentro do timeout de
+ * resposta TCP recebe a exceção 0x0B.
+ *
+ * Cada cliente TCP tem no máximo uma requisição encaminhada por vez, então
+ * a fila FIFO atende os clientes em rodízio e nenhum cliente monopoliza o
+ * barramento. A fila mantém a próxima requisição pronta para o barramento
+ * assim que a anterior termina.
+ *
+ * EXEMPLO DE USO:
+ * ---------------
+ * ```c
+ * modbus_gateway_config_t gw_config = MODBUS_GATEWAY_DEFAULT_CONFIG();
+ * modbus_gateway_start(tcp_handle, &gw_config);
+ * ...
+ * modbus_gateway_stop();
+ * ```
+ *
+ * @author Sistema ESP32
+ * @date 2025
+ */
+
+#ifndef MODBUS_GATEWAY_H
+#define MODBUS_GATEWAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/uart.h"
+#include "modbus_tcp_slave.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * TIPOS E ESTRUTURAS
+ * ============================================================================ */
+
+/**
+ * @brief Configuração do gateway
+ */
+typedef struct {
+    uart_port_t uart_port;           ///< UART do barramento RS485
+    uint32_t baudrate;               ///< Velocidade do barramento
+    uart_parity_t parity;            ///< Paridade do barramento
+    uint8_t queue_depth;             ///< Requisições em espera (0 = máximo de conexões TCP)
+} modbus_gateway_config_t;
+
+/**
+ * @brief Estatísticas do gateway
+ */
+typedef struct {
+    uint32_t forwarded;              ///< Requisições recebidas dos clientes TCP
+    uint32_t completed;              ///< Respostas normais dos dispositivos RTU
+    uint32_t exceptions;             ///< Respostas de exceção (do dispositivo ou do gateway)
+    uint32_t timeouts;               ///< Dispositivos que não responderam
+    uint32_t expired;                ///< Requisições vencidas na fila, sem envio ao barramento
+    uint32_t rejected;               ///< Requisições recusadas com a fila cheia (exceção 0x06)
+    uint32_t dropped;                ///< Respostas não entregues (cliente desconectou)
+    uint8_t queue_high_water;        ///< Maior ocupação da fila
+} modbus_gateway_stats_t;
+
+/* ============================================================================
+ * CONSTANTES
+ * ============================================================================ */
+
+#define MODBUS_GATEWAY_TASK_STACK_SIZE     4096   // Tamanho da pilha
+#define MODBUS_GATEWAY_TASK_PRIORITY       4      // Acima da task RTU, abaixo do TCP
+#define MODBUS_GATEWAY_PDU_MAX             253    // Maior PDU Modbus
+
+#define MODBUS_GATEWAY_DEFAULT_CONFIG() {      \
+    .uart_port = CONFIG_MB_UART_PORT_NUM,       \
+    .baudrate = CONFIG_MB_UART_BAUD_RATE,       \
+    .parity = UART_PARITY_DISABLE,              \
+    .queue_depth = 0,                           \
+}
+
+/* ============================================================================
+ * API PÚBLICA
+ * ============================================================================ */
+
+/**
+ * @brief Inicia o gateway sobre o servidor TCP em execução
+ *
+ * Instala o master RTU na UART e registra o encaminhamento no servidor TCP.
+ * A UART não pode estar em uso pelo slave RTU.
+ *
+ * @param tcp_handle Handle do servidor TCP (deve estar rodando)
+ * @param config Configuração do gateway (NULL para padrões)
+ * @return ESP_OK em sucesso, ESP_ERR_INVALID_STATE se já iniciado ou a UART estiver em uso
+ */
+esp_err_t modbus_gateway_start(modbus_tcp_handle_t tcp_handle, const modbus_gateway_config_t *config);
+
+/**
+ * @brief Para o gateway e libera a UART
+ *
+ * As requisições ainda na fila são respondidas com a exceção 0x0A.
+ * Deve ser chamado antes de parar o servidor TCP.
+ *
+ * @return ESP_OK em sucesso
+ */
+esp_err_t modbus_gateway_stop(void);
+
+/**
+ * @brief Verifica se o gateway está ativo
+ *
+ * @return true se o gateway estiver encaminhando requisições
+ */
+bool modbus_gateway_is_running(void);
+
+/**
+ * @brief Obtém as estatísticas do gateway
+ *
+ * @param stats Ponteiro para estrutura que receberá as estatísticas
+ * @return ESP_OK em sucesso
+ */
+esp_err_t modbus_gateway_get_stats(modbus_gateway_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MODBUS_GATEWAY_H
@@ -4,13 +4,13 @@
  * 
  * Este módulo fornece uma interface unificada para gerenciar tanto
  * Modbus RTU (ESP-IDF nativo) quanto Modbus TCP (biblioteca customizada),
- * permitindo alternância dinâmica entre os modos usando os mesmos registradores.
+ * que atendem ao mesmo tempo usando os mesmos registradores.
  * 
  * FUNCIONALIDADES:
  * ---------------
- * - Alternância dinâmica RTU ↔ TCP sem reiniciar ESP32
- * - Sincronização automática de todos os registradores
- * - Fallback inteligente (RTU quando WiFi não disponível)
+ * - RTU e TCP simultâneos, cada um com o seu controlador
+ * - Troca de modo sem parar o transporte que continua no novo modo
+ * - Fallback inteligente (só RTU quando WiFi não disponível)
  * - Interface de controle via web
  * - Monitoramento de status em tempo real
  * 
@@ -73,14 +73,16 @@ extern "C" {
  * 
  * MODBUS_MODE_DISABLED: Nenhum protocolo ativo (economia de energia)
  * MODBUS_MODE_RTU:      Modbus RTU via serial (ESP-IDF nativo)  
- * MODBUS_MODE_TCP:      Modbus TCP via WiFi (biblioteca customizada)
- * MODBUS_MODE_AUTO:     Auto-seleção baseada na conectividade WiFi
+ * MODBUS_MODE_TCP:      Modbus TCP via WiFi (biblioteca customizada) junto com o RTU
+ * MODBUS_MODE_AUTO:     RTU sempre, TCP junto enquanto o WiFi está conectado
+ *
+ * Com o gateway habilitado a UART é do gateway e o slave RTU para enquanto o TCP roda.
  */
 typedef enum {
     MODBUS_MODE_DISABLED = 0,   // Modbus completamente desabilitado
     MODBUS_MODE_RTU      = 1,   // RTU via serial (sempre disponível)
-    MODBUS_MODE_TCP      = 2,   // TCP via WiFi (requer conectividade)
-    MODBUS_MODE_AUTO     = 3    // TCP se WiFi OK, senão RTU
+    MODBUS_MODE_TCP      = 2,   // RTU + TCP via WiFi (TCP requer conectividade)
+    MODBUS_MODE_AUTO     = 3    // RTU + TCP se WiFi OK, senão só RTU
 } modbus_mode_t;
 
 /**
@@ -94,7 +96,8 @@ typedef enum {
     MANAGER_STATE_RUNNING_RTU,    // RTU ativo e operacional
     MANAGER_STATE_RUNNING_TCP,    // TCP ativo e operacional 
     MANAGER_STATE_SWITCHING,      // Em processo de alternância
-    MANAGER_STATE_ERROR           // Erro - aguardando recuperação
+    MANAGER_STATE_ERROR,          // Erro - aguardando recuperação
+    MANAGER_STATE_RUNNING_RTU_TCP // RTU e TCP ativos ao mesmo tempo
 } modbus_manager_state_t;
 
 /**
@@ -120,13 +123,61 @@ typedef struct {
  * Permite personalizar comportamento do manager
  */
 typedef struct {
-    uint32_t sync_interval_ms;       // Intervalo de sincronização (padrão: 1000ms)
+    uint32_t sync_interval_ms;       // Sem efeito: RTU e TCP usam a mesma memória
     uint32_t wifi_check_interval_ms; // Intervalo de verificação WiFi (padrão: 5000ms)
     bool auto_fallback_enabled;     // Se deve fazer fallback RTU quando WiFi cai
-    bool register_sync_enabled;      // Se deve sincronizar registradores
+    bool register_sync_enabled;      // Sem efeito: RTU e TCP usam a mesma memória
     uint8_t max_retry_attempts;      // Tentativas de recuperação de erro
+    bool gateway_enabled;            // Se deve encaminhar outros unit IDs ao barramento RTU (modo TCP)
 } modbus_manager_config_t;
 
+/**
+ * @brief Estágios medidos no processamento de uma requisição
+ * 
+ * QUEUE: frame recebido até o stack iniciar o tratamento
+ * EXEC:  execução do handler do código de função
+ * SEND:  fim do handler até o envio da resposta
+ * TOTAL: frame recebido até o envio da resposta
+ */
+typedef enum {
+    MODBUS_LATENCY_STAGE_QUEUE = 0,
+    MODBUS_LATENCY_STAGE_EXEC,
+    MODBUS_LATENCY_STAGE_SEND,
+    MODBUS_LATENCY_STAGE_TOTAL,
+    MODBUS_LATENCY_STAGE_COUNT
+} modbus_latency_stage_t;
+
+/**
+ * @brief Resumo do histograma de latência de um estágio
+ * 
+ * Os percentis são o limite superior da faixa log2 do histograma
+ */
+typedef struct {
+    uint32_t count;                  // Requisições registradas
+    uint32_t p50_us;                 // Mediana em microssegundos
+    uint32_t p99_us;                 // Percentil 99 em microssegundos
+    uint32_t max_us;                 // Máximo em microssegundos
+} modbus_latency_summary_t;
+
+/**
+ * @brief Latências de um código de função por transporte
+ */
+typedef struct {
+    uint8_t function_code;                                       // 0 = demais códigos
+    modbus_latency_summary_t rtu[MODBUS_LATENCY_STAGE_COUNT];    // Requisições RTU
+    modbus_latency_summary_t tcp[MODBUS_LATENCY_STAGE_COUNT];    // Requisições TCP
+} modbus_fc_latency_t;
+
+#define MODBUS_LATENCY_MAX_FUNCTIONS  10   // Códigos de função com histograma próprio
+
+/**
+ * @brief Estatísticas de latência do slave Modbus
+ */
+typedef struct {
+    uint8_t function_count;                                      // Entradas válidas em functions
+    modbus_fc_latency_t functions[MODBUS_LATENCY_MAX_FUNCTIONS];
+} modbus_latency_stats_t;
+
 /* ============================================================================
  * API PÚBLICA - FUNÇÕES PRINCIPAIS  
  * ============================================================================ */
@@ -188,6 +239,36 @@ bool modbus_manager_is_running(void);
  */
 esp_err_t modbus_manager_get_status(modbus_status_t *status);
 
+/**
+ * @brief Obtém as latências das requisições por código de função
+ * 
+ * Os histogramas são mantidos pelo stack Modbus para RTU e TCP,
+ * inclusive entre alternâncias de modo.
+ * 
+ * @param stats Ponteiro para estrutura que receberá as estatísticas
+ * @return ESP_OK em sucesso, ESP_ERR_NOT_SUPPORTED se CONFIG_FMB_STATS_EN desabilitado
+ */
+esp_err_t modbus_manager_get_latency_stats(modbus_latency_stats_t *stats);
+
+/**
+ * @brief Zera os histogramas de latência
+ * 
+ * @return ESP_OK em sucesso, ESP_ERR_NOT_SUPPORTED se CONFIG_FMB_STATS_EN desabilitado
+ */
+esp_err_t modbus_manager_reset_latency_stats(void);
+
+/**
+ * @brief Habilita ou desabilita o gateway TCP → RTU
+ * 
+ * Com o gateway ativo, as requisições TCP para unit IDs diferentes do
+ * slave local são encaminhadas aos dispositivos do barramento RS485.
+ * O gateway só roda no modo TCP; a configuração é mantida entre alternâncias.
+ * 
+ * @param enable true para encaminhar as requisições
+ * @return ESP_OK em sucesso, erro do gateway se não puder ser iniciado
+ */
+esp_err_t modbus_manager_set_gateway(bool enable);
+
 /* ============================================================================
  * API PÚBLICA - FUNÇÕES DE CONFIGURAÇÃO
  * ============================================================================ */
@@ -214,10 +295,10 @@ esp_err_t modbus_manager_save_config_mode(modbus_mode_t mode);
 /**
  * @brief Força sincronização manual dos registradores
  * 
- * Útil após alterações manuais nos registradores via código.
- * Normalmente a sincronização é automática.
+ * Mantida por compatibilidade: RTU e TCP atendem sobre a mesma memória
+ * de registradores, então não há cópia a fazer.
  * 
- * @return ESP_OK em sucesso
+ * @return ESP_OK em sucesso, ESP_ERR_INVALID_STATE sem transporte ativo
  */
 esp_err_t modbus_manager_sync_registers(void);
 
@@ -28,6 +28,36 @@
 #define REG_UNITSPECS_START		9000
 #define REG_UNITSPECS_SIZE		20
 
+// Floats nativos acessados por índice do elemento (não do registrador)
+#define REG_HOLDING_FLOAT_START		0
+#define REG_HOLDING_FLOAT_SIZE		8
+
+#define REG_INPUT_FLOAT_START		0
+#define REG_INPUT_FLOAT_SIZE		8
+
+// Tabela de endereços usada pelos acessores da biblioteca TCP:
+// X(início, quantidade, memória, tipo do elemento, seqlock). Cada bloco deve ficar
+// dentro de uma página de MODBUS_MAP_PAGE_SIZE endereços, sozinho na página, assim
+// a busca é um único acesso indexado (as duas regras são verificadas na compilação).
+// Um bloco novo é uma linha nesta lista.
+// Os blocos com seqlock são lidos sem lock; NULL usa o mutex da instância.
+#define MODBUS_MAP_PAGE_SIZE		1000
+
+#define MODBUS_MAP_HOLDING_RANGES(X) \
+    X(REG_HOLDING_FLOAT_START, REG_HOLDING_FLOAT_SIZE, &holding_reg_params.holding_data0,   MB_ELEM_FLOAT, &holding_reg_params_lock) \
+    X(REG_CONFIG_START,        REG_CONFIG_SIZE,        holding_reg1000_params.reg1000,      MB_ELEM_U16,   NULL) \
+    X(REG_DATA_START,          REG_DATA_SIZE,          reg2000,                             MB_ELEM_U16,   NULL) \
+    X(REG_3000_START,          REG_3000_SIZE,          reg3000,                             MB_ELEM_U16,   NULL) \
+    X(REG_4000_START,          REG_4000_SIZE,          reg4000,                             MB_ELEM_U16,   NULL) \
+    X(REG_5000_START,          REG_5000_SIZE,          reg5000,                             MB_ELEM_U16,   NULL) \
+    X(REG_6000_START,          REG_6000_SIZE,          reg6000,                             MB_ELEM_U16,   NULL) \
+    X(REG_7000_START,          REG_7000_SIZE,          reg7000,                             MB_ELEM_U16,   NULL) \
+    X(REG_8000_START,          REG_8000_SIZE,          reg8000,                             MB_ELEM_U16,   NULL) \
+    X(REG_UNITSPECS_START,     REG_UNITSPECS_SIZE,     reg9000,                             MB_ELEM_U16,   NULL)
+
+#define MODBUS_MAP_INPUT_RANGES(X) \
+    X(REG_INPUT_FLOAT_START,   REG_INPUT_FLOAT_SIZE,   &input_reg_params.input_data0,       MB_ELEM_FLOAT, &input_reg_params_lock)
+
 enum reg1000_config {
     baudrate,
     endereco,
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "modbus_map.h"
+#include "mb_seqlock.h"
 
 typedef struct {
     uint8_t discrete_input0;
@@ -63,4 +64,8 @@ extern uint16_t reg9000[REG_UNITSPECS_SIZE];
 extern coil_reg_params_t coil_reg_params;
 extern input_reg_params_t input_reg_params;
 
+// Seqlocks dos floats compartilhados entre o stack Modbus e as tasks da aplicação
+extern mb_seqlock_t holding_reg_params_lock;
+extern mb_seqlock_t input_reg_params_lock;
+
 #endif // MODBUS_PARAMS_H
\ No newline at end of file
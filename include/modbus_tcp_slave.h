@@ -13,6 +13,7 @@
 #include "esp_netif.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -44,6 +45,14 @@ typedef enum {
     MODBUS_REG_DISCRETE         ///< Discrete Inputs (R)
 } modbus_reg_type_t;
 
+/**
+ * @brief Transporte do servidor Modbus
+ */
+typedef enum {
+    MODBUS_TCP_TRANSPORT_TCP = 0,   ///< Modbus TCP com conexões (padrão)
+    MODBUS_TCP_TRANSPORT_UDP        ///< Modbus/UDP: um datagrama por requisição, sem conexões
+} modbus_tcp_transport_t;
+
 /**
  * @brief Configuração do Modbus TCP Slave
  */
@@ -54,6 +63,7 @@ typedef struct {
     bool auto_start;            ///< Auto iniciar após init
     uint16_t max_connections;   ///< Máximo de conexões simultâneas (padrão: 5)
     uint32_t timeout_ms;        ///< Timeout de conexão em ms (padrão: 20000)
+    modbus_tcp_transport_t transport; ///< Transporte na porta configurada (padrão: TCP)
 } modbus_tcp_config_t;
 
 /**
@@ -97,23 +107,41 @@ typedef struct {
     uint8_t discrete_input7:1;
 } modbus_discrete_regs_t;
 
+/**
+ * @brief Acesso do master a um intervalo, entregue pela task de operação
+ * 
+ * Os registros são as palavras de 16 bits da memória do bloco (nos floats, a ordem
+ * CDAB do mapa faz delas os próprios registros). Nos coils e discrete inputs os
+ * valores são um bitmap, o bit 0 é o endereço addr. Os ponteiros valem apenas
+ * durante o callback.
+ */
+typedef struct {
+    modbus_reg_type_t reg_type; ///< Tipo do registro
+    bool write;                 ///< true para escrita do master, false para leitura
+    uint16_t addr;              ///< Primeiro endereço do intervalo
+    uint16_t count;             ///< Quantidade de registros (ou bits) do intervalo
+    uint32_t hits;              ///< Acessos do master agrupados neste evento
+    const uint16_t *old_values; ///< Conteúdo no evento anterior do intervalo (igual a new_values nas leituras)
+    const uint16_t *new_values; ///< Conteúdo atual do intervalo
+} modbus_tcp_access_t;
+
 /**
  * @brief Callbacks para eventos do Modbus
  */
 typedef struct {
     /**
      * @brief Callback chamado quando um registro é lido
-     * @param addr Endereço do registro
+     * @param addr Endereço do primeiro registro do intervalo lido
      * @param reg_type Tipo do registro
-     * @param value Valor lido (apenas para debug)
+     * @param value Valor do primeiro registro (ou bit) do intervalo
      */
     void (*on_register_read)(uint16_t addr, modbus_reg_type_t reg_type, uint32_t value);
     
     /**
      * @brief Callback chamado quando um registro é escrito
-     * @param addr Endereço do registro
+     * @param addr Endereço do primeiro registro do intervalo escrito
      * @param reg_type Tipo do registro
-     * @param value Novo valor escrito
+     * @param value Novo valor do primeiro registro (ou bit) do intervalo
      */
     void (*on_register_write)(uint16_t addr, modbus_reg_type_t reg_type, uint32_t value);
     
@@ -130,8 +158,90 @@ typedef struct {
      * @param description Descrição do erro
      */
     void (*on_error)(esp_err_t error, const char* description);
+
+    /**
+     * @brief Callback chamado com um lote de acessos do master
+     * 
+     * Chamado na task de operação antes de on_register_read/on_register_write,
+     * com os acessos na ordem em que ocorreram.
+     * @param accesses Acessos do lote
+     * @param count Quantidade de acessos
+     */
+    void (*on_access_batch)(const modbus_tcp_access_t *accesses, size_t count);
 } modbus_tcp_callbacks_t;
 
+/**
+ * @brief Callback de um intervalo observado com modbus_tcp_watch_range()
+ * 
+ * Chamado na task de operação quando uma escrita do master alcança o intervalo,
+ * apenas com a parte escrita dentro dele. Não pode registrar ou cancelar watches:
+ * modbus_tcp_watch_range() e modbus_tcp_unwatch_range() retornam ESP_ERR_INVALID_STATE
+ * quando chamadas na task de operação.
+ * 
+ * @param ctx Contexto registrado com o watch
+ * @param reg_type Tipo do registro
+ * @param addr Primeiro endereço escrito dentro do intervalo observado
+ * @param count Quantidade de endereços escritos dentro do intervalo observado
+ * @param old_values Conteúdo anterior (registros, ou bitmap com o bit 0 em addr)
+ * @param new_values Conteúdo atual, no mesmo formato
+ */
+typedef void (*modbus_tcp_watch_cb_t)(void *ctx, modbus_reg_type_t reg_type, uint16_t addr, uint16_t count,
+                                      const uint16_t *old_values, const uint16_t *new_values);
+
+/**
+ * @brief Estatísticas da task de eventos
+ * 
+ * A vazão é events / (busy_us / 1e6) eventos por segundo de processamento.
+ */
+typedef struct {
+    uint32_t batches;           ///< Lotes processados
+    uint32_t events;            ///< Eventos entregues aos callbacks
+    uint32_t accesses;          ///< Acessos do master (os agrupados em um evento contam todos)
+    uint32_t max_batch;         ///< Maior quantidade de eventos em um lote
+    uint32_t dropped;           ///< Acessos perdidos com a fila de notificações cheia
+    uint64_t busy_us;           ///< Tempo total de processamento dos lotes (us)
+} modbus_tcp_event_stats_t;
+
+/**
+ * @brief Estatísticas do pool de slots de clientes
+ */
+typedef struct {
+    uint16_t slots;             ///< Número de slots alocados (max_connections)
+    uint16_t in_use;            ///< Slots ocupados no momento
+    uint16_t high_water;        ///< Máximo de slots ocupados simultaneamente
+    uint32_t exhausted;         ///< Conexões recusadas por falta de slot livre
+    uint32_t evicted_lru;       ///< Conexões ociosas substituídas por uma nova conexão
+    uint32_t dropped_idle;      ///< Conexões fechadas por timeout sem requisições
+    uint32_t closed_by_peer;    ///< Conexões fechadas pelo master
+    uint32_t dropped_keepalive; ///< Conexões sem resposta ao keepalive
+    uint32_t dropped_bad_frame; ///< Conexões fechadas por frame MBAP inválido
+    uint32_t dropped_error;     ///< Conexões fechadas por erro de socket
+} modbus_tcp_pool_stats_t;
+
+/**
+ * @brief Identificação de uma requisição encaminhada a outro unit ID (gateway)
+ */
+typedef struct {
+    uint16_t client;            ///< Slot do cliente TCP que enviou a requisição
+    uint16_t tid;               ///< Transaction ID MBAP original
+} modbus_tcp_forward_ticket_t;
+
+/**
+ * @brief Callback das requisições endereçadas a unit IDs diferentes do slave_id
+ * 
+ * Chamado na task TCP com o lock da porta: deve copiar o PDU e retornar sem bloquear.
+ * As próximas requisições do mesmo cliente aguardam a resposta desta.
+ * 
+ * @param ctx Contexto registrado com o callback
+ * @param ticket Identificação a ser passada para modbus_tcp_forward_response()
+ * @param unit_id Unit ID de destino
+ * @param pdu PDU da requisição (código de função e dados)
+ * @param pdu_len Tamanho do PDU
+ * @return true se a requisição foi aceita, false para tratá-la localmente
+ */
+typedef bool (*modbus_tcp_forward_cb_t)(void *ctx, modbus_tcp_forward_ticket_t ticket, uint8_t unit_id,
+                                        const uint8_t *pdu, uint16_t pdu_len);
+
 // ================================
 // API PRINCIPAL
 // ================================
@@ -156,16 +266,21 @@ esp_err_t modbus_tcp_slave_start(modbus_tcp_handle_t handle);
 /**
  * @brief Para o servidor Modbus TCP
  * 
+ * Bloqueia até a task de operação sair, inclusive do callback em andamento.
+ * 
  * @param handle Handle da instância
- * @return esp_err_t 
+ * @return esp_err_t ESP_ERR_INVALID_STATE se não está rodando ou se chamado de um callback
  */
 esp_err_t modbus_tcp_slave_stop(modbus_tcp_handle_t handle);
 
 /**
  * @brief Destrói a instância do Modbus TCP Slave
  * 
+ * Para o servidor se estiver rodando. A instância não é liberada enquanto
+ * a task de operação existe (stop em andamento em outra task).
+ * 
  * @param handle Handle da instância
- * @return esp_err_t 
+ * @return esp_err_t ESP_ERR_INVALID_STATE se a task de operação ainda existe
  */
 esp_err_t modbus_tcp_slave_destroy(modbus_tcp_handle_t handle);
 
@@ -305,6 +420,114 @@ esp_err_t modbus_tcp_set_discrete_input(modbus_tcp_handle_t handle, uint16_t add
  */
 esp_err_t modbus_tcp_get_discrete_input(modbus_tcp_handle_t handle, uint16_t addr, bool *value);
 
+// ================================
+// FUNÇÕES DE ACESSO EM BLOCO
+// ================================
+
+/**
+ * @brief Escreve um intervalo de Holding Registers
+ *
+ * O intervalo inteiro é validado antes da cópia e deve estar dentro de um
+ * único bloco do mapa (modbus_map.h). O mutex é obtido uma vez por chamada.
+ * Nos blocos float cada valor é convertido como em modbus_tcp_set_holding_register().
+ *
+ * @param handle Handle da instância
+ * @param start Endereço do primeiro registro
+ * @param count Quantidade de registros
+ * @param src Valores a serem escritos
+ * @return ESP_OK em sucesso, ESP_ERR_INVALID_ARG se o intervalo não está mapeado
+ */
+esp_err_t modbus_tcp_write_holding_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                         const uint16_t *src);
+
+/**
+ * @brief Lê um intervalo de Holding Registers
+ *
+ * @param handle Handle da instância
+ * @param start Endereço do primeiro registro
+ * @param count Quantidade de registros
+ * @param dst Buffer para receber os valores
+ * @return ESP_OK em sucesso, ESP_ERR_INVALID_ARG se o intervalo não está mapeado
+ */
+esp_err_t modbus_tcp_read_holding_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                        uint16_t *dst);
+
+/**
+ * @brief Escreve um intervalo de Input Registers
+ *
+ * @param handle Handle da instância
+ * @param start Endereço do primeiro registro
+ * @param count Quantidade de registros
+ * @param src Valores a serem escritos
+ * @return ESP_OK em sucesso, ESP_ERR_INVALID_ARG se o intervalo não está mapeado
+ */
+esp_err_t modbus_tcp_write_input_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                       const uint16_t *src);
+
+/**
+ * @brief Lê um intervalo de Input Registers
+ *
+ * @param handle Handle da instância
+ * @param start Endereço do primeiro registro
+ * @param count Quantidade de registros
+ * @param dst Buffer para receber os valores
+ * @return ESP_OK em sucesso, ESP_ERR_INVALID_ARG se o intervalo não está mapeado
+ */
+esp_err_t modbus_tcp_read_input_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                      uint16_t *dst);
+
+/**
+ * @brief Escreve um intervalo de Coils a partir de um bitmap
+ *
+ * O bit 0 de bits[0] corresponde à coil start (mesma ordem do PDU Modbus).
+ *
+ * @param handle Handle da instância
+ * @param start Endereço da primeira coil (0-15)
+ * @param count Quantidade de coils
+ * @param bits Bitmap com ((count + 7) / 8) bytes
+ * @return ESP_OK em sucesso, ESP_ERR_INVALID_ARG se o intervalo excede as coils
+ */
+esp_err_t modbus_tcp_write_coil_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                      const uint8_t *bits);
+
+/**
+ * @brief Lê um intervalo de Coils para um bitmap
+ *
+ * Os bits do último byte além de count não são alterados.
+ *
+ * @param handle Handle da instância
+ * @param start Endereço da primeira coil (0-15)
+ * @param count Quantidade de coils
+ * @param bits Bitmap com ((count + 7) / 8) bytes
+ * @return ESP_OK em sucesso, ESP_ERR_INVALID_ARG se o intervalo excede as coils
+ */
+esp_err_t modbus_tcp_read_coil_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                     uint8_t *bits);
+
+/**
+ * @brief Escreve um intervalo de Discrete Inputs a partir de um bitmap
+ *
+ * @param handle Handle da instância
+ * @param start Endereço do primeiro input (0-7)
+ * @param count Quantidade de inputs
+ * @param bits Bitmap com ((count + 7) / 8) bytes
+ * @return ESP_OK em sucesso, ESP_ERR_INVALID_ARG se o intervalo excede os inputs
+ */
+esp_err_t modbus_tcp_write_discrete_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                          const uint8_t *bits);
+
+/**
+ * @brief Lê um intervalo de Discrete Inputs para um bitmap
+ *
+ * @param handle Handle da instância
+ * @param start Endereço do primeiro input (0-7)
+ * @param count Quantidade de inputs
+ * @param bits Bitmap com ((count + 7) / 8) bytes
+ * @return ESP_OK em sucesso, ESP_ERR_INVALID_ARG se o intervalo excede os inputs
+ */
+esp_err_t modbus_tcp_read_discrete_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                         uint8_t *bits);
+
 // ================================
 // CALLBACKS E EVENTOS
 // ================================
@@ -318,6 +541,38 @@ esp_err_t modbus_tcp_get_discrete_input(modbus_tcp_handle_t handle, uint16_t add
  */
 esp_err_t modbus_tcp_register_callbacks(modbus_tcp_handle_t handle, const modbus_tcp_callbacks_t *callbacks);
 
+/**
+ * @brief Observa um intervalo de endereços escrito pelo master
+ * 
+ * Os endereços são os do protocolo (registros ou bits). Apenas as escritas que
+ * alcançam o intervalo chamam o callback, pelo índice ordenado dos intervalos,
+ * sem varrer os demais watches. Pode ser chamado antes ou depois do start.
+ * 
+ * @param handle Handle da instância
+ * @param type MODBUS_REG_HOLDING ou MODBUS_REG_COIL (os demais não são escritos pelo master)
+ * @param start Primeiro endereço do intervalo
+ * @param count Quantidade de endereços
+ * @param cb Callback das escritas no intervalo
+ * @param ctx Contexto passado ao callback
+ * @return ESP_OK em sucesso, ESP_ERR_NO_MEM se o limite de watches do tipo foi atingido,
+ *         ESP_ERR_INVALID_STATE se chamado de um callback (task de operação)
+ */
+esp_err_t modbus_tcp_watch_range(modbus_tcp_handle_t handle, modbus_reg_type_t type, uint16_t start,
+                                 uint16_t count, modbus_tcp_watch_cb_t cb, void *ctx);
+
+/**
+ * @brief Cancela os watches registrados com o callback e contexto
+ * 
+ * Depois do retorno o callback não é mais chamado.
+ * 
+ * @param handle Handle da instância
+ * @param cb Callback dos watches
+ * @param ctx Contexto dos watches
+ * @return ESP_OK em sucesso, ESP_ERR_NOT_FOUND se nenhum watch foi encontrado,
+ *         ESP_ERR_INVALID_STATE se chamado de um callback (task de operação)
+ */
+esp_err_t modbus_tcp_unwatch_range(modbus_tcp_handle_t handle, modbus_tcp_watch_cb_t cb, void *ctx);
+
 // ================================
 // UTILITÁRIOS
 // ================================
@@ -347,6 +602,54 @@ esp_err_t modbus_tcp_get_registers_ptr(modbus_tcp_handle_t handle,
  * @return esp_err_t 
  */
 esp_err_t modbus_tcp_get_connection_info(modbus_tcp_handle_t handle, uint8_t *connection_count, uint16_t *port);
+
+/**
+ * @brief Obtém estatísticas do pool de slots de clientes
+ * 
+ * @param handle Handle da instância
+ * @param stats Ponteiro para receber as estatísticas
+ * @return esp_err_t ESP_ERR_INVALID_STATE se o servidor não estiver rodando
+ */
+esp_err_t modbus_tcp_get_pool_stats(modbus_tcp_handle_t handle, modbus_tcp_pool_stats_t *stats);
+
+/**
+ * @brief Obtém estatísticas da task de eventos
+ * 
+ * @param handle Handle da instância
+ * @param stats Ponteiro para receber as estatísticas
+ * @return esp_err_t ESP_ERR_INVALID_STATE se o servidor não estiver rodando
+ */
+esp_err_t modbus_tcp_get_event_stats(modbus_tcp_handle_t handle, modbus_tcp_event_stats_t *stats);
+
+// ================================
+// GATEWAY
+// ================================
+
+/**
+ * @brief Encaminha as requisições de outros unit IDs para o callback
+ * 
+ * As requisições para o slave_id, broadcast (0) e 255 continuam sendo atendidas localmente.
+ * 
+ * @param handle Handle da instância
+ * @param cb Callback das requisições encaminhadas (NULL desabilita o encaminhamento)
+ * @param ctx Contexto passado ao callback
+ * @return esp_err_t ESP_ERR_INVALID_STATE se o servidor não estiver rodando
+ */
+esp_err_t modbus_tcp_set_forward(modbus_tcp_handle_t handle, modbus_tcp_forward_cb_t cb, void *ctx);
+
+/**
+ * @brief Envia a resposta de uma requisição encaminhada
+ * 
+ * A resposta é enviada com o Transaction ID original da requisição.
+ * 
+ * @param handle Handle da instância
+ * @param ticket Identificação recebida no callback
+ * @param pdu PDU da resposta (código de função e dados)
+ * @param pdu_len Tamanho do PDU
+ * @return esp_err_t ESP_ERR_NOT_FOUND se o cliente já desconectou ou o envio falhou
+ */
+esp_err_t modbus_tcp_forward_response(modbus_tcp_handle_t handle, modbus_tcp_forward_ticket_t ticket,
+                                      const uint8_t *pdu, uint16_t pdu_len);
 void slave_operation_task(void *arg);
 #ifdef __cplusplus
 }
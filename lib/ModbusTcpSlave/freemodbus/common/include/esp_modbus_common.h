@@ -11,9 +11,7 @@
 #include "driver/uart.h"                    // for UART types
 #include "sdkconfig.h"
 
-#if CONFIG_FMB_EXT_TYPE_SUPPORT
-#include "mb_endianness_utils.h"
-#endif
+#include "mb_endianness_utils.h"            // for register byte order conversion
 
 #ifdef __cplusplus
 extern "C" {
@@ -48,7 +46,8 @@ extern "C" {
 #define MB_PAR_INFO_TOUT    (10)                // Timeout for get parameter info
 #define MB_PARITY_NONE      (UART_PARITY_DISABLE)
 
-// The Macros below handle the endianness while transfer N byte data into buffer (convert from network byte order)
+// The Macros below handle the endianness while transfer N byte data into buffer (convert from network byte order),
+// the register callbacks use mb_swap_copy_regs() to transfer the whole register range
 #define _XFER_2_RD(dst, src) { \
     *(uint8_t *)(dst)++ = *(uint8_t *)(src + 1); \
     *(uint8_t *)(dst)++ = *(uint8_t *)(src + 0); \
@@ -139,6 +138,7 @@ typedef union {
         mb_tcp_addr_type_t ip_addr_type;       /*!< Modbus address type */
         void* ip_addr;                         /*!< Modbus address table for connection */
         void* ip_netif_ptr;                    /*!< Modbus network interface */
+        uint16_t ip_max_conn;                  /*!< Modbus slave client slots, 0 - use CONFIG_FMB_TCP_PORT_MAX_CONN */
     }; /*!< Modbus options version 2 */
 } mb_communication_info_t;
 
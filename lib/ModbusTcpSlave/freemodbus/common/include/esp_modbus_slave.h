@@ -14,6 +14,7 @@
 #include "freertos/FreeRTOS.h"      // for task creation and queues access
 #include "freertos/event_groups.h"  // for event groups
 #include "esp_modbus_common.h"      // for common types
+#include "mb_seqlock.h"             // for shared area sequence lock
 
 #ifdef __cplusplus
 extern "C" {
@@ -34,16 +35,36 @@ typedef struct {
     mb_event_group_t type;                  /*!< Modbus event type */
     uint8_t* address;                       /*!< Modbus data storage address */
     size_t size;                            /*!< Modbus event register size (number of registers)*/
+    uint32_t hits;                          /*!< Number of the accesses merged into the event */
 } mb_param_info_t;
 
+/**
+ * @brief Statistic of the parameter access notifications
+ */
+typedef struct {
+    uint32_t queued;                        /*!< Number of notifications put into the ring */
+    uint32_t coalesced;                     /*!< Number of accesses merged into a pending notification */
+    uint32_t overflows;                     /*!< Number of accesses dropped because the ring was full */
+    uint32_t pending;                       /*!< Number of notifications waiting in the ring */
+} mb_param_notify_stats_t;
+
 /**
  * @brief Parameter storage area descriptor
+ *
+ * The holding and input areas can keep the native values of elem_type, every value occupies
+ * sizeof(value) / 2 registers and is converted to the word order on access. The zero initialized
+ * fields select the raw 16-bit registers sent big endian.
+ * The area changed by the application tasks while the stack is running can be protected by the
+ * sequence lock, the stack writes it under the lock and retries the reads interrupted by a change.
  */
 typedef struct {
     uint16_t start_offset;                  /*!< Modbus start address for area descriptor */
     mb_param_type_t type;                   /*!< Type of storage area descriptor */
     void* address;                          /*!< Instance address for storage area descriptor */
     size_t size;                            /*!< Instance size for area descriptor (bytes) */
+    mb_elem_type_t elem_type;               /*!< Type of the values in the area (MB_ELEM_U16 for raw registers) */
+    mb_word_order_t word_order;             /*!< Order of the value bytes in the registers */
+    mb_seqlock_t* seqlock;                  /*!< Sequence lock of the area data, NULL if not shared */
 } mb_register_area_descriptor_t;
 
 /**
@@ -90,9 +111,12 @@ esp_err_t mbc_slave_destroy(void);
 /**
  * @brief Start Modbus communication stack
  *
+ * The area descriptors are frozen into the sorted lookup index on start.
+ *
  * @return
  *     - ESP_OK   Success
  *     - ESP_ERR_INVALID_ARG Modbus stack start error
+ *     - ESP_ERR_NO_MEM Not enough memory for the descriptor index
  */
 esp_err_t mbc_slave_start(void);
 
@@ -120,6 +144,9 @@ mb_event_group_t mbc_slave_check_event(mb_event_group_t group);
 /**
  * @brief Get parameter information
  *
+ * Repeated accesses to the same area are merged into one notification,
+ * the hits field counts them. The notifications are taken by one task only.
+ *
  * @param[out] reg_info parameter info structure
  * @param timeout Timeout in milliseconds to read information from
  *                parameter queue
@@ -130,17 +157,103 @@ mb_event_group_t mbc_slave_check_event(mb_event_group_t group);
  */
 esp_err_t mbc_slave_get_param_info(mb_param_info_t* reg_info, uint32_t timeout);
 
+/**
+ * @brief Get all pending parameter information at once
+ *
+ * Waits for the first notification and takes up to max_count notifications
+ * in the order of the access. The notifications are taken by one task only.
+ *
+ * @param[out] reg_info array of parameter info structures
+ * @param max_count number of structures in the array
+ * @param[out] count number of structures filled
+ * @param timeout Timeout in milliseconds to wait for the first notification
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Incorrect arguments
+ *     - ESP_ERR_TIMEOUT No notifications during the timeout
+ */
+esp_err_t mbc_slave_get_param_info_batch(mb_param_info_t* reg_info, size_t max_count,
+                                            size_t* count, uint32_t timeout);
+
+/**
+ * @brief Select the events reported by the parameter notifications and the event group
+ *
+ * The accesses of the events not in the mask are neither queued nor signaled,
+ * for example the read events can be excluded to see the writes only.
+ * All access events are enabled by default.
+ *
+ * @param event_mask mask of mb_event_group_t access events
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_STATE Slave interface is not initialized
+ */
+esp_err_t mbc_slave_set_notify_mask(mb_event_group_t event_mask);
+
+/**
+ * @brief Get the statistic of the parameter notifications
+ *
+ * @param[out] stats statistic structure
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Incorrect arguments
+ *     - ESP_ERR_INVALID_STATE Slave interface is not initialized
+ */
+esp_err_t mbc_slave_get_notify_stats(mb_param_notify_stats_t* stats);
+
+/**
+ * @brief Set the value read from the unmapped registers between the areas
+ *
+ * The register requests spanning several adjacent areas are served as one request.
+ * When the fill is enabled the unmapped registers between two areas are read as the
+ * fill value, otherwise such requests are answered with the illegal address exception.
+ * The writes are always rejected if any of the registers is unmapped.
+ *
+ * @param type MB_PARAM_HOLDING or MB_PARAM_INPUT
+ * @param enable read the gaps between the areas as the fill value
+ * @param fill_value value of the unmapped registers
+ *
+ * @return
+ *     - ESP_OK: The fill is set
+ *     - ESP_ERR_INVALID_ARG: The type is not the register type
+ *     - ESP_ERR_INVALID_STATE: Slave interface is not initialized
+ */
+esp_err_t mbc_slave_set_gap_fill(mb_param_type_t type, bool enable, uint16_t fill_value);
+
 /**
  * @brief Set Modbus area descriptor
  *
+ * The descriptors are set before mbc_slave_start(), the areas of one type must not overlap.
+ * The size of a typed area is a multiple of the element size, the coil and discrete areas are untyped.
+ *
  * @param descr_data Modbus registers area descriptor structure
  *
  * @return
  *     - ESP_OK: The appropriate descriptor is set
- *     - ESP_ERR_INVALID_ARG: The argument is incorrect
+ *     - ESP_ERR_INVALID_ARG: The argument is incorrect or the area overlaps a defined one
+ *     - ESP_ERR_INVALID_STATE: The controller is already started
  */
 esp_err_t mbc_slave_set_descriptor(mb_register_area_descriptor_t descr_data);
 
+/**
+ * @brief Functions of a selected controller interface
+ *
+ * One serial and one TCP controller can run at the same time, each with its own
+ * area descriptors and notifications. The functions below take the handler returned
+ * by mbc_slave_init() or mbc_slave_init_tcp(), the functions above without the handler
+ * use the last initialized controller. The return values are the same.
+ */
+esp_err_t mbc_slave_destroy_hdl(void* handler);
+esp_err_t mbc_slave_setup_hdl(void* handler, void* comm_info);
+esp_err_t mbc_slave_start_hdl(void* handler);
+mb_event_group_t mbc_slave_check_event_hdl(void* handler, mb_event_group_t group);
+esp_err_t mbc_slave_get_param_info_hdl(void* handler, mb_param_info_t* reg_info, uint32_t timeout);
+esp_err_t mbc_slave_get_param_info_batch_hdl(void* handler, mb_param_info_t* reg_info, size_t max_count,
+                                                size_t* count, uint32_t timeout);
+esp_err_t mbc_slave_set_notify_mask_hdl(void* handler, mb_event_group_t event_mask);
+esp_err_t mbc_slave_get_notify_stats_hdl(void* handler, mb_param_notify_stats_t* stats);
+esp_err_t mbc_slave_set_gap_fill_hdl(void* handler, mb_param_type_t type, bool enable, uint16_t fill_value);
+esp_err_t mbc_slave_set_descriptor_hdl(void* handler, mb_register_area_descriptor_t descr_data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,9 +7,12 @@
 #ifndef _MB_CONTROLLER_SLAVE_H
 #define _MB_CONTROLLER_SLAVE_H
 
+#include <stdatomic.h>      // for notification ring indexes
 #include "driver/uart.h"    // for uart defines
 #include "errno.h"          // for errno
 #include "sys/queue.h"      // for list
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h" // for notification ring semaphore
 #include "esp_log.h"        // for log write
 #include "string.h"         // for strerror()
 
@@ -22,6 +25,16 @@
 
 #define MB_CONTROLLER_NOTIFY_QUEUE_SIZE     (CONFIG_FMB_CONTROLLER_NOTIFY_QUEUE_SIZE) // Number of messages in parameter notification queue
 #define MB_CONTROLLER_NOTIFY_TIMEOUT        (pdMS_TO_TICKS(CONFIG_FMB_CONTROLLER_NOTIFY_TIMEOUT)) // notification timeout
+#define MB_NOTIFY_COALESCE_DEPTH            (4) // Number of the newest ring entries checked for coalescing
+#define MB_EVENT_ACCESS_MASK                (MB_EVENT_HOLDING_REG_WR | MB_EVENT_HOLDING_REG_RD \
+                                                | MB_EVENT_INPUT_REG_RD | MB_EVENT_COILS_WR \
+                                                | MB_EVENT_COILS_RD | MB_EVENT_DISCRETE_RD) // All access events
+#define MB_DESCR_PAGE_SHIFT                 (6) // The page of descriptor index is 64 registers (bits)
+#ifdef CONFIG_FMB_CONTROLLER_SLAVE_DESCR_PAGES
+#define MB_DESCR_PAGES_MAX                  (CONFIG_FMB_CONTROLLER_SLAVE_DESCR_PAGES) // Page index size limit
+#else
+#define MB_DESCR_PAGES_MAX                  (128)
+#endif
 
 /**
  * @brief Device communication parameters for master
@@ -42,9 +55,66 @@ typedef struct mb_descr_entry_s{
     mb_param_type_t type;                   /*!< Type of storage area descriptor */
     void* p_data;                           /*!< Instance address for storage area descriptor */
     size_t size;                            /*!< Instance size for area descriptor (bytes) */
+    uint8_t elem_size;                      /*!< Size of the area values (bytes) */
+    mb_word_order_t word_order;             /*!< Order of the value bytes in the registers */
+    mb_seqlock_t* seqlock;                  /*!< Sequence lock of the area data or NULL */
     LIST_ENTRY(mb_descr_entry_s) entries;    /*!< The Modbus area descriptor entry */
 } mb_descr_entry_t;
 
+/**
+ * @brief Modbus address range of the area descriptor in the lookup index
+ */
+typedef struct {
+    uint32_t start;                         /*!< First register (bit) of the area */
+    uint32_t end;                           /*!< Register (bit) following the last one of the area */
+    mb_descr_entry_t* descr;                /*!< Area descriptor */
+} mb_descr_range_t;
+
+/**
+ * @brief Lookup index of the area descriptors of one type, built on controller start
+ */
+typedef struct {
+    mb_descr_range_t* ranges;               /*!< Descriptor ranges sorted by start address */
+    uint16_t count;                         /*!< Number of ranges */
+    uint16_t* pages;                        /*!< Number of ranges starting at or below each page base, NULL if not built */
+    uint32_t page_base;                     /*!< Address of the first page */
+    uint16_t page_count;                    /*!< Number of pages (the pages array has one more sentinel entry) */
+} mb_descr_index_t;
+
+/**
+ * @brief Value of the unmapped registers between the areas
+ */
+typedef struct {
+    bool enable;                            /*!< The unmapped registers between the areas are readable */
+    uint16_t value;                         /*!< Value read from the unmapped registers */
+} mb_gap_fill_t;
+
+/**
+ * @brief Entry of the parameter notification ring
+ */
+typedef struct {
+    mb_param_info_t info;                   /*!< Parameter access information */
+    atomic_uint hits;                       /*!< Number of the accesses, zero once taken by the consumer */
+} mb_param_ring_entry_t;
+
+/**
+ * @brief Single producer single consumer ring of the parameter access notifications
+ *
+ * The stack task is the only producer and the application task is the only consumer.
+ * Repeated accesses to the same area are merged into the pending entry of the area.
+ */
+typedef struct {
+    mb_param_ring_entry_t* entries;         /*!< Ring entries, the number of entries is a power of two */
+    uint32_t mask;                          /*!< Index mask of the ring */
+    atomic_uint head;                       /*!< Free running index of the next entry to put */
+    atomic_uint tail;                       /*!< Free running index of the next entry to take */
+    atomic_uint event_mask;                 /*!< Events put into the ring */
+    atomic_uint queued;                     /*!< Number of entries put into the ring */
+    atomic_uint coalesced;                  /*!< Number of accesses merged into the pending entries */
+    atomic_uint overflows;                  /*!< Number of accesses dropped with the full ring */
+    SemaphoreHandle_t ready;                /*!< Given when an entry is put into the ring */
+} mb_param_ring_t;
+
 /**
  * @brief Modbus controller handler structure
  */
@@ -53,8 +123,12 @@ typedef struct {
     mb_communication_info_t mbs_comm;                   /*!< communication info */
     TaskHandle_t mbs_task_handle;                       /*!< task handle */
     EventGroupHandle_t mbs_event_group;                 /*!< controller event group */
-    QueueHandle_t mbs_notification_queue_handle;        /*!< controller notification queue */
+    mb_param_ring_t mbs_notify_ring;                    /*!< controller notification ring */
+    xMBHandle mbs_stack_handle;                         /*!< Modbus stack instance of the controller */
     LIST_HEAD(mbs_area_descriptors_, mb_descr_entry_s) mbs_area_descriptors[MB_PARAM_COUNT]; /*!< register area descriptors */
+    mb_descr_index_t mbs_descr_index[MB_PARAM_COUNT];   /*!< lookup index of descriptors, frozen on start */
+    bool mbs_descr_frozen;                              /*!< descriptors are indexed and can not be changed */
+    mb_gap_fill_t mbs_gap_fill[MB_PARAM_COUNT];         /*!< fill value of the gaps between the register areas */
 } mb_slave_options_t;
 
 typedef mb_event_group_t (*iface_check_event)(mb_event_group_t);          /*!< Interface method check_event */
@@ -84,4 +158,35 @@ typedef struct
     reg_coils_cb slave_reg_cb_coils;        /*!< Stack callback coils rw method */
 } mb_slave_interface_t;
 
+/**
+ * @brief Create the parameter notification ring of the controller
+ *
+ * @param ring ring to initialize
+ * @param size number of entries, rounded up to a power of two
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_NO_MEM Not enough memory for the ring
+ */
+esp_err_t mbc_slave_notify_ring_create(mb_param_ring_t* ring, size_t size);
+
+/**
+ * @brief Delete the parameter notification ring of the controller
+ *
+ * @param ring ring to delete
+ */
+void mbc_slave_notify_ring_delete(mb_param_ring_t* ring);
+
+/**
+ * @brief Take the parameter notifications from the ring, waiting for the first one
+ *
+ * @param ring ring of the controller
+ * @param[out] reg_info array of parameter info structures
+ * @param max_count number of structures in the array
+ * @param timeout timeout in milliseconds to wait for a notification
+ *
+ * @return number of the structures filled, zero on timeout
+ */
+size_t mbc_slave_notify_ring_get(mb_param_ring_t* ring, mb_param_info_t* reg_info, size_t max_count, uint32_t timeout);
+
 #endif
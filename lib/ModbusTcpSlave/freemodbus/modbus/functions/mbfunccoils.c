@@ -120,6 +120,9 @@ eMBFuncReadCoils( UCHAR * pucFrame, USHORT * usLen )
             *pucFrameCur++ = ucNBytes;
             *usLen += 1;
 
+            /* The callback copies the bits only, clear the unused ones. */
+            pucFrameCur[ucNBytes - 1] = 0;
+
             eRegStatus =
                 eMBRegCoilsCB( pucFrameCur, usRegAddress, usCoilCount,
                                MB_REG_READ );
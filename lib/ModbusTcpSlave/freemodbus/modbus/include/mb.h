@@ -154,6 +154,9 @@ typedef enum
  *    - eMBErrorCode::MB_EINVAL If the slave address was not valid. Valid
  *        slave addresses are in the range 1 - 247.
  *    - eMBErrorCode::MB_EPORTERR IF the porting layer returned an error.
+ *    - eMBErrorCode::MB_EILLSTATE If the stack is initialized already.
+ *        The single instance API ( eMBEnable( ), eMBPoll( ), ... ) uses one
+ *        instance, see eMBInitHdl( ) for the independent instances.
  */
 eMBErrorCode    eMBInit( eMBMode eMode, UCHAR ucSlaveAddress,
                          UCHAR ucPort, ULONG ulBaudRate, eMBParity eParity );
@@ -172,6 +175,7 @@ eMBErrorCode    eMBInit( eMBMode eMode, UCHAR ucSlaveAddress,
  *    - eMBErrorCode::MB_EINVAL If the slave address was not valid. Valid
  *        slave addresses are in the range 1 - 247.
  *    - eMBErrorCode::MB_EPORTERR IF the porting layer returned an error.
+ *    - eMBErrorCode::MB_EILLSTATE If the stack is initialized already.
  */
 eMBErrorCode    eMBTCPInit( UCHAR ucSlaveUid, USHORT usTCPPort );
 
@@ -228,6 +232,67 @@ eMBErrorCode    eMBDisable( void );
  */
 eMBErrorCode    eMBPoll( void );
 
+/*! \ingroup modbus
+ * \brief Initialize the Modbus stack instance for Modbus RTU or ASCII.
+ *
+ * The instance keeps the state of the stack, so the serial and the TCP stacks
+ * can run at the same time, each polled by its own task with eMBPollHdl( ).
+ * The register callbacks and the function handlers are shared by the instances.
+ * The parameters are the same as for eMBInit( ).
+ *
+ * \param pxHdl Returns the handle of the initialized instance.
+ *
+ * \return eMBErrorCode::MB_ENOERR on success. eMBErrorCode::MB_EILLSTATE if
+ *   the serial transport already serves another instance, eMBErrorCode::MB_ENORES
+ *   if the instance can not be allocated. The other error codes as for eMBInit( ).
+ */
+eMBErrorCode    eMBInitHdl( xMBHandle * pxHdl, eMBMode eMode, UCHAR ucSlaveAddress,
+                            UCHAR ucPort, ULONG ulBaudRate, eMBParity eParity );
+
+/*! \ingroup modbus
+ * \brief Initialize the Modbus stack instance for Modbus TCP.
+ *
+ * \param pxHdl Returns the handle of the initialized instance.
+ *
+ * \return eMBErrorCode::MB_ENOERR on success. eMBErrorCode::MB_EILLSTATE if
+ *   the TCP transport already serves another instance, eMBErrorCode::MB_ENORES
+ *   if the instance can not be allocated. The other error codes as for eMBTCPInit( ).
+ */
+eMBErrorCode    eMBTCPInitHdl( xMBHandle * pxHdl, UCHAR ucSlaveUid, USHORT usTCPPort );
+
+/*! \ingroup modbus
+ * \brief Release the stack instance, see eMBClose( ).
+ *
+ * The handle is invalid after the instance is closed.
+ */
+eMBErrorCode    eMBCloseHdl( xMBHandle xHdl );
+
+/*! \ingroup modbus
+ * \brief Enable the stack instance, see eMBEnable( ).
+ */
+eMBErrorCode    eMBEnableHdl( xMBHandle xHdl );
+
+/*! \ingroup modbus
+ * \brief Disable the stack instance, see eMBDisable( ).
+ */
+eMBErrorCode    eMBDisableHdl( xMBHandle xHdl );
+
+/*! \ingroup modbus
+ * \brief Poll the stack instance, see eMBPoll( ).
+ *
+ * The events of the instance are delivered to the task which polls it, so
+ * every instance must be polled by its own task.
+ */
+eMBErrorCode    eMBPollHdl( xMBHandle xHdl );
+
+/*! \ingroup modbus
+ * \brief Return the instance whose function handler is executing.
+ *
+ * Valid inside the register callbacks only, which are executed with the
+ * handler lock held. Returns NULL outside of a handler.
+ */
+xMBHandle       xMBGetExecHdl( void );
+
 /*! \ingroup modbus
  * \brief Configure the slave id of the device.
  *
@@ -265,10 +330,10 @@ eMBErrorCode    eMBSetSlaveID( UCHAR ucSlaveID, BOOL xIsRunning,
  *   such a frame is received. If \c NULL a previously registered function handler
  *   for this function code is removed.
  *
- * \return eMBErrorCode::MB_ENOERR if the handler has been installed. If no
- *   more resources are available it returns eMBErrorCode::MB_ENORES. In this
- *   case the values in mbconfig.h should be adjusted. If the argument was not
- *   valid it returns eMBErrorCode::MB_EINVAL.
+ * The handler replaces the built-in handler of the function code, if any.
+ *
+ * \return eMBErrorCode::MB_ENOERR if the handler has been installed or removed.
+ *   If the argument was not valid it returns eMBErrorCode::MB_EINVAL.
  */
 eMBErrorCode    eMBRegisterCB( UCHAR ucFunctionCode,
                                pxMBFunctionHandler pxHandler );
@@ -93,6 +93,28 @@ PR_BEGIN_EXTERN_C
  */
 #define MB_TCP_UID_ENABLED                      (  CONFIG_FMB_TCP_UID_ENABLED )
 
+/*! \brief If the TCP slave port answers the read holding and input registers
+ * requests in the port task without the event round trip through the stack task.
+ */
+#define MB_TCP_FAST_READ_ENABLED                (  CONFIG_FMB_TCP_FAST_READ_EN )
+
+/*! \brief If the slave stack collects the request latency histograms.
+ */
+#define MB_STATS_ENABLED                        (  CONFIG_FMB_STATS_EN )
+
+/*! \brief Number of bytes folded into the RTU CRC16 per table lookup step.
+ *
+ * The slice-by-4 and slice-by-8 variants use 2 and 4 KB of tables instead
+ * of the 512 bytes of the classic byte tables.
+ */
+#if CONFIG_FMB_CRC16_SLICE8
+#define MB_CRC16_SLICE                          ( 8 )
+#elif CONFIG_FMB_CRC16_SLICE4
+#define MB_CRC16_SLICE                          ( 4 )
+#else
+#define MB_CRC16_SLICE                          ( 1 )
+#endif
+
 /*! \brief This option defines the number of data bits per ASCII character.
  *
  * A parity bit is added before the stop bit which keeps the actual byte size at 10 bits.
@@ -132,9 +154,9 @@ PR_BEGIN_EXTERN_C
 /*! \brief Maximum number of Modbus functions codes the protocol stack
  *    should support.
  *
- * The maximum number of supported Modbus functions must be greater than
- * the sum of all enabled functions in this file and custom function
- * handlers. If set to small adding more functions will fail.
+ * The handlers are kept in the tables indexed by the function code, which
+ * hold every code from 1 to 127. The value is not used by the stack any more
+ * and is kept for the applications which refer to it.
  */
 #define MB_FUNC_HANDLERS_MAX                    ( 16 )
 
@@ -39,6 +39,7 @@
 #define _MB_FRAME_H
 
 #include "port.h"
+#include "mbport.h"
 
 #ifdef __cplusplus
 PR_BEGIN_EXTERN_C
@@ -110,6 +111,15 @@ typedef eMBErrorCode( *peMBFrameSend ) ( UCHAR slaveAddress,
 
 typedef void( *pvMBFrameClose ) ( void );
 
+typedef void( *pvMBFrameRelease ) ( void );
+
+/* Post the event of the transport to the stack instance it is bound to,
+ * can be called from the ISR. */
+BOOL            xMBEventPost( xMBHandle xHdl, eMBEventType eEvent );
+
+/*! \brief Frame buffer of a serial instance (MB_SERIAL_BUF_SIZE bytes). */
+volatile UCHAR *pucMBSerialBuf( xMBHandle xHdl );
+
 #ifdef __cplusplus
 PR_END_EXTERN_C
 #endif
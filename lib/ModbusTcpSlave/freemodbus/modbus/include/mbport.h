@@ -59,6 +59,17 @@ PR_BEGIN_EXTERN_C
 
 /* ----------------------- Type definitions ---------------------------------*/
 
+/*! \ingroup modbus
+ * \brief Handle of the slave stack instance.
+ *
+ * The instance keeps the state of one slave stack. The transports are bound
+ * to the instance they were initialized for and post their events to it.
+ */
+typedef struct xMBInstanceStruct *xMBHandle;
+
+/*! \brief Event channel of the slave stack instance, defined by the port. */
+typedef struct xMBPortEventStruct xMBPortEvent;
+
 typedef enum
 {
     EV_READY = 0x01,                   /*!< Startup finished. */
@@ -116,11 +127,13 @@ typedef enum
 } eMBParity;
 
 /* ----------------------- Supporting functions -----------------------------*/
-BOOL            xMBPortEventInit( void );
+BOOL            xMBPortEventInit( xMBPortEvent * pxEvent );
+
+void            vMBPortEventClose( xMBPortEvent * pxEvent );
 
-BOOL            xMBPortEventPost( eMBEventType eEvent );
+BOOL            xMBPortEventPost( xMBPortEvent * pxEvent, eMBEventType eEvent );
 
-BOOL            xMBPortEventGet(  /*@out@ */ eMBEventType * eEvent );
+BOOL            xMBPortEventGet( xMBPortEvent * pxEvent, /*@out@ */ eMBEventType * eEvent );
 
 #if MB_MASTER_RTU_ENABLED || MB_MASTER_ASCII_ENABLED || MB_MASTER_TCP_ENABLED
 BOOL            xMBMasterPortEventInit( void );
@@ -204,6 +217,9 @@ void            vMBMasterPortTimersConvertDelayEnable( void );
 
 void            vMBMasterPortTimersRespondTimeoutEnable( void );
 
+/* Sets the respond timeout of the next requests, 0 restores MB_MASTER_TIMEOUT_MS_RESPOND. */
+void            vMBMasterPortTimersSetRespondTimeout( ULONG ulTimeoutMs );
+
 void            vMBMasterPortTimersDisable( void );
 
 
@@ -225,22 +241,48 @@ void            vMBMasterCBRequestSuccess( uint64_t xTransId, UCHAR ucDestAddres
 #endif
 /* ----------------------- Callback for the protocol stack ------------------*/
 /*!
- * \brief Callback function for the porting layer when a new byte is
- *   available.
- *
- * Depending upon the mode this callback function is used by the RTU or
- * ASCII transmission layers. In any case a call to xMBPortSerialGetByte()
- * must immediately return a new character.
+ * \brief Callback functions for the serial porting layer.
  *
- * \return <code>TRUE</code> if a event was posted to the queue because
- *   a new byte was received. The port implementation should wake up the
- *   tasks which are currently blocked on the eventqueue.
+ * They belong to the stack instance bound to the serial transport and are
+ * set by eMBInitHdl( ) for its mode (RTU or ASCII).
  */
-extern          BOOL( *pxMBFrameCBByteReceived ) ( void );
-
-extern          BOOL( *pxMBFrameCBTransmitterEmpty ) ( void );
+typedef struct
+{
+    /*!
+     * \brief Called when a new byte is available.
+     *
+     * A call to xMBPortSerialGetByte() must immediately return a new
+     * character.
+     *
+     * \return <code>TRUE</code> if a event was posted to the queue because
+     *   a new byte was received. The port implementation should wake up the
+     *   tasks which are currently blocked on the eventqueue.
+     */
+    BOOL( *pxByteReceived ) ( void );
+
+    /*!
+     * \brief Called when the complete frame is received.
+     *
+     * The ports which detect the t3.5 silence themselves (UART receive timeout)
+     * pass all the bytes received before the silence in one call instead of the
+     * byte callback and the t3.5 timer expiration. NULL for the transmission
+     * layers without the frame mode.
+     *
+     * \return <code>TRUE</code> if a event was posted to the queue.
+     */
+    BOOL( *pxFrameReceived ) ( const UCHAR * pucData, USHORT usLength );
+
+    BOOL( *pxTransmitterEmpty ) ( void );
+
+    BOOL( *pxTimerExpired ) ( void );
+} xMBSerialFrameCB;
 
-extern          BOOL( *pxMBPortCBTimerExpired ) ( void );
+/*!
+ * \brief The callbacks of the instance bound to the serial transport.
+ *
+ * \return NULL if no instance is bound to the serial transport.
+ */
+xMBSerialFrameCB *pxMBSerialFrameCB( void );
 
 #if MB_MASTER_RTU_ENABLED || MB_MASTER_ASCII_ENABLED || MB_MASTER_TCP_ENABLED
 extern          BOOL( *pxMBMasterFrameCBByteReceived ) ( void );
@@ -251,7 +293,7 @@ extern          BOOL( *pxMBMasterPortCBTimerExpired ) ( void );
 #endif
 /* ----------------------- TCP port functions -------------------------------*/
 #if MB_TCP_ENABLED
-BOOL            xMBTCPPortInit( USHORT usTCPPort );
+BOOL            xMBTCPPortInit( xMBHandle xHdl, USHORT usTCPPort );
 
 void            vMBTCPPortClose( void );
 
@@ -263,6 +305,16 @@ BOOL            xMBTCPPortGetRequest( UCHAR **ppucMBTCPFrame, USHORT * usTCPLeng
 
 BOOL            xMBTCPPortSendResponse( UCHAR *pucMBTCPFrame, USHORT usTCPLength );
 
+/* Called instead of xMBTCPPortSendResponse( ) when the stack does not answer
+ * the request taken by xMBTCPPortGetRequest( ). */
+void            vMBTCPPortReleaseRequest( void );
+
+#if MB_TCP_FAST_READ_ENABLED
+/* Executed by the port task to answer the read request in place,
+ * returns FALSE if the request has to be processed by the stack. */
+BOOL            xMBTCPFastRead( xMBHandle xHdl, UCHAR * pucMBTCPFrame, USHORT * pusTCPLength );
+#endif
+
 #endif
 
 #if MB_MASTER_TCP_ENABLED
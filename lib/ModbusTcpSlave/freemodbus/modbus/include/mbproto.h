@@ -61,6 +61,7 @@ PR_BEGIN_EXTERN_C
 #define MB_FUNC_DIAG_GET_COM_EVENT_LOG        ( 12 )
 #define MB_FUNC_OTHER_REPORT_SLAVEID          ( 17 )
 #define MB_FUNC_ERROR                         ( 128u )
+#define MB_FUNC_TABLE_SIZE                    ( 128 )   /*! Function codes indexing the handler tables. */
 /* ----------------------- Type definitions ---------------------------------*/
 typedef enum
 {
@@ -49,6 +49,7 @@
 #include "mbproto.h"
 #include "mbfunc.h"
 #include "mbport.h"
+#include "mbstats.h"
 
 #if MB_SLAVE_RTU_ENABLED
 #include "mbrtu.h"
@@ -64,119 +65,238 @@
 #define MB_PORT_HAS_CLOSE 1
 #endif
 
-/* ----------------------- Static variables ---------------------------------*/
-
-static UCHAR    ucMBAddress;
-static eMBMode  eMBCurrentMode;
-
-volatile UCHAR ucMbSlaveBuf[MB_SERIAL_BUF_SIZE];
-
-static enum
+/* ----------------------- Type definitions ---------------------------------*/
+typedef enum
 {
     STATE_ENABLED,
     STATE_DISABLED,
     STATE_NOT_INITIALIZED
-} eMBState = STATE_NOT_INITIALIZED;
+} eMBStackState;
 
-/* Functions pointer which are initialized in eMBInit( ). Depending on the
- * mode (RTU or ASCII) the are set to the correct implementations.
+/* The state of one slave stack instance. The serial and TCP transports are
+ * bound to their own instances, so both stacks can be polled at the same time
+ * by their tasks.
  */
-static peMBFrameSend peMBFrameSendCur;
-static pvMBFrameStart pvMBFrameStartCur;
-static pvMBFrameStop pvMBFrameStopCur;
-static peMBFrameReceive peMBFrameReceiveCur;
-static pvMBFrameClose pvMBFrameCloseCur;
-
-/* Callback functions required by the porting layer. They are called when
- * an external event has happend which includes a timeout or the reception
- * or transmission of a character.
+struct xMBInstanceStruct
+{
+    UCHAR           ucMBAddress;
+    eMBMode         eMBCurrentMode;
+    eMBStackState   eMBState;
+
+    /* Functions pointer which are initialized in eMBInitHdl( ). Depending on the
+     * mode (RTU, ASCII or TCP) the are set to the correct implementations.
+     */
+    peMBFrameSend   peMBFrameSendCur;
+    pvMBFrameStart  pvMBFrameStartCur;
+    pvMBFrameStop   pvMBFrameStopCur;
+    peMBFrameReceive peMBFrameReceiveCur;
+    pvMBFrameClose  pvMBFrameCloseCur;
+    /* Releases the received frame which is not answered, NULL if the transport
+     * does not keep the frame for the response. */
+    pvMBFrameRelease pvMBFrameReleaseCur;
+
+    /* Events posted by the transport to the polling task. */
+    xMBPortEvent    xEvent;
+
+    /* Callbacks of the serial port, set by eMBInitHdl( ) for the mode. */
+    xMBSerialFrameCB xSerialCB;
+
+    /* The frame taken by eMBPollHdl( ) until it is executed. */
+    UCHAR          *pucMBFrame;
+    UCHAR           ucRcvAddress;
+    USHORT          usLength;
+#if MB_STATS_ENABLED
+    int64_t         xStatsReceived;
+#endif
+
+    /* Frame buffer of the serial transmission layers, allocated with the
+     * serial instances only. */
+    volatile UCHAR  ucSerialBuf[];
+};
+
+/* ----------------------- Static variables ---------------------------------*/
+
+/* The instances bound to the serial and TCP transports. Every transport has a
+ * single port, so it serves at most one instance.
  */
-BOOL( *pxMBFrameCBByteReceived ) ( void );
-BOOL( *pxMBFrameCBTransmitterEmpty ) ( void );
-BOOL( *pxMBPortCBTimerExpired ) ( void );
-BOOL( *pxMBFrameCBReceiveFSMCur ) ( void );
-BOOL( *pxMBFrameCBTransmitFSMCur ) ( void );
-
-/* An array of Modbus functions handlers which associates Modbus function
- * codes with implementing functions.
+static xMBHandle xMBSerialHdl = NULL;
+static xMBHandle xMBTCPHdl = NULL;
+
+/* The instance of the single instance API ( eMBInit( ), eMBPoll( ), ... ). */
+static xMBHandle xMBDefaultHdl = NULL;
+
+/* The Modbus function handlers indexed by the function code, so the handler
+ * of a request is found with a single lookup. Unsupported codes are NULL.
  */
-static xMBFunctionHandler xFuncHandlers[MB_FUNC_HANDLERS_MAX] = {
+static pxMBFunctionHandler xFuncHandlers[MB_FUNC_TABLE_SIZE] = {
 #if MB_FUNC_OTHER_REP_SLAVEID_ENABLED > 0
-    {MB_FUNC_OTHER_REPORT_SLAVEID, eMBFuncReportSlaveID},
+    [MB_FUNC_OTHER_REPORT_SLAVEID] = eMBFuncReportSlaveID,
 #endif
 #if MB_FUNC_READ_INPUT_ENABLED > 0
-    {MB_FUNC_READ_INPUT_REGISTER, eMBFuncReadInputRegister},
+    [MB_FUNC_READ_INPUT_REGISTER] = eMBFuncReadInputRegister,
 #endif
 #if MB_FUNC_READ_HOLDING_ENABLED > 0
-    {MB_FUNC_READ_HOLDING_REGISTER, eMBFuncReadHoldingRegister},
+    [MB_FUNC_READ_HOLDING_REGISTER] = eMBFuncReadHoldingRegister,
 #endif
 #if MB_FUNC_WRITE_MULTIPLE_HOLDING_ENABLED > 0
-    {MB_FUNC_WRITE_MULTIPLE_REGISTERS, eMBFuncWriteMultipleHoldingRegister},
+    [MB_FUNC_WRITE_MULTIPLE_REGISTERS] = eMBFuncWriteMultipleHoldingRegister,
 #endif
 #if MB_FUNC_WRITE_HOLDING_ENABLED > 0
-    {MB_FUNC_WRITE_REGISTER, eMBFuncWriteHoldingRegister},
+    [MB_FUNC_WRITE_REGISTER] = eMBFuncWriteHoldingRegister,
 #endif
 #if MB_FUNC_READWRITE_HOLDING_ENABLED > 0
-    {MB_FUNC_READWRITE_MULTIPLE_REGISTERS, eMBFuncReadWriteMultipleHoldingRegister},
+    [MB_FUNC_READWRITE_MULTIPLE_REGISTERS] = eMBFuncReadWriteMultipleHoldingRegister,
 #endif
 #if MB_FUNC_READ_COILS_ENABLED > 0
-    {MB_FUNC_READ_COILS, eMBFuncReadCoils},
+    [MB_FUNC_READ_COILS] = eMBFuncReadCoils,
 #endif
 #if MB_FUNC_WRITE_COIL_ENABLED > 0
-    {MB_FUNC_WRITE_SINGLE_COIL, eMBFuncWriteCoil},
+    [MB_FUNC_WRITE_SINGLE_COIL] = eMBFuncWriteCoil,
 #endif
 #if MB_FUNC_WRITE_MULTIPLE_COILS_ENABLED > 0
-    {MB_FUNC_WRITE_MULTIPLE_COILS, eMBFuncWriteMultipleCoils},
+    [MB_FUNC_WRITE_MULTIPLE_COILS] = eMBFuncWriteMultipleCoils,
 #endif
 #if MB_FUNC_READ_DISCRETE_INPUTS_ENABLED > 0
-    {MB_FUNC_READ_DISCRETE_INPUTS, eMBFuncReadDiscreteInputs},
+    [MB_FUNC_READ_DISCRETE_INPUTS] = eMBFuncReadDiscreteInputs,
 #endif
 };
 
+/* The handlers access the register areas shared by all the instances and are
+ * also executed by the TCP port task for the fast reads. The lock keeps them
+ * from running concurrently, it is created on first use as the port lock.
+ */
+static _lock_t  xMBHandlerLock;
+
+/* The instance whose handler runs under the lock, read by the register callbacks. */
+static xMBHandle xMBExecHdl;
+
+/* ----------------------- Static functions ---------------------------------*/
+static eMBException
+prveMBExecuteHandler( xMBHandle xHdl, pxMBFunctionHandler pxHandler, UCHAR * pucFrame, USHORT * pusLength )
+{
+    eMBException    eException = MB_EX_SLAVE_DEVICE_FAILURE;
+    CRITICAL_SECTION( xMBHandlerLock )
+    {
+        xMBExecHdl = xHdl;
+        eException = pxHandler( pucFrame, pusLength );
+        xMBExecHdl = NULL;
+    }
+    return eException;
+}
+
+static pxMBFunctionHandler
+prxMBGetHandler( UCHAR ucFunctionCode )
+{
+    /* The codes with the error bit set are not valid requests. */
+    return ( ucFunctionCode < MB_FUNC_TABLE_SIZE ) ? xFuncHandlers[ucFunctionCode] : NULL;
+}
+
+/* Allocates the instance and binds it to the transport, fails if the
+ * transport already serves another instance. */
+static eMBErrorCode
+prveMBInstanceCreate( xMBHandle * pxTransportHdl, xMBHandle * pxHdl, size_t xSerialBufSize )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+    xMBHandle       xHdl = calloc( 1, sizeof( struct xMBInstanceStruct ) + xSerialBufSize );
+
+    if( xHdl == NULL )
+    {
+        return MB_ENORES;
+    }
+    xHdl->eMBState = STATE_NOT_INITIALIZED;
+    /* The transport may post the events as soon as it is initialized. */
+    if( !xMBPortEventInit( &xHdl->xEvent ) )
+    {
+        free( xHdl );
+        return MB_EPORTERR;
+    }
+    ENTER_CRITICAL_SECTION(  );
+    if( *pxTransportHdl == NULL )
+    {
+        *pxTransportHdl = xHdl;
+    }
+    else
+    {
+        eStatus = MB_EILLSTATE;
+    }
+    EXIT_CRITICAL_SECTION(  );
+    if( eStatus != MB_ENOERR )
+    {
+        vMBPortEventClose( &xHdl->xEvent );
+        free( xHdl );
+        xHdl = NULL;
+    }
+    *pxHdl = xHdl;
+    return eStatus;
+}
+
+static void
+prvvMBInstanceDestroy( xMBHandle * pxTransportHdl, xMBHandle xHdl )
+{
+    ENTER_CRITICAL_SECTION(  );
+    if( *pxTransportHdl == xHdl )
+    {
+        *pxTransportHdl = NULL;
+    }
+    EXIT_CRITICAL_SECTION(  );
+    vMBPortEventClose( &xHdl->xEvent );
+    free( xHdl );
+}
+
+static xMBHandle *
+prvpxMBTransportHdl( xMBHandle xHdl )
+{
+    return ( xHdl->eMBCurrentMode == MB_TCP ) ? &xMBTCPHdl : &xMBSerialHdl;
+}
+
 /* ----------------------- Start implementation -----------------------------*/
 eMBErrorCode
-eMBInit( eMBMode eMode, UCHAR ucSlaveAddress, UCHAR ucPort, ULONG ulBaudRate, eMBParity eParity )
+eMBInitHdl( xMBHandle * pxHdl, eMBMode eMode, UCHAR ucSlaveAddress, UCHAR ucPort, ULONG ulBaudRate, eMBParity eParity )
 {
     eMBErrorCode    eStatus = MB_ENOERR;
+    xMBHandle       xHdl = NULL;
 
     /* check preconditions */
-    if( ( ucSlaveAddress == MB_ADDRESS_BROADCAST ) ||
+    if( ( pxHdl == NULL ) || ( ucSlaveAddress == MB_ADDRESS_BROADCAST ) ||
         ( ucSlaveAddress < MB_ADDRESS_MIN ) || ( ucSlaveAddress > MB_ADDRESS_MAX ) )
     {
         eStatus = MB_EINVAL;
     }
-    else
+    else if( ( eStatus = prveMBInstanceCreate( &xMBSerialHdl, &xHdl, MB_SERIAL_BUF_SIZE ) ) == MB_ENOERR )
     {
-        ucMBAddress = ucSlaveAddress;
+        xHdl->ucMBAddress = ucSlaveAddress;
+        xHdl->eMBCurrentMode = eMode;
 
         switch ( eMode )
         {
 #if MB_SLAVE_RTU_ENABLED > 0
         case MB_RTU:
-            pvMBFrameStartCur = eMBRTUStart;
-            pvMBFrameStopCur = eMBRTUStop;
-            peMBFrameSendCur = eMBRTUSend;
-            peMBFrameReceiveCur = eMBRTUReceive;
-            pvMBFrameCloseCur = MB_PORT_HAS_CLOSE ? vMBPortClose : NULL;
-            pxMBFrameCBByteReceived = xMBRTUReceiveFSM;
-            pxMBFrameCBTransmitterEmpty = xMBRTUTransmitFSM;
-            pxMBPortCBTimerExpired = xMBRTUTimerT35Expired;
-
-            eStatus = eMBRTUInit( ucMBAddress, ucPort, ulBaudRate, eParity );
+            xHdl->pvMBFrameStartCur = eMBRTUStart;
+            xHdl->pvMBFrameStopCur = eMBRTUStop;
+            xHdl->peMBFrameSendCur = eMBRTUSend;
+            xHdl->peMBFrameReceiveCur = eMBRTUReceive;
+            xHdl->pvMBFrameCloseCur = MB_PORT_HAS_CLOSE ? vMBPortClose : NULL;
+            xHdl->xSerialCB.pxByteReceived = xMBRTUReceiveFSM;
+            xHdl->xSerialCB.pxFrameReceived = xMBRTUReceiveFrame;
+            xHdl->xSerialCB.pxTransmitterEmpty = xMBRTUTransmitFSM;
+            xHdl->xSerialCB.pxTimerExpired = xMBRTUTimerT35Expired;
+
+            eStatus = eMBRTUInit( xHdl, ucSlaveAddress, ucPort, ulBaudRate, eParity );
             break;
 #endif
 // #if MB_SLAVE_ASCII_ENABLED > 0
 //         case MB_ASCII:
-//             pvMBFrameStartCur = eMBASCIIStart;
-//             pvMBFrameStopCur = eMBASCIIStop;
-//             peMBFrameSendCur = eMBASCIISend;
-//             peMBFrameReceiveCur = eMBASCIIReceive;
-//             pvMBFrameCloseCur = MB_PORT_HAS_CLOSE ? vMBPortClose : NULL;
-//             pxMBFrameCBByteReceived = xMBASCIIReceiveFSM;
-//             pxMBFrameCBTransmitterEmpty = xMBASCIITransmitFSM;
-//             pxMBPortCBTimerExpired = xMBASCIITimerT1SExpired;
-
-//             eStatus = eMBASCIIInit( ucMBAddress, ucPort, ulBaudRate, eParity );
+//             xHdl->pvMBFrameStartCur = eMBASCIIStart;
+//             xHdl->pvMBFrameStopCur = eMBASCIIStop;
+//             xHdl->peMBFrameSendCur = eMBASCIISend;
+//             xHdl->peMBFrameReceiveCur = eMBASCIIReceive;
+//             xHdl->pvMBFrameCloseCur = MB_PORT_HAS_CLOSE ? vMBPortClose : NULL;
+//             xHdl->xSerialCB.pxByteReceived = xMBASCIIReceiveFSM;
+//             xHdl->xSerialCB.pxFrameReceived = NULL;
+//             xHdl->xSerialCB.pxTransmitterEmpty = xMBASCIITransmitFSM;
+//             xHdl->xSerialCB.pxTimerExpired = xMBASCIITimerT1SExpired;
+
+//             eStatus = eMBASCIIInit( xHdl, ucSlaveAddress, ucPort, ulBaudRate, eParity );
 //             break;
 // #endif
         default:
@@ -185,16 +305,12 @@ eMBInit( eMBMode eMode, UCHAR ucSlaveAddress, UCHAR ucPort, ULONG ulBaudRate, eM
 
         if( eStatus == MB_ENOERR )
         {
-            if( !xMBPortEventInit(  ) )
-            {
-                /* port dependent event module initalization failed. */
-                eStatus = MB_EPORTERR;
-            }
-            else
-            {
-                eMBCurrentMode = eMode;
-                eMBState = STATE_DISABLED;
-            }
+            xHdl->eMBState = STATE_DISABLED;
+            *pxHdl = xHdl;
+        }
+        else
+        {
+            prvvMBInstanceDestroy( &xMBSerialHdl, xHdl );
         }
     }
     return eStatus;
@@ -202,77 +318,116 @@ eMBInit( eMBMode eMode, UCHAR ucSlaveAddress, UCHAR ucPort, ULONG ulBaudRate, eM
 
 #if MB_TCP_ENABLED > 0
 eMBErrorCode
-eMBTCPInit( UCHAR ucSlaveUid, USHORT ucTCPPort )
+eMBTCPInitHdl( xMBHandle * pxHdl, UCHAR ucSlaveUid, USHORT ucTCPPort )
 {
     eMBErrorCode    eStatus = MB_ENOERR;
+    xMBHandle       xHdl = NULL;
 
     /* Check preconditions */
-    if( ucSlaveUid > MB_ADDRESS_MAX )
+    if( ( pxHdl == NULL ) || ( ucSlaveUid > MB_ADDRESS_MAX ) )
     {
         eStatus = MB_EINVAL;
     }
-    else if( ( eStatus = eMBTCPDoInit( ucTCPPort ) ) != MB_ENOERR )
+    else if( ( eStatus = prveMBInstanceCreate( &xMBTCPHdl, &xHdl, 0 ) ) == MB_ENOERR )
+    {
+        /* The port task is started by the port initialization. */
+        xHdl->pvMBFrameStartCur = eMBTCPStart;
+        xHdl->pvMBFrameStopCur = eMBTCPStop;
+        xHdl->peMBFrameReceiveCur = eMBTCPReceive;
+        xHdl->peMBFrameSendCur = eMBTCPSend;
+        xHdl->pvMBFrameCloseCur = MB_PORT_HAS_CLOSE ? vMBTCPPortClose : NULL;
+        xHdl->pvMBFrameReleaseCur = vMBTCPPortReleaseRequest;
+        xHdl->ucMBAddress = ucSlaveUid;
+        xHdl->eMBCurrentMode = MB_TCP;
+        xHdl->eMBState = STATE_DISABLED;
+        if( ( eStatus = eMBTCPDoInit( xHdl, ucTCPPort ) ) != MB_ENOERR )
+        {
+            prvvMBInstanceDestroy( &xMBTCPHdl, xHdl );
+        }
+        else
+        {
+            *pxHdl = xHdl;
+        }
+    }
+    return eStatus;
+}
+
+xMBHandle
+xMBGetExecHdl( void )
+{
+    return xMBExecHdl;
+}
+
+#if MB_TCP_FAST_READ_ENABLED
+BOOL
+xMBTCPFastRead( xMBHandle xHdl, UCHAR * pucMBTCPFrame, USHORT * pusTCPLength )
+{
+    UCHAR          *pucFrame = &pucMBTCPFrame[MB_TCP_FUNC];
+    USHORT          usLength = *pusTCPLength - MB_TCP_FUNC;
+    UCHAR           ucFunctionCode = pucFrame[MB_PDU_FUNC_OFF];
+    pxMBFunctionHandler pxHandler;
+    BOOL            xReadHandler = FALSE;
+    eMBException    eException;
+
+    if( ( xHdl == NULL ) || ( xHdl->eMBState != STATE_ENABLED ) || ( xHdl->eMBCurrentMode != MB_TCP ) )
     {
-        eMBState = STATE_DISABLED;
+        return FALSE;
     }
-    else if( !xMBPortEventInit(  ) )
+    /* Only the Modbus protocol identifier (0) is served. */
+    if( ( pucMBTCPFrame[MB_TCP_PID] != 0 ) || ( pucMBTCPFrame[MB_TCP_PID + 1] != 0 ) )
     {
-        /* Port dependent event module initalization failed. */
-        eStatus = MB_EPORTERR;
+        return FALSE;
     }
-    else
+#if MB_TCP_UID_ENABLED
+    if( ( pucMBTCPFrame[MB_TCP_UID] != xHdl->ucMBAddress ) && ( pucMBTCPFrame[MB_TCP_UID] != MB_ADDRESS_BROADCAST ) )
     {
-        pvMBFrameStartCur = eMBTCPStart;
-        pvMBFrameStopCur = eMBTCPStop;
-        peMBFrameReceiveCur = eMBTCPReceive;
-        peMBFrameSendCur = eMBTCPSend;
-        pvMBFrameCloseCur = MB_PORT_HAS_CLOSE ? vMBTCPPortClose : NULL;
-        ucMBAddress = ucSlaveUid;
-        eMBCurrentMode = MB_TCP;
-        eMBState = STATE_DISABLED;
+        return FALSE;
     }
-    return eStatus;
+#endif
+    pxHandler = prxMBGetHandler( ucFunctionCode );
+    /* The handlers replaced by eMBRegisterCB( ) are executed by the stack task only. */
+#if MB_FUNC_READ_HOLDING_ENABLED > 0
+    xReadHandler |= ( ucFunctionCode == MB_FUNC_READ_HOLDING_REGISTER )
+                        && ( pxHandler == eMBFuncReadHoldingRegister );
+#endif
+#if MB_FUNC_READ_INPUT_ENABLED > 0
+    xReadHandler |= ( ucFunctionCode == MB_FUNC_READ_INPUT_REGISTER )
+                        && ( pxHandler == eMBFuncReadInputRegister );
+#endif
+    if( !xReadHandler )
+    {
+        return FALSE;
+    }
+
+    eException = prveMBExecuteHandler( xHdl, pxHandler, pucFrame, &usLength );
+    if( eException != MB_EX_NONE )
+    {
+        usLength = 0;
+        pucFrame[usLength++] = ( UCHAR )( ucFunctionCode | MB_FUNC_ERROR );
+        pucFrame[usLength++] = eException;
+    }
+    /* The length field of MBAP header includes the UID byte. */
+    pucMBTCPFrame[MB_TCP_LEN] = ( usLength + 1 ) >> 8U;
+    pucMBTCPFrame[MB_TCP_LEN + 1] = ( usLength + 1 ) & 0xFF;
+    *pusTCPLength = usLength + MB_TCP_FUNC;
+    return TRUE;
 }
 #endif
+#endif
 
 eMBErrorCode
 eMBRegisterCB( UCHAR ucFunctionCode, pxMBFunctionHandler pxHandler )
 {
-    int             i;
     eMBErrorCode    eStatus;
 
     if( ( 0 < ucFunctionCode ) && ( ucFunctionCode <= MB_FUNC_CODE_MAX ) )
     {
+        /* The handler replaces the built-in one of the function code,
+         * NULL removes the function. Neither can fail. */
         ENTER_CRITICAL_SECTION(  );
-        if( pxHandler != NULL )
-        {
-            for( i = 0; i < MB_FUNC_HANDLERS_MAX; i++ )
-            {
-                if( ( xFuncHandlers[i].pxHandler == NULL ) ||
-                    ( xFuncHandlers[i].pxHandler == pxHandler ) )
-                {
-                    xFuncHandlers[i].ucFunctionCode = ucFunctionCode;
-                    xFuncHandlers[i].pxHandler = pxHandler;
-                    break;
-                }
-            }
-            eStatus = ( i != MB_FUNC_HANDLERS_MAX ) ? MB_ENOERR : MB_ENORES;
-        }
-        else
-        {
-            for( i = 0; i < MB_FUNC_HANDLERS_MAX; i++ )
-            {
-                if( xFuncHandlers[i].ucFunctionCode == ucFunctionCode )
-                {
-                    xFuncHandlers[i].ucFunctionCode = 0;
-                    xFuncHandlers[i].pxHandler = NULL;
-                    break;
-                }
-            }
-            /* Remove can't fail. */
-            eStatus = MB_ENOERR;
-        }
+        xFuncHandlers[ucFunctionCode] = pxHandler;
         EXIT_CRITICAL_SECTION(  );
+        eStatus = MB_ENOERR;
     }
     else
     {
@@ -283,16 +438,17 @@ eMBRegisterCB( UCHAR ucFunctionCode, pxMBFunctionHandler pxHandler )
 
 
 eMBErrorCode
-eMBClose( void )
+eMBCloseHdl( xMBHandle xHdl )
 {
     eMBErrorCode    eStatus = MB_ENOERR;
 
-    if( eMBState == STATE_DISABLED )
+    if( ( xHdl != NULL ) && ( xHdl->eMBState == STATE_DISABLED ) )
     {
-        if( pvMBFrameCloseCur != NULL )
+        if( xHdl->pvMBFrameCloseCur != NULL )
         {
-            pvMBFrameCloseCur(  );
+            xHdl->pvMBFrameCloseCur(  );
         }
+        prvvMBInstanceDestroy( prvpxMBTransportHdl( xHdl ), xHdl );
     }
     else
     {
@@ -302,15 +458,15 @@ eMBClose( void )
 }
 
 eMBErrorCode
-eMBEnable( void )
+eMBEnableHdl( xMBHandle xHdl )
 {
     eMBErrorCode    eStatus = MB_ENOERR;
 
-    if( eMBState == STATE_DISABLED )
+    if( ( xHdl != NULL ) && ( xHdl->eMBState == STATE_DISABLED ) )
     {
         /* Activate the protocol stack. */
-        pvMBFrameStartCur(  );
-        eMBState = STATE_ENABLED;
+        xHdl->pvMBFrameStartCur(  );
+        xHdl->eMBState = STATE_ENABLED;
     }
     else
     {
@@ -320,17 +476,21 @@ eMBEnable( void )
 }
 
 eMBErrorCode
-eMBDisable( void )
+eMBDisableHdl( xMBHandle xHdl )
 {
     eMBErrorCode    eStatus;
 
-    if( eMBState == STATE_ENABLED )
+    if( xHdl == NULL )
     {
-        pvMBFrameStopCur(  );
-        eMBState = STATE_DISABLED;
+        eStatus = MB_EILLSTATE;
+    }
+    else if( xHdl->eMBState == STATE_ENABLED )
+    {
+        xHdl->pvMBFrameStopCur(  );
+        xHdl->eMBState = STATE_DISABLED;
         eStatus = MB_ENOERR;
     }
-    else if( eMBState == STATE_DISABLED )
+    else if( xHdl->eMBState == STATE_DISABLED )
     {
         eStatus = MB_ENOERR;
     }
@@ -341,28 +501,58 @@ eMBDisable( void )
     return eStatus;
 }
 
+xMBSerialFrameCB * MB_PORT_ISR_ATTR
+pxMBSerialFrameCB( void )
+{
+    xMBHandle       xHdl = xMBSerialHdl;
+
+    return ( xHdl != NULL ) ? &xHdl->xSerialCB : NULL;
+}
+
+volatile UCHAR *
+pucMBSerialBuf( xMBHandle xHdl )
+{
+    return xHdl->ucSerialBuf;
+}
+
+BOOL MB_PORT_ISR_ATTR
+xMBEventPost( xMBHandle xHdl, eMBEventType eEvent )
+{
+    /* The transport may still run for a moment after its instance is closed. */
+    if( ( xHdl == NULL ) || ( ( xHdl != xMBSerialHdl ) && ( xHdl != xMBTCPHdl ) ) )
+    {
+        return FALSE;
+    }
+    return xMBPortEventPost( &xHdl->xEvent, eEvent );
+}
+
 eMBErrorCode
-eMBPoll( void )
+eMBPollHdl( xMBHandle xHdl )
 {
-    static UCHAR    *ucMBFrame = NULL;
-    static UCHAR    ucRcvAddress;
-    static UCHAR    ucFunctionCode;
-    static USHORT   usLength;
-    static eMBException eException;
+    UCHAR           ucFunctionCode;
+    eMBException    eException;
+#if MB_STATS_ENABLED
+    eMBStatsTransport eStatsTransport;
+    int64_t         xStatsDispatched;
+    int64_t         xStatsExecuted;
+#endif
 
-    int             i;
+    pxMBFunctionHandler pxHandler;
     eMBErrorCode    eStatus = MB_ENOERR;
     eMBEventType    eEvent;
 
     /* Check if the protocol stack is ready. */
-    if( eMBState != STATE_ENABLED )
+    if( ( xHdl == NULL ) || ( xHdl->eMBState != STATE_ENABLED ) )
     {
         return MB_EILLSTATE;
     }
+#if MB_STATS_ENABLED
+    eStatsTransport = ( xHdl->eMBCurrentMode == MB_TCP ) ? MB_STATS_TRANSPORT_TCP : MB_STATS_TRANSPORT_SERIAL;
+#endif
 
     /* Check if there is a event available. If not return control to caller.
      * Otherwise we will handle the event. */
-    if( xMBPortEventGet( &eEvent ) == TRUE )
+    if( xMBPortEventGet( &xHdl->xEvent, &eEvent ) == TRUE )
     {
         switch ( eEvent )
         {
@@ -372,57 +562,70 @@ eMBPoll( void )
 
         case EV_FRAME_RECEIVED:
             ESP_LOGD(MB_PORT_TAG, "EV_FRAME_RECEIVED");
-            eStatus = peMBFrameReceiveCur( &ucRcvAddress, &ucMBFrame, &usLength );
-            if( eStatus == MB_ENOERR )
+#if MB_STATS_ENABLED
+            xHdl->xStatsReceived = xMBStatsTakeReceived( eStatsTransport, xMBStatsTimeStamp( ) );
+#endif
+            eStatus = xHdl->peMBFrameReceiveCur( &xHdl->ucRcvAddress, &xHdl->pucMBFrame, &xHdl->usLength );
+            /* Check if the frame is for us. If not ignore the frame. */
+            if( ( eStatus != MB_ENOERR ) ||
+                ( ( xHdl->ucRcvAddress != xHdl->ucMBAddress ) && ( xHdl->ucRcvAddress != MB_ADDRESS_BROADCAST )
+                                            && ( xHdl->ucRcvAddress != MB_TCP_PSEUDO_ADDRESS ) ) )
             {
-                /* Check if the frame is for us. If not ignore the frame. */
-                if( ( ucRcvAddress == ucMBAddress ) || ( ucRcvAddress == MB_ADDRESS_BROADCAST ) 
-                                            || ( ucRcvAddress == MB_TCP_PSEUDO_ADDRESS ) )
+                /* The frame is not answered, so the transport does not wait for the response. */
+                if( xHdl->pvMBFrameReleaseCur != NULL )
                 {
-                    ( void )xMBPortEventPost( EV_EXECUTE );
-                    ESP_LOG_BUFFER_HEX_LEVEL(MB_PORT_TAG, &ucMBFrame[MB_PDU_FUNC_OFF], usLength, ESP_LOG_DEBUG);
+                    xHdl->pvMBFrameReleaseCur(  );
                 }
+                break;
             }
-            break;
-
+            ESP_LOG_BUFFER_HEX_LEVEL(MB_PORT_TAG, &xHdl->pucMBFrame[MB_PDU_FUNC_OFF], xHdl->usLength, ESP_LOG_DEBUG);
+            /* The frame is executed in the same wake-up of the task, EV_EXECUTE
+             * is kept for the ports which post it on their own. */
+            /* fall through */
         case EV_EXECUTE:
-            if ( !ucMBFrame ) {
+            if ( !xHdl->pucMBFrame ) {
                 return MB_EILLSTATE;
             }
             ESP_LOGD(MB_PORT_TAG, "%s:EV_EXECUTE", __func__);
-            ucFunctionCode = ucMBFrame[MB_PDU_FUNC_OFF];
+            ucFunctionCode = xHdl->pucMBFrame[MB_PDU_FUNC_OFF];
             eException = MB_EX_ILLEGAL_FUNCTION;
-            for( i = 0; i < MB_FUNC_HANDLERS_MAX; i++ )
+#if MB_STATS_ENABLED
+            xStatsDispatched = xMBStatsTimeStamp( );
+#endif
+            pxHandler = prxMBGetHandler( ucFunctionCode );
+            if( pxHandler != NULL )
             {
-                /* No more function handlers registered. Abort. */
-                if( xFuncHandlers[i].ucFunctionCode == 0 )
-                {
-                    break;
-                }
-                if( xFuncHandlers[i].ucFunctionCode == ucFunctionCode )
-                {
-                    eException = xFuncHandlers[i].pxHandler( ucMBFrame, &usLength );
-                    break;
-                }
+                eException = prveMBExecuteHandler( xHdl, pxHandler, xHdl->pucMBFrame, &xHdl->usLength );
             }
+#if MB_STATS_ENABLED
+            xStatsExecuted = xMBStatsTimeStamp( );
+#endif
 
             /* If the request was not sent to the broadcast address we
              * return a reply. In case of TCP the slave answers to broadcast address. */
-            if( ( ucRcvAddress != MB_ADDRESS_BROADCAST ) || ( eMBCurrentMode == MB_TCP ) )
+            if( ( xHdl->ucRcvAddress != MB_ADDRESS_BROADCAST ) || ( xHdl->eMBCurrentMode == MB_TCP ) )
             {
                 if( eException != MB_EX_NONE )
                 {
                     /* An exception occurred. Build an error frame. */
-                    usLength = 0;
-                    ucMBFrame[usLength++] = ( UCHAR )( ucFunctionCode | MB_FUNC_ERROR );
-                    ucMBFrame[usLength++] = eException;
+                    xHdl->usLength = 0;
+                    xHdl->pucMBFrame[xHdl->usLength++] = ( UCHAR )( ucFunctionCode | MB_FUNC_ERROR );
+                    xHdl->pucMBFrame[xHdl->usLength++] = eException;
                 }
-                if( ( eMBCurrentMode == MB_ASCII ) && MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS )
+                if( ( xHdl->eMBCurrentMode == MB_ASCII ) && MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS )
                 {
                     vMBPortTimersDelay( MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS );
                 }
-                eStatus = peMBFrameSendCur( ucMBAddress, ucMBFrame, usLength );
+                eStatus = xHdl->peMBFrameSendCur( xHdl->ucMBAddress, xHdl->pucMBFrame, xHdl->usLength );
+            }
+            else if( xHdl->pvMBFrameReleaseCur != NULL )
+            {
+                xHdl->pvMBFrameReleaseCur(  );
             }
+#if MB_STATS_ENABLED
+            vMBStatsRecord( eStatsTransport, ucFunctionCode, xHdl->xStatsReceived,
+                            xStatsDispatched, xStatsExecuted, xMBStatsTimeStamp( ) );
+#endif
             break;
 
         case EV_FRAME_TRANSMIT:
@@ -439,3 +642,56 @@ eMBPoll( void )
     }
     return eStatus;
 }
+
+/* ----------------------- Single instance API ------------------------------*/
+eMBErrorCode
+eMBInit( eMBMode eMode, UCHAR ucSlaveAddress, UCHAR ucPort, ULONG ulBaudRate, eMBParity eParity )
+{
+    if( xMBDefaultHdl != NULL )
+    {
+        return MB_EILLSTATE;
+    }
+    return eMBInitHdl( &xMBDefaultHdl, eMode, ucSlaveAddress, ucPort, ulBaudRate, eParity );
+}
+
+#if MB_TCP_ENABLED > 0
+eMBErrorCode
+eMBTCPInit( UCHAR ucSlaveUid, USHORT ucTCPPort )
+{
+    if( xMBDefaultHdl != NULL )
+    {
+        return MB_EILLSTATE;
+    }
+    return eMBTCPInitHdl( &xMBDefaultHdl, ucSlaveUid, ucTCPPort );
+}
+#endif
+
+eMBErrorCode
+eMBClose( void )
+{
+    eMBErrorCode    eStatus = eMBCloseHdl( xMBDefaultHdl );
+
+    if( eStatus == MB_ENOERR )
+    {
+        xMBDefaultHdl = NULL;
+    }
+    return eStatus;
+}
+
+eMBErrorCode
+eMBEnable( void )
+{
+    return eMBEnableHdl( xMBDefaultHdl );
+}
+
+eMBErrorCode
+eMBDisable( void )
+{
+    return eMBDisableHdl( xMBDefaultHdl );
+}
+
+eMBErrorCode
+eMBPoll( void )
+{
+    return eMBPollHdl( xMBDefaultHdl );
+}
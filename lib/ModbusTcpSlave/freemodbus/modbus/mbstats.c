@@ -0,0 +1,177 @@
+/*
+ * SPDX-FileCopyrightText: 2026 ModbusTCP project contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// mbstats.c
+// Request latency histograms of the Modbus slave stack.
+// The histograms are static arrays of log2 buckets indexed by transport,
+// function code and processing stage, so recording a request is a few
+// increments under the lock and never allocates.
+
+#include <string.h>
+#include "port.h"
+#include "mbproto.h"
+#include "mbstats.h"
+
+#if MB_STATS_ENABLED
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_STATS_FUNC_MAX           (128)
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef struct {
+    ULONG ulBuckets[MB_STATS_BUCKETS];  /*!< Number of the latencies in the log2 bucket */
+    ULONG ulCount;                      /*!< Number of the recorded latencies */
+    ULONG ulMaxUs;                      /*!< Maximum recorded latency */
+} MbStatsHistogram_t;
+
+/* ----------------------- Static variables ---------------------------------*/
+
+// Function codes which have the dedicated histograms, the first slot collects the others
+static const UCHAR ucStatsFunctions[] = {
+    MB_FUNC_NONE,
+    MB_FUNC_READ_COILS,
+    MB_FUNC_READ_DISCRETE_INPUTS,
+    MB_FUNC_READ_HOLDING_REGISTER,
+    MB_FUNC_READ_INPUT_REGISTER,
+    MB_FUNC_WRITE_SINGLE_COIL,
+    MB_FUNC_WRITE_REGISTER,
+    MB_FUNC_WRITE_MULTIPLE_COILS,
+    MB_FUNC_WRITE_MULTIPLE_REGISTERS,
+    MB_FUNC_READWRITE_MULTIPLE_REGISTERS
+};
+
+#define MB_STATS_FUNC_SLOTS         (sizeof(ucStatsFunctions) / sizeof(ucStatsFunctions[0]))
+
+// Direct map of the function code to the histogram slot, unlisted codes map to MB_STATS_FUNC_OTHER
+static const UCHAR ucStatsFuncSlot[MB_STATS_FUNC_MAX] = {
+    [MB_FUNC_READ_COILS] = 1,
+    [MB_FUNC_READ_DISCRETE_INPUTS] = 2,
+    [MB_FUNC_READ_HOLDING_REGISTER] = 3,
+    [MB_FUNC_READ_INPUT_REGISTER] = 4,
+    [MB_FUNC_WRITE_SINGLE_COIL] = 5,
+    [MB_FUNC_WRITE_REGISTER] = 6,
+    [MB_FUNC_WRITE_MULTIPLE_COILS] = 7,
+    [MB_FUNC_WRITE_MULTIPLE_REGISTERS] = 8,
+    [MB_FUNC_READWRITE_MULTIPLE_REGISTERS] = 9
+};
+
+static MbStatsHistogram_t xStatsHistograms[MB_STATS_TRANSPORT_COUNT][MB_STATS_FUNC_SLOTS][MB_STATS_STAGE_COUNT];
+static int64_t xStatsRecvTimeStamp[MB_STATS_TRANSPORT_COUNT] = { 0 };
+static _lock_t xStatsLock;
+
+/* ----------------------- Static functions ---------------------------------*/
+static UCHAR ucMBStatsFuncSlot(UCHAR ucFunctionCode)
+{
+    // The exception responses are counted with the request function code
+    return ucStatsFuncSlot[ucFunctionCode & ~MB_FUNC_ERROR];
+}
+
+static int xMBStatsBucket(ULONG ulUs)
+{
+    int xBucket = (ulUs == 0) ? 0 : (32 - __builtin_clz(ulUs));
+    return (xBucket < MB_STATS_BUCKETS) ? xBucket : (MB_STATS_BUCKETS - 1);
+}
+
+static void vMBStatsAdd(MbStatsHistogram_t* pxHistogram, int64_t xStart, int64_t xEnd)
+{
+    int64_t xDelta = xEnd - xStart;
+    ULONG ulUs = (xDelta <= 0) ? 0 : ((xDelta > UINT32_MAX) ? UINT32_MAX : (ULONG)xDelta);
+    pxHistogram->ulBuckets[xMBStatsBucket(ulUs)]++;
+    pxHistogram->ulCount++;
+    if (ulUs > pxHistogram->ulMaxUs) {
+        pxHistogram->ulMaxUs = ulUs;
+    }
+}
+
+// Returns the upper bound of the bucket where the percentile falls, limited by the maximum
+static ULONG ulMBStatsPercentile(const MbStatsHistogram_t* pxHistogram, ULONG ulPercent)
+{
+    uint64_t ullTarget = ((uint64_t)pxHistogram->ulCount * ulPercent + 99) / 100;
+    uint64_t ullSeen = 0;
+    if (!pxHistogram->ulCount) {
+        return 0;
+    }
+    for (int i = 0; i < MB_STATS_BUCKETS - 1; i++) {
+        ullSeen += pxHistogram->ulBuckets[i];
+        if (ullSeen >= ullTarget) {
+            ULONG ulBound = (i == 0) ? 0 : ((1UL << i) - 1);
+            return (ulBound < pxHistogram->ulMaxUs) ? ulBound : pxHistogram->ulMaxUs;
+        }
+    }
+    return pxHistogram->ulMaxUs;
+}
+
+/* ----------------------- Start implementation -----------------------------*/
+int64_t xMBStatsTimeStamp(void)
+{
+    return esp_timer_get_time();
+}
+
+void vMBStatsFrameReceived(eMBStatsTransport eTransport, int64_t xTimeStamp)
+{
+    if (eTransport < MB_STATS_TRANSPORT_COUNT) {
+        xStatsRecvTimeStamp[eTransport] = xTimeStamp;
+    }
+}
+
+int64_t xMBStatsTakeReceived(eMBStatsTransport eTransport, int64_t xDefault)
+{
+    if (eTransport >= MB_STATS_TRANSPORT_COUNT) {
+        return xDefault;
+    }
+    int64_t xTimeStamp = xStatsRecvTimeStamp[eTransport];
+    xStatsRecvTimeStamp[eTransport] = 0;
+    return ((xTimeStamp > 0) && (xTimeStamp <= xDefault)) ? xTimeStamp : xDefault;
+}
+
+void vMBStatsRecord(eMBStatsTransport eTransport, UCHAR ucFunctionCode, int64_t xReceived,
+                        int64_t xDispatched, int64_t xExecuted, int64_t xSent)
+{
+    if (eTransport >= MB_STATS_TRANSPORT_COUNT) {
+        return;
+    }
+    MbStatsHistogram_t* pxHistograms = xStatsHistograms[eTransport][ucMBStatsFuncSlot(ucFunctionCode)];
+    CRITICAL_SECTION(xStatsLock) {
+        vMBStatsAdd(&pxHistograms[MB_STATS_STAGE_QUEUE], xReceived, xDispatched);
+        vMBStatsAdd(&pxHistograms[MB_STATS_STAGE_EXEC], xDispatched, xExecuted);
+        vMBStatsAdd(&pxHistograms[MB_STATS_STAGE_SEND], xExecuted, xSent);
+        vMBStatsAdd(&pxHistograms[MB_STATS_STAGE_TOTAL], xReceived, xSent);
+    }
+}
+
+BOOL xMBStatsGetSummary(eMBStatsTransport eTransport, UCHAR ucFunctionCode,
+                            eMBStatsStage eStage, xMBStatsSummary* pxSummary)
+{
+    MB_PORT_CHECK((pxSummary != NULL), FALSE, "Summary pointer is incorrect.");
+    MB_PORT_CHECK((eTransport < MB_STATS_TRANSPORT_COUNT) && (eStage < MB_STATS_STAGE_COUNT),
+                    FALSE, "Incorrect statistic requested.");
+    MbStatsHistogram_t xHistogram;
+    CRITICAL_SECTION(xStatsLock) {
+        xHistogram = xStatsHistograms[eTransport][ucMBStatsFuncSlot(ucFunctionCode)][eStage];
+    }
+    pxSummary->ulCount = xHistogram.ulCount;
+    pxSummary->ulP50Us = ulMBStatsPercentile(&xHistogram, 50);
+    pxSummary->ulP99Us = ulMBStatsPercentile(&xHistogram, 99);
+    pxSummary->ulMaxUs = xHistogram.ulMaxUs;
+    return TRUE;
+}
+
+USHORT usMBStatsGetFunctions(const UCHAR** pucFunctionCodes)
+{
+    if (pucFunctionCodes) {
+        *pucFunctionCodes = ucStatsFunctions;
+    }
+    return (USHORT)MB_STATS_FUNC_SLOTS;
+}
+
+void vMBStatsReset(void)
+{
+    CRITICAL_SECTION(xStatsLock) {
+        memset(xStatsHistograms, 0, sizeof(xStatsHistograms));
+    }
+}
+
+#endif
@@ -38,6 +38,23 @@
 #ifndef _MB_CRC_H
 #define _MB_CRC_H
 
+/*! \brief Initial value of the running CRC16. */
+#define MB_CRC16_INIT   ( ( USHORT )0xFFFF )
+
+/*! \brief Calculate the CRC16 of the complete frame.
+ *
+ * The CRC of a frame with the CRC field appended is zero.
+ */
 USHORT          usMBCRC16( UCHAR * pucFrame, USHORT usLen );
 
+/*! \brief Continue the running CRC16 with the next data block.
+ *
+ * The running value starts from MB_CRC16_INIT and is the same whatever
+ * way the frame is split into blocks.
+ */
+USHORT          usMBCRC16Update( USHORT usCRC, const UCHAR * pucData, USHORT usLen );
+
+/*! \brief Continue the running CRC16 with the next received byte. */
+USHORT          usMBCRC16UpdateByte( USHORT usCRC, UCHAR ucByte );
+
 #endif
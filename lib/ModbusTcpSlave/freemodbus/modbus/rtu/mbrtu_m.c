@@ -84,6 +84,9 @@ static volatile UCHAR   *pucMasterSndBufferCur;
 static volatile USHORT  usMasterSndBufferCount;
 static volatile USHORT  usMasterRcvBufferPos;
 
+/* Running CRC16 of the received bytes, zero for a complete correct frame. */
+static volatile USHORT  usMasterRcvCRC16;
+
 static volatile UCHAR *ucMasterRTURcvBuf = ucMasterRcvBuf;
 static volatile UCHAR *ucMasterRTUSndBuf = ucMasterSndBuf;
 
@@ -163,6 +166,7 @@ eMBMasterRTUReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLengt
     eMBErrorCode    eStatus = MB_ENOERR;
     UCHAR          *pucMBRTUFrame = ( UCHAR* ) ucMasterRTURcvBuf;
     USHORT          usFrameLength = usMasterRcvBufferPos;
+    USHORT          usFrameCRC16;
 
     if( xMBMasterPortSerialGetResponse( &pucMBRTUFrame, &usFrameLength ) == FALSE )
     {
@@ -173,9 +177,20 @@ eMBMasterRTUReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLengt
     assert( usFrameLength < MB_SER_PDU_SIZE_MAX );
     assert( pucMBRTUFrame );
 
+    /* The CRC is already calculated while the bytes arrive, the frame
+     * is recalculated only if the port has replaced the received one.
+     */
+    if( ( pucMBRTUFrame == ucMasterRTURcvBuf ) && ( usFrameLength == usMasterRcvBufferPos ) )
+    {
+        usFrameCRC16 = usMasterRcvCRC16;
+    }
+    else
+    {
+        usFrameCRC16 = usMBCRC16( ( UCHAR * ) pucMBRTUFrame, usFrameLength );
+    }
+
     /* Length and CRC check */
-    if( ( usFrameLength >= MB_RTU_SER_PDU_SIZE_MIN )
-        && ( usMBCRC16( ( UCHAR * ) pucMBRTUFrame, usFrameLength ) == 0 ) )
+    if( ( usFrameLength >= MB_RTU_SER_PDU_SIZE_MIN ) && ( usFrameCRC16 == 0 ) )
     {
         /* Save the address field. All frames are passed to the upper layer
          * and the decision if a frame is used is done there.
@@ -290,6 +305,7 @@ xMBMasterRTUReceiveFSM( void )
         usMasterRcvBufferPos = 0;
         if( xStatus && ucByte ) {
             ucMasterRTURcvBuf[usMasterRcvBufferPos++] = ucByte;
+            usMasterRcvCRC16 = usMBCRC16UpdateByte( MB_CRC16_INIT, ucByte );
             eRcvState = STATE_M_RX_RCV;
             eSndState = STATE_M_TX_IDLE;
         }
@@ -310,6 +326,7 @@ xMBMasterRTUReceiveFSM( void )
         {
             if ( xStatus ) {
                 ucMasterRTURcvBuf[usMasterRcvBufferPos++] = ucByte;
+                usMasterRcvCRC16 = usMBCRC16UpdateByte( usMasterRcvCRC16, ucByte );
             }
         }
         else
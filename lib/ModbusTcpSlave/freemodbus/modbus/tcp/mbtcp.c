@@ -79,11 +79,11 @@
 
 /* ----------------------- Start implementation -----------------------------*/
 eMBErrorCode
-eMBTCPDoInit( USHORT ucTCPPort )
+eMBTCPDoInit( xMBHandle xHdl, USHORT ucTCPPort )
 {
     eMBErrorCode    eStatus = MB_ENOERR;
 
-    if( xMBTCPPortInit( ucTCPPort ) == FALSE )
+    if( xMBTCPPortInit( xHdl, ucTCPPort ) == FALSE )
     {
         eStatus = MB_EPORTERR;
     }
@@ -47,7 +47,7 @@ PR_BEGIN_EXTERN_C
 #if MB_TCP_ENABLED
 
 /* ----------------------- Function prototypes ------------------------------*/
-eMBErrorCode    eMBTCPDoInit( USHORT ucTCPPort );
+eMBErrorCode    eMBTCPDoInit( xMBHandle xHdl, USHORT ucTCPPort );
 void            eMBTCPStart( void );
 void            eMBTCPStop( void );
 eMBErrorCode    eMBTCPReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame,
@@ -184,7 +184,8 @@ prvvMBTCPLogFrame( const CHAR * pucMsg, UCHAR * pucFrame, USHORT usFrameLen )
             res = 0;
             break;
         }
-        if( res == -1 ) {
+        // The long frames are truncated to the buffer
+        if( ( res < 0 ) || ( ( size_t )res >= iBufLeft ) ) {
             break;
         }
         else {
@@ -194,7 +195,7 @@ prvvMBTCPLogFrame( const CHAR * pucMsg, UCHAR * pucFrame, USHORT usFrameLen )
 
         // Print the data.
         res = snprintf( &arcBuffer[iBufPos], iBufLeft, "%02X", pucFrame[i] );
-        if( res == -1 ) {
+        if( ( res < 0 ) || ( ( size_t )res >= iBufLeft ) ) {
             break;
         } else {
             iBufPos += res;
@@ -202,12 +203,10 @@ prvvMBTCPLogFrame( const CHAR * pucMsg, UCHAR * pucFrame, USHORT usFrameLen )
         }
     }
 
-    if( res != -1 ) {
-        // Append an end of frame string.
-        res = snprintf( &arcBuffer[iBufPos], iBufLeft, " |" );
-        if( res != -1 ) {
-            ESP_LOGD(pucMsg, "%s", arcBuffer);
-        }
+    // Append an end of frame string.
+    res = snprintf( &arcBuffer[iBufPos], iBufLeft, " |" );
+    if( res >= 0 ) {
+        ESP_LOGD(pucMsg, "%s", arcBuffer);
     }
 }
 #endif
@@ -38,7 +38,6 @@
 /* ----------------------- System includes ----------------------------------*/
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/queue.h>
 
 /* ----------------------- Modbus includes ----------------------------------*/
 #include "mb.h"
@@ -46,76 +45,114 @@
 #include "port.h"
 #include "mbconfig.h"
 #include "port_serial_slave.h"
-/* ----------------------- Variables ----------------------------------------*/
-static QueueHandle_t xQueueHdl;
-
 /* ----------------------- Start implementation -----------------------------*/
+// The events are the bits of the notification value of the task which polls the
+// stack instance. The task is known on its first wait, the events posted before
+// are kept in ulEventsEarly. Every stack instance is polled by its own task.
 BOOL
-xMBPortEventInit( void )
+xMBPortEventInit( xMBPortEvent * pxEvent )
 {
-    BOOL bStatus = FALSE;
-    if((xQueueHdl = xQueueCreate(MB_EVENT_QUEUE_SIZE, sizeof(eMBEventType))) != NULL)
-    {
-        vQueueAddToRegistry(xQueueHdl, "MbPortEventQueue");
-        bStatus = TRUE;
-    }
-    return bStatus;
+    MB_PORT_CHECK((pxEvent != NULL), FALSE, "%s: incorrect event channel.", __func__);
+    portMUX_INITIALIZE(&pxEvent->xLock);
+    pxEvent->xTask = NULL;
+    pxEvent->ulEventsEarly = 0;
+    pxEvent->ulEventsPending = 0;
+    pxEvent->xInit = TRUE;
+    return TRUE;
 }
 
 void
-vMBPortEventClose( void )
+vMBPortEventClose( xMBPortEvent * pxEvent )
 {
-    if(xQueueHdl != NULL)
+    if (pxEvent == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&pxEvent->xLock);
+    TaskHandle_t xTask = pxEvent->xTask;
+    pxEvent->xTask = NULL;
+    pxEvent->ulEventsEarly = 0;
+    pxEvent->ulEventsPending = 0;
+    pxEvent->xInit = FALSE;
+    portEXIT_CRITICAL(&pxEvent->xLock);
+    if (xTask != NULL)
     {
-        vQueueDelete(xQueueHdl);
-        xQueueHdl = NULL;
+        // Drop the events which are not taken yet, the task may poll the next stack instance
+        (void)ulTaskNotifyValueClear(xTask, UINT32_MAX);
     }
 }
 
 BOOL MB_PORT_ISR_ATTR
-xMBPortEventPost( eMBEventType eEvent )
+xMBPortEventPost( xMBPortEvent * pxEvent, eMBEventType eEvent )
 {
-    BaseType_t xStatus, xHigherPriorityTaskWoken = pdFALSE;
-    assert(xQueueHdl != NULL);
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    TaskHandle_t xTask = NULL;
+    BOOL xInit = FALSE;
 
     if( (BOOL)xPortInIsrContext() == TRUE )
     {
-        xStatus = xQueueSendFromISR(xQueueHdl, (const void*)&eEvent, &xHigherPriorityTaskWoken);
-        if ( xHigherPriorityTaskWoken )
-        {
-            portYIELD_FROM_ISR();
+        portENTER_CRITICAL_ISR(&pxEvent->xLock);
+        xInit = pxEvent->xInit;
+        xTask = pxEvent->xTask;
+        if (xInit && (xTask == NULL)) {
+            pxEvent->ulEventsEarly |= (uint32_t)eEvent;
+        }
+        portEXIT_CRITICAL_ISR(&pxEvent->xLock);
+        if (xTask != NULL) {
+            (void)xTaskNotifyFromISR(xTask, (uint32_t)eEvent, eSetBits, &xHigherPriorityTaskWoken);
+            if ( xHigherPriorityTaskWoken )
+            {
+                portYIELD_FROM_ISR();
+            }
         }
-        if (xStatus != pdTRUE) {
-            ESP_EARLY_LOGV(MB_PORT_TAG, "%s: Post message failure = %u.", __func__, (unsigned)xStatus);
+        if (!xInit) {
+            ESP_EARLY_LOGV(MB_PORT_TAG, "%s: Post event failure, not initialized.", __func__);
             return FALSE;
         }
     }
     else
     {
-        xStatus = xQueueSend(xQueueHdl, (const void*)&eEvent, MB_EVENT_QUEUE_TIMEOUT);
-        MB_PORT_CHECK((xStatus == pdTRUE), FALSE, "%s: Post message failure.", __func__);
+        portENTER_CRITICAL(&pxEvent->xLock);
+        xInit = pxEvent->xInit;
+        xTask = pxEvent->xTask;
+        if (xInit && (xTask == NULL)) {
+            pxEvent->ulEventsEarly |= (uint32_t)eEvent;
+        }
+        portEXIT_CRITICAL(&pxEvent->xLock);
+        MB_PORT_CHECK(xInit, FALSE, "%s: Post event failure, not initialized.", __func__);
+        if (xTask != NULL) {
+            // Setting bits can not fail, the same pending events are merged
+            (void)xTaskNotify(xTask, (uint32_t)eEvent, eSetBits);
+        }
     }
     return TRUE;
 }
 
 BOOL
-xMBPortEventGet(eMBEventType * peEvent)
+xMBPortEventGet( xMBPortEvent * pxEvent, eMBEventType * peEvent )
 {
-    assert(xQueueHdl != NULL);
-    BOOL xEventHappened = FALSE;
+    TaskHandle_t xTask = xTaskGetCurrentTaskHandle();
+    uint32_t ulEvents = 0;
 
-    if (xQueueReceive(xQueueHdl, peEvent, portMAX_DELAY) == pdTRUE) {
-        xEventHappened = TRUE;
+    assert(pxEvent->xInit);
+    if (pxEvent->ulEventsPending == 0) {
+        portENTER_CRITICAL(&pxEvent->xLock);
+        if (pxEvent->xTask != xTask) {
+            // The polling task is known now, take the events posted before
+            pxEvent->xTask = xTask;
+            pxEvent->ulEventsPending = pxEvent->ulEventsEarly;
+            pxEvent->ulEventsEarly = 0;
+        }
+        portEXIT_CRITICAL(&pxEvent->xLock);
     }
-    return xEventHappened;
-}
-
-QueueHandle_t
-xMBPortEventGetHandle(void)
-{
-    if(xQueueHdl != NULL)
-    {
-        return xQueueHdl;
+    while (pxEvent->ulEventsPending == 0) {
+        if (xTaskNotifyWait(0, UINT32_MAX, &ulEvents, portMAX_DELAY) == pdTRUE) {
+            pxEvent->ulEventsPending = ulEvents;
+        }
     }
-    return NULL;
+    // The events are returned one per call in the order of their values,
+    // so a received frame is processed before the frame sent event
+    ulEvents = pxEvent->ulEventsPending & (~pxEvent->ulEventsPending + 1);
+    pxEvent->ulEventsPending &= ~ulEvents;
+    *peEvent = (eMBEventType)ulEvents;
+    return TRUE;
 }
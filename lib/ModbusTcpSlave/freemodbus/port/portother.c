@@ -62,8 +62,6 @@ vMBPortClose( void )
 {
     extern void     vMBPortSerialClose( void );
     extern void     vMBPortTimerClose( void );
-    extern void     vMBPortEventClose( void );
     vMBPortSerialClose(  );
     vMBPortTimerClose(  );
-    vMBPortEventClose(  );
 }
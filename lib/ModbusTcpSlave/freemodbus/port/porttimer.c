@@ -51,7 +51,10 @@ static xTimerContext_t* pxTimerContext = NULL;
 /* ----------------------- Start implementation -----------------------------*/
 static void IRAM_ATTR vTimerAlarmCBHandler(void *param)
 {
-    pxMBPortCBTimerExpired(); // Timer expired callback function
+    xMBSerialFrameCB* pxFrameCB = pxMBSerialFrameCB();
+    if (pxFrameCB) {
+        pxFrameCB->pxTimerExpired(); // Timer expired callback function
+    }
     pxTimerContext->xTimerState = TRUE;
     ESP_EARLY_LOGD(TAG, "Slave timeout triggered.");
 }
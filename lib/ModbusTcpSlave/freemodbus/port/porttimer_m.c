@@ -46,6 +46,7 @@ static const char *TAG = "MBM_TIMER";
 
 /* ----------------------- Variables ----------------------------------------*/
 static xTimerContext_t* pxTimerContext = NULL;
+static ULONG ulRespondTimeoutMs = MB_MASTER_TIMEOUT_MS_RESPOND;
 
 /* ----------------------- Start implementation -----------------------------*/
 static void IRAM_ATTR vTimerAlarmCBHandler(void *param)
@@ -120,9 +121,15 @@ void vMBMasterPortTimersConvertDelayEnable(void)
     (void)xMBMasterPortTimersEnable(xToutUs);
 }
 
+void vMBMasterPortTimersSetRespondTimeout(ULONG ulTimeoutMs)
+{
+    // Applied when the timer is armed for the next request
+    ulRespondTimeoutMs = ulTimeoutMs ? ulTimeoutMs : MB_MASTER_TIMEOUT_MS_RESPOND;
+}
+
 void vMBMasterPortTimersRespondTimeoutEnable(void)
 {
-    uint64_t xToutUs = (MB_MASTER_TIMEOUT_MS_RESPOND * 1000);
+    uint64_t xToutUs = ((uint64_t)ulRespondTimeoutMs * 1000);
 
     vMBMasterSetCurTimerMode(MB_TMODE_RESPOND_TIMEOUT);
     ESP_LOGD(MB_PORT_TAG,"%s Respond enable timeout.", __func__);
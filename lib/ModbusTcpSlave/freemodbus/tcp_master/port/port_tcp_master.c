@@ -74,9 +74,6 @@
 #define MB_TCP_READ_BUF_RETRY_CNT       ( 4 )
 #define MB_SLAVE_FMT(fmt)               "Slave #%d, Socket(#%d)(%s)"fmt
 
-/* ----------------------- Types & Prototypes --------------------------------*/
-void vMBPortEventClose(void);
-
 /* ----------------------- Static variables ---------------------------------*/
 static const char *TAG = "MB_TCP_MASTER_PORT";
 static MbPortConfig_t xMbPortConfig;
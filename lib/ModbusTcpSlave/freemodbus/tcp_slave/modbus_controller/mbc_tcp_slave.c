@@ -40,7 +40,7 @@ static void modbus_tcp_slave_task(void *pvParameters)
                                                 portMAX_DELAY);
         // Check if stack started then poll for data
         if (status & MB_EVENT_STACK_STARTED) {
-            (void)eMBPoll(); // allow stack to process data
+            (void)eMBPollHdl(mbs_opts->mbs_stack_handle); // allow stack to process data
         }
     }
 }
@@ -53,7 +53,7 @@ static esp_err_t mbc_tcp_slave_setup(void* comm_info)
     MB_SLAVE_CHECK((comm_info != NULL), ESP_ERR_INVALID_ARG,
                     "mb wrong communication settings.");
     mb_communication_info_t* comm_settings = (mb_communication_info_t*)comm_info;
-    MB_SLAVE_CHECK((comm_settings->ip_mode == MB_MODE_TCP),
+    MB_SLAVE_CHECK(((comm_settings->ip_mode == MB_MODE_TCP) || (comm_settings->ip_mode == MB_MODE_UDP)),
                         ESP_ERR_INVALID_ARG, "mb incorrect mode = (%u).", (unsigned)comm_settings->ip_mode);
     MB_SLAVE_CHECK(((comm_settings->ip_addr_type == MB_IPV4) || (comm_settings->ip_addr_type == MB_IPV6)),
                         ESP_ERR_INVALID_ARG, "mb incorrect addr type = (%u).", (unsigned)comm_settings->ip_addr_type);
@@ -71,16 +71,21 @@ static esp_err_t mbc_tcp_slave_start(void)
     mb_slave_options_t* mbs_opts = &mbs_interface_ptr->opts;
     eMBErrorCode status = MB_EIO;
 
-    // Initialize Modbus stack using mbcontroller parameters
-    status = eMBTCPInit((UCHAR)mbs_opts->mbs_comm.slave_uid, (USHORT)mbs_opts->mbs_comm.ip_port);
-    MB_SLAVE_CHECK((status == MB_ENOERR), ESP_ERR_INVALID_STATE,
-                    "mb stack initialization failure, eMBInit() returns (0x%x).", (int)status);
+    // The client slots are allocated by the port on stack initialization
+    vMBTCPPortSlaveSetMaxConn((USHORT)mbs_opts->mbs_comm.ip_max_conn);
 
+    // The port task binds the socket right after the initialization, so the options go first
     eMBPortProto proto = (mbs_opts->mbs_comm.ip_mode == MB_MODE_TCP) ? MB_PROTO_TCP : MB_PROTO_UDP;
     eMBPortIpVer ip_ver = (mbs_opts->mbs_comm.ip_addr_type == MB_IPV4) ? MB_PORT_IPV4 : MB_PORT_IPV6;
     vMBTCPPortSlaveSetNetOpt(mbs_opts->mbs_comm.ip_netif_ptr, ip_ver, proto, (char*)mbs_opts->mbs_comm.ip_addr);
 
-    status = eMBEnable();
+    // Initialize Modbus stack using mbcontroller parameters
+    status = eMBTCPInitHdl(&mbs_opts->mbs_stack_handle,
+                            (UCHAR)mbs_opts->mbs_comm.slave_uid, (USHORT)mbs_opts->mbs_comm.ip_port);
+    MB_SLAVE_CHECK((status == MB_ENOERR), ESP_ERR_INVALID_STATE,
+                    "mb stack initialization failure, eMBInit() returns (0x%x).", (int)status);
+
+    status = eMBEnableHdl(mbs_opts->mbs_stack_handle);
     MB_SLAVE_CHECK((status == MB_ENOERR), ESP_ERR_INVALID_STATE,
                     "mb TCP stack start failure, eMBEnable() returned (0x%x).", (int)status);
     // Set the mbcontroller start flag
@@ -103,12 +108,16 @@ static esp_err_t mbc_tcp_slave_destroy(void)
     MB_SLAVE_CHECK((flag & MB_EVENT_STACK_STARTED),
                     ESP_ERR_INVALID_STATE, "mb stack stop event failure.");
     // Disable and then destroy the Modbus stack
-    mb_error = eMBDisable();
+    mb_error = eMBDisableHdl(mbs_opts->mbs_stack_handle);
     MB_SLAVE_CHECK((mb_error == MB_ENOERR), ESP_ERR_INVALID_STATE, "mb stack disable failure.");
     (void)vTaskDelete(mbs_opts->mbs_task_handle);
-    (void)vQueueDelete(mbs_opts->mbs_notification_queue_handle);
+    mbc_slave_notify_ring_delete(&mbs_opts->mbs_notify_ring);
     (void)vEventGroupDelete(mbs_opts->mbs_event_group);
-    (void)vMBTCPPortClose();
+    // Closes the port and releases the stack instance
+    mb_error = eMBCloseHdl(mbs_opts->mbs_stack_handle);
+    MB_SLAVE_CHECK((mb_error == MB_ENOERR), ESP_ERR_INVALID_STATE,
+                        "mb stack close failure returned (0x%x).", (int)mb_error);
+    mbs_opts->mbs_stack_handle = NULL;
     mbs_interface_ptr = NULL;
     vMBPortSetMode((UCHAR)MB_PORT_INACTIVE);
     return ESP_OK;
@@ -130,16 +139,11 @@ static esp_err_t mbc_tcp_slave_get_param_info(mb_param_info_t* reg_info, uint32_
 {
     MB_SLAVE_ASSERT(mbs_interface_ptr != NULL);
     mb_slave_options_t* mbs_opts = &mbs_interface_ptr->opts;
-    esp_err_t err = ESP_ERR_TIMEOUT;
-    MB_SLAVE_CHECK((mbs_opts->mbs_notification_queue_handle != NULL),
-                    ESP_ERR_INVALID_ARG, "mb queue handle is invalid.");
+    MB_SLAVE_CHECK((mbs_opts->mbs_notify_ring.entries != NULL),
+                ESP_ERR_INVALID_ARG, "mb notify ring is invalid.");
     MB_SLAVE_CHECK((reg_info != NULL), ESP_ERR_INVALID_ARG, "mb register information is invalid.");
-    BaseType_t status = xQueueReceive(mbs_opts->mbs_notification_queue_handle,
-                                        reg_info, pdMS_TO_TICKS(timeout));
-    if (status == pdTRUE) {
-        err = ESP_OK;
-    }
-    return err;
+    size_t count = mbc_slave_notify_ring_get(&mbs_opts->mbs_notify_ring, reg_info, 1, timeout);
+    return (count > 0) ? ESP_OK : ESP_ERR_TIMEOUT;
 }
 
 /* ----------------------- Callback functions for Modbus stack ---------------------------------*/
@@ -171,12 +175,9 @@ esp_err_t mbc_tcp_slave_create(void** handler)
     mbs_opts->mbs_event_group = xEventGroupCreate();
     MB_SLAVE_CHECK((mbs_opts->mbs_event_group != NULL),
                     ESP_ERR_NO_MEM, "mb event group error.");
-    // Parameter change notification queue
-    mbs_opts->mbs_notification_queue_handle = xQueueCreate(
-                                                MB_CONTROLLER_NOTIFY_QUEUE_SIZE,
-                                                sizeof(mb_param_info_t));
-    MB_SLAVE_CHECK((mbs_opts->mbs_notification_queue_handle != NULL),
-                    ESP_ERR_NO_MEM, "mb notify queue creation error.");
+    // Parameter change notification ring
+    esp_err_t err = mbc_slave_notify_ring_create(&mbs_opts->mbs_notify_ring, MB_CONTROLLER_NOTIFY_QUEUE_SIZE);
+    MB_SLAVE_CHECK((err == ESP_OK), ESP_ERR_NO_MEM, "mb notify ring creation error.");
     // Create Modbus controller task
     status = xTaskCreatePinnedToCore((void*)&modbus_tcp_slave_task,
                             "mbs_port_tcp_task",
@@ -54,24 +54,27 @@
 #include "mbport.h"
 #include "port.h"
 #include "mbframe.h"
+#include "mbstats.h"
 #include "port_tcp_slave.h"
+#include "port_tcp_slave_poll.h"
 #include "esp_modbus_common.h"      // for common types for network options
 
 #if MB_TCP_ENABLED
 
 /* ----------------------- Defines  -----------------------------------------*/
 #define MB_TCP_DISCONNECT_TIMEOUT       ( CONFIG_FMB_TCP_CONNECTION_TOUT_SEC * 1000000UL ) // disconnect timeout in uS
-#define MB_TCP_RESP_TIMEOUT_MS          ( MB_MASTER_TIMEOUT_MS_RESPOND - 1 ) // slave response time limit
 #define MB_TCP_NET_LISTEN_BACKLOG       ( SOMAXCONN )
-
-/* ----------------------- Prototypes ---------------------------------------*/
-void vMBPortEventClose( void );
+#define MB_TCP_IDLE_CHECK_PERIOD        ( 1000000UL ) // idle connections check period in uS
+#define MB_TCP_SLOT_BUF_SIZE            ( MB_TCP_PIPELINE_DEPTH * MB_TCP_BUF_SIZE + MB_TCP_RX_RING_SIZE )
 
 /* ----------------------- Static variables ---------------------------------*/
 static const char *TAG = "MB_TCP_SLAVE_PORT";
 static int xListenSock = -1;
 static SemaphoreHandle_t xShutdownSema = NULL;
 static MbSlavePortConfig_t xConfig = { 0 };
+static MbPollSet_t xPollSet = { 0 };
+static USHORT usThrottledCount = 0;
+static BOOL xListenMuted = FALSE;
 
 /* ----------------------- Static functions ---------------------------------*/
 // The helper function to get time stamp in microseconds
@@ -87,68 +90,427 @@ static void vxMBTCPPortMStoTimeVal(USHORT usTimeoutMs, struct timeval *pxTimeout
     pxTimeout->tv_usec = (usTimeoutMs - (pxTimeout->tv_sec * 1000)) * 1000;
 }
 
-static QueueHandle_t xMBTCPPortRespQueueCreate(void)
+// Allocate the client slots and their transaction buffers once, so the
+// connections of reconnecting clients do not touch the heap
+static BOOL xMBTCPPortPoolInit(MbClientPool_t* pxPool, USHORT usSize)
+{
+    memset(pxPool, 0, sizeof(MbClientPool_t));
+    pxPool->pxSlots = calloc(usSize, sizeof(MbClientInfo_t));
+    pxPool->pucBuf = calloc(usSize, MB_TCP_SLOT_BUF_SIZE);
+    pxPool->pusFree = calloc(usSize, sizeof(USHORT));
+    if (!pxPool->pxSlots || !pxPool->pucBuf || !pxPool->pusFree) {
+        free(pxPool->pxSlots);
+        free(pxPool->pucBuf);
+        free(pxPool->pusFree);
+        memset(pxPool, 0, sizeof(MbClientPool_t));
+        return FALSE;
+    }
+    // The lowest slot is on the top of the free stack
+    for (USHORT i = 0; i < usSize; i++) {
+        pxPool->pusFree[i] = usSize - 1 - i;
+    }
+    pxPool->usFreeCount = usSize;
+    pxPool->usSize = usSize;
+    return TRUE;
+}
+
+static void vMBTCPPortPoolClose(MbClientPool_t* pxPool)
+{
+    free(pxPool->pxSlots);
+    free(pxPool->pucBuf);
+    free(pxPool->pusFree);
+    memset(pxPool, 0, sizeof(MbClientPool_t));
+}
+
+// Take the free client slot, the index of the slot is the index of the client.
+// Must be called with the transaction lock taken.
+static MbClientInfo_t* pxMBTCPPortPoolAcquire(MbClientPool_t* pxPool)
+{
+    if (!pxPool->usFreeCount) {
+        return NULL;
+    }
+    USHORT usIdx = pxPool->pusFree[--pxPool->usFreeCount];
+    MbClientInfo_t* pxClientInfo = &pxPool->pxSlots[usIdx];
+    UCHAR* pucBuf = &pxPool->pucBuf[(size_t)usIdx * MB_TCP_SLOT_BUF_SIZE];
+    memset(pxClientInfo, 0, sizeof(MbClientInfo_t));
+    pxClientInfo->xIndex = usIdx;
+    pxClientInfo->xSockId = -1;
+    for (int xTrans = 0; xTrans < MB_TCP_PIPELINE_DEPTH; xTrans++) {
+        pxClientInfo->xTransQueue[xTrans].pucBuf = &pucBuf[xTrans * MB_TCP_BUF_SIZE];
+    }
+    pxClientInfo->pucRxRing = &pucBuf[MB_TCP_PIPELINE_DEPTH * MB_TCP_BUF_SIZE];
+    USHORT usInUse = pxPool->usSize - pxPool->usFreeCount;
+    if (usInUse > pxPool->usHighWater) {
+        pxPool->usHighWater = usInUse;
+    }
+    return pxClientInfo;
+}
+
+// Return the client slot into the pool.
+// Must be called with the transaction lock taken.
+static void vMBTCPPortPoolRelease(MbClientPool_t* pxPool, MbClientInfo_t* pxClientInfo)
+{
+    pxPool->pusFree[pxPool->usFreeCount++] = (USHORT)pxClientInfo->xIndex;
+}
+
+// Get the transaction currently being received from the client (the tail of its queue)
+static MbTransaction_t* pxMBTCPPortTransTail(MbClientInfo_t* pxClientInfo)
+{
+    USHORT usIdx = (pxClientInfo->usTransHead + pxClientInfo->usTransCount) % MB_TCP_PIPELINE_DEPTH;
+    return &pxClientInfo->xTransQueue[usIdx];
+}
+
+// Get the oldest pending transaction of the client
+static MbTransaction_t* pxMBTCPPortTransHead(MbClientInfo_t* pxClientInfo)
+{
+    return &pxClientInfo->xTransQueue[pxClientInfo->usTransHead];
+}
+
+// Get the sender of the UDP transaction, the peers are allocated per transaction
+// of the only client slot in the UDP mode
+static MbUdpPeer_t* pxMBTCPPortUdpPeer(MbClientInfo_t* pxClientInfo, MbTransaction_t* pxTrans)
+{
+    return &xConfig.pxUdpPeers[pxTrans - pxClientInfo->xTransQueue];
+}
+
+// Get the unparsed byte at the offset from the head of the receive ring
+static UCHAR ucMBTCPPortRxPeek(MbClientInfo_t* pxClientInfo, USHORT usOffset)
+{
+    return pxClientInfo->pucRxRing[(pxClientInfo->usRxHead + usOffset) % MB_TCP_RX_RING_SIZE];
+}
+
+// Move the bytes from the head of the receive ring into the linear buffer
+static void vMBTCPPortRxRead(MbClientInfo_t* pxClientInfo, UCHAR* pucDst, USHORT usLength)
+{
+    USHORT usFirst = MB_TCP_RX_RING_SIZE - pxClientInfo->usRxHead;
+    if (usFirst > usLength) {
+        usFirst = usLength;
+    }
+    memcpy(pucDst, &pxClientInfo->pucRxRing[pxClientInfo->usRxHead], usFirst);
+    memcpy(&pucDst[usFirst], pxClientInfo->pucRxRing, usLength - usFirst);
+    pxClientInfo->usRxHead = (pxClientInfo->usRxHead + usLength) % MB_TCP_RX_RING_SIZE;
+    pxClientInfo->usRxCount -= usLength;
+}
+
+// Check if the request is addressed to the unit served by the forward callback
+static BOOL xMBTCPPortTransIsForward(MbTransaction_t* pxTrans)
 {
-    QueueHandle_t xRespQueueHandle = xQueueCreate(2, sizeof(void*));
-    MB_PORT_CHECK((xRespQueueHandle != NULL), NULL, "TCP respond queue creation failure.");
-    return xRespQueueHandle;
+    UCHAR ucUid = pxTrans->pucBuf[MB_TCP_UID];
+    return (xConfig.pxForwardCB != NULL) && (ucUid != xConfig.ucLocalUid)
+                && (ucUid != MB_ADDRESS_BROADCAST) && (ucUid != MB_TCP_PSEUDO_ADDRESS);
 }
 
-static void vMBTCPPortRespQueueDelete(QueueHandle_t xRespQueueHandle)
+// Pass the oldest pending transaction of the client to the forward callback.
+// Must be called with the transaction lock taken.
+static BOOL xMBTCPPortTransForward(MbClientInfo_t* pxClientInfo)
 {
-    vQueueDelete(xRespQueueHandle);
+    MbTransaction_t* pxTrans = pxMBTCPPortTransHead(pxClientInfo);
+    if (!xMBTCPPortTransIsForward(pxTrans)) {
+        return FALSE;
+    }
+    MbForwardTicket_t xTicket = { .usClient = (USHORT)pxClientInfo->xIndex, .usTid = pxTrans->usTid };
+    pxClientInfo->xForwarded = xConfig.pxForwardCB(xConfig.pvForwardArg, xTicket, pxTrans->pucBuf[MB_TCP_UID],
+                                                    &pxTrans->pucBuf[MB_TCP_FUNC], pxTrans->usLength - MB_TCP_FUNC);
+    return pxClientInfo->xForwarded;
+}
+
+// Hand the next pending transaction over to the stack if it is idle.
+// Clients are served round robin, transactions of one client in arrival order.
+// The transactions addressed to the other units are passed to the forward callback
+// without waiting for the stack, one per client at a time.
+// Must be called with the transaction lock taken.
+static void vMBTCPPortTransDispatch(void)
+{
+    if (!xConfig.pxMbClientInfo || (xConfig.pxCurClientInfo && !xConfig.pxForwardCB)) {
+        return;
+    }
+    for (int i = 0; i < xConfig.usMaxConn; i++) {
+        USHORT usIdx = (xConfig.usNextClient + i) % xConfig.usMaxConn;
+        MbClientInfo_t* pxClientInfo = xConfig.pxMbClientInfo[usIdx];
+        if (!pxClientInfo || !pxClientInfo->usTransCount || pxClientInfo->xForwarded
+                || (pxClientInfo == xConfig.pxCurClientInfo)) {
+            continue;
+        }
+        if (xMBTCPPortTransForward(pxClientInfo)) {
+            continue;
+        }
+        if (!xConfig.pxCurClientInfo) {
+            xConfig.usNextClient = (usIdx + 1) % xConfig.usMaxConn;
+            xConfig.pxCurClientInfo = pxClientInfo;
+            xConfig.xCurTaken = FALSE;
+            xConfig.xCurLate = FALSE;
+            xConfig.xDispatchTimeStamp = xMBTCPGetTimeStamp();
+#if MB_STATS_ENABLED
+            vMBStatsFrameReceived(MB_STATS_TRANSPORT_TCP, pxMBTCPPortTransHead(pxClientInfo)->xRecvTimeStamp);
+#endif
+            (void)xMBEventPost(xConfig.xMBHdl, EV_FRAME_RECEIVED);
+            if (!xConfig.pxForwardCB) {
+                break;
+            }
+        }
+    }
 }
 
-static void* vxMBTCPPortRespQueueRecv(QueueHandle_t xRespQueueHandle)
+static BOOL xMBTCPPortSendFrame(MbClientInfo_t* pxClientInfo, MbTransaction_t* pxTrans,
+                                    UCHAR* pucMBTCPFrame, USHORT usTCPLength);
+
+// Queue the request placed into the tail transaction buffer of the client
+// and pass it to the stack if there is no other transaction in progress.
+static void vMBTCPPortTransCommit(MbClientInfo_t* pxClientInfo, MbTransaction_t* pxTrans, USHORT usLength)
 {
-    void* pvResp = NULL;
-    MB_PORT_CHECK(xRespQueueHandle != NULL, NULL, "Response queue is not initialized.");
-    BaseType_t xStatus = xQueueReceive(xRespQueueHandle,
-                                        (void*)&pvResp,
-                                        pdMS_TO_TICKS(MB_TCP_RESP_TIMEOUT_MS));
-    if (xStatus != pdTRUE) {
-        ESP_LOGD(TAG, "Could not get respond confirmation.");
+    BOOL xFastRead = FALSE;
+    CRITICAL_SECTION(xConfig.xTransLock) {
+#if MB_TCP_DEBUG
+        prvvMBTCPLogFrame(TAG, pxTrans->pucBuf, usLength);
+#endif
+        // Copy TID field from incoming packet
+        pxClientInfo->usTidCnt = MB_TCP_GET_FIELD(pxTrans->pucBuf, MB_TCP_TID);
+        pxTrans->usTid = pxClientInfo->usTidCnt;
+        pxTrans->usLength = usLength;
+        pxTrans->xRecvTimeStamp = xMBTCPGetTimeStamp();
+#if MB_TCP_FAST_READ_ENABLED
+        // The request can be answered by the port only if it does not overtake the pending ones
+        xFastRead = (pxClientInfo->usTransCount == 0) && !xMBTCPPortTransIsForward(pxTrans);
+#endif
+        if (!xFastRead) {
+            pxClientInfo->usTransCount++;
+            vMBTCPPortTransDispatch();
+        }
     }
-    return pvResp;
+#if MB_TCP_FAST_READ_ENABLED
+    // The tail buffer is not visible to the stack until the transaction is counted
+    if (xFastRead) {
+        USHORT usTCPLength = usLength;
+#if MB_STATS_ENABLED
+        UCHAR ucFunctionCode = pxTrans->pucBuf[MB_TCP_FUNC];
+        int64_t xDispatched = xMBTCPGetTimeStamp();
+#endif
+        if (xMBTCPFastRead(xConfig.xMBHdl, pxTrans->pucBuf, &usTCPLength)) {
+            ESP_LOGD(TAG, "Socket (#%d), TID=0x%X, answered by the port.",
+                                (int)pxClientInfo->xSockId, (int)pxTrans->usTid);
+#if MB_STATS_ENABLED
+            int64_t xExecuted = xMBTCPGetTimeStamp();
+            (void)xMBTCPPortSendFrame(pxClientInfo, pxTrans, pxTrans->pucBuf, usTCPLength);
+            vMBStatsRecord(MB_STATS_TRANSPORT_TCP, ucFunctionCode, pxTrans->xRecvTimeStamp,
+                                xDispatched, xExecuted, xMBTCPGetTimeStamp());
+#else
+            (void)xMBTCPPortSendFrame(pxClientInfo, pxTrans, pxTrans->pucBuf, usTCPLength);
+#endif
+        } else {
+            CRITICAL_SECTION(xConfig.xTransLock) {
+                pxClientInfo->usTransCount++;
+                vMBTCPPortTransDispatch();
+            }
+        }
+    }
+#endif
 }
 
-static BOOL vxMBTCPPortRespQueueSend(QueueHandle_t xRespQueueHandle, void* pvResp)
+// Move the complete frame from the receive ring into the transaction queue of the client.
+// Returns FALSE if the queue is full, the frame is left in the ring then.
+static BOOL xMBTCPPortTransPush(MbClientInfo_t* pxClientInfo, USHORT usLength)
 {
-    MB_PORT_CHECK(xRespQueueHandle != NULL, FALSE, "Response queue is not initialized.");
-    BaseType_t xStatus = xQueueSend(xConfig.xRespQueueHandle,
-                                    (const void*)&pvResp,
-                                    pdMS_TO_TICKS(MB_TCP_RESP_TIMEOUT_MS));
-    MB_PORT_CHECK((xStatus == pdTRUE), FALSE, "FAIL to send to response queue.");
+    MbTransaction_t* pxTrans = NULL;
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        if (pxClientInfo->usTransCount < MB_TCP_PIPELINE_DEPTH) {
+            pxTrans = pxMBTCPPortTransTail(pxClientInfo);
+            vMBTCPPortRxRead(pxClientInfo, pxTrans->pucBuf, usLength);
+        }
+    }
+    if (!pxTrans) {
+        return FALSE;
+    }
+    vMBTCPPortTransCommit(pxClientInfo, pxTrans, usLength);
     return TRUE;
 }
 
+// Check if the transaction queue of the client has no room for the next frame
+static BOOL xMBTCPPortTransFull(MbClientInfo_t* pxClientInfo)
+{
+    BOOL xFull = FALSE;
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        xFull = (pxClientInfo->usTransCount >= MB_TCP_PIPELINE_DEPTH);
+    }
+    return xFull;
+}
+
+static void vMBTCPPortFreeClientInfo(MbClientInfo_t *pxClientInfo);
+
+// Close the socket of the client dropped during its active transaction. The socket is
+// kept open until then, so the response being sent can not reach a new connection
+// which would get the same descriptor.
+// Must be called with the transaction lock taken.
+static void vMBTCPPortCloseDeferred(MbClientInfo_t* pxClientInfo)
+{
+    if (pxClientInfo->xSockId >= 0) {
+        (void)shutdown(pxClientInfo->xSockId, SHUT_RDWR);
+        close(pxClientInfo->xSockId);
+        pxClientInfo->xSockId = -1;
+    }
+}
+
+// Remove the active transaction from the queue of the client.
+// Must be called with the transaction lock taken.
+static void vMBTCPPortTransPop(MbClientInfo_t* pxClientInfo)
+{
+    if (pxClientInfo->xCloseDeferred) {
+        // The client was dropped while its request was being processed
+        vMBTCPPortCloseDeferred(pxClientInfo);
+        vMBTCPPortFreeClientInfo(pxClientInfo);
+    } else if (pxClientInfo->usTransCount) {
+        pxClientInfo->usTransHead = (pxClientInfo->usTransHead + 1) % MB_TCP_PIPELINE_DEPTH;
+        pxClientInfo->usTransCount--;
+        // The server task resumes the client, see vMBTCPPortWakeServer()
+        xConfig.xWakePending |= pxClientInfo->xThrottled;
+    }
+}
+
+// Wake the server task from the poll wait once the stack has freed the queue of a throttled
+// client, otherwise the client is resumed only on the poll timeout
+static void vMBTCPPortWakeServer(void)
+{
+    BOOL xWake = FALSE;
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        xWake = xConfig.xWakePending;
+        xConfig.xWakePending = FALSE;
+    }
+    if (xWake && (xConfig.xWakeSock >= 0)) {
+        UCHAR ucWake = 0;
+        (void)sendto(xConfig.xWakeSock, &ucWake, sizeof(ucWake), MSG_DONTWAIT,
+                        (struct sockaddr *)&xConfig.xWakeAddr, sizeof(xConfig.xWakeAddr));
+    }
+}
+
+// Complete the transaction processed by the stack and dispatch the next one.
+// Must be called with the transaction lock taken.
+static void vMBTCPPortTransComplete(void)
+{
+    MbClientInfo_t* pxClientInfo = xConfig.pxCurClientInfo;
+    if (pxClientInfo) {
+        xConfig.pxCurClientInfo = NULL;
+        xConfig.xCurTaken = FALSE;
+        vMBTCPPortTransPop(pxClientInfo);
+    }
+    vMBTCPPortTransDispatch();
+}
+
+// Unregister the client. The client with the active transaction is only marked, the stack or
+// the forward callback can be sending its response, the socket is closed and the client info
+// is released once the transaction completes. Returns TRUE if the release is deferred.
+static BOOL xMBTCPPortReleaseClient(MbClientInfo_t* pxClientInfo, eMBTCPDropReason eReason)
+{
+    BOOL xDeferred = FALSE;
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        xConfig.xClientPool.ulDropped[eReason]++;
+        xConfig.pxMbClientInfo[pxClientInfo->xIndex] = NULL;
+        if ((pxClientInfo == xConfig.pxCurClientInfo) || pxClientInfo->xForwarded) {
+            pxClientInfo->xCloseDeferred = TRUE;
+            xDeferred = TRUE;
+        }
+    }
+    return xDeferred;
+}
+
+static void vMBTCPPortWakeClose(void)
+{
+    if (xConfig.xWakeSock >= 0) {
+        vMBTCPPortPollRemove(&xPollSet, xConfig.xWakeSock);
+        close(xConfig.xWakeSock);
+        xConfig.xWakeSock = -1;
+    }
+}
+
+// Open the wake socket bound to the loopback and register it in the poll set.
+// Without it the throttled clients are still resumed, on the poll timeout.
+static void vMBTCPPortWakeOpen(void)
+{
+    socklen_t xAddrLen = sizeof(xConfig.xWakeAddr);
+    memset(&xConfig.xWakeAddr, 0, sizeof(xConfig.xWakeAddr));
+    xConfig.xWakeAddr.sin_family = AF_INET;
+    xConfig.xWakeAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    xConfig.xWakeAddr.sin_port = 0;
+    xConfig.xWakePending = FALSE;
+    xConfig.xWakeSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if ((xConfig.xWakeSock < 0)
+        || (bind(xConfig.xWakeSock, (struct sockaddr *)&xConfig.xWakeAddr, sizeof(xConfig.xWakeAddr)) != 0)
+        || (getsockname(xConfig.xWakeSock, (struct sockaddr *)&xConfig.xWakeAddr, &xAddrLen) != 0)
+        || !xMBTCPPortPollAdd(&xPollSet, xConfig.xWakeSock, &xConfig.xWakeSock)) {
+        ESP_LOGW(TAG, "Wake socket is not available, errno = %u.", (unsigned)errno);
+        if (xConfig.xWakeSock >= 0) {
+            close(xConfig.xWakeSock);
+            xConfig.xWakeSock = -1;
+        }
+    }
+}
+
+// Read out the wake datagrams, the wake itself only ends the poll wait
+static void vMBTCPPortWakeDrain(void)
+{
+    UCHAR ucBuf[8];
+    while (recv(xConfig.xWakeSock, ucBuf, sizeof(ucBuf), MSG_DONTWAIT) > 0);
+}
+
 static void vMBTCPPortServerTask(void *pvParameters);
 
 /* ----------------------- Begin implementation -----------------------------*/
 BOOL
-xMBTCPPortInit( USHORT usTCPPort )
+xMBTCPPortInit( xMBHandle xHdl, USHORT usTCPPort )
 {
     BOOL bOkay = FALSE;
 
-    xConfig.pxMbClientInfo = calloc(MB_TCP_PORT_MAX_CONN + 1, sizeof(MbClientInfo_t*));
+    xConfig.xMBHdl = xHdl;
+
+    if ((xConfig.usMaxConn == 0) || (xConfig.usMaxConn > MB_TCP_PORT_MAX_CONN)) {
+        xConfig.usMaxConn = MB_TCP_PORT_MAX_CONN;
+    }
+    xConfig.pxMbClientInfo = calloc(xConfig.usMaxConn, sizeof(MbClientInfo_t*));
     if (!xConfig.pxMbClientInfo) {
         ESP_LOGE(TAG, "TCP client info allocation failure.");
         return FALSE;
     }
-    for(int idx = 0; idx < MB_TCP_PORT_MAX_CONN; xConfig.pxMbClientInfo[idx] = NULL, idx++);
+    for(int idx = 0; idx < xConfig.usMaxConn; xConfig.pxMbClientInfo[idx] = NULL, idx++);
 
-    xConfig.xRespQueueHandle = xMBTCPPortRespQueueCreate();
-    if (!xConfig.xRespQueueHandle) {
-        ESP_LOGE(TAG, "Response queue allocation failure.");
+    if (!xMBTCPPortPoolInit(&xConfig.xClientPool, xConfig.usMaxConn)) {
+        ESP_LOGE(TAG, "TCP client pool allocation failure.");
+        free(xConfig.pxMbClientInfo);
+        xConfig.pxMbClientInfo = NULL;
         return FALSE;
     }
 
+    // The interest set holds the listen socket, the wake socket and all the client connections
+    if (!xMBTCPPortPollInit(&xPollSet, xConfig.usMaxConn + 2)) {
+        ESP_LOGE(TAG, "TCP poll set allocation failure.");
+        vMBTCPPortPoolClose(&xConfig.xClientPool);
+        free(xConfig.pxMbClientInfo);
+        xConfig.pxMbClientInfo = NULL;
+        return FALSE;
+    }
+
+    // The senders of the datagrams are kept only in the UDP mode
+    xConfig.pxUdpPeers = NULL;
+    if (xConfig.eMbProto == MB_PROTO_UDP) {
+        xConfig.pxUdpPeers = calloc(MB_TCP_PIPELINE_DEPTH, sizeof(MbUdpPeer_t));
+        if (!xConfig.pxUdpPeers) {
+            ESP_LOGE(TAG, "UDP peer allocation failure.");
+            vMBTCPPortPollClose(&xPollSet);
+            vMBTCPPortPoolClose(&xConfig.xClientPool);
+            free(xConfig.pxMbClientInfo);
+            xConfig.pxMbClientInfo = NULL;
+            return FALSE;
+        }
+    }
+    usThrottledCount = 0;
+    xListenMuted = FALSE;
+    vMBTCPPortWakeOpen();
+
+    CRITICAL_SECTION_INIT(xConfig.xTransLock);
+    xConfig.pxCurClientInfo = NULL;
+    xConfig.xCurTaken = FALSE;
+    xConfig.usNextClient = 0;
+
+    // The network options are set by vMBTCPPortSlaveSetNetOpt() before the initialization
     xConfig.usPort = usTCPPort;
-    xConfig.eMbProto = MB_PROTO_TCP;
     xConfig.usClientCount = 0;
-    xConfig.pvNetIface = NULL;
-    xConfig.xIpVer = MB_PORT_IPV4;
-    xConfig.pcBindAddr = NULL;
 
     // Create task for packet processing
     BaseType_t xErr = xTaskCreatePinnedToCore(vMBTCPPortServerTask,
@@ -161,7 +523,16 @@ xMBTCPPortInit( USHORT usTCPPort )
     if (xErr != pdTRUE)
     {
         ESP_LOGE(TAG, "Server task creation failure.");
-        vTaskDelete(xConfig.xMbTcpTaskHandle);
+        // No task to delete, release what is allocated above as vMBTCPPortClose() does
+        xConfig.xMbTcpTaskHandle = NULL;
+        vMBTCPPortWakeClose();
+        vMBTCPPortPollClose(&xPollSet);
+        vMBTCPPortPoolClose(&xConfig.xClientPool);
+        free(xConfig.pxUdpPeers);
+        xConfig.pxUdpPeers = NULL;
+        CRITICAL_SECTION_CLOSE(xConfig.xTransLock);
+        free(xConfig.pxMbClientInfo);
+        xConfig.pxMbClientInfo = NULL;
     } else {
         ESP_LOGI(TAG, "Protocol stack initialized.");
         bOkay = TRUE;
@@ -178,16 +549,38 @@ void vMBTCPPortSlaveSetNetOpt(void* pvNetIf, eMBPortIpVer xIpVersion, eMBPortPro
     xConfig.pcBindAddr = pcBindAddrStr;
 }
 
-static int xMBTCPPortAcceptConnection(int xListenSockId, char** pcIPAddr)
+void vMBTCPPortSlaveSetMaxConn(USHORT usMaxConn)
+{
+    // Applied on the next port initialization
+    xConfig.usMaxConn = usMaxConn;
+}
+
+BOOL xMBTCPPortSlaveGetPoolStats(MbClientPoolStats_t* pxStats)
+{
+    BOOL xRet = FALSE;
+    MB_PORT_CHECK(pxStats, FALSE, "Wrong statistic pointer.");
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        MbClientPool_t* pxPool = &xConfig.xClientPool;
+        if (pxPool->pxSlots) {
+            pxStats->usSize = pxPool->usSize;
+            pxStats->usInUse = pxPool->usSize - pxPool->usFreeCount;
+            pxStats->usHighWater = pxPool->usHighWater;
+            pxStats->ulExhausted = pxPool->ulExhausted;
+            memcpy(pxStats->ulDropped, pxPool->ulDropped, sizeof(pxStats->ulDropped));
+            xRet = TRUE;
+        }
+    }
+    return xRet;
+}
+
+static int xMBTCPPortAcceptConnection(int xListenSockId, CHAR* pcIPAddr, size_t xAddrSize)
 {
     MB_PORT_CHECK(pcIPAddr, -1, "Wrong IP address pointer.");
     MB_PORT_CHECK((xListenSockId > 0), -1, "Incorrect listen socket ID.");
 
     // Address structure large enough for both IPv4 or IPv6 address
     struct sockaddr_storage xSrcAddr;
-    CHAR cAddrStr[128];
     int xSockId = -1;
-    CHAR* pcStr = NULL;
     socklen_t xSize = sizeof(struct sockaddr_storage);
 
     // Accept new socket connection if not active
@@ -198,24 +591,18 @@ static int xMBTCPPortAcceptConnection(int xListenSockId, char** pcIPAddr)
     } else {
         // Get the sender's ip address as string
         if (xSrcAddr.ss_family == PF_INET) {
-            inet_ntoa_r(((struct sockaddr_in *)&xSrcAddr)->sin_addr.s_addr, cAddrStr, sizeof(cAddrStr) - 1);
+            inet_ntoa_r(((struct sockaddr_in *)&xSrcAddr)->sin_addr.s_addr, pcIPAddr, xAddrSize - 1);
         }
 #if CONFIG_LWIP_IPV6
         else if (xSrcAddr.ss_family == PF_INET6) {
-            inet6_ntoa_r(((struct sockaddr_in6 *)&xSrcAddr)->sin6_addr, cAddrStr, sizeof(cAddrStr) - 1);
+            inet6_ntoa_r(((struct sockaddr_in6 *)&xSrcAddr)->sin6_addr, pcIPAddr, xAddrSize - 1);
         }
 #endif
         else {
             // Make sure ss_family is valid
             abort();
         }
-        ESP_LOGI(TAG, "Socket (#%d), accept client connection from address: %s", (int)xSockId, cAddrStr);
-        pcStr = calloc(1, strlen(cAddrStr) + 1);
-        if (pcStr && pcIPAddr) {
-            memcpy(pcStr, cAddrStr, strlen(cAddrStr));
-            pcStr[strlen(cAddrStr)] = '\0';
-            *pcIPAddr = pcStr; // Set IP address of connected client
-        }
+        ESP_LOGI(TAG, "Socket (#%d), accept client connection from address: %s", (int)xSockId, pcIPAddr);
     }
     return xSockId;
 }
@@ -230,7 +617,9 @@ static BOOL xMBTCPPortCloseConnection(MbClientInfo_t* pxInfo)
     }
     
     // Empty tcp buffer before shutdown
-    (void)recv(pxInfo->xSockId, &pxInfo->pucTCPBuf[0], MB_PDU_SIZE_MAX, MSG_DONTWAIT);
+    // (the stack may still own the client buffers, so use a local one)
+    UCHAR ucDiscard[MB_PDU_SIZE_MAX];
+    (void)recv(pxInfo->xSockId, ucDiscard, sizeof(ucDiscard), MSG_DONTWAIT);
 
     if (shutdown(pxInfo->xSockId, SHUT_RDWR) == -1)
     {
@@ -240,128 +629,116 @@ static BOOL xMBTCPPortCloseConnection(MbClientInfo_t* pxInfo)
     pxInfo->xSockId = -1;
     if (xConfig.usClientCount) {
         xConfig.usClientCount--; // decrement counter of client connections
-    } else {
-        xConfig.pxCurClientInfo = NULL;
     }
     return TRUE;
 }
 
+// Must be called with the transaction lock taken
 static void vMBTCPPortFreeClientInfo(MbClientInfo_t *pxClientInfo)
 {
     if (pxClientInfo) {
-        if (pxClientInfo->pucTCPBuf) {
-            free((void *)pxClientInfo->pucTCPBuf);
-        }
-        if (pxClientInfo->pcIpAddr) {
-            free((void *)pxClientInfo->pcIpAddr);
-        }
-        free((void *)pxClientInfo);
+        vMBTCPPortPoolRelease(&xConfig.xClientPool, pxClientInfo);
     }
 }
 
 static void vMBTCPPortShutdown(void)
 {
-    for (int i = 0; i < MB_TCP_PORT_MAX_CONN; i++) {
-        MbClientInfo_t *pxClientInfo = xConfig.pxMbClientInfo[i];
-        if (pxClientInfo != NULL) {
-            if (pxClientInfo->xSockId > 0) {
-                xMBTCPPortCloseConnection(pxClientInfo);
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        for (int i = 0; i < xConfig.usMaxConn; i++) {
+            MbClientInfo_t *pxClientInfo = xConfig.pxMbClientInfo[i];
+            if (pxClientInfo != NULL) {
+                // The UDP client slot uses the listen socket, it is closed with the port
+                if ((pxClientInfo->xSockId > 0) && (pxClientInfo->xSockId != xListenSock)) {
+                    xMBTCPPortCloseConnection(pxClientInfo);
+                }
+                ESP_LOGD(TAG,"Close port instance: %p.", pxClientInfo);
+                // The late response of the forwarded request must not find the slot
+                pxClientInfo->xForwarded = FALSE;
+                vMBTCPPortFreeClientInfo(pxClientInfo);
+                xConfig.pxMbClientInfo[i] = NULL;
+            }
+        }
+        // The slots dropped during their transactions are not registered, close their sockets
+        for (int i = 0; i < xConfig.xClientPool.usSize; i++) {
+            MbClientInfo_t *pxClientInfo = &xConfig.xClientPool.pxSlots[i];
+            if (pxClientInfo->xCloseDeferred && (pxClientInfo->xSockId >= 0)) {
+                vMBTCPPortCloseDeferred(pxClientInfo);
+                pxClientInfo->xForwarded = FALSE;
             }
-            ESP_LOGD(TAG,"Close port instance: %p.", pxClientInfo);
-            vMBTCPPortFreeClientInfo(pxClientInfo);
-            xConfig.pxMbClientInfo[i] = NULL;
         }
+        if (xConfig.pxCurClientInfo && xConfig.pxCurClientInfo->xCloseDeferred) {
+            vMBTCPPortFreeClientInfo(xConfig.pxCurClientInfo);
+        }
+        xConfig.pxCurClientInfo = NULL;
+        xConfig.xCurTaken = FALSE;
+        free(xConfig.pxMbClientInfo);
+        xConfig.pxMbClientInfo = NULL;
     }
     ESP_LOGD(TAG,"Shutdown port task.");
-    free(xConfig.pxMbClientInfo);
     xSemaphoreGive(xShutdownSema);
     vTaskSuspend(NULL);
 }
 
-static int xMBTCPPortRxPoll(MbClientInfo_t *pxClientInfo, ULONG xTimeoutMs)
+// Extract the complete frames from the receive ring into the transaction queue.
+// The MBAP header is parsed in place, an incomplete frame stays in the ring until the rest of it arrives.
+static int xMBTCPPortRxParse(MbClientInfo_t *pxClientInfo)
 {
-    int xRet = ERR_CLSD;
-    struct timeval xTimeVal;
-    fd_set xReadSet;
-    int64_t xStartTimeStamp = 0;
-
-    // Receive data from connected client
-    if (pxClientInfo && pxClientInfo->xSockId > -1) {
-        // Set receive timeout
-        vxMBTCPPortMStoTimeVal(xTimeoutMs, &xTimeVal);
-        xStartTimeStamp = xMBTCPGetTimeStamp();
-        while (1)
-        {
-            FD_ZERO(&xReadSet);
-            FD_SET(pxClientInfo->xSockId, &xReadSet);
-            xRet = select(pxClientInfo->xSockId + 1, &xReadSet, NULL, NULL, &xTimeVal);
-            if (xRet == -1)
-            {
-                // If select an error occurred
-                xRet = ERR_CLSD;
-                TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
-                break;
-            } else if (xRet == 0) {
-                // timeout occurred
-                if ((xStartTimeStamp + xTimeoutMs * 1000) > xMBTCPGetTimeStamp()) {
-                    ESP_LOGD(TAG, "Socket (#%d) Read timeout.", (int)pxClientInfo->xSockId);
-                    xRet = ERR_TIMEOUT;
-                    TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
-                    break;
-                }
+    int xFrames = 0;
+
+    while (pxClientInfo->usRxCount >= MB_TCP_FUNC) {
+        // Length is a byte count of Modbus PDU (function code + data) and the
+        // unit identifier.
+        USHORT usLength = ((USHORT)ucMBTCPPortRxPeek(pxClientInfo, MB_TCP_LEN) << 8U)
+                                | ucMBTCPPortRxPeek(pxClientInfo, MB_TCP_LEN + 1);
+        USHORT usFrameLength = MB_TCP_UID + usLength;
+        if ((usLength < 2) || (usFrameLength > MB_TCP_BUF_SIZE)) {
+            ESP_LOGE(TAG, "Incorrect buffer received (%u) bytes.", (unsigned)usLength);
+            // This should not happen. We can't deal with such a client and
+            // drop the connection for security reasons.
+            return ERR_BUF;
+        }
+        if ((pxClientInfo->usRxCount < usFrameLength) || !xMBTCPPortTransPush(pxClientInfo, usFrameLength)) {
+            // The frame is incomplete or the transaction queue is full
+            break;
+        }
+        ESP_LOGD(TAG, "Socket (#%d)(%s), get packet TID=0x%X, %d bytes.",
+                                            (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr,
+                                            (int)pxClientInfo->usTidCnt, (int)usFrameLength);
+        xFrames++;
+    }
+    return xFrames;
+}
+
+// Read out the data available in the socket without blocking.
+// Called on the readiness event of the socket, one recv() fills the contiguous free space of the ring,
+// the data which does not fit is reported by the next event.
+static int xMBTCPPortRxPoll(MbClientInfo_t *pxClientInfo)
+{
+    MB_PORT_CHECK((pxClientInfo && (pxClientInfo->xSockId > -1)), ERR_CLSD, "Client is not connected.");
+
+    USHORT usTail = (pxClientInfo->usRxHead + pxClientInfo->usRxCount) % MB_TCP_RX_RING_SIZE;
+    USHORT usSpace = MB_TCP_RX_RING_SIZE - pxClientInfo->usRxCount;
+    if (usSpace > (MB_TCP_RX_RING_SIZE - usTail)) {
+        usSpace = MB_TCP_RX_RING_SIZE - usTail;
+    }
+    if (usSpace) {
+        int xLength = recv(pxClientInfo->xSockId, &pxClientInfo->pucRxRing[usTail], usSpace, MSG_DONTWAIT);
+        if (xLength < 0) {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                // If an error occurred during receiving, the keepalive timeout is reported separately
+                ESP_LOGE(TAG, "Receive failed: length=%d, errno=%u", xLength, (unsigned)errno);
+                return (errno == ETIMEDOUT) ? ERR_TIMEOUT : (err_t)xLength;
             }
-            if (FD_ISSET(pxClientInfo->xSockId, &xReadSet)) {
-                // If new buffer received then read Modbus packet into buffer
-                MB_PORT_CHECK((pxClientInfo->usTCPBufPos + pxClientInfo->usTCPFrameBytesLeft < MB_TCP_BUF_SIZE),
-                                    ERR_BUF, "Socket (#%d), incorrect request buffer size = %u, ignore.",
-                                    (int)pxClientInfo->xSockId,
-                                    (unsigned)(pxClientInfo->usTCPBufPos + pxClientInfo->usTCPFrameBytesLeft));
-                int xLength = recv(pxClientInfo->xSockId, &pxClientInfo->pucTCPBuf[pxClientInfo->usTCPBufPos],
-                                      pxClientInfo->usTCPFrameBytesLeft, MSG_DONTWAIT);
-                if (xLength < 0) {
-                    // If an error occurred during receiving
-                    ESP_LOGE(TAG, "Receive failed: length=%u, errno=%u", (unsigned)xLength, (unsigned)errno);
-                    xRet = (err_t)xLength;
-                    break;
-                } else if (xLength == 0) {
-                    // Socket connection closed
-                    ESP_LOGD(TAG, "Socket (#%d)(%s), connection closed.",
-                                                        (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr);
-                    xRet = ERR_CLSD;
-                    break;
-                } else {
-                    // New data received
-                    pxClientInfo->usTCPBufPos += xLength;
-                    pxClientInfo->usTCPFrameBytesLeft -= xLength;
-                    if (pxClientInfo->usTCPBufPos >= MB_TCP_FUNC) {
-                        // Length is a byte count of Modbus PDU (function code + data) and the
-                        // unit identifier.
-                        xLength = (int)MB_TCP_GET_FIELD(pxClientInfo->pucTCPBuf, MB_TCP_LEN);
-                        // Is the frame already complete.
-                        if (pxClientInfo->usTCPBufPos < (MB_TCP_UID + xLength)) {
-                            // The incomplete frame is received
-                            pxClientInfo->usTCPFrameBytesLeft = xLength + MB_TCP_UID - pxClientInfo->usTCPBufPos;
-                        } else if (pxClientInfo->usTCPBufPos == (MB_TCP_UID + xLength)) {
-#if MB_TCP_DEBUG
-                            prvvMBTCPLogFrame(TAG, (UCHAR*)&pxClientInfo->pucTCPBuf[0], pxClientInfo->usTCPBufPos);
-#endif
-                            // Copy TID field from incoming packet
-                            pxClientInfo->usTidCnt = MB_TCP_GET_FIELD(pxClientInfo->pucTCPBuf, MB_TCP_TID);
-                            xRet = pxClientInfo->usTCPBufPos;
-                            break;
-                        } else if ((pxClientInfo->usTCPBufPos + xLength) >= MB_TCP_BUF_SIZE) {
-                            ESP_LOGE(TAG, "Incorrect buffer received (%u) bytes.", (unsigned)xLength);
-                            // This should not happen. We can't deal with such a client and
-                            // drop the connection for security reasons.
-                            xRet = ERR_BUF;
-                            break;
-                        }
-                    } // if ( pxClientInfo->usTCPBufPos >= MB_TCP_FUNC )
-                } // if data received
-            } // if (FD_ISSET(pxClientInfo->xSockId, &xReadSet))
-        } // while (1)
+        } else if (xLength == 0) {
+            // Socket connection closed
+            ESP_LOGD(TAG, "Socket (#%d)(%s), connection closed.",
+                                                (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr);
+            return ERR_CLSD;
+        } else {
+            pxClientInfo->usRxCount += xLength;
+        }
     }
-    return (xRet);
+    return xMBTCPPortRxParse(pxClientInfo);
 }
 
 // Create a listening socket on pcBindIp: Port
@@ -452,13 +829,356 @@ vMBTCPPortBindAddr(const CHAR* pcBindIp)
     return(xListenSockFd);
 }
 
+// Enable the keepalive probes, so the connections of the rebooted masters are detected
+// by the socket error instead of the connection timeout
+static void vMBTCPPortSetKeepAlive(int xSockId)
+{
+#if (MB_TCP_KEEPALIVE_IDLE_SEC > 0)
+    int xKeepAlive = 1;
+    int xIdle = MB_TCP_KEEPALIVE_IDLE_SEC;
+    int xInterval = MB_TCP_KEEPALIVE_INTVL_SEC;
+    int xCount = MB_TCP_KEEPALIVE_COUNT;
+    if ((setsockopt(xSockId, SOL_SOCKET, SO_KEEPALIVE, &xKeepAlive, sizeof(int)) != 0)
+        || (setsockopt(xSockId, IPPROTO_TCP, TCP_KEEPIDLE, &xIdle, sizeof(int)) != 0)
+        || (setsockopt(xSockId, IPPROTO_TCP, TCP_KEEPINTVL, &xInterval, sizeof(int)) != 0)
+        || (setsockopt(xSockId, IPPROTO_TCP, TCP_KEEPCNT, &xCount, sizeof(int)) != 0)) {
+        ESP_LOGW(TAG, "Socket (#%d), fail to set keepalive options, errno = %u.", xSockId, (unsigned)errno);
+    }
+#endif
+}
+
+// Send the responses without the Nagle delay: the pipelined responses of a client follow
+// each other without a request in between and would wait for the delayed ACK of the master
+static void vMBTCPPortSetNoDelay(int xSockId)
+{
+    int xNoDelay = 1;
+    if (setsockopt(xSockId, IPPROTO_TCP, TCP_NODELAY, &xNoDelay, sizeof(int)) != 0) {
+        ESP_LOGW(TAG, "Socket (#%d), fail to set nodelay option, errno = %u.", xSockId, (unsigned)errno);
+    }
+}
+
+// Get the registered client with the oldest request. The clients with pending transactions
+// are skipped, their slots are released only once the transactions complete.
+static MbClientInfo_t* pxMBTCPPortFindLruClient(void)
+{
+    MbClientInfo_t* pxLruClient = NULL;
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        for (int i = 0; i < xConfig.usMaxConn; i++) {
+            MbClientInfo_t* pxClientInfo = xConfig.pxMbClientInfo[i];
+            if (!pxClientInfo || pxClientInfo->usTransCount || pxClientInfo->xForwarded
+                    || (pxClientInfo == xConfig.pxCurClientInfo)) {
+                continue;
+            }
+            if (!pxLruClient || (pxClientInfo->xRecvTimeStamp < pxLruClient->xRecvTimeStamp)) {
+                pxLruClient = pxClientInfo;
+            }
+        }
+    }
+    return pxLruClient;
+}
+
+static void vMBTCPPortDropClient(MbClientInfo_t* pxClientInfo, eMBTCPDropReason eReason);
+
+// Accept the pending connection and register the client
+static void vMBTCPPortAcceptClient(void)
+{
+    MbClientInfo_t* pxClientInfo = NULL;
+
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        pxClientInfo = pxMBTCPPortPoolAcquire(&xConfig.xClientPool);
+    }
+    if (!pxClientInfo) {
+        // All slots are in use, replace the least recently active client without pending
+        // transactions if it is idle long enough
+        MbClientInfo_t* pxLruClient = pxMBTCPPortFindLruClient();
+        int64_t xIdleTime = pxLruClient ? (xMBTCPGetTimeStamp() - pxLruClient->xRecvTimeStamp) : 0;
+        if (pxLruClient && (xIdleTime >= (MB_TCP_LRU_EVICT_IDLE_MS * 1000LL))) {
+            ESP_LOGW(TAG, "Client %d, Socket(#%d)(%s) is idle for %" PRIu64 " (us), replaced by new connection.",
+                                            (int)pxLruClient->xIndex, (int)pxLruClient->xSockId,
+                                            pxLruClient->pcIpAddr, (uint64_t)xIdleTime);
+            vMBTCPPortDropClient(pxLruClient, MB_TCP_DROP_LRU);
+            CRITICAL_SECTION(xConfig.xTransLock) {
+                pxClientInfo = pxMBTCPPortPoolAcquire(&xConfig.xClientPool);
+            }
+        }
+    }
+    if (!pxClientInfo) {
+        // Leave the connection in the backlog until a client slot is released
+        ESP_LOGE(TAG, "Fail to accept connection %u, only %u connections supported.",
+                                            (unsigned)(xConfig.usClientCount + 1), (unsigned)xConfig.usMaxConn);
+        CRITICAL_SECTION(xConfig.xTransLock) {
+            xConfig.xClientPool.ulExhausted++;
+        }
+        vMBTCPPortPollEnable(&xPollSet, xListenSock, FALSE);
+        xListenMuted = TRUE;
+        return;
+    }
+    // Accept new client connection
+    pxClientInfo->xSockId = xMBTCPPortAcceptConnection(xListenSock, pxClientInfo->pcIpAddr,
+                                                        sizeof(pxClientInfo->pcIpAddr));
+    if ((pxClientInfo->xSockId < 0)
+        || !xMBTCPPortPollAdd(&xPollSet, pxClientInfo->xSockId, pxClientInfo)) {
+        ESP_LOGE(TAG, "Fail to accept connection for client %u.", (unsigned)pxClientInfo->xIndex);
+        // Accept connection fail, then return the slot and continue polling.
+        if (pxClientInfo->xSockId >= 0) {
+            xMBTCPPortCloseConnection(pxClientInfo);
+        }
+        CRITICAL_SECTION(xConfig.xTransLock) {
+            vMBTCPPortFreeClientInfo(pxClientInfo);
+        }
+        return;
+    }
+    vMBTCPPortSetKeepAlive(pxClientInfo->xSockId);
+    vMBTCPPortSetNoDelay(pxClientInfo->xSockId);
+    // Fill the connection info structure
+    xConfig.usClientCount++;
+    pxClientInfo->xRecvTimeStamp = xMBTCPGetTimeStamp();
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        xConfig.pxMbClientInfo[pxClientInfo->xIndex] = pxClientInfo;
+    }
+}
+
+// Unregister the client and close its connection, the connection of the client with
+// the active transaction is closed once the transaction completes
+static void vMBTCPPortDropClient(MbClientInfo_t* pxClientInfo, eMBTCPDropReason eReason)
+{
+    vMBTCPPortPollRemove(&xPollSet, pxClientInfo->xSockId);
+    if (pxClientInfo->xThrottled) {
+        usThrottledCount--;
+    }
+    if (xMBTCPPortReleaseClient(pxClientInfo, eReason)) {
+        if (xConfig.usClientCount) {
+            xConfig.usClientCount--;
+        }
+        return;
+    }
+    xMBTCPPortCloseConnection(pxClientInfo);
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        vMBTCPPortFreeClientInfo(pxClientInfo);
+    }
+}
+
+// Resume accepting the connections waiting in the backlog once a client slot is free.
+// The slot of a client dropped during the transaction is returned by the stack task later.
+static void vMBTCPPortResumeListen(void)
+{
+    BOOL xSlotFree = FALSE;
+    if (xListenMuted) {
+        CRITICAL_SECTION(xConfig.xTransLock) {
+            xSlotFree = (xConfig.xClientPool.usFreeCount > 0);
+        }
+        if (xSlotFree) {
+            vMBTCPPortPollEnable(&xPollSet, xListenSock, TRUE);
+            xListenMuted = FALSE;
+        }
+    }
+}
+
+// Exclude the client from the readiness reporting while its transaction queue is full
+// Drop reason of the socket reported with an error or a hangup by the poll set
+static eMBTCPDropReason xMBTCPPortSockErrorReason(MbClientInfo_t* pxClientInfo)
+{
+    int xSockErr = 0;
+    socklen_t xLen = sizeof(xSockErr);
+    (void)getsockopt(pxClientInfo->xSockId, SOL_SOCKET, SO_ERROR, &xSockErr, &xLen);
+    if (xSockErr) {
+        ESP_LOGE(TAG, "Socket (#%d)(%s), socket error, errno = %d.",
+                                            (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr, xSockErr);
+        return MB_TCP_DROP_ERROR;
+    }
+    ESP_LOGE(TAG, "Socket (#%d)(%s), connection closed by peer.",
+                                        (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr);
+    return MB_TCP_DROP_PEER_CLOSED;
+}
+
+static void vMBTCPPortThrottleClient(MbClientInfo_t* pxClientInfo)
+{
+    BOOL xThrottle = FALSE;
+    // The flag is set under the lock, so the stack task freeing the queue sees it and wakes the task
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        if (!pxClientInfo->xThrottled && (pxClientInfo->usTransCount >= MB_TCP_PIPELINE_DEPTH)) {
+            pxClientInfo->xThrottled = TRUE;
+            xThrottle = TRUE;
+        }
+    }
+    if (xThrottle) {
+        vMBTCPPortPollEnable(&xPollSet, pxClientInfo->xSockId, FALSE);
+        usThrottledCount++;
+    }
+}
+
+// Resume the readiness reporting of the clients which queues are drained by the stack.
+// The frames left in the receive ring are queued first, they do not make the socket ready.
+static void vMBTCPPortResumeClients(void)
+{
+    for (int i = 0; (i < xConfig.usMaxConn) && usThrottledCount; i++) {
+        MbClientInfo_t* pxClientInfo = xConfig.pxMbClientInfo[i];
+        if (pxClientInfo && pxClientInfo->xThrottled && !xMBTCPPortTransFull(pxClientInfo)) {
+            if (xMBTCPPortRxParse(pxClientInfo) < 0) {
+                vMBTCPPortDropClient(pxClientInfo, MB_TCP_DROP_BAD_FRAME);
+                continue;
+            }
+            if (xMBTCPPortTransFull(pxClientInfo)) {
+                continue;
+            }
+            vMBTCPPortPollEnable(&xPollSet, pxClientInfo->xSockId, TRUE);
+            CRITICAL_SECTION(xConfig.xTransLock) {
+                pxClientInfo->xThrottled = FALSE;
+            }
+            usThrottledCount--;
+        }
+    }
+}
+
+// Drop the clients which do not send any request during the connection timeout
+static void vMBTCPPortCheckIdleClients(void)
+{
+    for (int i = 0; i < xConfig.usMaxConn; i++) {
+        MbClientInfo_t* pxClientInfo = xConfig.pxMbClientInfo[i];
+        if (pxClientInfo && !pxClientInfo->xThrottled) {
+            int64_t xTime = xMBTCPGetTimeStamp() - pxClientInfo->xRecvTimeStamp;
+            if (xTime > MB_TCP_DISCONNECT_TIMEOUT) {
+                ESP_LOGE(TAG, "Client %d, Socket(#%d) do not answer for %" PRIu64 " (us). Drop connection...",
+                                                (int)pxClientInfo->xIndex, (int)pxClientInfo->xSockId, (uint64_t)xTime);
+                // This client does not respond, then delete registered data
+                vMBTCPPortDropClient(pxClientInfo, MB_TCP_DROP_IDLE);
+            }
+        }
+    }
+}
+
+// Report the transaction which the stack does not answer in time. The transaction stays
+// active until the stack sends the response or releases the request, because the stack
+// builds the response in the transaction buffer and the late response must not be sent
+// under the identifier of the next transaction.
+static void vMBTCPPortCheckRespTimeout(void)
+{
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        if (xConfig.pxCurClientInfo && !xConfig.xCurLate
+            && ((xMBTCPGetTimeStamp() - xConfig.xDispatchTimeStamp) > (MB_TCP_RESP_TIMEOUT_MS * 1000))) {
+            xConfig.xCurLate = TRUE;
+            ESP_LOGW(TAG, "Client %d, TID=0x%X, response time exceeds configured %u [ms].",
+                                                (int)xConfig.pxCurClientInfo->xIndex,
+                                                (int)pxMBTCPPortTransHead(xConfig.pxCurClientInfo)->usTid,
+                                                (unsigned)MB_TCP_RESP_TIMEOUT_MS);
+        }
+    }
+}
+
+// Receive the pending datagrams into the transaction queue of the UDP client slot.
+// Every datagram carries one complete MBAP frame, the incorrect ones are discarded.
+// Returns the number of queued requests.
+static int xMBTCPPortUdpRxPoll(MbClientInfo_t *pxClientInfo)
+{
+    int xFrames = 0;
+
+    while (1) {
+        MbTransaction_t* pxTrans = NULL;
+        CRITICAL_SECTION(xConfig.xTransLock) {
+            if (pxClientInfo->usTransCount < MB_TCP_PIPELINE_DEPTH) {
+                pxTrans = pxMBTCPPortTransTail(pxClientInfo);
+            }
+        }
+        if (!pxTrans) {
+            // The datagrams wait in the socket until the stack drains the queue
+            break;
+        }
+        // The tail buffer is not visible to the stack until the transaction is counted
+        MbUdpPeer_t* pxPeer = pxMBTCPPortUdpPeer(pxClientInfo, pxTrans);
+        pxPeer->xAddrLen = sizeof(pxPeer->xAddr);
+        int xLength = recvfrom(pxClientInfo->xSockId, pxTrans->pucBuf, MB_TCP_BUF_SIZE, MSG_DONTWAIT,
+                                (struct sockaddr *)&pxPeer->xAddr, &pxPeer->xAddrLen);
+        if (xLength < 0) {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                ESP_LOGE(TAG, "Socket (#%d), receive datagram failed, errno=%u",
+                                            (int)pxClientInfo->xSockId, (unsigned)errno);
+            }
+            break;
+        }
+        USHORT usLength = (xLength >= MB_TCP_FUNC) ? MB_TCP_GET_FIELD(pxTrans->pucBuf, MB_TCP_LEN) : 0;
+        if ((xLength <= MB_TCP_FUNC) || ((MB_TCP_UID + usLength) != xLength) || !pxPeer->xAddrLen) {
+            ESP_LOGD(TAG, "Socket (#%d), incorrect datagram (%d) bytes discarded.",
+                                            (int)pxClientInfo->xSockId, xLength);
+            CRITICAL_SECTION(xConfig.xTransLock) {
+                xConfig.xClientPool.ulDropped[MB_TCP_DROP_BAD_FRAME]++;
+            }
+            continue;
+        }
+        vMBTCPPortTransCommit(pxClientInfo, pxTrans, (USHORT)xLength);
+        ESP_LOGD(TAG, "Socket (#%d), get datagram TID=0x%X, %d bytes.",
+                                            (int)pxClientInfo->xSockId, (int)pxClientInfo->usTidCnt, xLength);
+        xFrames++;
+    }
+    return xFrames;
+}
+
+// Serve the Modbus/UDP requests on the bound socket. There is no connection table,
+// one client slot queues the datagrams of all the senders and keeps the sender
+// address with each transaction. Returns only if the socket can not be registered.
+static void vMBTCPPortUdpServe(void)
+{
+    MbPollEvent_t xEvents[2];
+    MbClientInfo_t* pxClientInfo = NULL;
+
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        pxClientInfo = pxMBTCPPortPoolAcquire(&xConfig.xClientPool);
+    }
+    if (!pxClientInfo || !xMBTCPPortPollAdd(&xPollSet, xListenSock, pxClientInfo)) {
+        ESP_LOGE(TAG, "Socket (#%d), fail to register UDP socket.", xListenSock);
+        if (pxClientInfo) {
+            CRITICAL_SECTION(xConfig.xTransLock) {
+                vMBTCPPortFreeClientInfo(pxClientInfo);
+            }
+        }
+        return;
+    }
+    pxClientInfo->xSockId = xListenSock;
+    strncpy(pxClientInfo->pcIpAddr, "UDP", sizeof(pxClientInfo->pcIpAddr) - 1);
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        xConfig.pxMbClientInfo[pxClientInfo->xIndex] = pxClientInfo;
+    }
+
+    while (1) {
+        TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
+
+        vMBTCPPortResumeClients();
+
+        ULONG ulTimeoutMs = usThrottledCount ? MB_TCP_PIPELINE_POLL_MS : MB_TCP_RESP_TIMEOUT_MS;
+        int xErr = xMBTCPPortPollWait(&xPollSet, xEvents, 2, ulTimeoutMs);
+        if ((xErr < 0) && (errno != EINTR)) {
+            ESP_LOGE(TAG, "poll() errno = %u.", (unsigned)errno);
+            continue;
+        }
+
+        vMBTCPPortCheckRespTimeout();
+
+        for (int xEv = 0; xEv < xErr; xEv++) {
+            if (xEvents[xEv].pvCtx == &xConfig.xWakeSock) {
+                vMBTCPPortWakeDrain();
+                continue;
+            }
+            if (xEvents[xEv].xError) {
+                // Reading the error clears it, the throttled socket does not wake the wait again
+                int xSockErr = 0;
+                socklen_t xLen = sizeof(xSockErr);
+                (void)getsockopt(xListenSock, SOL_SOCKET, SO_ERROR, &xSockErr, &xLen);
+                ESP_LOGD(TAG, "Socket (#%d), socket error, errno = %d.", xListenSock, xSockErr);
+            }
+            int xRet = xMBTCPPortUdpRxPoll(pxClientInfo);
+            if (xRet) {
+                ESP_LOGD(TAG, "Socket (#%d), queued %d datagram(s), %u pending.",
+                                    (int)pxClientInfo->xSockId, xRet, (unsigned)pxClientInfo->usTransCount);
+            }
+            vMBTCPPortThrottleClient(pxClientInfo);
+        }
+    }
+}
+
 static void vMBTCPPortServerTask(void *pvParameters)
 {
     int xErr = 0;
-    fd_set xReadSet;
-    int i;
-    CHAR* pcClientIp = NULL;
-    struct timeval xTimeVal;
+    MbPollEvent_t xEvents[MB_TCP_PORT_MAX_CONN + 2];
+    int64_t xIdleCheckTimeStamp = 0;
 
     // Main connection cycle
     while (1) {
@@ -468,194 +1188,111 @@ static void vMBTCPPortServerTask(void *pvParameters)
             TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
             continue;
         }
+        if (xConfig.eMbProto == MB_PROTO_UDP) {
+            vMBTCPPortUdpServe();
+            close(xListenSock);
+            xListenSock = -1;
+            TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
+            continue;
+        }
+        // The listen socket is registered with the empty context
+        if (!xMBTCPPortPollAdd(&xPollSet, xListenSock, NULL)) {
+            close(xListenSock);
+            xListenSock = -1;
+            TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
+            continue;
+        }
 
         // Connections handling cycle
         while (1) {
-            // clear the socket set
-            FD_ZERO(&xReadSet);
-            // add master socket to set
-            FD_SET(xListenSock, &xReadSet);
-            int xMaxSd = xListenSock;
-            xConfig.usClientCount = 0;
-
-            vxMBTCPPortMStoTimeVal(1, &xTimeVal);
-            // Initialize read set and file descriptor according to
-            // all registered connected clients
-            for (i = 0; i < MB_TCP_PORT_MAX_CONN; i++) {
-                TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
-                if ((xConfig.pxMbClientInfo[i] != NULL) && (xConfig.pxMbClientInfo[i]->xSockId > 0)) {
-                    // calculate max file descriptor for select
-                    xMaxSd = (xConfig.pxMbClientInfo[i]->xSockId > xMaxSd) ?
-                            xConfig.pxMbClientInfo[i]->xSockId : xMaxSd;
-                    FD_SET(xConfig.pxMbClientInfo[i]->xSockId, &xReadSet);
-                    xConfig.usClientCount++;
-                }
-            }
+            TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
 
-            vxMBTCPPortMStoTimeVal(MB_TCP_RESP_TIMEOUT_MS, &xTimeVal);
+            vMBTCPPortResumeClients();
+            vMBTCPPortResumeListen();
 
-            // Wait for an activity on one of the sockets during timeout
-            xErr = select(xMaxSd + 1, &xReadSet, NULL, NULL, &xTimeVal);
+            // Wait for an activity on one of the registered sockets during timeout,
+            // poll faster while some clients wait for the stack to drain their queues
+            ULONG ulTimeoutMs = usThrottledCount ? MB_TCP_PIPELINE_POLL_MS : MB_TCP_RESP_TIMEOUT_MS;
+            xErr = xMBTCPPortPollWait(&xPollSet, xEvents, MB_TCP_PORT_MAX_CONN + 2, ulTimeoutMs);
             if ((xErr < 0) && (errno != EINTR)) {
                 // error occurred during wait for read
-                ESP_LOGE(TAG, "select() errno = %u.", (unsigned)errno);
+                ESP_LOGE(TAG, "poll() errno = %u.", (unsigned)errno);
                 TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
                 continue;
             } else if (xErr == 0) {
                 // If timeout happened, something is wrong
-                ESP_LOGD(TAG, "select() timeout, errno = %u.", (unsigned)errno);
-                TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
+                ESP_LOGD(TAG, "poll() timeout, errno = %u.", (unsigned)errno);
             }
 
-            // If something happened on the master socket, then its an incoming connection.
-            if (FD_ISSET(xListenSock, &xReadSet) && xConfig.usClientCount < MB_TCP_PORT_MAX_CONN) {
-                MbClientInfo_t* pxClientInfo = NULL;
-                // find first empty place to insert connection info
-                for (i = 0; i < MB_TCP_PORT_MAX_CONN; i++) {
-                    pxClientInfo = xConfig.pxMbClientInfo[i];
-                    if (pxClientInfo == NULL) {
-                        break;
-                    }
+            vMBTCPPortCheckRespTimeout();
+
+            // Handle the ready sockets only
+            for (int xEv = 0; xEv < xErr; xEv++) {
+                if (xEvents[xEv].pvCtx == &xConfig.xWakeSock) {
+                    // The queues freed by the stack are resumed at the beginning of the cycle
+                    vMBTCPPortWakeDrain();
+                    continue;
+                }
+                MbClientInfo_t* pxClientInfo = (MbClientInfo_t*)xEvents[xEv].pvCtx;
+                if (!pxClientInfo) {
+                    // Something happened on the listen socket, then its an incoming connection.
+                    vMBTCPPortAcceptClient();
+                    continue;
+                }
+                if ((xConfig.pxMbClientInfo[pxClientInfo->xIndex] != pxClientInfo)
+                    || (pxClientInfo->xSockId != xEvents[xEv].xSockId)) {
+                    // The client is replaced by the connection accepted during this cycle
+                    continue;
+                }
+                if (xEvents[xEv].xError) {
+                    // The hangup and the errors are reported for the throttled sockets too, which
+                    // receive ring can be full: drop the client here instead of waiting for recv()
+                    vMBTCPPortDropClient(pxClientInfo, xMBTCPPortSockErrorReason(pxClientInfo));
+                    continue;
                 }
-                // if request for new connection but no space left
-                if (pxClientInfo != NULL) {
-                    if (xConfig.pxMbClientInfo[MB_TCP_PORT_MAX_CONN] == NULL) {
-                        ESP_LOGE(TAG, "Fail to accept connection %u, only %u connections supported.", (unsigned)(i + 1), (unsigned)MB_TCP_PORT_MAX_CONN);
+                int xRet = xMBTCPPortRxPoll(pxClientInfo);
+                // If an invalid data received from socket or connection fail then drop connection
+                if (xRet < 0) {
+                    eMBTCPDropReason eReason = MB_TCP_DROP_ERROR;
+                    switch(xRet)
+                    {
+                        case ERR_CLSD:
+                            ESP_LOGE(TAG, "Socket (#%d)(%s), connection closed by peer.",
+                                                                (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr);
+                            eReason = MB_TCP_DROP_PEER_CLOSED;
+                            break;
+                        case ERR_TIMEOUT:
+                            ESP_LOGE(TAG, "Socket (#%d)(%s), peer does not answer keepalive.",
+                                                                (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr);
+                            eReason = MB_TCP_DROP_KEEPALIVE;
+                            break;
+                        case ERR_BUF:
+                            eReason = MB_TCP_DROP_BAD_FRAME;
+                            // fall through
+                        default:
+                            ESP_LOGE(TAG, "Socket (#%d)(%s), read data error: 0x%x",
+                                                                (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr, (int)xRet);
+                            break;
                     }
-                    xConfig.pxMbClientInfo[MB_TCP_PORT_MAX_CONN] = pxClientInfo; // set last connection info
+                    // Close client connection and unregister it
+                    vMBTCPPortDropClient(pxClientInfo, eReason);
                 } else {
-                    // allocate memory for new client info
-                    pxClientInfo = calloc(1, sizeof(MbClientInfo_t));
-                    if (!pxClientInfo) {
-                        ESP_LOGE(TAG, "Client info allocation fail.");
-                        vMBTCPPortFreeClientInfo(pxClientInfo);
-                        pxClientInfo = NULL;
-                    } else {
-                        // Accept new client connection
-                        pxClientInfo->xSockId = xMBTCPPortAcceptConnection(xListenSock, &pcClientIp);
-                        if (pxClientInfo->xSockId < 0) {
-                            ESP_LOGE(TAG, "Fail to accept connection for client %u.", (unsigned)(xConfig.usClientCount - 1));
-                            // Accept connection fail, then free client info and continue polling.
-                            vMBTCPPortFreeClientInfo(pxClientInfo);
-                            pxClientInfo = NULL;
-                            continue;
-                        }
-                        pxClientInfo->pucTCPBuf = calloc(MB_TCP_BUF_SIZE, sizeof(UCHAR));
-                        if (!pxClientInfo->pucTCPBuf) {
-                            ESP_LOGE(TAG, "Fail to allocate buffer for client %u.", (unsigned)(xConfig.usClientCount - 1));
-                            vMBTCPPortFreeClientInfo(pxClientInfo);
-                            pxClientInfo = NULL;
-                            continue;
-                        }
-                        // Fill the connection info structure
-                        xConfig.pxMbClientInfo[i] = pxClientInfo;
-                        pxClientInfo->xIndex = i;
-                        xConfig.usClientCount++;
-                        pxClientInfo->pcIpAddr = pcClientIp;
-                        pxClientInfo->xRecvTimeStamp = xMBTCPGetTimeStamp();
-                        xConfig.pxMbClientInfo[MB_TCP_PORT_MAX_CONN] = NULL;
-                        pxClientInfo->usTCPFrameBytesLeft = MB_TCP_FUNC;
-                        pxClientInfo->usTCPBufPos = 0;
+                    // The received requests are queued and dispatched to the stack in order,
+                    // the responses are sent from the stack task, so do not wait for them here
+                    pxClientInfo->xRecvTimeStamp = xMBTCPGetTimeStamp();
+                    if (xRet) {
+                        ESP_LOGD(TAG, "Socket (#%d)(%s), queued %d request(s), %u pending.",
+                                                            (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr,
+                                                            xRet, (unsigned)pxClientInfo->usTransCount);
                     }
+                    vMBTCPPortThrottleClient(pxClientInfo);
                 }
             }
-            // Handle data request from client
-            if (xErr > 0) {
-                // Handling client connection requests
-                for (i = 0; i < MB_TCP_PORT_MAX_CONN; i++) {
-                    MbClientInfo_t* pxClientInfo = xConfig.pxMbClientInfo[i];
-                    if ((pxClientInfo != NULL) && (pxClientInfo->xSockId > 0)) {
-                        if (FD_ISSET(pxClientInfo->xSockId, &xReadSet)) {
-                            // Other sockets are ready to be read
-                            xErr = xMBTCPPortRxPoll(pxClientInfo, MB_TCP_READ_TIMEOUT_MS);
-                            // If an invalid data received from socket or connection fail
-                            // or if timeout then drop connection and restart
-                            if (xErr < 0) {
-                                uint64_t xTimeStamp = xMBTCPGetTimeStamp();
-                                // If data update is timed out
-                                switch(xErr)
-                                {
-                                    case ERR_TIMEOUT:
-                                        ESP_LOGE(TAG, "Socket (#%d)(%s), data receive timeout, time[us]: %" PRIu64 ", close active connection.",
-                                                                            (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr,
-                                                                            (uint64_t)(xTimeStamp - pxClientInfo->xRecvTimeStamp));
-                                        break;
-                                    case ERR_CLSD:
-                                        ESP_LOGE(TAG, "Socket (#%d)(%s), connection closed by peer.",
-                                                                            (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr);
-                                        break;
-                                    case ERR_BUF:
-                                    default:
-                                        ESP_LOGE(TAG, "Socket (#%d)(%s), read data error: 0x%x",
-                                                                            (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr, (int)xErr);
-                                        break;
-                                }
-
-                                TCP_PORT_CHECK_SHDN(xShutdownSema, vMBTCPPortShutdown);
-
-                                // Close client connection
-                                xMBTCPPortCloseConnection(pxClientInfo);
-
-                                // This client does not respond, then unregister it
-                                vMBTCPPortFreeClientInfo(pxClientInfo);
-                                xConfig.pxMbClientInfo[i] = NULL;
-                                xConfig.pxMbClientInfo[MB_TCP_PORT_MAX_CONN] = NULL;
-                                // If no any active connections, break
-                                if (!xConfig.usClientCount) {
-                                    xConfig.pxCurClientInfo = NULL;
-                                    break;
-                                }
-                            } else {
-                                pxClientInfo->xRecvTimeStamp = xMBTCPGetTimeStamp();
-
-                                // set current client info to active client from which we received request
-                                xConfig.pxCurClientInfo = pxClientInfo;
-
-                                // Complete frame received, inform state machine to process frame
-                                xMBPortEventPost(EV_FRAME_RECEIVED);
-
-                                ESP_LOGD(TAG, "Socket (#%d)(%s), get packet TID=0x%X, %d bytes.",
-                                                                    (int)pxClientInfo->xSockId, pxClientInfo->pcIpAddr,
-                                                                    (int)pxClientInfo->usTidCnt, (int)xErr);
-
-                                // Wait while response is not processed by stack by timeout
-                                UCHAR* pucSentBuffer = vxMBTCPPortRespQueueRecv(xConfig.xRespQueueHandle);
-                                if (pucSentBuffer == NULL) {
-                                    ESP_LOGD(TAG, "Response is ignored, time exceeds configured %d [ms].",
-                                                                        (unsigned)MB_TCP_RESP_TIMEOUT_MS);
-                                } else  {
-                                    USHORT usSentTid = MB_TCP_GET_FIELD(pucSentBuffer, MB_TCP_TID);
-                                    if (usSentTid != pxClientInfo->usTidCnt) {
-                                        ESP_LOGE(TAG, "Sent TID(%x) != Recv TID(%x), ignore packet.",
-                                                                            (int)usSentTid, (int)pxClientInfo->usTidCnt);
-                                    }
-                                }
-
-                                // Get time stamp of last data update
-                                pxClientInfo->xSendTimeStamp = xMBTCPGetTimeStamp();
-                                ESP_LOGD(TAG, "Client %d, Socket(#%d), processing time = %" PRIu64 "(us).",
-                                                            (int)pxClientInfo->xIndex, (int)pxClientInfo->xSockId,
-                                                            (uint64_t)(pxClientInfo->xSendTimeStamp - pxClientInfo->xRecvTimeStamp));
-                            }
-                        } else {
-                            if (pxClientInfo) {
-                                // client is not ready to be read
-                                int64_t xTime = xMBTCPGetTimeStamp() - pxClientInfo->xRecvTimeStamp;
-                                if (xTime > MB_TCP_DISCONNECT_TIMEOUT) {
-                                    ESP_LOGE(TAG, "Client %d, Socket(#%d) do not answer for %" PRIu64 " (us). Drop connection...",
-                                                                    (int)pxClientInfo->xIndex, (int)pxClientInfo->xSockId, (uint64_t)xTime);
-                                    xMBTCPPortCloseConnection(pxClientInfo);
-
-                                    // This client does not respond, then delete registered data
-                                    vMBTCPPortFreeClientInfo(pxClientInfo);
-                                    xConfig.pxMbClientInfo[i] = NULL;
-                                }
-                            } else {
-                                ESP_LOGE(TAG, "Client %d is disconnected.", (int)i);
-                            }
-                        }
-                    } // if ((pxClientInfo != NULL)
-                } // Handling client connection requests
+
+            // The connection timeout is in seconds, so there is no need to check it every cycle
+            if ((xMBTCPGetTimeStamp() - xIdleCheckTimeStamp) > MB_TCP_IDLE_CHECK_PERIOD) {
+                xIdleCheckTimeStamp = xMBTCPGetTimeStamp();
+                vMBTCPPortCheckIdleClients();
             }
         } // while(1) // Handle connection cycle
     } // Main connection cycle
@@ -676,13 +1313,18 @@ vMBTCPPortClose( )
     xConfig.xMbTcpTaskHandle = NULL;
     close(xListenSock);
     xListenSock = -1;
+    vMBTCPPortWakeClose();
+    vMBTCPPortPollClose(&xPollSet);
+    vMBTCPPortPoolClose(&xConfig.xClientPool);
+    free(xConfig.pxUdpPeers);
+    xConfig.pxUdpPeers = NULL;
 
-    vMBTCPPortRespQueueDelete(xConfig.xRespQueueHandle);
+    CRITICAL_SECTION_CLOSE(xConfig.xTransLock);
     if (xShutdownSema) {
         vSemaphoreDelete(xShutdownSema);
         xShutdownSema = NULL;
     }
-    vMBPortEventClose();
+    xConfig.xMBHdl = NULL;
     ESP_LOGD(TAG,"Port is closed.");
 }
 
@@ -701,20 +1343,38 @@ BOOL
 xMBTCPPortGetRequest( UCHAR ** ppucMBTCPFrame, USHORT * usTCPLength )
 {
     BOOL xRet = FALSE;
-    if (xConfig.pxCurClientInfo) {
-        *ppucMBTCPFrame = &xConfig.pxCurClientInfo->pucTCPBuf[0];
-        *usTCPLength = xConfig.pxCurClientInfo->usTCPBufPos;
-
-        // Reset the buffer.
-        xConfig.pxCurClientInfo->usTCPBufPos = 0;
-        xConfig.pxCurClientInfo->usTCPFrameBytesLeft = MB_TCP_FUNC;
-        xRet = TRUE;
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        if (xConfig.pxCurClientInfo && xConfig.pxCurClientInfo->usTransCount) {
+            MbTransaction_t* pxTrans = pxMBTCPPortTransHead(xConfig.pxCurClientInfo);
+            *ppucMBTCPFrame = &pxTrans->pucBuf[0];
+            *usTCPLength = pxTrans->usLength;
+            xConfig.xCurTaken = TRUE;
+            xRet = TRUE;
+        }
     }
     return xRet;
 }
 
-BOOL
-xMBTCPPortSendResponse( UCHAR * pucMBTCPFrame, USHORT usTCPLength )
+// Send the response datagram to the sender of the UDP request
+static BOOL xMBTCPPortSendDatagram(MbClientInfo_t* pxClientInfo, MbTransaction_t* pxTrans,
+                                    UCHAR* pucMBTCPFrame, USHORT usTCPLength)
+{
+    MbUdpPeer_t* pxPeer = pxMBTCPPortUdpPeer(pxClientInfo, pxTrans);
+    int xErr = sendto(pxClientInfo->xSockId, pucMBTCPFrame, usTCPLength, 0,
+                        (struct sockaddr *)&pxPeer->xAddr, pxPeer->xAddrLen);
+    if (xErr < 0) {
+        ESP_LOGE(TAG, "Socket(#%d), fail to send datagram, errno = %u",
+                    (int)pxClientInfo->xSockId, (unsigned)errno);
+        pxClientInfo->xError = xErr;
+        return FALSE;
+    }
+    pxClientInfo->xSendTimeStamp = xMBTCPGetTimeStamp();
+    return TRUE;
+}
+
+// Wait until the socket of the client is writable and send the frame of the transaction
+static BOOL xMBTCPPortSendFrame(MbClientInfo_t* pxClientInfo, MbTransaction_t* pxTrans,
+                                    UCHAR* pucMBTCPFrame, USHORT usTCPLength)
 {
     BOOL bFrameSent = FALSE;
     fd_set xWriteSet;
@@ -722,38 +1382,150 @@ xMBTCPPortSendResponse( UCHAR * pucMBTCPFrame, USHORT usTCPLength )
     int xErr = -1;
     struct timeval xTimeVal;
 
-    if (xConfig.pxCurClientInfo) {
-        FD_ZERO(&xWriteSet);
-        FD_ZERO(&xErrorSet);
-        FD_SET(xConfig.pxCurClientInfo->xSockId, &xWriteSet);
-        FD_SET(xConfig.pxCurClientInfo->xSockId, &xErrorSet);
-        vxMBTCPPortMStoTimeVal(MB_TCP_SEND_TIMEOUT_MS, &xTimeVal);
-        // Check if socket writable
-        xErr = select(xConfig.pxCurClientInfo->xSockId + 1, NULL, &xWriteSet, &xErrorSet, &xTimeVal);
-        if ((xErr == -1) || FD_ISSET(xConfig.pxCurClientInfo->xSockId, &xErrorSet)) {
-            ESP_LOGE(TAG, "Socket(#%d) , send select() error = %u.",
-                            (int)xConfig.pxCurClientInfo->xSockId, (unsigned)errno);
-            return FALSE;
-        }
-
-        // Apply TID field from request to the frame before send response
-        pucMBTCPFrame[MB_TCP_TID] = (UCHAR)(xConfig.pxCurClientInfo->usTidCnt >> 8U);
-        pucMBTCPFrame[MB_TCP_TID + 1] = (UCHAR)(xConfig.pxCurClientInfo->usTidCnt & 0xFF);
+    if (xConfig.pxUdpPeers) {
+        return xMBTCPPortSendDatagram(pxClientInfo, pxTrans, pucMBTCPFrame, usTCPLength);
+    }
 
+    FD_ZERO(&xWriteSet);
+    FD_ZERO(&xErrorSet);
+    FD_SET(pxClientInfo->xSockId, &xWriteSet);
+    FD_SET(pxClientInfo->xSockId, &xErrorSet);
+    vxMBTCPPortMStoTimeVal(MB_TCP_SEND_TIMEOUT_MS, &xTimeVal);
+    // Check if socket writable
+    xErr = select(pxClientInfo->xSockId + 1, NULL, &xWriteSet, &xErrorSet, &xTimeVal);
+    if ((xErr == -1) || FD_ISSET(pxClientInfo->xSockId, &xErrorSet)) {
+        ESP_LOGE(TAG, "Socket(#%d) , send select() error = %u.",
+                        (int)pxClientInfo->xSockId, (unsigned)errno);
+    } else {
         // Write message into socket and disable Nagle's algorithm
-        xErr = send(xConfig.pxCurClientInfo->xSockId, pucMBTCPFrame, usTCPLength, TCP_NODELAY);
+        xErr = send(pxClientInfo->xSockId, pucMBTCPFrame, usTCPLength, 0);
         if (xErr < 0) {
             ESP_LOGE(TAG, "Socket(#%d), fail to send data, errno = %u",
-                        (int)xConfig.pxCurClientInfo->xSockId, (unsigned)errno);
-            xConfig.pxCurClientInfo->xError = xErr;
+                        (int)pxClientInfo->xSockId, (unsigned)errno);
+            pxClientInfo->xError = xErr;
         } else {
             bFrameSent = TRUE;
-            vxMBTCPPortRespQueueSend(xConfig.xRespQueueHandle, (void*)pucMBTCPFrame);
+            pxClientInfo->xSendTimeStamp = xMBTCPGetTimeStamp();
+        }
+    }
+    return bFrameSent;
+}
+
+BOOL
+xMBTCPPortSendResponse( UCHAR * pucMBTCPFrame, USHORT usTCPLength )
+{
+    BOOL bFrameSent = FALSE;
+    MbClientInfo_t* pxClientInfo = NULL;
+    MbTransaction_t* pxTrans = NULL;
+    USHORT usTid = 0;
+
+    // The client info is kept while it is active in the stack even if the connection is dropped
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        if (xConfig.pxCurClientInfo && !xConfig.pxCurClientInfo->xCloseDeferred
+                && xConfig.pxCurClientInfo->usTransCount) {
+            pxClientInfo = xConfig.pxCurClientInfo;
+            pxTrans = pxMBTCPPortTransHead(pxClientInfo);
+            usTid = pxTrans->usTid;
+        }
+    }
+
+    if (pxClientInfo) {
+        // Apply TID field of the transaction to the frame before send response
+        pucMBTCPFrame[MB_TCP_TID] = (UCHAR)(usTid >> 8U);
+        pucMBTCPFrame[MB_TCP_TID + 1] = (UCHAR)(usTid & 0xFF);
+        bFrameSent = xMBTCPPortSendFrame(pxClientInfo, pxTrans, pucMBTCPFrame, usTCPLength);
+        if (bFrameSent) {
+            ESP_LOGD(TAG, "Client %d, Socket(#%d), TID=0x%X, processing time = %" PRIu64 "(us).",
+                                        (int)pxClientInfo->xIndex, (int)pxClientInfo->xSockId, (int)usTid,
+                                        (uint64_t)(pxClientInfo->xSendTimeStamp - xConfig.xDispatchTimeStamp));
         }
     } else {
-        ESP_LOGD(TAG, "Port is not active. Release lock.");
-        vxMBTCPPortRespQueueSend(xConfig.xRespQueueHandle, (void*)pucMBTCPFrame);
+        ESP_LOGD(TAG, "Port is not active. Release transaction.");
+    }
+
+    // The transaction is completed, pass the next pending request to the stack
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        vMBTCPPortTransComplete();
+    }
+    vMBTCPPortWakeServer();
+    return bFrameSent;
+}
+
+void
+vMBTCPPortReleaseRequest( void )
+{
+    // The request is not answered (addressed to the other unit or incorrect),
+    // complete it at once so the next transactions do not wait for the response timeout
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        if (xConfig.xCurTaken) {
+            ESP_LOGD(TAG, "Client %d, TID=0x%X, request is not answered by the stack.",
+                                        (int)xConfig.pxCurClientInfo->xIndex,
+                                        (int)pxMBTCPPortTransHead(xConfig.pxCurClientInfo)->usTid);
+            vMBTCPPortTransComplete();
+        }
+    }
+    vMBTCPPortWakeServer();
+}
+
+void vMBTCPPortSlaveSetForward(UCHAR ucLocalUid, pxMBTCPForwardCB pxForwardCB, void* pvArg)
+{
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        xConfig.ucLocalUid = ucLocalUid;
+        xConfig.pvForwardArg = pvArg;
+        xConfig.pxForwardCB = pxForwardCB;
+    }
+}
+
+BOOL xMBTCPPortSlaveForwardResponse(MbForwardTicket_t xTicket, const UCHAR* pucPDU, USHORT usPDULength)
+{
+    BOOL bFrameSent = FALSE;
+    BOOL xSend = FALSE;
+    MbClientInfo_t* pxClientInfo = NULL;
+    MbTransaction_t* pxTrans = NULL;
+    UCHAR* pucFrame = NULL;
+    USHORT usTCPLength = usPDULength + MB_TCP_FUNC;
+
+    MB_PORT_CHECK(((pucPDU != NULL) && (usPDULength > 0) && (usTCPLength <= MB_TCP_BUF_SIZE)),
+                    FALSE, "Incorrect forwarded response.");
+
+    // The slot of the client dropped during the forwarding is kept until the response
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        if (xConfig.xClientPool.pxSlots && (xTicket.usClient < xConfig.xClientPool.usSize)) {
+            MbClientInfo_t* pxSlot = &xConfig.xClientPool.pxSlots[xTicket.usClient];
+            if (pxSlot->xForwarded && pxSlot->usTransCount
+                    && (pxMBTCPPortTransHead(pxSlot)->usTid == xTicket.usTid)) {
+                pxClientInfo = pxSlot;
+                xSend = !pxSlot->xCloseDeferred;
+            }
+        }
+        if (xSend) {
+            // The response replaces the request in the buffer, the MBAP header is kept
+            pxTrans = pxMBTCPPortTransHead(pxClientInfo);
+            pucFrame = pxTrans->pucBuf;
+            memcpy(&pucFrame[MB_TCP_FUNC], pucPDU, usPDULength);
+            pucFrame[MB_TCP_LEN] = (UCHAR)((usPDULength + 1) >> 8U);
+            pucFrame[MB_TCP_LEN + 1] = (UCHAR)((usPDULength + 1) & 0xFF);
+        }
+    }
+    if (!pxClientInfo) {
+        ESP_LOGD(TAG, "Forwarded transaction TID=0x%X is not active, response is ignored.", (int)xTicket.usTid);
+        return FALSE;
+    }
+
+    if (xSend) {
+        bFrameSent = xMBTCPPortSendFrame(pxClientInfo, pxTrans, pucFrame, usTCPLength);
+        if (bFrameSent) {
+            ESP_LOGD(TAG, "Client %d, Socket(#%d), TID=0x%X, forwarded response sent.",
+                                        (int)pxClientInfo->xIndex, (int)pxClientInfo->xSockId, (int)xTicket.usTid);
+        }
+    }
+
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        pxClientInfo->xForwarded = FALSE;
+        vMBTCPPortTransPop(pxClientInfo);
+        vMBTCPPortTransDispatch();
     }
+    vMBTCPPortWakeServer();
     return bFrameSent;
 }
 
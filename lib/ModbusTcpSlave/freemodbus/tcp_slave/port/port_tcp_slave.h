@@ -43,7 +43,9 @@
 
 #include "lwip/opt.h"
 #include "lwip/sys.h"
+#include "lwip/sockets.h"
 #include "port.h"
+#include "mbport.h"                 // for xMBHandle
 #include "esp_modbus_common.h"      // for common types for network options
 
 /* ----------------------- Defines ------------------------------------------*/
@@ -56,41 +58,123 @@
 #define FALSE                   0
 #endif
 
+#define MB_TCP_IP_ADDR_LEN      (46)    // enough for the IPv6 address string
+
 #ifdef __cplusplus
 PR_BEGIN_EXTERN_C
 #endif
 
 /* ----------------------- Type definitions ---------------------------------*/
+typedef enum {
+    MB_TCP_DROP_LRU = 0,            /*!< Replaced by the new connection while all slots are in use */
+    MB_TCP_DROP_IDLE,               /*!< No requests during the connection timeout */
+    MB_TCP_DROP_PEER_CLOSED,        /*!< Connection closed by the peer */
+    MB_TCP_DROP_KEEPALIVE,          /*!< Peer does not answer the keepalive probes */
+    MB_TCP_DROP_BAD_FRAME,          /*!< Incorrect MBAP frame received (discarded datagram in UDP mode) */
+    MB_TCP_DROP_ERROR,              /*!< Socket error */
+    MB_TCP_DROP_COUNT
+} eMBTCPDropReason;
+
+typedef struct {
+    USHORT usClient;                /*!< index of the client slot */
+    USHORT usTid;                   /*!< MBAP transaction identifier of the request */
+} MbForwardTicket_t;
+
+/**
+ * Callback receiving the requests addressed to the units other than the slave itself.
+ * It is called with the port lock taken, so it must copy the PDU and return without blocking.
+ * The accepted request is answered by xMBTCPPortSlaveForwardResponse() with the same ticket,
+ * the next requests of the client wait until then.
+ *
+ * @return TRUE if the request is accepted, FALSE to pass it to the stack
+ */
+typedef BOOL (*pxMBTCPForwardCB)(void* pvArg, MbForwardTicket_t xTicket, UCHAR ucUnitId,
+                                    const UCHAR* pucPDU, USHORT usPDULength);
+
+typedef struct {
+    USHORT usTid;                   /*!< MBAP transaction identifier of the request */
+    USHORT usLength;                /*!< length of the complete request frame */
+    UCHAR* pucBuf;                  /*!< frame buffer, the response is built in place */
+    int64_t xRecvTimeStamp;         /*!< time stamp of the complete request reception */
+} MbTransaction_t;
+
+typedef struct {
+    struct sockaddr_storage xAddr;  /*!< sender of the UDP request, the response is sent back to it */
+    socklen_t xAddrLen;             /*!< length of the sender address */
+} MbUdpPeer_t;
+
 typedef struct {
     int xIndex;                     /*!< Modbus info index */
     int xSockId;                    /*!< Socket id */
     int xError;                     /*!< TCP/UDP sock error */
-    const char* pcIpAddr;           /*!< TCP/UDP IP address (string) */
-    UCHAR* pucTCPBuf;               /*!< buffer pointer */
-    USHORT usTCPBufPos;             /*!< buffer active position */
-    USHORT usTCPFrameBytesLeft;     /*!< buffer left bytes to receive transaction */
+    CHAR pcIpAddr[MB_TCP_IP_ADDR_LEN]; /*!< TCP/UDP IP address (string) */
+    UCHAR* pucRxRing;               /*!< receive ring buffer of MB_TCP_RX_RING_SIZE */
+    USHORT usRxHead;                /*!< ring position of the first unparsed byte */
+    USHORT usRxCount;               /*!< number of unparsed bytes in the ring */
     int64_t xSendTimeStamp;         /*!< send request timestamp */
     int64_t xRecvTimeStamp;         /*!< receive response timestamp */
     USHORT usTidCnt;                /*!< last TID counter from packet */
+    MbTransaction_t xTransQueue[MB_TCP_PIPELINE_DEPTH]; /*!< pending transactions in arrival order */
+    USHORT usTransHead;             /*!< index of the oldest pending transaction */
+    USHORT usTransCount;            /*!< number of pending transactions */
+    BOOL xCloseDeferred;            /*!< release the client once its active transaction completes */
+    BOOL xThrottled;                /*!< socket readiness is not reported while the queue is full */
+    BOOL xForwarded;                /*!< the active transaction is processed by the forward callback */
 } MbClientInfo_t;
 
+typedef struct {
+    MbClientInfo_t* pxSlots;        /*!< Client slots, allocated once on port init */
+    UCHAR* pucBuf;                  /*!< Transaction buffers and receive rings of all the slots */
+    USHORT* pusFree;                /*!< Stack of free slot indexes */
+    USHORT usFreeCount;             /*!< Number of free slots */
+    USHORT usSize;                  /*!< Number of slots in the pool */
+    USHORT usHighWater;             /*!< Maximum number of slots in use at once */
+    ULONG ulExhausted;              /*!< Number of connections rejected because no slot is free */
+    ULONG ulDropped[MB_TCP_DROP_COUNT]; /*!< Number of dropped connections per reason */
+} MbClientPool_t;
+
+typedef struct {
+    USHORT usSize;                  /*!< Number of slots in the pool */
+    USHORT usInUse;                 /*!< Number of slots currently in use */
+    USHORT usHighWater;             /*!< Maximum number of slots in use at once */
+    ULONG ulExhausted;              /*!< Number of connections rejected because no slot is free */
+    ULONG ulDropped[MB_TCP_DROP_COUNT]; /*!< Number of dropped connections per reason */
+} MbClientPoolStats_t;
+
 typedef struct {
     TaskHandle_t xMbTcpTaskHandle;      /*!< Server task handle */
-    QueueHandle_t xRespQueueHandle;      /*!< Response queue handle */
-    MbClientInfo_t* pxCurClientInfo;    /*!< Current client info */
+    _lock_t xTransLock;                 /*!< Lock of transaction queues shared with the stack task */
+    MbClientInfo_t* pxCurClientInfo;    /*!< Client of the transaction processed by the stack */
+    BOOL xCurTaken;                     /*!< The stack has taken the frame of the active transaction */
+    BOOL xCurLate;                      /*!< The late response of the active transaction is reported */
+    int64_t xDispatchTimeStamp;         /*!< Time stamp of the transaction dispatch to the stack */
+    USHORT usNextClient;                /*!< Round robin index of the next client to dispatch */
     MbClientInfo_t** pxMbClientInfo;    /*!< Pointers to information about connected clients */
+    MbClientPool_t xClientPool;         /*!< Preallocated client slots */
+    USHORT usMaxConn;                   /*!< Maximum number of client connections */
     USHORT usPort;                      /*!< TCP/UDP port number */
     CHAR* pcBindAddr;                   /*!< IP address to bind */
     eMBPortProto eMbProto;              /*!< Protocol type used by port */
     USHORT usClientCount;               /*!< Client connection count */
     void* pvNetIface;                   /*!< Network netif interface pointer for port */
     eMBPortIpVer xIpVer;                /*!< IP protocol version */
+    pxMBTCPForwardCB pxForwardCB;       /*!< Callback of the requests to the other units */
+    void* pvForwardArg;                 /*!< Argument of the forward callback */
+    UCHAR ucLocalUid;                   /*!< Unit identifier served by the stack itself */
+    xMBHandle xMBHdl;                   /*!< Stack instance the port is bound to */
+    MbUdpPeer_t* pxUdpPeers;            /*!< Senders of the transactions of the UDP client slot, UDP mode only */
+    int xWakeSock;                      /*!< Loopback datagram socket waking the server task */
+    struct sockaddr_in xWakeAddr;       /*!< Address of the wake socket */
+    BOOL xWakePending;                  /*!< The stack has freed the queue of a throttled client */
 } MbSlavePortConfig_t;
 
 /* ----------------------- Function prototypes ------------------------------*/
 
 /**
- * Function to setup communication options for TCP/UDP Modbus port
+ * Function to setup communication options for TCP/UDP Modbus port,
+ * the options are applied on the next port initialization.
+ * In the UDP mode every datagram carries one request and the response is sent
+ * to the sender of the datagram, there is no connection state.
  *
  * @param pvNetIf netif interface pointer
  * @param xIpVersion IP version
@@ -101,6 +185,45 @@ typedef struct {
  */
 void vMBTCPPortSlaveSetNetOpt(void* pvNetIf, eMBPortIpVer xIpVersion, eMBPortProto xProto, CHAR* pcBindAddr);
 
+/**
+ * Set the number of client slots allocated on port initialization
+ *
+ * @param usMaxConn number of slots, 0 or the values above MB_TCP_PORT_MAX_CONN
+ *                  select MB_TCP_PORT_MAX_CONN
+ */
+void vMBTCPPortSlaveSetMaxConn(USHORT usMaxConn);
+
+/**
+ * Get the usage statistic of the client slot pool
+ *
+ * @param pxStats pointer to statistic structure
+ *
+ * @return TRUE if the port is initialized
+ */
+BOOL xMBTCPPortSlaveGetPoolStats(MbClientPoolStats_t* pxStats);
+
+/**
+ * Forward the requests addressed to the other units to the callback (gateway mode).
+ * The requests to the local unit, broadcast (0) and pseudo (255) addresses are served by the stack.
+ *
+ * @param ucLocalUid unit identifier of the slave itself
+ * @param pxForwardCB callback of the forwarded requests, NULL disables forwarding
+ * @param pvArg argument passed to the callback
+ */
+void vMBTCPPortSlaveSetForward(UCHAR ucLocalUid, pxMBTCPForwardCB pxForwardCB, void* pvArg);
+
+/**
+ * Send the response of the forwarded request and release the transaction.
+ * The response is sent under the transaction identifier of the request.
+ *
+ * @param xTicket ticket passed to the forward callback with the request
+ * @param pucPDU response PDU (function code and data)
+ * @param usPDULength length of the response PDU
+ *
+ * @return TRUE if the response is sent, FALSE if the transaction is gone or the send failed
+ */
+BOOL xMBTCPPortSlaveForwardResponse(MbForwardTicket_t xTicket, const UCHAR* pucPDU, USHORT usPDULength);
+
 #ifdef __cplusplus
 PR_END_EXTERN_C
 #endif
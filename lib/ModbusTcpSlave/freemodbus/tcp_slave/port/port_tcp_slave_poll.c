@@ -0,0 +1,201 @@
+/*
+ * SPDX-FileCopyrightText: 2026 ModbusTCP project contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// port_tcp_slave_poll.c
+// Socket readiness multiplexer of the Modbus TCP slave port.
+// The interest set is kept between the waits, sockets are registered on accept
+// and removed on close, so the server task does not rebuild it on every cycle.
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "port.h"
+#include "port_tcp_slave_poll.h"
+
+#if MB_TCP_ENABLED
+
+static const char *TAG = "MB_TCP_SLAVE_POLL";
+
+#if MB_TCP_POLL_USE_EPOLL
+
+BOOL xMBTCPPortPollInit(MbPollSet_t* pxSet, USHORT usMaxFds)
+{
+    MB_PORT_CHECK((pxSet != NULL) && (usMaxFds > 0), FALSE, "Incorrect poll set arguments.");
+    memset(pxSet, 0, sizeof(MbPollSet_t));
+    pxSet->xEpollFd = epoll_create1(0);
+    MB_PORT_CHECK((pxSet->xEpollFd >= 0), FALSE, "epoll_create1() fail, errno = %u.", (unsigned)errno);
+    pxSet->pxEvents = calloc(usMaxFds, sizeof(struct epoll_event));
+    pxSet->pxSockIds = calloc(usMaxFds, sizeof(int));
+    pxSet->ppvCtx = calloc(usMaxFds, sizeof(void*));
+    if (!pxSet->pxEvents || !pxSet->pxSockIds || !pxSet->ppvCtx) {
+        ESP_LOGE(TAG, "Poll set allocation failure.");
+        vMBTCPPortPollClose(pxSet);
+        return FALSE;
+    }
+    for (int i = 0; i < usMaxFds; pxSet->pxSockIds[i] = -1, i++);
+    pxSet->usMaxFds = usMaxFds;
+    return TRUE;
+}
+
+void vMBTCPPortPollClose(MbPollSet_t* pxSet)
+{
+    if (pxSet->xEpollFd > 0) {
+        close(pxSet->xEpollFd);
+    }
+    free(pxSet->pxEvents);
+    free(pxSet->pxSockIds);
+    free(pxSet->ppvCtx);
+    memset(pxSet, 0, sizeof(MbPollSet_t));
+    pxSet->xEpollFd = -1;
+}
+
+static int xMBTCPPortPollFind(MbPollSet_t* pxSet, int xSockId)
+{
+    for (int i = 0; i < pxSet->usMaxFds; i++) {
+        if (pxSet->pxSockIds[i] == xSockId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+BOOL xMBTCPPortPollAdd(MbPollSet_t* pxSet, int xSockId, void* pvCtx)
+{
+    int xIdx = xMBTCPPortPollFind(pxSet, -1);
+    MB_PORT_CHECK((xIdx >= 0), FALSE, "Poll set is full, socket (#%d) is not registered.", xSockId);
+    struct epoll_event xEvent = { .events = EPOLLIN, .data.u32 = (uint32_t)xIdx };
+    MB_PORT_CHECK((epoll_ctl(pxSet->xEpollFd, EPOLL_CTL_ADD, xSockId, &xEvent) == 0), FALSE,
+                    "Socket (#%d), epoll_ctl() fail, errno = %u.", xSockId, (unsigned)errno);
+    pxSet->pxSockIds[xIdx] = xSockId;
+    pxSet->ppvCtx[xIdx] = pvCtx;
+    pxSet->usCount++;
+    return TRUE;
+}
+
+void vMBTCPPortPollRemove(MbPollSet_t* pxSet, int xSockId)
+{
+    int xIdx = xMBTCPPortPollFind(pxSet, xSockId);
+    if (xIdx >= 0) {
+        (void)epoll_ctl(pxSet->xEpollFd, EPOLL_CTL_DEL, xSockId, NULL);
+        pxSet->pxSockIds[xIdx] = -1;
+        pxSet->ppvCtx[xIdx] = NULL;
+        pxSet->usCount--;
+    }
+}
+
+void vMBTCPPortPollEnable(MbPollSet_t* pxSet, int xSockId, BOOL xEnable)
+{
+    int xIdx = xMBTCPPortPollFind(pxSet, xSockId);
+    if (xIdx >= 0) {
+        struct epoll_event xEvent = { .events = xEnable ? EPOLLIN : 0, .data.u32 = (uint32_t)xIdx };
+        (void)epoll_ctl(pxSet->xEpollFd, EPOLL_CTL_MOD, xSockId, &xEvent);
+    }
+}
+
+int xMBTCPPortPollWait(MbPollSet_t* pxSet, MbPollEvent_t* pxEvents, int xMaxEvents, ULONG ulTimeoutMs)
+{
+    int xMax = (xMaxEvents < pxSet->usMaxFds) ? xMaxEvents : pxSet->usMaxFds;
+    int xReady = epoll_wait(pxSet->xEpollFd, pxSet->pxEvents, xMax, (int)ulTimeoutMs);
+    for (int i = 0; i < xReady; i++) {
+        uint32_t ulIdx = pxSet->pxEvents[i].data.u32;
+        pxEvents[i].xSockId = pxSet->pxSockIds[ulIdx];
+        pxEvents[i].pvCtx = pxSet->ppvCtx[ulIdx];
+        pxEvents[i].xError = (pxSet->pxEvents[i].events & (EPOLLERR | EPOLLHUP)) ? TRUE : FALSE;
+    }
+    return xReady;
+}
+
+#else // lwIP poll() backend
+
+#if LWIP_SOCKET_POLL
+#define MB_TCP_POLL(fds, nfds, tout)    lwip_poll(fds, nfds, tout)
+#else
+#define MB_TCP_POLL(fds, nfds, tout)    poll(fds, nfds, tout)
+#endif
+
+BOOL xMBTCPPortPollInit(MbPollSet_t* pxSet, USHORT usMaxFds)
+{
+    MB_PORT_CHECK((pxSet != NULL) && (usMaxFds > 0), FALSE, "Incorrect poll set arguments.");
+    memset(pxSet, 0, sizeof(MbPollSet_t));
+    pxSet->pxFds = calloc(usMaxFds, sizeof(struct pollfd));
+    pxSet->ppvCtx = calloc(usMaxFds, sizeof(void*));
+    if (!pxSet->pxFds || !pxSet->ppvCtx) {
+        ESP_LOGE(TAG, "Poll set allocation failure.");
+        vMBTCPPortPollClose(pxSet);
+        return FALSE;
+    }
+    pxSet->usMaxFds = usMaxFds;
+    return TRUE;
+}
+
+void vMBTCPPortPollClose(MbPollSet_t* pxSet)
+{
+    free(pxSet->pxFds);
+    free(pxSet->ppvCtx);
+    memset(pxSet, 0, sizeof(MbPollSet_t));
+}
+
+static int xMBTCPPortPollFind(MbPollSet_t* pxSet, int xSockId)
+{
+    for (int i = 0; i < pxSet->usCount; i++) {
+        if (pxSet->pxFds[i].fd == xSockId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+BOOL xMBTCPPortPollAdd(MbPollSet_t* pxSet, int xSockId, void* pvCtx)
+{
+    MB_PORT_CHECK((pxSet->usCount < pxSet->usMaxFds), FALSE,
+                    "Poll set is full, socket (#%d) is not registered.", xSockId);
+    pxSet->pxFds[pxSet->usCount].fd = xSockId;
+    pxSet->pxFds[pxSet->usCount].events = POLLIN;
+    pxSet->pxFds[pxSet->usCount].revents = 0;
+    pxSet->ppvCtx[pxSet->usCount] = pvCtx;
+    pxSet->usCount++;
+    return TRUE;
+}
+
+void vMBTCPPortPollRemove(MbPollSet_t* pxSet, int xSockId)
+{
+    int xIdx = xMBTCPPortPollFind(pxSet, xSockId);
+    if (xIdx >= 0) {
+        // Keep the set dense, move the last entry into the released place
+        pxSet->usCount--;
+        pxSet->pxFds[xIdx] = pxSet->pxFds[pxSet->usCount];
+        pxSet->ppvCtx[xIdx] = pxSet->ppvCtx[pxSet->usCount];
+    }
+}
+
+void vMBTCPPortPollEnable(MbPollSet_t* pxSet, int xSockId, BOOL xEnable)
+{
+    int xIdx = xMBTCPPortPollFind(pxSet, xSockId);
+    if (xIdx >= 0) {
+        pxSet->pxFds[xIdx].events = xEnable ? POLLIN : 0;
+    }
+}
+
+int xMBTCPPortPollWait(MbPollSet_t* pxSet, MbPollEvent_t* pxEvents, int xMaxEvents, ULONG ulTimeoutMs)
+{
+    int xReady = MB_TCP_POLL(pxSet->pxFds, pxSet->usCount, (int)ulTimeoutMs);
+    int xCount = 0;
+    for (int i = 0; (i < pxSet->usCount) && (xCount < xReady) && (xCount < xMaxEvents); i++) {
+        short xRevents = pxSet->pxFds[i].revents;
+        if (xRevents) {
+            pxEvents[xCount].xSockId = pxSet->pxFds[i].fd;
+            pxEvents[xCount].pvCtx = pxSet->ppvCtx[i];
+            pxEvents[xCount].xError = (xRevents & (POLLERR | POLLHUP | POLLNVAL)) ? TRUE : FALSE;
+            xCount++;
+        }
+    }
+    return (xReady < 0) ? xReady : xCount;
+}
+
+#endif // MB_TCP_POLL_USE_EPOLL
+
+#endif // MB_TCP_ENABLED
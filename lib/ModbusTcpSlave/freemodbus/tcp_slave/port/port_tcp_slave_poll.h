@@ -0,0 +1,118 @@
+/*
+ * SPDX-FileCopyrightText: 2026 ModbusTCP project contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// port_tcp_slave_poll.h
+// Socket readiness multiplexer of the Modbus TCP slave port
+
+#ifndef _PORT_TCP_SLAVE_POLL_H
+#define _PORT_TCP_SLAVE_POLL_H
+
+#include "port.h"
+
+/* ----------------------- Defines ------------------------------------------*/
+
+// The epoll backend is used in a Linux host build, the lwIP poll() is used on target
+#if defined(__linux__) && __has_include(<sys/epoll.h>)
+#define MB_TCP_POLL_USE_EPOLL           (1)
+#else
+#define MB_TCP_POLL_USE_EPOLL           (0)
+#endif
+
+#if MB_TCP_POLL_USE_EPOLL
+#include <sys/epoll.h>
+#else
+#include "lwip/sockets.h"
+#endif
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef struct {
+    int xSockId;                    /*!< Socket id */
+    void* pvCtx;                    /*!< Context registered with the socket */
+    BOOL xError;                    /*!< Socket has error or hang up condition */
+} MbPollEvent_t;
+
+typedef struct {
+    USHORT usMaxFds;                /*!< Maximum number of registered sockets */
+    USHORT usCount;                 /*!< Number of registered sockets */
+#if MB_TCP_POLL_USE_EPOLL
+    int xEpollFd;                   /*!< Epoll instance descriptor */
+    struct epoll_event* pxEvents;   /*!< Event buffer for epoll_wait() */
+    int* pxSockIds;                 /*!< Registered sockets, the event data holds the index */
+    void** ppvCtx;                  /*!< Contexts of the registered sockets */
+#else
+    struct pollfd* pxFds;           /*!< Persistent interest set passed to poll() */
+    void** ppvCtx;                  /*!< Contexts of the registered sockets */
+#endif
+} MbPollSet_t;
+
+/* ----------------------- Function prototypes ------------------------------*/
+
+/**
+ * Initialize the interest set
+ *
+ * @param pxSet interest set object
+ * @param usMaxFds maximum number of sockets to register
+ *
+ * @return TRUE if success
+ */
+BOOL xMBTCPPortPollInit(MbPollSet_t* pxSet, USHORT usMaxFds);
+
+/**
+ * Release resources of the interest set
+ *
+ * @param pxSet interest set object
+ */
+void vMBTCPPortPollClose(MbPollSet_t* pxSet);
+
+/**
+ * Register the socket for read readiness
+ *
+ * @param pxSet interest set object
+ * @param xSockId socket id
+ * @param pvCtx context returned with the events of the socket
+ *
+ * @return TRUE if success
+ */
+BOOL xMBTCPPortPollAdd(MbPollSet_t* pxSet, int xSockId, void* pvCtx);
+
+/**
+ * Remove the socket from the interest set
+ *
+ * @param pxSet interest set object
+ * @param xSockId socket id
+ */
+void vMBTCPPortPollRemove(MbPollSet_t* pxSet, int xSockId);
+
+/**
+ * Enable or disable read readiness reporting of the registered socket
+ *
+ * @param pxSet interest set object
+ * @param xSockId socket id
+ * @param xEnable TRUE to report the socket, FALSE to keep it registered without the read
+ *                readiness (the error and hangup conditions are still reported)
+ */
+void vMBTCPPortPollEnable(MbPollSet_t* pxSet, int xSockId, BOOL xEnable);
+
+/**
+ * Wait for the registered sockets readiness
+ *
+ * @param pxSet interest set object
+ * @param pxEvents buffer for ready sockets
+ * @param xMaxEvents size of the buffer
+ * @param ulTimeoutMs wait timeout in milliseconds
+ *
+ * @return number of ready sockets, 0 on timeout, -1 on error (errno is set)
+ */
+int xMBTCPPortPollWait(MbPollSet_t* pxSet, MbPollEvent_t* pxEvents, int xMaxEvents, ULONG ulTimeoutMs);
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
@@ -9,7 +9,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "esp_timer.h"
 #include "string.h"
+#include <stdatomic.h>
 
 // Mapear diretamente os registradores globais usados pelo RTU
 #include "modbus_params.h"
@@ -18,9 +20,33 @@
 #include "mbcontroller.h"
 #include "esp_modbus_common.h"
 #include "esp_modbus_slave.h"
+#include "port_tcp_slave.h"
+#include "mbutils.h"
 
 static const char *TAG = "MODBUS_TCP_SLAVE";
 
+// Watches por tipo escrito pelo master (holding e coils)
+#ifndef MODBUS_TCP_WATCH_MAX
+#define MODBUS_TCP_WATCH_MAX                (32)
+#endif
+#define MB_WATCH_TYPES                      (2)
+
+typedef struct {
+    uint16_t start;                  ///< Primeiro endereço observado
+    uint32_t end;                    ///< Endereço seguinte ao último observado
+    modbus_tcp_watch_cb_t cb;
+    void *ctx;
+} modbus_watch_t;
+
+// Índice de intervalos: ordenado pelo início, max_end[i] é o maior fim entre
+// os itens 0..i (não decrescente), então os watches que alcançam [a, b) são
+// os de max_end > a até o último com início < b, ambos por busca binária
+typedef struct {
+    modbus_watch_t items[MODBUS_TCP_WATCH_MAX];
+    uint32_t max_end[MODBUS_TCP_WATCH_MAX];
+    uint16_t count;
+} modbus_watch_index_t;
+
 // Estrutura interna da instância
 typedef struct {
     modbus_tcp_config_t config;
@@ -36,10 +62,22 @@ typedef struct {
     // Controle de acesso
     SemaphoreHandle_t mutex;
     TaskHandle_t operation_task;
+    void *mbc_handler;                  ///< Controlador TCP da instância, o RTU tem o seu
+    struct modbus_event_ctx *events;    ///< Estado da task de eventos, alocado no start
+    
+    // Watches de intervalos (holding, coils), protegidos por watch_mutex
+    modbus_watch_index_t watches[MB_WATCH_TYPES];
+    SemaphoreHandle_t watch_mutex;
     
     // Info de conexão
     uint8_t connection_count;
-    bool is_running;
+    // Lidos pela task de operação e escritos por quem chama start/stop
+    atomic_bool is_running;             ///< A task deve continuar
+    atomic_bool task_alive;             ///< A task ainda usa a instância, zerado por ela ao sair
+    
+    // Gateway (encaminhamento de outros unit IDs)
+    modbus_tcp_forward_cb_t forward_cb;
+    void *forward_ctx;
     
 } modbus_tcp_instance_t;
 
@@ -50,11 +88,13 @@ typedef struct {
 #define MB_REG_DISCRETE_INPUT_START         (0x0000)
 #define MB_REG_COILS_START                  (0x0000)
 #define MB_REG_INPUT_START_AREA0            (INPUT_OFFSET(input_data0))
-#define MB_REG_INPUT_START_AREA1            (INPUT_OFFSET(input_data4))
 #define MB_REG_HOLDING_START_AREA0          (HOLD_OFFSET(holding_data0))
-#define MB_REG_HOLDING_START_AREA1          (HOLD_OFFSET(holding_data4))
 
-#define MB_PAR_INFO_GET_TOUT                (10)
+// Task de eventos: espera bloqueada na fila de notificações e trata os eventos em lotes
+#define MB_EVENT_BATCH_MAX                  (16)    // Eventos retirados da fila por vez
+#define MB_EVENT_WAIT_MS                    (50)    // Espera máxima por evento (verifica is_running)
+#define MB_EVENT_VALUES_MAX                 (512)   // Palavras de old/new disponíveis por lote
+#define MB_EVENT_LOG_PERIOD_US              (10 * 1000 * 1000) // Resumo e erros no máximo 1x por período
 #define MB_CHAN_DATA_MAX_VAL                (10)
 #define MB_CHAN_DATA_OFFSET                 (1.1f)
 
@@ -66,6 +106,78 @@ typedef struct {
                                                 | MB_EVENT_COILS_WR)
 #define MB_READ_WRITE_MASK                  (MB_READ_MASK | MB_WRITE_MASK)
 
+// Tabela de endereços gerada de MODBUS_MAP_*_RANGES (modbus_map.h), indexada
+// pela página do endereço: cada acesso resolve o bloco com uma única leitura
+typedef struct {
+    uint16_t start;                  ///< Primeiro endereço do bloco
+    uint16_t size;                   ///< Quantidade de elementos (0 = página vazia)
+    mb_elem_type_t type;             ///< MB_ELEM_U16 ou MB_ELEM_FLOAT
+    void *data;                      ///< Memória do bloco
+    mb_seqlock_t *seqlock;           ///< Seqlock do bloco compartilhado com o stack (NULL = mutex)
+} modbus_map_range_t;
+
+// Quantidade de bits das áreas de coils e discrete inputs
+#define MB_COIL_COUNT                       (sizeof(coil_reg_params_t) << 3)
+#define MB_DISCRETE_COUNT                   (sizeof(modbus_discrete_regs_t) << 3)
+
+#define MODBUS_MAP_PAGES                    ((UINT16_MAX / MODBUS_MAP_PAGE_SIZE) + 1)
+
+#define MODBUS_MAP_ENTRY(start, size, data, type, seqlock) \
+    [(start) / MODBUS_MAP_PAGE_SIZE] = { (start), (size), (type), (void*)(data), (seqlock) },
+#define MODBUS_MAP_CHECK(start, size, data, type, seqlock) \
+    _Static_assert(((start) % MODBUS_MAP_PAGE_SIZE) + (size) * MODBUS_MAP_ELEM_REGS(type) <= MODBUS_MAP_PAGE_SIZE, \
+                   "Modbus map range crosses the page boundary");
+
+// Registros Modbus por elemento: o bloco float ocupa os registros [start, start + 2 * size)
+#define MODBUS_MAP_ELEM_REGS(type)          (((type) == MB_ELEM_FLOAT) ? 2 : 1)
+#define MODBUS_MAP_REGS(start, size, data, type, seqlock) + ((size) * MODBUS_MAP_ELEM_REGS(type))
+#define MODBUS_MAP_HOLDING_REGS             (0 MODBUS_MAP_HOLDING_RANGES(MODBUS_MAP_REGS))
+
+static const modbus_map_range_t holding_map[MODBUS_MAP_PAGES] = {
+    MODBUS_MAP_HOLDING_RANGES(MODBUS_MAP_ENTRY)
+};
+
+static const modbus_map_range_t input_map[MODBUS_MAP_PAGES] = {
+    MODBUS_MAP_INPUT_RANGES(MODBUS_MAP_ENTRY)
+};
+
+MODBUS_MAP_HOLDING_RANGES(MODBUS_MAP_CHECK)
+MODBUS_MAP_INPUT_RANGES(MODBUS_MAP_CHECK)
+
+// Cada bloco tem a sua página: com um bit por página nas palavras 0 e 1, a soma dos
+// bits só é igual ao OU se nenhuma página se repete (o inicializador designado
+// substituiria o bloco anterior da página sem erro)
+#define MODBUS_MAP_PAGE_BIT(start, word) \
+    (((((start) / MODBUS_MAP_PAGE_SIZE) >> 6) == (word)) ? (1ULL << (((start) / MODBUS_MAP_PAGE_SIZE) & 63)) : 0ULL)
+#define MODBUS_MAP_PAGE_SUM0(start, size, data, type, seqlock) + MODBUS_MAP_PAGE_BIT(start, 0)
+#define MODBUS_MAP_PAGE_OR0(start, size, data, type, seqlock) | MODBUS_MAP_PAGE_BIT(start, 0)
+#define MODBUS_MAP_PAGE_SUM1(start, size, data, type, seqlock) + MODBUS_MAP_PAGE_BIT(start, 1)
+#define MODBUS_MAP_PAGE_OR1(start, size, data, type, seqlock) | MODBUS_MAP_PAGE_BIT(start, 1)
+#define MODBUS_MAP_PAGES_UNIQUE(RANGES) \
+    (((0ULL RANGES(MODBUS_MAP_PAGE_SUM0)) == (0ULL RANGES(MODBUS_MAP_PAGE_OR0))) \
+     && ((0ULL RANGES(MODBUS_MAP_PAGE_SUM1)) == (0ULL RANGES(MODBUS_MAP_PAGE_OR1))))
+
+_Static_assert(MODBUS_MAP_PAGES <= 128, "Modbus map page size too small for the page check");
+_Static_assert(MODBUS_MAP_PAGES_UNIQUE(MODBUS_MAP_HOLDING_RANGES), "Two Modbus map holding ranges share a page");
+_Static_assert(MODBUS_MAP_PAGES_UNIQUE(MODBUS_MAP_INPUT_RANGES), "Two Modbus map input ranges share a page");
+
+// Estado da task de eventos: usado apenas pela task, exceto as estatísticas
+typedef struct modbus_event_ctx {
+    mb_param_info_t infos[MB_EVENT_BATCH_MAX];          ///< Notificações retiradas da fila
+    modbus_tcp_access_t accesses[MB_EVENT_BATCH_MAX];   ///< Acessos entregues aos callbacks
+    uint16_t values[MB_EVENT_VALUES_MAX];               ///< old/new dos acessos do lote
+    uint16_t used;                                      ///< Palavras de values em uso
+    uint16_t holding_shadow[MODBUS_MAP_HOLDING_REGS];   ///< Último conteúdo visto dos holdings
+    uint16_t holding_shadow_pos[MODBUS_MAP_PAGES];      ///< Posição de cada bloco em holding_shadow
+    uint8_t coil_shadow[sizeof(coil_reg_params_t)];     ///< Último conteúdo visto dos coils
+    uint16_t watch_old[(MB_COIL_COUNT + 15) >> 4];      ///< Bits old/new do trecho entregue a um watch
+    uint16_t watch_new[(MB_COIL_COUNT + 15) >> 4];
+    modbus_tcp_event_stats_t stats;
+    int64_t log_time;                                   ///< Início do período de log atual
+    uint32_t log_events;                                ///< Eventos no período de log
+    uint32_t log_errors;                                ///< Erros suprimidos no período de log
+} modbus_event_ctx_t;
+
 // Função para validar handle
 static bool is_valid_handle(modbus_tcp_handle_t handle) {
     return (handle != NULL);
@@ -79,6 +191,178 @@ static modbus_tcp_instance_t* get_instance(modbus_tcp_handle_t handle) {
     return (modbus_tcp_instance_t*)handle;
 }
 
+// Bloco que contém o endereço, NULL se o endereço não está mapeado
+static const modbus_map_range_t* map_lookup(const modbus_map_range_t *map, uint16_t addr) {
+    const modbus_map_range_t *range = &map[addr / MODBUS_MAP_PAGE_SIZE];
+    return ((uint16_t)(addr - range->start) < range->size) ? range : NULL;
+}
+
+// Bloco que contém o intervalo inteiro, NULL se alguma parte não está mapeada
+static const modbus_map_range_t* map_lookup_range(const modbus_map_range_t *map, uint16_t start,
+                                                  uint16_t count) {
+    const modbus_map_range_t *range = count ? map_lookup(map, start) : NULL;
+    if (!range || ((uint32_t)(start - range->start) + count > range->size)) {
+        return NULL;
+    }
+    return range;
+}
+
+// Copia os valores para o bloco convertendo para o tipo do bloco (índice do elemento)
+static void map_store(const modbus_map_range_t *range, uint16_t index, uint16_t count, const float *src) {
+    if (range->type == MB_ELEM_FLOAT) {
+        memcpy(&((float*)range->data)[index], src, count * sizeof(float));
+    } else {
+        uint16_t *dst = &((uint16_t*)range->data)[index];
+        for (uint16_t i = 0; i < count; i++) {
+            dst[i] = (uint16_t)src[i];
+        }
+    }
+}
+
+// Copia os valores do bloco convertendo do tipo do bloco (índice do elemento)
+static void map_load(const modbus_map_range_t *range, uint16_t index, uint16_t count, float *dst) {
+    if (range->type == MB_ELEM_FLOAT) {
+        memcpy(dst, &((const float*)range->data)[index], count * sizeof(float));
+    } else {
+        const uint16_t *src = &((const uint16_t*)range->data)[index];
+        for (uint16_t i = 0; i < count; i++) {
+            dst[i] = (float)src[i];
+        }
+    }
+}
+
+// Bloco que contém os registros [addr, addr + count), NULL se algum não está mapeado
+static const modbus_map_range_t* map_lookup_regs(const modbus_map_range_t *map, uint16_t addr,
+                                                 uint16_t count) {
+    const modbus_map_range_t *range = &map[addr / MODBUS_MAP_PAGE_SIZE];
+    uint32_t regs = (uint32_t)range->size * MODBUS_MAP_ELEM_REGS(range->type);
+    uint16_t index = addr - range->start;
+    return (count && (index < regs) && ((uint32_t)index + count <= regs)) ? range : NULL;
+}
+
+// Copia os registros do bloco; com seqlock a cópia é refeita se o stack escreveu durante a leitura
+static void map_snapshot_regs(const modbus_map_range_t *range, uint16_t index, uint16_t count,
+                              uint16_t *dst) {
+    const uint16_t *src = (const uint16_t*)range->data + index;
+    if (!range->seqlock) {
+        memcpy(dst, src, count * sizeof(uint16_t));
+        return;
+    }
+    uint32_t seq;
+    do {
+        seq = mb_seqlock_read_begin(range->seqlock);
+        memcpy(dst, src, count * sizeof(uint16_t));
+    } while (mb_seqlock_read_retry(range->seqlock, seq));
+}
+
+// Copia os registros [start, start + count) entre o bloco e o buffer do usuário, sem
+// conversão: nos blocos float são as palavras dos valores, como o master as vê
+static esp_err_t map_copy_regs(modbus_tcp_instance_t *instance, const modbus_map_range_t *map,
+                               uint16_t start, uint16_t count, uint16_t *regs, bool write) {
+    const modbus_map_range_t *range = map_lookup_regs(map, start, count);
+    if (!range) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t index = start - range->start;
+    uint16_t *area = (uint16_t*)range->data + index;
+    if (range->seqlock) {
+        if (!write) {
+            map_snapshot_regs(range, index, count, regs);
+            return ESP_OK;
+        }
+        mb_seqlock_write_begin(range->seqlock);
+        memmove(area, regs, count * sizeof(uint16_t));
+        mb_seqlock_write_end(range->seqlock);
+        return ESP_OK;
+    }
+
+    if (xSemaphoreTake(instance->mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    // memmove: a origem pode ser a própria memória do bloco
+    if (write) {
+        memmove(area, regs, count * sizeof(uint16_t));
+    } else {
+        memmove(regs, area, count * sizeof(uint16_t));
+    }
+    xSemaphoreGive(instance->mutex);
+    return ESP_OK;
+}
+
+// Escreve os valores com um único lock: o seqlock nos blocos compartilhados
+// com o stack, o mutex da instância nos demais
+static esp_err_t map_write_values(modbus_tcp_instance_t *instance, const modbus_map_range_t *map,
+                                  uint16_t start, uint16_t count, const float *src) {
+    const modbus_map_range_t *range = map_lookup_range(map, start, count);
+    if (!range) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t index = start - range->start;
+    if (range->seqlock) {
+        mb_seqlock_write_begin(range->seqlock);
+        map_store(range, index, count, src);
+        mb_seqlock_write_end(range->seqlock);
+        return ESP_OK;
+    }
+
+    if (xSemaphoreTake(instance->mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    map_store(range, index, count, src);
+    xSemaphoreGive(instance->mutex);
+    return ESP_OK;
+}
+
+// Lê os valores: nos blocos com seqlock a cópia é refeita se um escritor
+// alterou o bloco durante a leitura, sem bloquear
+static esp_err_t map_read_values(modbus_tcp_instance_t *instance, const modbus_map_range_t *map,
+                                 uint16_t start, uint16_t count, float *dst) {
+    const modbus_map_range_t *range = map_lookup_range(map, start, count);
+    if (!range) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t index = start - range->start;
+    if (range->seqlock) {
+        uint32_t seq;
+        do {
+            seq = mb_seqlock_read_begin(range->seqlock);
+            map_load(range, index, count, dst);
+        } while (mb_seqlock_read_retry(range->seqlock, seq));
+        return ESP_OK;
+    }
+
+    if (xSemaphoreTake(instance->mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    map_load(range, index, count, dst);
+    xSemaphoreGive(instance->mutex);
+    return ESP_OK;
+}
+
+// Copia o intervalo de bits entre a área e o bitmap do usuário (bit 0 = start)
+static esp_err_t bits_copy_range(modbus_tcp_instance_t *instance, uint8_t *area, uint16_t area_bits,
+                                 uint16_t start, uint16_t count, uint8_t *bits, bool write) {
+    if (!count || ((uint32_t)start + count > area_bits)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (xSemaphoreTake(instance->mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (write) {
+        vMBUtilCopyBits(area, start, bits, 0, count);
+    } else {
+        vMBUtilCopyBits(bits, 0, area, start, count);
+    }
+
+    xSemaphoreGive(instance->mutex);
+    return ESP_OK;
+}
+
 // Configuração inicial dos registros
 static void setup_reg_data(modbus_tcp_instance_t *instance) {
     // Discrete Inputs (mantidos locais - não há equivalentes globais definidos)
@@ -91,7 +375,9 @@ static void setup_reg_data(modbus_tcp_instance_t *instance) {
     instance->discrete_regs.discrete_input6 = 1;
     instance->discrete_regs.discrete_input7 = 0;
 
-    // Holding Registers base (0-7) - usar memória global compartilhada
+    // Holding Registers base (0-7) - usar memória global compartilhada,
+    // escrita sob o seqlock do banco (o slave RTU pode estar lendo)
+    mb_seqlock_write_begin(&holding_reg_params_lock);
     holding_reg_params.holding_data0 = 1.34f;
     holding_reg_params.holding_data1 = 2.56f;
     holding_reg_params.holding_data2 = 3.78f;
@@ -100,12 +386,14 @@ static void setup_reg_data(modbus_tcp_instance_t *instance) {
     holding_reg_params.holding_data5 = 6.78f;
     holding_reg_params.holding_data6 = 7.79f;
     holding_reg_params.holding_data7 = 8.80f;
+    mb_seqlock_write_end(&holding_reg_params_lock);
 
     // Coils - usar memória global compartilhada
     coil_reg_params.coils_port0 = 0x55;
     coil_reg_params.coils_port1 = 0xAA;
 
     // Input Registers base (0-7) - usar memória global compartilhada
+    mb_seqlock_write_begin(&input_reg_params_lock);
     input_reg_params.input_data0 = 1.12f;
     input_reg_params.input_data1 = 2.34f;
     input_reg_params.input_data2 = 3.56f;
@@ -114,77 +402,303 @@ static void setup_reg_data(modbus_tcp_instance_t *instance) {
     input_reg_params.input_data5 = 2.34f;
     input_reg_params.input_data6 = 3.56f;
     input_reg_params.input_data7 = 4.78f;
+    mb_seqlock_write_end(&input_reg_params_lock);
+}
+
+// ================================
+// TASK DE EVENTOS
+// ================================
+
+// Inicia as cópias de sombra (valores antigos) com o conteúdo atual
+static void events_reset(modbus_event_ctx_t *ctx) {
+    uint16_t pos = 0;
+    memset(ctx, 0, sizeof(*ctx));
+    for (size_t page = 0; page < MODBUS_MAP_PAGES; page++) {
+        const modbus_map_range_t *range = &holding_map[page];
+        uint16_t regs = range->size * MODBUS_MAP_ELEM_REGS(range->type);
+        ctx->holding_shadow_pos[page] = pos;
+        if (regs) {
+            map_snapshot_regs(range, 0, regs, &ctx->holding_shadow[pos]);
+            pos += regs;
+        }
+    }
+    memcpy(ctx->coil_shadow, &coil_reg_params, sizeof(ctx->coil_shadow));
+    ctx->log_time = esp_timer_get_time();
+}
+
+// Reserva palavras de old/new no lote atual
+static uint16_t* events_alloc(modbus_event_ctx_t *ctx, uint16_t words) {
+    uint16_t *values = &ctx->values[ctx->used];
+    ctx->used += words;
+    return values;
+}
+
+// Palavras de old/new necessárias para a notificação
+static uint16_t event_words(const mb_param_info_t *info) {
+    uint16_t words = (info->type & (MB_EVENT_COILS_RD | MB_EVENT_COILS_WR | MB_EVENT_DISCRETE_RD))
+                     ? (uint16_t)((info->size + 15) >> 4) : (uint16_t)info->size;
+    return (info->type & MB_WRITE_MASK) ? (words << 1) : words;
 }
 
-// Task de operação do Modbus (baseada no código original)
+// Monta o acesso com o conteúdo do intervalo; false se o intervalo não está mapeado
+static bool event_build_access(modbus_tcp_instance_t *instance, modbus_event_ctx_t *ctx,
+                               const mb_param_info_t *info, modbus_tcp_access_t *access) {
+    uint16_t addr = info->mb_offset;
+    uint16_t count = (uint16_t)info->size;
+    const modbus_map_range_t *range = NULL;
+    const uint8_t *bits_area = NULL;
+    uint16_t bits_total = 0;
+
+    access->write = (info->type & MB_WRITE_MASK) != 0;
+    access->addr = addr;
+    access->count = count;
+    access->hits = info->hits;
+
+    switch (info->type) {
+        case MB_EVENT_HOLDING_REG_RD:
+        case MB_EVENT_HOLDING_REG_WR:
+            access->reg_type = MODBUS_REG_HOLDING;
+            range = map_lookup_regs(holding_map, addr, count);
+            break;
+        case MB_EVENT_INPUT_REG_RD:
+            access->reg_type = MODBUS_REG_INPUT;
+            range = map_lookup_regs(input_map, addr, count);
+            break;
+        case MB_EVENT_COILS_RD:
+        case MB_EVENT_COILS_WR:
+            access->reg_type = MODBUS_REG_COIL;
+            bits_area = (const uint8_t*)&coil_reg_params;
+            bits_total = MB_COIL_COUNT;
+            break;
+        case MB_EVENT_DISCRETE_RD:
+            access->reg_type = MODBUS_REG_DISCRETE;
+            bits_area = (const uint8_t*)&instance->discrete_regs;
+            bits_total = MB_DISCRETE_COUNT;
+            break;
+        default:
+            return false;
+    }
+
+    if (range) {
+        uint16_t index = addr - range->start;
+        uint16_t *new_values = events_alloc(ctx, count);
+        map_snapshot_regs(range, index, count, new_values);
+        access->new_values = new_values;
+        access->old_values = new_values;
+        if (access->reg_type == MODBUS_REG_HOLDING) {
+            uint16_t *shadow = &ctx->holding_shadow[ctx->holding_shadow_pos[addr / MODBUS_MAP_PAGE_SIZE] + index];
+            if (access->write) {
+                uint16_t *old_values = events_alloc(ctx, count);
+                memcpy(old_values, shadow, count * sizeof(uint16_t));
+                access->old_values = old_values;
+            }
+            memcpy(shadow, new_values, count * sizeof(uint16_t));
+        }
+        return true;
+    }
+
+    if (!bits_area || !count || ((uint32_t)addr + count > bits_total)) {
+        return false;
+    }
+    uint16_t words = (count + 15) >> 4;
+    uint16_t *new_bits = events_alloc(ctx, words);
+    memset(new_bits, 0, words * sizeof(uint16_t));
+    vMBUtilCopyBits((UCHAR*)new_bits, 0, bits_area, addr, count);
+    access->new_values = new_bits;
+    access->old_values = new_bits;
+    if (access->reg_type == MODBUS_REG_COIL) {
+        if (access->write) {
+            uint16_t *old_bits = events_alloc(ctx, words);
+            memset(old_bits, 0, words * sizeof(uint16_t));
+            vMBUtilCopyBits((UCHAR*)old_bits, 0, ctx->coil_shadow, addr, count);
+            access->old_values = old_bits;
+        }
+        vMBUtilCopyBits(ctx->coil_shadow, addr, (const UCHAR*)new_bits, 0, count);
+    }
+    return true;
+}
+
+// Índice de watches do tipo, NULL se o tipo não é escrito pelo master
+static modbus_watch_index_t* watch_index(modbus_tcp_instance_t *instance, modbus_reg_type_t type) {
+    switch (type) {
+        case MODBUS_REG_HOLDING:
+            return &instance->watches[0];
+        case MODBUS_REG_COIL:
+            return &instance->watches[1];
+        default:
+            return NULL;
+    }
+}
+
+// Recalcula o maior fim acumulado depois de inserir ou remover watches
+static void watch_index_update(modbus_watch_index_t *index) {
+    uint32_t max_end = 0;
+    for (uint16_t i = 0; i < index->count; i++) {
+        if (index->items[i].end > max_end) {
+            max_end = index->items[i].end;
+        }
+        index->max_end[i] = max_end;
+    }
+}
+
+// Se quem chama é a task de operação, isto é, um dos callbacks: eles rodam com
+// watch_mutex, que não é recursivo, e stop esperaria pela própria task
+static bool on_operation_task(const modbus_tcp_instance_t *instance) {
+    return instance->operation_task && (xTaskGetCurrentTaskHandle() == instance->operation_task);
+}
+
+// Chama os watches que alcançam a escrita com o trecho escrito dentro de cada um
+static void watch_dispatch(modbus_event_ctx_t *ctx, const modbus_watch_index_t *index,
+                           const modbus_tcp_access_t *access) {
+    uint32_t a = access->addr;
+    uint32_t b = a + access->count;
+    uint16_t lo = 0, hi = index->count;
+
+    // Primeiro item com max_end > a
+    for (uint16_t n = hi; lo < n; ) {
+        uint16_t mid = (lo + n) >> 1;
+        if (index->max_end[mid] > a) {
+            n = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    // Primeiro item com início >= b
+    for (uint16_t n = lo; n < hi; ) {
+        uint16_t mid = (n + hi) >> 1;
+        if (index->items[mid].start < b) {
+            n = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (uint16_t i = lo; i < hi; i++) {
+        const modbus_watch_t *watch = &index->items[i];
+        if (watch->end <= a) {
+            continue;
+        }
+        uint16_t first = (watch->start > a) ? watch->start : (uint16_t)a;
+        uint16_t count = (uint16_t)(((watch->end < b) ? watch->end : b) - first);
+        uint16_t offset = first - (uint16_t)a;
+        if (access->reg_type == MODBUS_REG_COIL) {
+            memset(ctx->watch_old, 0, sizeof(ctx->watch_old));
+            memset(ctx->watch_new, 0, sizeof(ctx->watch_new));
+            vMBUtilCopyBits((UCHAR*)ctx->watch_old, 0, (const UCHAR*)access->old_values, offset, count);
+            vMBUtilCopyBits((UCHAR*)ctx->watch_new, 0, (const UCHAR*)access->new_values, offset, count);
+            watch->cb(watch->ctx, access->reg_type, first, count, ctx->watch_old, ctx->watch_new);
+        } else {
+            watch->cb(watch->ctx, access->reg_type, first, count,
+                      &access->old_values[offset], &access->new_values[offset]);
+        }
+    }
+}
+
+// Entrega os acessos do lote aos callbacks e libera os valores
+static void events_deliver(modbus_tcp_instance_t *instance, modbus_event_ctx_t *ctx, size_t count) {
+    const modbus_tcp_callbacks_t *cb = &instance->callbacks;
+    if (count && cb->on_access_batch) {
+        cb->on_access_batch(ctx->accesses, count);
+    }
+    // O mutex dos watches fica com a task durante os callbacks: depois de
+    // modbus_tcp_unwatch_range() retornar o callback não é mais chamado
+    if (count && (instance->watches[0].count || instance->watches[1].count)
+        && (xSemaphoreTake(instance->watch_mutex, portMAX_DELAY) == pdTRUE)) {
+        for (size_t i = 0; i < count; i++) {
+            const modbus_tcp_access_t *access = &ctx->accesses[i];
+            const modbus_watch_index_t *index = watch_index(instance, access->reg_type);
+            if (access->write && index && index->count) {
+                watch_dispatch(ctx, index, access);
+            }
+        }
+        xSemaphoreGive(instance->watch_mutex);
+    }
+    for (size_t i = 0; i < count; i++) {
+        const modbus_tcp_access_t *access = &ctx->accesses[i];
+        uint32_t value = ((access->reg_type == MODBUS_REG_COIL) || (access->reg_type == MODBUS_REG_DISCRETE))
+                         ? (access->new_values[0] & 1) : access->new_values[0];
+        ESP_LOGV(TAG, "%s type=%d addr=%u count=%u hits=%u", access->write ? "WRITE" : "READ",
+                 (int)access->reg_type, (unsigned)access->addr, (unsigned)access->count,
+                 (unsigned)access->hits);
+        if (access->write && cb->on_register_write) {
+            cb->on_register_write(access->addr, access->reg_type, value);
+        } else if (!access->write && cb->on_register_read) {
+            cb->on_register_read(access->addr, access->reg_type, value);
+        }
+    }
+    ctx->stats.events += count;
+    ctx->log_events += count;
+    ctx->used = 0;
+}
+
+// Trata um lote de notificações retirado da fila
+static void events_process(modbus_tcp_instance_t *instance, modbus_event_ctx_t *ctx, size_t count) {
+    int64_t start = esp_timer_get_time();
+    size_t built = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const mb_param_info_t *info = &ctx->infos[i];
+        if (ctx->used + event_words(info) > MB_EVENT_VALUES_MAX) {
+            events_deliver(instance, ctx, built);
+            built = 0;
+        }
+        ctx->stats.accesses += info->hits;
+        if (event_build_access(instance, ctx, info, &ctx->accesses[built])) {
+            built++;
+        }
+    }
+    events_deliver(instance, ctx, built);
+
+    ctx->stats.batches++;
+    if (count > ctx->stats.max_batch) {
+        ctx->stats.max_batch = count;
+    }
+    ctx->stats.busy_us += esp_timer_get_time() - start;
+}
+
+// Resumo periódico em vez de um log por acesso
+static void events_log(modbus_event_ctx_t *ctx) {
+    int64_t now = esp_timer_get_time();
+    if (now - ctx->log_time < MB_EVENT_LOG_PERIOD_US) {
+        return;
+    }
+    if (ctx->log_events) {
+        ESP_LOGI(TAG, "📊 %u eventos nos últimos %u s", (unsigned)ctx->log_events,
+                 (unsigned)(MB_EVENT_LOG_PERIOD_US / 1000000));
+    }
+    if (ctx->log_errors > 1) {
+        ESP_LOGW(TAG, "⚠️ %u erros de notificação suprimidos", (unsigned)(ctx->log_errors - 1));
+    }
+    ctx->log_time = now;
+    ctx->log_events = 0;
+    ctx->log_errors = 0;
+}
+
+// Task de operação: bloqueia na fila de notificações do controlador e trata os eventos em lotes
 void slave_operation_task(void *arg) {
     modbus_tcp_instance_t *instance = (modbus_tcp_instance_t*)arg;
-    mb_param_info_t reg_info;
+    modbus_event_ctx_t *ctx = instance->events;
 
     ESP_LOGI(TAG, "Modbus slave operation task started");
 
-    while (instance->is_running) {
-        // Check for read/write events
-        esp_err_t err = mbc_slave_check_event(MB_READ_WRITE_MASK);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "mbc_slave_check_event returned error: %s", esp_err_to_name(err));
-        } else {
-            err = mbc_slave_get_param_info(&reg_info, MB_PAR_INFO_GET_TOUT);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "mbc_slave_get_param_info failed: %s", esp_err_to_name(err));
-            } else {
-                const char* rw_str = (reg_info.type & MB_READ_MASK) ? "READ" : "WRITE";
-
-                // Log a decoded summary for easier debugging
-                ESP_LOGD(TAG, "mbc event: type=0x%04x offset=%u size=%u", (unsigned)reg_info.type,
-                         (unsigned)reg_info.mb_offset, (unsigned)reg_info.size);
-
-                // Process events and call callbacks (if registered) with extra debug
-                if (reg_info.type & (MB_EVENT_HOLDING_REG_WR | MB_EVENT_HOLDING_REG_RD)) {
-                    ESP_LOGI(TAG, "HOLDING %s addr=%u size=%u", rw_str, (unsigned)reg_info.mb_offset, (unsigned)reg_info.size);
-                    if (instance->callbacks.on_register_read && (reg_info.type & MB_READ_MASK)) {
-                        ESP_LOGD(TAG, "Invoking on_register_read for HOLDING @%u", (unsigned)reg_info.mb_offset);
-                        instance->callbacks.on_register_read(reg_info.mb_offset, MODBUS_REG_HOLDING, 0);
-                    }
-                    if (instance->callbacks.on_register_write && (reg_info.type & MB_WRITE_MASK)) {
-                        ESP_LOGD(TAG, "Invoking on_register_write for HOLDING @%u", (unsigned)reg_info.mb_offset);
-                        instance->callbacks.on_register_write(reg_info.mb_offset, MODBUS_REG_HOLDING, 0);
-                    }
-
-                } else if (reg_info.type & MB_EVENT_INPUT_REG_RD) {
-                    ESP_LOGI(TAG, "INPUT READ addr=%u size=%u", (unsigned)reg_info.mb_offset, (unsigned)reg_info.size);
-                    if (instance->callbacks.on_register_read) {
-                        ESP_LOGD(TAG, "Invoking on_register_read for INPUT @%u", (unsigned)reg_info.mb_offset);
-                        instance->callbacks.on_register_read(reg_info.mb_offset, MODBUS_REG_INPUT, 0);
-                    }
-
-                } else if (reg_info.type & MB_EVENT_DISCRETE_RD) {
-                    ESP_LOGI(TAG, "DISCRETE READ addr=%u size=%u", (unsigned)reg_info.mb_offset, (unsigned)reg_info.size);
-                    if (instance->callbacks.on_register_read) {
-                        ESP_LOGD(TAG, "Invoking on_register_read for DISCRETE @%u", (unsigned)reg_info.mb_offset);
-                        instance->callbacks.on_register_read(reg_info.mb_offset, MODBUS_REG_DISCRETE, 0);
-                    }
-
-                } else if (reg_info.type & (MB_EVENT_COILS_RD | MB_EVENT_COILS_WR)) {
-                    ESP_LOGI(TAG, "COILS %s addr=%u size=%u", rw_str, (unsigned)reg_info.mb_offset, (unsigned)reg_info.size);
-                    if (instance->callbacks.on_register_read && (reg_info.type & MB_READ_MASK)) {
-                        ESP_LOGD(TAG, "Invoking on_register_read for COIL @%u", (unsigned)reg_info.mb_offset);
-                        instance->callbacks.on_register_read(reg_info.mb_offset, MODBUS_REG_COIL, 0);
-                    }
-                    if (instance->callbacks.on_register_write && (reg_info.type & MB_WRITE_MASK)) {
-                        ESP_LOGD(TAG, "Invoking on_register_write for COIL @%u", (unsigned)reg_info.mb_offset);
-                        instance->callbacks.on_register_write(reg_info.mb_offset, MODBUS_REG_COIL, 0);
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Unhandled mbc event type: 0x%04x", (unsigned)reg_info.type);
-                }
+    while (atomic_load(&instance->is_running)) {
+        size_t count = 0;
+        esp_err_t err = mbc_slave_get_param_info_batch_hdl(instance->mbc_handler, ctx->infos, MB_EVENT_BATCH_MAX, &count, MB_EVENT_WAIT_MS);
+        if (err == ESP_OK) {
+            events_process(instance, ctx, count);
+        } else if (err != ESP_ERR_TIMEOUT) {
+            // Loga o primeiro erro do período, os demais entram no resumo
+            if (!ctx->log_errors++) {
+                ESP_LOGE(TAG, "mbc_slave_get_param_info_batch failed: %s", esp_err_to_name(err));
             }
+            vTaskDelay(pdMS_TO_TICKS(MB_EVENT_WAIT_MS));
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(10)); // Small delay
+        events_log(ctx);
     }
 
     ESP_LOGI(TAG, "Modbus slave operation task ended");
+    // Último acesso à instância: depois disso stop/destroy podem liberá-la
+    atomic_store(&instance->task_alive, false);
     vTaskDelete(NULL);
 }
 
@@ -229,6 +743,12 @@ esp_err_t modbus_tcp_slave_init(const modbus_tcp_config_t *config, modbus_tcp_ha
         free(instance);
         return ESP_ERR_NO_MEM;
     }
+    instance->watch_mutex = xSemaphoreCreateMutex();
+    if (!instance->watch_mutex) {
+        vSemaphoreDelete(instance->mutex);
+        free(instance);
+        return ESP_ERR_NO_MEM;
+    }
 
     // Estado inicial
     instance->state = MODBUS_TCP_STATE_STOPPED;
@@ -272,8 +792,8 @@ esp_err_t modbus_tcp_slave_start(modbus_tcp_handle_t handle) {
     // Inicializar controlador Modbus TCP (usa o port handler do componente TCP)
     // Chama mbc_slave_init_tcp para registrar a interface interna do slave
     ESP_LOGI(TAG, "Initializing Modbus TCP slave controller interface...");
-    void *port_handler = NULL;
-    err = mbc_slave_init_tcp(&port_handler);
+    instance->mbc_handler = NULL;
+    err = mbc_slave_init_tcp(&instance->mbc_handler);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "mbc_slave_init_tcp failed: %s", esp_err_to_name(err));
         instance->state = MODBUS_TCP_STATE_ERROR;
@@ -288,16 +808,17 @@ esp_err_t modbus_tcp_slave_start(modbus_tcp_handle_t handle) {
     comm_info.ip_netif_ptr = (void*)instance->config.netif;
     comm_info.slave_uid = instance->config.slave_id;
     comm_info.ip_port = instance->config.port;
+    comm_info.ip_max_conn = instance->config.max_connections; // slots pré-alocados pela porta
     
 #if !CONFIG_EXAMPLE_CONNECT_IPV6
     comm_info.ip_addr_type = MB_IPV4;
 #else
     comm_info.ip_addr_type = MB_IPV6;
 #endif
-    comm_info.ip_mode = MB_MODE_TCP;
+    comm_info.ip_mode = (instance->config.transport == MODBUS_TCP_TRANSPORT_UDP) ? MB_MODE_UDP : MB_MODE_TCP;
 
     // Setup e start
-    err = mbc_slave_setup((void*)&comm_info);
+    err = mbc_slave_setup_hdl(instance->mbc_handler, (void*)&comm_info);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to setup Modbus slave: %s", esp_err_to_name(err));
         instance->state = MODBUS_TCP_STATE_ERROR;
@@ -306,66 +827,56 @@ esp_err_t modbus_tcp_slave_start(modbus_tcp_handle_t handle) {
     }
 
     // Configurar áreas de registros
-    mb_register_area_descriptor_t reg_area;
+    mb_register_area_descriptor_t reg_area = {0};
 
-    // Holding Registers - Area 0 (usar memória global do RTU)
+    // As áreas 0/1 guardam floats nativos, convertidos no acesso. A ordem CDAB
+    // mantém o formato já usado pelos clientes (registro menos significativo primeiro)
+    reg_area.elem_type = MB_ELEM_FLOAT;
+    reg_area.word_order = MB_WORD_ORDER_CDAB;
+
+    // O stack lê e escreve os floats com o seqlock do banco, os acessores da
+    // biblioteca leem sem bloquear e nunca veem um valor pela metade
+    reg_area.seqlock = &holding_reg_params_lock;
+
+    // Holding Registers 0-7 (usar memória global do RTU): uma única área, assim
+    // uma leitura dos 8 floats é feita numa só passagem do seqlock
     reg_area.type = MB_PARAM_HOLDING;
     reg_area.start_offset = MB_REG_HOLDING_START_AREA0;
     reg_area.address = (void*)&holding_reg_params.holding_data0;
-    reg_area.size = (MB_REG_HOLDING_START_AREA1 - MB_REG_HOLDING_START_AREA0) << 1;
-    err = mbc_slave_set_descriptor(reg_area);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers area 0: %s", esp_err_to_name(err));
-        instance->state = MODBUS_TCP_STATE_ERROR;
-        xSemaphoreGive(instance->mutex);
-        return err;
-    }
-
-    // Holding Registers - Area 1 (usar memória global do RTU)
-    reg_area.type = MB_PARAM_HOLDING;
-    reg_area.start_offset = MB_REG_HOLDING_START_AREA1;
-    reg_area.address = (void*)&holding_reg_params.holding_data4;
-    reg_area.size = sizeof(float) << 2;
-    err = mbc_slave_set_descriptor(reg_area);
+    reg_area.size = sizeof(holding_reg_params_t);
+    err = mbc_slave_set_descriptor_hdl(instance->mbc_handler, reg_area);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers area 1: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to set holding registers area: %s", esp_err_to_name(err));
         instance->state = MODBUS_TCP_STATE_ERROR;
         xSemaphoreGive(instance->mutex);
         return err;
     }
 
-    // Input Registers - Area 0 (usar memória global do RTU)
+    // Input Registers 0-7 (usar memória global do RTU)
     reg_area.type = MB_PARAM_INPUT;
+    reg_area.seqlock = &input_reg_params_lock;
     reg_area.start_offset = MB_REG_INPUT_START_AREA0;
     reg_area.address = (void*)&input_reg_params.input_data0;
-    reg_area.size = sizeof(float) << 2;
-    err = mbc_slave_set_descriptor(reg_area);
+    reg_area.size = sizeof(input_reg_params_t);
+    err = mbc_slave_set_descriptor_hdl(instance->mbc_handler, reg_area);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set input registers area 0: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to set input registers area: %s", esp_err_to_name(err));
         instance->state = MODBUS_TCP_STATE_ERROR;
         xSemaphoreGive(instance->mutex);
         return err;
     }
 
-    // Input Registers - Area 1 (usar memória global do RTU)
-    reg_area.type = MB_PARAM_INPUT;
-    reg_area.start_offset = MB_REG_INPUT_START_AREA1;
-    reg_area.address = (void*)&input_reg_params.input_data4;
-    reg_area.size = sizeof(float) << 2;
-    err = mbc_slave_set_descriptor(reg_area);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set input registers area 1: %s", esp_err_to_name(err));
-        instance->state = MODBUS_TCP_STATE_ERROR;
-        xSemaphoreGive(instance->mutex);
-        return err;
-    }
+    // Demais áreas são registradores/bits sem tipo
+    reg_area.elem_type = MB_ELEM_U16;
+    reg_area.word_order = MB_WORD_ORDER_ABCD;
+    reg_area.seqlock = NULL;
 
     // Coils (usar memória global do RTU)
     reg_area.type = MB_PARAM_COIL;
     reg_area.start_offset = MB_REG_COILS_START;
     reg_area.address = (void*)&coil_reg_params;
     reg_area.size = sizeof(coil_reg_params_t);
-    err = mbc_slave_set_descriptor(reg_area);
+    err = mbc_slave_set_descriptor_hdl(instance->mbc_handler, reg_area);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set coils: %s", esp_err_to_name(err));
         instance->state = MODBUS_TCP_STATE_ERROR;
@@ -378,7 +889,7 @@ esp_err_t modbus_tcp_slave_start(modbus_tcp_handle_t handle) {
     reg_area.start_offset = MB_REG_DISCRETE_INPUT_START;
     reg_area.address = (void*)&instance->discrete_regs;
     reg_area.size = sizeof(modbus_discrete_regs_t);
-    err = mbc_slave_set_descriptor(reg_area);
+    err = mbc_slave_set_descriptor_hdl(instance->mbc_handler, reg_area);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set discrete inputs: %s", esp_err_to_name(err));
         instance->state = MODBUS_TCP_STATE_ERROR;
@@ -386,135 +897,51 @@ esp_err_t modbus_tcp_slave_start(modbus_tcp_handle_t handle) {
         return err;
     }
 
-    // Registrar áreas adicionais de Holding Registers
-    // REG 1000 - Configuração (3 registros) -> usa memória global compartilhada
-    reg_area.type = MB_PARAM_HOLDING;
-    reg_area.start_offset = REG_CONFIG_START;
-    reg_area.address = (void*)holding_reg1000_params.reg1000;
-    reg_area.size = REG_CONFIG_SIZE * sizeof(uint16_t);
-    err = mbc_slave_set_descriptor(reg_area);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers 1000: %s", esp_err_to_name(err));
-        instance->state = MODBUS_TCP_STATE_ERROR;
-        xSemaphoreGive(instance->mutex);
-        return err;
-    }
-
-    // REG 2000 - Data (1 registro) -> global reg2000
-    reg_area.type = MB_PARAM_HOLDING;
-    reg_area.start_offset = REG_DATA_START;
-    reg_area.address = (void*)reg2000;
-    reg_area.size = REG_DATA_SIZE * sizeof(uint16_t);
-    err = mbc_slave_set_descriptor(reg_area);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers 2000: %s", esp_err_to_name(err));
-        instance->state = MODBUS_TCP_STATE_ERROR;
-        xSemaphoreGive(instance->mutex);
-        return err;
-    }
-
-    // REG 3000 -> global reg3000
-    reg_area.type = MB_PARAM_HOLDING;
-    reg_area.start_offset = REG_3000_START;
-    reg_area.address = (void*)reg3000;
-    reg_area.size = REG_3000_SIZE * sizeof(uint16_t);
-    err = mbc_slave_set_descriptor(reg_area);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers 3000: %s", esp_err_to_name(err));
-        instance->state = MODBUS_TCP_STATE_ERROR;
-        xSemaphoreGive(instance->mutex);
-        return err;
-    }
-
-    // REG 4000 -> global reg4000
-    reg_area.type = MB_PARAM_HOLDING;
-    reg_area.start_offset = REG_4000_START;
-    reg_area.address = (void*)reg4000;
-    reg_area.size = REG_4000_SIZE * sizeof(uint16_t);
-    err = mbc_slave_set_descriptor(reg_area);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers 4000: %s", esp_err_to_name(err));
-        instance->state = MODBUS_TCP_STATE_ERROR;
-        xSemaphoreGive(instance->mutex);
-        return err;
-    }
-
-    // REG 5000 -> global reg5000
-    reg_area.type = MB_PARAM_HOLDING;
-    reg_area.start_offset = REG_5000_START;
-    reg_area.address = (void*)reg5000;
-    reg_area.size = REG_5000_SIZE * sizeof(uint16_t);
-    err = mbc_slave_set_descriptor(reg_area);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers 5000: %s", esp_err_to_name(err));
-        instance->state = MODBUS_TCP_STATE_ERROR;
-        xSemaphoreGive(instance->mutex);
-        return err;
-    }
-
-    // REG 6000 -> global reg6000
+    // Registrar os blocos uint16 da tabela de endereços (os floats já estão nas áreas 0/1)
     reg_area.type = MB_PARAM_HOLDING;
-    reg_area.start_offset = REG_6000_START;
-    reg_area.address = (void*)reg6000;
-    reg_area.size = REG_6000_SIZE * sizeof(uint16_t);
-    err = mbc_slave_set_descriptor(reg_area);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers 6000: %s", esp_err_to_name(err));
-        instance->state = MODBUS_TCP_STATE_ERROR;
-        xSemaphoreGive(instance->mutex);
-        return err;
-    }
-
-    // REG 7000 -> global reg7000
-    reg_area.type = MB_PARAM_HOLDING;
-    reg_area.start_offset = REG_7000_START;
-    reg_area.address = (void*)reg7000;
-    reg_area.size = REG_7000_SIZE * sizeof(uint16_t);
-    err = mbc_slave_set_descriptor(reg_area);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers 7000: %s", esp_err_to_name(err));
-        instance->state = MODBUS_TCP_STATE_ERROR;
-        xSemaphoreGive(instance->mutex);
-        return err;
+    for (size_t page = 0; page < MODBUS_MAP_PAGES; page++) {
+        const modbus_map_range_t *range = &holding_map[page];
+        if (!range->size || range->type != MB_ELEM_U16) {
+            continue;
+        }
+        reg_area.start_offset = range->start;
+        reg_area.address = range->data;
+        reg_area.size = range->size * sizeof(uint16_t);
+        err = mbc_slave_set_descriptor_hdl(instance->mbc_handler, reg_area);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to set holding registers %u: %s", (unsigned)range->start, esp_err_to_name(err));
+            instance->state = MODBUS_TCP_STATE_ERROR;
+            xSemaphoreGive(instance->mutex);
+            return err;
+        }
     }
 
-    // REG 8000 -> global reg8000
-    reg_area.type = MB_PARAM_HOLDING;
-    reg_area.start_offset = REG_8000_START;
-    reg_area.address = (void*)reg8000;
-    reg_area.size = REG_8000_SIZE * sizeof(uint16_t);
-    err = mbc_slave_set_descriptor(reg_area);
+    // Start Modbus slave
+    err = mbc_slave_start_hdl(instance->mbc_handler);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers 8000: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to start Modbus slave: %s", esp_err_to_name(err));
         instance->state = MODBUS_TCP_STATE_ERROR;
         xSemaphoreGive(instance->mutex);
         return err;
     }
 
-    // REG 9000 - Unit Specs -> global reg9000
-    reg_area.type = MB_PARAM_HOLDING;
-    reg_area.start_offset = REG_UNITSPECS_START;
-    reg_area.address = (void*)reg9000;
-    reg_area.size = REG_UNITSPECS_SIZE * sizeof(uint16_t);
-    err = mbc_slave_set_descriptor(reg_area);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set holding registers 9000: %s", esp_err_to_name(err));
-        instance->state = MODBUS_TCP_STATE_ERROR;
-        xSemaphoreGive(instance->mutex);
-        return err;
+    // Estado da task de eventos, com as cópias de sombra iniciadas com o conteúdo atual
+    if (!instance->events) {
+        instance->events = malloc(sizeof(modbus_event_ctx_t));
     }
-
-    // Start Modbus slave
-    err = mbc_slave_start();
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start Modbus slave: %s", esp_err_to_name(err));
+    if (!instance->events) {
+        ESP_LOGE(TAG, "Failed to allocate event context");
+        mbc_slave_destroy_hdl(instance->mbc_handler);
+        instance->mbc_handler = NULL;
         instance->state = MODBUS_TCP_STATE_ERROR;
         xSemaphoreGive(instance->mutex);
-        return err;
+        return ESP_ERR_NO_MEM;
     }
+    events_reset(instance->events);
 
     // Criar task de operação
-    instance->is_running = true;
+    atomic_store(&instance->is_running, true);
+    atomic_store(&instance->task_alive, true);
     BaseType_t task_created = xTaskCreate(slave_operation_task, 
                                          "modbus_tcp_operation", 
                                          4096, 
@@ -523,8 +950,11 @@ esp_err_t modbus_tcp_slave_start(modbus_tcp_handle_t handle) {
                                          &instance->operation_task);
     if (task_created != pdTRUE) {
         ESP_LOGE(TAG, "Failed to create operation task");
-        instance->is_running = false;
-        mbc_slave_destroy();
+        atomic_store(&instance->is_running, false);
+        atomic_store(&instance->task_alive, false);
+        instance->operation_task = NULL;
+        mbc_slave_destroy_hdl(instance->mbc_handler);
+        instance->mbc_handler = NULL;
         instance->state = MODBUS_TCP_STATE_ERROR;
         xSemaphoreGive(instance->mutex);
         return ESP_ERR_NO_MEM;
@@ -534,7 +964,8 @@ esp_err_t modbus_tcp_slave_start(modbus_tcp_handle_t handle) {
     
     xSemaphoreGive(instance->mutex);
 
-    ESP_LOGI(TAG, "Modbus TCP Slave started successfully on port %d", instance->config.port);
+    ESP_LOGI(TAG, "Modbus TCP Slave started successfully on port %d (%s)", instance->config.port,
+             (instance->config.transport == MODBUS_TCP_TRANSPORT_UDP) ? "UDP" : "TCP");
 
     return ESP_OK;
 }
@@ -544,6 +975,10 @@ esp_err_t modbus_tcp_slave_stop(modbus_tcp_handle_t handle) {
     if (!instance) {
         return ESP_ERR_INVALID_ARG;
     }
+    // A task de operação não pode esperar por ela mesma
+    if (on_operation_task(instance)) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
     if (xSemaphoreTake(instance->mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
         return ESP_ERR_TIMEOUT;
@@ -556,19 +991,25 @@ esp_err_t modbus_tcp_slave_stop(modbus_tcp_handle_t handle) {
 
     instance->state = MODBUS_TCP_STATE_STOPPING;
 
-    // Parar task de operação
-    instance->is_running = false;
-    if (instance->operation_task) {
-        // Aguardar task terminar
-        vTaskDelay(pdMS_TO_TICKS(100));
-        instance->operation_task = NULL;
+    // Requisições encaminhadas depois daqui não teriam para onde voltar
+    vMBTCPPortSlaveSetForward(0, NULL, NULL);
+    instance->forward_cb = NULL;
+    instance->forward_ctx = NULL;
+
+    // Parar task de operação: ela sai em até MB_EVENT_WAIT_MS depois do callback
+    // em andamento, que ainda usa a instância e o controlador
+    atomic_store(&instance->is_running, false);
+    while (atomic_load(&instance->task_alive)) {
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
+    instance->operation_task = NULL;
 
     // Destruir controlador Modbus
-    esp_err_t err = mbc_slave_destroy();
+    esp_err_t err = mbc_slave_destroy_hdl(instance->mbc_handler);
     if (err != ESP_OK) {
         ESP_LOGW(TAG, "Warning during Modbus destroy: %s", esp_err_to_name(err));
     }
+    instance->mbc_handler = NULL;
 
     instance->state = MODBUS_TCP_STATE_STOPPED;
     
@@ -587,13 +1028,25 @@ esp_err_t modbus_tcp_slave_destroy(modbus_tcp_handle_t handle) {
 
     // Parar se estiver rodando
     if (instance->state == MODBUS_TCP_STATE_RUNNING) {
-        modbus_tcp_slave_stop(handle);
+        esp_err_t err = modbus_tcp_slave_stop(handle);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    // Um stop em andamento em outra task ainda espera pela task de operação
+    if (atomic_load(&instance->task_alive)) {
+        return ESP_ERR_INVALID_STATE;
     }
 
     // Destruir mutex
     if (instance->mutex) {
         vSemaphoreDelete(instance->mutex);
     }
+    if (instance->watch_mutex) {
+        vSemaphoreDelete(instance->watch_mutex);
+    }
+
+    free(instance->events);
 
     // Liberar memória
     free(instance);
@@ -621,48 +1074,8 @@ esp_err_t modbus_tcp_set_holding_reg_float(modbus_tcp_handle_t handle, uint16_t
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Endereços básicos (0-7) armazenados como float - usar memória global compartilhada
-    if (addr <= 7) {
-        if (xSemaphoreTake(instance->mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-            return ESP_ERR_TIMEOUT;
-        }
-        float *reg_ptr = (float*)&holding_reg_params;
-        reg_ptr[addr] = value;
-        xSemaphoreGive(instance->mutex);
-        return ESP_OK;
-    }
-
-    // Endereços estendidos - escrever diretamente nos arrays globais (uint16_t)
-    uint16_t as_u16 = (uint16_t)value;
-    if (addr >= REG_CONFIG_START && addr < REG_CONFIG_START + REG_CONFIG_SIZE) {
-        holding_reg1000_params.reg1000[addr - REG_CONFIG_START] = as_u16;
-        return ESP_OK;
-    } else if (addr >= REG_DATA_START && addr < REG_DATA_START + REG_DATA_SIZE) {
-        reg2000[addr - REG_DATA_START] = as_u16;
-        return ESP_OK;
-    } else if (addr >= REG_3000_START && addr < REG_3000_START + REG_3000_SIZE) {
-        reg3000[addr - REG_3000_START] = as_u16;
-        return ESP_OK;
-    } else if (addr >= REG_4000_START && addr < REG_4000_START + REG_4000_SIZE) {
-        reg4000[addr - REG_4000_START] = as_u16;
-        return ESP_OK;
-    } else if (addr >= REG_5000_START && addr < REG_5000_START + REG_5000_SIZE) {
-        reg5000[addr - REG_5000_START] = as_u16;
-        return ESP_OK;
-    } else if (addr >= REG_6000_START && addr < REG_6000_START + REG_6000_SIZE) {
-        reg6000[addr - REG_6000_START] = as_u16;
-        return ESP_OK;
-    } else if (addr >= REG_7000_START && addr < REG_7000_START + REG_7000_SIZE) {
-        reg7000[addr - REG_7000_START] = as_u16;
-        return ESP_OK;
-    } else if (addr >= REG_8000_START && addr < REG_8000_START + REG_8000_SIZE) {
-        reg8000[addr - REG_8000_START] = as_u16;
-        return ESP_OK;
-    } else if (addr >= REG_UNITSPECS_START && addr < REG_UNITSPECS_START + REG_UNITSPECS_SIZE) {
-        reg9000[addr - REG_UNITSPECS_START] = as_u16;
-        return ESP_OK;
-    }
-    return ESP_ERR_INVALID_ARG;
+    // Floats (0-7) e blocos uint16 estendidos resolvidos pela tabela de endereços
+    return map_write_values(instance, holding_map, addr, 1, &value);
 }
 
 esp_err_t modbus_tcp_get_holding_reg_float(modbus_tcp_handle_t handle, uint16_t addr, float *value) {
@@ -671,79 +1084,25 @@ esp_err_t modbus_tcp_get_holding_reg_float(modbus_tcp_handle_t handle, uint16_t
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (addr <= 7) {
-        if (xSemaphoreTake(instance->mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-            return ESP_ERR_TIMEOUT;
-        }
-        float *reg_ptr = (float*)&holding_reg_params;
-        *value = reg_ptr[addr];
-        xSemaphoreGive(instance->mutex);
-        return ESP_OK;
-    }
-
-    if (addr >= REG_CONFIG_START && addr < REG_CONFIG_START + REG_CONFIG_SIZE) {
-        *value = (float)holding_reg1000_params.reg1000[addr - REG_CONFIG_START];
-        return ESP_OK;
-    } else if (addr >= REG_DATA_START && addr < REG_DATA_START + REG_DATA_SIZE) {
-        *value = (float)reg2000[addr - REG_DATA_START];
-        return ESP_OK;
-    } else if (addr >= REG_3000_START && addr < REG_3000_START + REG_3000_SIZE) {
-        *value = (float)reg3000[addr - REG_3000_START];
-        return ESP_OK;
-    } else if (addr >= REG_4000_START && addr < REG_4000_START + REG_4000_SIZE) {
-        *value = (float)reg4000[addr - REG_4000_START];
-        return ESP_OK;
-    } else if (addr >= REG_5000_START && addr < REG_5000_START + REG_5000_SIZE) {
-        *value = (float)reg5000[addr - REG_5000_START];
-        return ESP_OK;
-    } else if (addr >= REG_6000_START && addr < REG_6000_START + REG_6000_SIZE) {
-        *value = (float)reg6000[addr - REG_6000_START];
-        return ESP_OK;
-    } else if (addr >= REG_7000_START && addr < REG_7000_START + REG_7000_SIZE) {
-        *value = (float)reg7000[addr - REG_7000_START];
-        return ESP_OK;
-    } else if (addr >= REG_8000_START && addr < REG_8000_START + REG_8000_SIZE) {
-        *value = (float)reg8000[addr - REG_8000_START];
-        return ESP_OK;
-    } else if (addr >= REG_UNITSPECS_START && addr < REG_UNITSPECS_START + REG_UNITSPECS_SIZE) {
-        *value = (float)reg9000[addr - REG_UNITSPECS_START];
-        return ESP_OK;
-    }
-    return ESP_ERR_INVALID_ARG;
+    return map_read_values(instance, holding_map, addr, 1, value);
 }
 
 esp_err_t modbus_tcp_set_input_reg_float(modbus_tcp_handle_t handle, uint16_t addr, float value) {
     modbus_tcp_instance_t *instance = get_instance(handle);
-    if (!instance || addr > 7) {
+    if (!instance) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (xSemaphoreTake(instance->mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
-    }
-
-    float *reg_ptr = (float*)&input_reg_params;
-    reg_ptr[addr] = value;
-
-    xSemaphoreGive(instance->mutex);
-    return ESP_OK;
+    return map_write_values(instance, input_map, addr, 1, &value);
 }
 
 esp_err_t modbus_tcp_get_input_reg_float(modbus_tcp_handle_t handle, uint16_t addr, float *value) {
     modbus_tcp_instance_t *instance = get_instance(handle);
-    if (!instance || !value || addr > 7) {
+    if (!instance || !value) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (xSemaphoreTake(instance->mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
-    }
-
-    float *reg_ptr = (float*)&input_reg_params;
-    *value = reg_ptr[addr];
-
-    xSemaphoreGive(instance->mutex);
-    return ESP_OK;
+    return map_read_values(instance, input_map, addr, 1, value);
 }
 
 esp_err_t modbus_tcp_set_coil(modbus_tcp_handle_t handle, uint16_t addr, bool value) {
@@ -828,6 +1187,86 @@ esp_err_t modbus_tcp_get_discrete_input(modbus_tcp_handle_t handle, uint16_t add
     return ESP_OK;
 }
 
+// ================================
+// FUNÇÕES DE ACESSO EM BLOCO
+// ================================
+
+esp_err_t modbus_tcp_write_holding_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                         const uint16_t *src) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !src) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return map_copy_regs(instance, holding_map, start, count, (uint16_t*)src, true);
+}
+
+esp_err_t modbus_tcp_read_holding_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                        uint16_t *dst) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !dst) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return map_copy_regs(instance, holding_map, start, count, dst, false);
+}
+
+esp_err_t modbus_tcp_write_input_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                       const uint16_t *src) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !src) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return map_copy_regs(instance, input_map, start, count, (uint16_t*)src, true);
+}
+
+esp_err_t modbus_tcp_read_input_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                      uint16_t *dst) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !dst) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return map_copy_regs(instance, input_map, start, count, dst, false);
+}
+
+esp_err_t modbus_tcp_write_coil_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                      const uint8_t *bits) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !bits) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return bits_copy_range(instance, (uint8_t*)&coil_reg_params, MB_COIL_COUNT,
+                           start, count, (uint8_t*)bits, true);
+}
+
+esp_err_t modbus_tcp_read_coil_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                     uint8_t *bits) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !bits) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return bits_copy_range(instance, (uint8_t*)&coil_reg_params, MB_COIL_COUNT,
+                           start, count, bits, false);
+}
+
+esp_err_t modbus_tcp_write_discrete_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                          const uint8_t *bits) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !bits) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return bits_copy_range(instance, (uint8_t*)&instance->discrete_regs, MB_DISCRETE_COUNT,
+                           start, count, (uint8_t*)bits, true);
+}
+
+esp_err_t modbus_tcp_read_discrete_range(modbus_tcp_handle_t handle, uint16_t start, uint16_t count,
+                                         uint8_t *bits) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !bits) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return bits_copy_range(instance, (uint8_t*)&instance->discrete_regs, MB_DISCRETE_COUNT,
+                           start, count, bits, false);
+}
+
 esp_err_t modbus_tcp_register_callbacks(modbus_tcp_handle_t handle, const modbus_tcp_callbacks_t *callbacks) {
     modbus_tcp_instance_t *instance = get_instance(handle);
     if (!instance || !callbacks) {
@@ -846,6 +1285,74 @@ esp_err_t modbus_tcp_register_callbacks(modbus_tcp_handle_t handle, const modbus
     return ESP_OK;
 }
 
+esp_err_t modbus_tcp_watch_range(modbus_tcp_handle_t handle, modbus_reg_type_t type, uint16_t start,
+                                 uint16_t count, modbus_tcp_watch_cb_t cb, void *ctx) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    modbus_watch_index_t *index = instance ? watch_index(instance, type) : NULL;
+    if (!index || !cb || !count || ((uint32_t)start + count > UINT16_MAX + 1)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (on_operation_task(instance)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xSemaphoreTake(instance->watch_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (index->count >= MODBUS_TCP_WATCH_MAX) {
+        xSemaphoreGive(instance->watch_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Inserção ordenada pelo início
+    uint16_t pos = index->count;
+    while (pos && (index->items[pos - 1].start > start)) {
+        index->items[pos] = index->items[pos - 1];
+        pos--;
+    }
+    index->items[pos] = (modbus_watch_t){ .start = start, .end = (uint32_t)start + count, .cb = cb, .ctx = ctx };
+    index->count++;
+    watch_index_update(index);
+
+    xSemaphoreGive(instance->watch_mutex);
+
+    ESP_LOGD(TAG, "Watch %u..%u registered (type %d)", (unsigned)start, (unsigned)(start + count - 1), (int)type);
+    return ESP_OK;
+}
+
+esp_err_t modbus_tcp_unwatch_range(modbus_tcp_handle_t handle, modbus_tcp_watch_cb_t cb, void *ctx) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (on_operation_task(instance)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xSemaphoreTake(instance->watch_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    uint16_t removed = 0;
+    for (size_t t = 0; t < MB_WATCH_TYPES; t++) {
+        modbus_watch_index_t *index = &instance->watches[t];
+        uint16_t kept = 0;
+        for (uint16_t i = 0; i < index->count; i++) {
+            if ((index->items[i].cb == cb) && (index->items[i].ctx == ctx)) {
+                removed++;
+            } else {
+                index->items[kept++] = index->items[i];
+            }
+        }
+        index->count = kept;
+        watch_index_update(index);
+    }
+
+    xSemaphoreGive(instance->watch_mutex);
+    return removed ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
 esp_err_t modbus_tcp_get_registers_ptr(modbus_tcp_handle_t handle,
                                        modbus_holding_regs_t **holding,
                                        modbus_input_regs_t **input,
@@ -876,6 +1383,106 @@ esp_err_t modbus_tcp_get_connection_info(modbus_tcp_handle_t handle, uint8_t *co
     return ESP_OK;
 }
 
+esp_err_t modbus_tcp_get_pool_stats(modbus_tcp_handle_t handle, modbus_tcp_pool_stats_t *stats) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (instance->state != MODBUS_TCP_STATE_RUNNING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    MbClientPoolStats_t pool_stats;
+    if (!xMBTCPPortSlaveGetPoolStats(&pool_stats)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    stats->slots = pool_stats.usSize;
+    stats->in_use = pool_stats.usInUse;
+    stats->high_water = pool_stats.usHighWater;
+    stats->exhausted = pool_stats.ulExhausted;
+    stats->evicted_lru = pool_stats.ulDropped[MB_TCP_DROP_LRU];
+    stats->dropped_idle = pool_stats.ulDropped[MB_TCP_DROP_IDLE];
+    stats->closed_by_peer = pool_stats.ulDropped[MB_TCP_DROP_PEER_CLOSED];
+    stats->dropped_keepalive = pool_stats.ulDropped[MB_TCP_DROP_KEEPALIVE];
+    stats->dropped_bad_frame = pool_stats.ulDropped[MB_TCP_DROP_BAD_FRAME];
+    stats->dropped_error = pool_stats.ulDropped[MB_TCP_DROP_ERROR];
+
+    return ESP_OK;
+}
+
+esp_err_t modbus_tcp_get_event_stats(modbus_tcp_handle_t handle, modbus_tcp_event_stats_t *stats) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if ((instance->state != MODBUS_TCP_STATE_RUNNING) || !instance->events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    mb_param_notify_stats_t notify_stats;
+    if (mbc_slave_get_notify_stats_hdl(instance->mbc_handler, &notify_stats) != ESP_OK) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Contadores escritos apenas pela task de eventos
+    *stats = instance->events->stats;
+    stats->dropped = notify_stats.overflows;
+
+    return ESP_OK;
+}
+
+// ================================
+// GATEWAY
+// ================================
+
+// Adapta o callback da porta para o callback da aplicação
+static BOOL forward_port_cb(void *arg, MbForwardTicket_t port_ticket, UCHAR unit_id,
+                            const UCHAR *pdu, USHORT pdu_len) {
+    modbus_tcp_instance_t *instance = (modbus_tcp_instance_t*)arg;
+    modbus_tcp_forward_ticket_t ticket = { .client = port_ticket.usClient, .tid = port_ticket.usTid };
+    return instance->forward_cb(instance->forward_ctx, ticket, unit_id, pdu, pdu_len) ? TRUE : FALSE;
+}
+
+esp_err_t modbus_tcp_set_forward(modbus_tcp_handle_t handle, modbus_tcp_forward_cb_t cb, void *ctx) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (instance->state != MODBUS_TCP_STATE_RUNNING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Desliga o encaminhamento antes de trocar o callback usado pela porta
+    vMBTCPPortSlaveSetForward(0, NULL, NULL);
+    instance->forward_cb = cb;
+    instance->forward_ctx = ctx;
+    if (cb) {
+        vMBTCPPortSlaveSetForward(instance->config.slave_id, forward_port_cb, instance);
+        ESP_LOGI(TAG, "Gateway enabled, unit IDs other than %d are forwarded", instance->config.slave_id);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t modbus_tcp_forward_response(modbus_tcp_handle_t handle, modbus_tcp_forward_ticket_t ticket,
+                                      const uint8_t *pdu, uint16_t pdu_len) {
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    if (!instance || !pdu || !pdu_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    MbForwardTicket_t port_ticket = { .usClient = ticket.client, .usTid = ticket.tid };
+    if (!xMBTCPPortSlaveForwardResponse(port_ticket, pdu, pdu_len)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    return ESP_OK;
+}
+
 // ================================
 // FUNÇÕES DE COMPATIBILIDADE RTU (uint16_t)
 // ================================
@@ -0,0 +1,555 @@
+/**
+ * @file modbus_gateway.c
+ * @brief Implementação do gateway Modbus TCP → RTU
+ *
+ * O callback de encaminhamento roda na task TCP com o lock da porta, então
+ * apenas copia o PDU para a fila. A task do gateway converte o PDU em uma
+ * requisição do master serial, aguarda a resposta do barramento e monta o
+ * PDU de resposta (ou de exceção) devolvido ao cliente TCP.
+ *
+ * CÓDIGOS DE FUNÇÃO ENCAMINHADOS:
+ * ------------------------------
+ * - 0x01/0x02 Leitura de coils/discrete inputs
+ * - 0x03/0x04 Leitura de holding/input registers
+ * - 0x05/0x06 Escrita simples
+ * - 0x0F/0x10 Escrita múltipla
+ * Os demais códigos são respondidos com a exceção 0x01.
+ *
+ * PRAZO DE RESPOSTA:
+ * -----------------
+ * Cada requisição tem o prazo MB_TCP_RESP_TIMEOUT_MS a partir da chegada.
+ * O timeout de resposta do master serial é limitado ao tempo restante e a
+ * requisição que vence na fila é respondida com 0x0B sem ir ao barramento,
+ * então um dispositivo lento não segura as requisições dos outros clientes.
+ *
+ * @author Sistema ESP32
+ * @date 2025
+ */
+
+#include "modbus_gateway.h"
+#include "esp_modbus_master.h"
+#include "port.h"                // MB_TCP_PORT_MAX_CONN
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+/* ============================================================================
+ * CONSTANTES E DEFINIÇÕES INTERNAS
+ * ============================================================================ */
+
+static const char *TAG = "MODBUS_GATEWAY";
+
+// Códigos de função encaminhados
+#define GW_FC_READ_COILS            0x01
+#define GW_FC_READ_DISCRETE         0x02
+#define GW_FC_READ_HOLDING          0x03
+#define GW_FC_READ_INPUT            0x04
+#define GW_FC_WRITE_COIL            0x05
+#define GW_FC_WRITE_REGISTER        0x06
+#define GW_FC_WRITE_COILS           0x0F
+#define GW_FC_WRITE_REGISTERS       0x10
+
+// Códigos de exceção
+#define GW_EX_ILLEGAL_FUNCTION      0x01
+#define GW_EX_ILLEGAL_VALUE         0x03
+#define GW_EX_DEVICE_FAILURE        0x04
+#define GW_EX_DEVICE_BUSY           0x06
+#define GW_EX_PATH_UNAVAILABLE      0x0A
+#define GW_EX_TARGET_NO_RESPONSE    0x0B
+
+// Limites de quantidade da especificação Modbus
+#define GW_MAX_READ_BITS            2000
+#define GW_MAX_READ_REGS            125
+#define GW_MAX_WRITE_BITS           1968
+#define GW_MAX_WRITE_REGS           123
+
+#define GW_QUEUE_WAIT_MS            100    // Período de verificação do pedido de parada
+#define GW_STOP_TIMEOUT_MS          5000   // Espera pelo fim da transação em curso (> timeout do master)
+
+/* ============================================================================
+ * ESTRUTURAS INTERNAS
+ * ============================================================================ */
+
+/**
+ * @brief Requisição copiada do cliente TCP
+ */
+typedef struct {
+    modbus_tcp_forward_ticket_t ticket;      // Identificação para a resposta
+    int64_t deadline_us;                     // Prazo da resposta ao cliente TCP
+    uint8_t unit_id;                         // Endereço do dispositivo RTU
+    uint16_t pdu_len;                        // Tamanho do PDU
+    uint8_t pdu[MODBUS_GATEWAY_PDU_MAX];     // Código de função e dados
+} gateway_request_t;
+
+typedef struct {
+    modbus_tcp_handle_t tcp_handle;          // Servidor TCP de origem
+    void *master_handler;                    // Handler do master serial
+    QueueHandle_t queue;                     // Fila FIFO de requisições
+    TaskHandle_t task_handle;                // Task do barramento
+    SemaphoreHandle_t task_done;             // Sinaliza o fim da task
+    volatile bool is_running;                // Aceitando requisições
+    uint8_t queue_depth;                     // Tamanho da fila
+
+    // Requisições recusadas com a fila cheia, respondidas com 0x06 pela task.
+    // Cada cliente tem no máximo uma requisição encaminhada: um lugar por cliente.
+    portMUX_TYPE busy_lock;
+    bool busy_pending[MB_TCP_PORT_MAX_CONN];
+    modbus_tcp_forward_ticket_t busy_ticket[MB_TCP_PORT_MAX_CONN];
+    uint8_t busy_function[MB_TCP_PORT_MAX_CONN];
+
+    // Buffers da task (evita uso de pilha)
+    gateway_request_t request;
+    uint8_t response[MODBUS_GATEWAY_PDU_MAX];
+    uint16_t data[GW_MAX_READ_REGS];
+
+    // Estatísticas
+    portMUX_TYPE stats_lock;
+    modbus_gateway_stats_t stats;
+} modbus_gateway_instance_t;
+
+static modbus_gateway_instance_t g_gateway = {
+    .busy_lock = portMUX_INITIALIZER_UNLOCKED,
+    .stats_lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+/* ============================================================================
+ * FUNÇÕES INTERNAS - UTILITÁRIAS
+ * ============================================================================ */
+
+#define GW_STATS_INC(field) do {                        \
+    portENTER_CRITICAL(&g_gateway.stats_lock);          \
+    g_gateway.stats.field++;                            \
+    portEXIT_CRITICAL(&g_gateway.stats_lock);           \
+} while (0)
+
+static inline uint16_t get_be16(const uint8_t *buf) {
+    return (uint16_t)((buf[0] << 8) | buf[1]);
+}
+
+static inline void put_be16(uint8_t *buf, uint16_t value) {
+    buf[0] = (uint8_t)(value >> 8);
+    buf[1] = (uint8_t)(value & 0xFF);
+}
+
+/**
+ * @brief Monta o PDU de exceção
+ */
+static uint16_t build_exception(uint8_t function, uint8_t exception, uint8_t *rsp) {
+    rsp[0] = function | 0x80;
+    rsp[1] = exception;
+    GW_STATS_INC(exceptions);
+    return 2;
+}
+
+/**
+ * @brief Converte o erro do master serial no código de exceção Modbus
+ */
+static uint8_t master_error_to_exception(esp_err_t err) {
+    switch (err) {
+        case ESP_ERR_TIMEOUT:
+            GW_STATS_INC(timeouts);
+            return GW_EX_TARGET_NO_RESPONSE;
+        case ESP_ERR_INVALID_RESPONSE: {
+            // O dispositivo respondeu com exceção ou com um frame inválido
+            mb_trans_info_t info = {0};
+            if ((mbc_master_get_transaction_info(&info) == ESP_OK) && info.exception) {
+                return info.exception;
+            }
+            return GW_EX_TARGET_NO_RESPONSE;
+        }
+        case ESP_ERR_NOT_SUPPORTED:
+            return GW_EX_DEVICE_FAILURE;
+        default:
+            return GW_EX_PATH_UNAVAILABLE;
+    }
+}
+
+/* ============================================================================
+ * FUNÇÕES INTERNAS - EXECUÇÃO NO BARRAMENTO
+ * ============================================================================ */
+
+/**
+ * @brief Executa a requisição no barramento RTU e monta o PDU de resposta
+ *
+ * @return Tamanho do PDU de resposta
+ */
+static uint16_t gateway_execute(const gateway_request_t *req, uint8_t *rsp) {
+    const uint8_t *pdu = req->pdu;
+    uint8_t function = pdu[0];
+    uint16_t start = (req->pdu_len >= 3) ? get_be16(&pdu[1]) : 0;
+    uint16_t count = (req->pdu_len >= 5) ? get_be16(&pdu[3]) : 0;
+    mb_param_request_t mb_req = {
+        .slave_addr = req->unit_id,
+        .command = function,
+        .reg_start = start,
+        .reg_size = count,
+    };
+    uint16_t *data = g_gateway.data;
+    uint16_t rsp_len = 0;
+    esp_err_t err;
+
+    // O cliente não espera mais pela resposta: não ocupa o barramento
+    int64_t remaining_ms = (req->deadline_us - esp_timer_get_time()) / 1000;
+    if (remaining_ms <= 0) {
+        GW_STATS_INC(expired);
+        return build_exception(function, GW_EX_TARGET_NO_RESPONSE, rsp);
+    }
+    // A resposta do dispositivo deve chegar dentro do prazo restante
+    mbc_master_set_response_timeout((uint32_t)remaining_ms);
+
+    switch (function) {
+        case GW_FC_READ_COILS:
+        case GW_FC_READ_DISCRETE: {
+            if ((req->pdu_len != 5) || (count < 1) || (count > GW_MAX_READ_BITS)) {
+                return build_exception(function, GW_EX_ILLEGAL_VALUE, rsp);
+            }
+            uint8_t byte_count = (uint8_t)((count + 7) / 8);
+            // Os bits chegam compactados a partir do bit 0, como no PDU
+            memset(&rsp[2], 0, byte_count);
+            err = mbc_master_send_request(&mb_req, &rsp[2]);
+            if (err == ESP_OK) {
+                rsp[0] = function;
+                rsp[1] = byte_count;
+                rsp_len = 2 + byte_count;
+            }
+            break;
+        }
+        case GW_FC_READ_HOLDING:
+        case GW_FC_READ_INPUT:
+            if ((req->pdu_len != 5) || (count < 1) || (count > GW_MAX_READ_REGS)) {
+                return build_exception(function, GW_EX_ILLEGAL_VALUE, rsp);
+            }
+            // O master entrega os registradores na ordem nativa
+            err = mbc_master_send_request(&mb_req, data);
+            if (err == ESP_OK) {
+                rsp[0] = function;
+                rsp[1] = (uint8_t)(count * 2);
+                for (int i = 0; i < count; i++) {
+                    put_be16(&rsp[2 + i * 2], data[i]);
+                }
+                rsp_len = 2 + count * 2;
+            }
+            break;
+        case GW_FC_WRITE_COIL:
+        case GW_FC_WRITE_REGISTER:
+            if ((req->pdu_len != 5)
+                    || ((function == GW_FC_WRITE_COIL) && (count != 0xFF00) && (count != 0x0000))) {
+                return build_exception(function, GW_EX_ILLEGAL_VALUE, rsp);
+            }
+            // O valor vai no campo de quantidade, a resposta é o eco da requisição
+            data[0] = count;
+            mb_req.reg_size = 1;
+            err = mbc_master_send_request(&mb_req, data);
+            if (err == ESP_OK) {
+                memcpy(rsp, pdu, 5);
+                rsp_len = 5;
+            }
+            break;
+        case GW_FC_WRITE_COILS:
+        case GW_FC_WRITE_REGISTERS: {
+            bool is_coils = (function == GW_FC_WRITE_COILS);
+            uint16_t max_count = is_coils ? GW_MAX_WRITE_BITS : GW_MAX_WRITE_REGS;
+            uint16_t byte_count = is_coils ? ((count + 7) / 8) : (count * 2);
+            if ((req->pdu_len < 6) || (count < 1) || (count > max_count)
+                    || (pdu[5] != byte_count) || (req->pdu_len != 6 + byte_count)) {
+                return build_exception(function, GW_EX_ILLEGAL_VALUE, rsp);
+            }
+            if (is_coils) {
+                // Bits compactados seguem direto do PDU
+                memcpy(data, &pdu[6], byte_count);
+            } else {
+                for (int i = 0; i < count; i++) {
+                    data[i] = get_be16(&pdu[6 + i * 2]);
+                }
+            }
+            err = mbc_master_send_request(&mb_req, data);
+            if (err == ESP_OK) {
+                rsp[0] = function;
+                put_be16(&rsp[1], start);
+                put_be16(&rsp[3], count);
+                rsp_len = 5;
+            }
+            break;
+        }
+        default:
+            return build_exception(function, GW_EX_ILLEGAL_FUNCTION, rsp);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGD(TAG, "UID %u FC 0x%02X falhou: %s", req->unit_id, function, esp_err_to_name(err));
+        return build_exception(function, master_error_to_exception(err), rsp);
+    }
+    GW_STATS_INC(completed);
+    return rsp_len;
+}
+
+/**
+ * @brief Devolve a resposta ao cliente TCP
+ */
+static void gateway_reply(const gateway_request_t *req, const uint8_t *rsp, uint16_t rsp_len) {
+    if (modbus_tcp_forward_response(g_gateway.tcp_handle, req->ticket, rsp, rsp_len) != ESP_OK) {
+        GW_STATS_INC(dropped);
+        ESP_LOGD(TAG, "Resposta TID=0x%04X descartada", req->ticket.tid);
+    }
+}
+
+/**
+ * @brief Responde com exceção 0x06 as requisições recusadas com a fila cheia
+ */
+static void gateway_reply_busy(void) {
+    for (int i = 0; i < MB_TCP_PORT_MAX_CONN; i++) {
+        gateway_request_t busy = {0};
+        bool pending = false;
+        portENTER_CRITICAL(&g_gateway.busy_lock);
+        if (g_gateway.busy_pending[i]) {
+            busy.ticket = g_gateway.busy_ticket[i];
+            busy.pdu[0] = g_gateway.busy_function[i];
+            g_gateway.busy_pending[i] = false;
+            pending = true;
+        }
+        portEXIT_CRITICAL(&g_gateway.busy_lock);
+        if (pending) {
+            uint8_t rsp[2];
+            gateway_reply(&busy, rsp, build_exception(busy.pdu[0], GW_EX_DEVICE_BUSY, rsp));
+        }
+    }
+}
+
+/**
+ * @brief Task do barramento RTU
+ *
+ * Envia as requisições da fila uma após a outra, sem pausa entre elas.
+ * As recusas por fila cheia são respondidas antes de cada requisição.
+ */
+static void gateway_task(void *arg) {
+    gateway_request_t *req = &g_gateway.request;
+    uint8_t *rsp = g_gateway.response;
+
+    ESP_LOGI(TAG, "🔀 Task do gateway iniciada");
+    while (g_gateway.is_running) {
+        gateway_reply_busy();
+        if (xQueueReceive(g_gateway.queue, req, pdMS_TO_TICKS(GW_QUEUE_WAIT_MS)) != pdTRUE) {
+            continue;
+        }
+        uint16_t rsp_len = gateway_execute(req, rsp);
+        gateway_reply(req, rsp, rsp_len);
+    }
+
+    // Os clientes aguardam a resposta das requisições ainda na fila
+    while (xQueueReceive(g_gateway.queue, req, 0) == pdTRUE) {
+        uint16_t rsp_len = build_exception(req->pdu[0], GW_EX_PATH_UNAVAILABLE, rsp);
+        gateway_reply(req, rsp, rsp_len);
+    }
+    gateway_reply_busy();
+    mbc_master_set_response_timeout(0);
+
+    ESP_LOGI(TAG, "🔀 Task do gateway finalizada");
+    xSemaphoreGive(g_gateway.task_done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Callback de encaminhamento chamado pela porta TCP
+ *
+ * Roda com o lock da porta: apenas copia a requisição para a fila. A requisição
+ * é sempre aceita, porque o slave local responderia a outro unit ID com os
+ * próprios registradores.
+ */
+static bool gateway_forward_cb(void *ctx, modbus_tcp_forward_ticket_t ticket, uint8_t unit_id,
+                               const uint8_t *pdu, uint16_t pdu_len) {
+    (void)ctx;
+    gateway_request_t req = {
+        .ticket = ticket,
+        .deadline_us = esp_timer_get_time() + (MB_TCP_RESP_TIMEOUT_MS * 1000LL),
+        .unit_id = unit_id,
+        .pdu_len = (pdu_len < MODBUS_GATEWAY_PDU_MAX) ? pdu_len : MODBUS_GATEWAY_PDU_MAX,
+    };
+    memcpy(req.pdu, pdu, req.pdu_len);
+
+    if (xQueueSend(g_gateway.queue, &req, 0) != pdTRUE) {
+        // Sem espaço: a task responde com exceção 0x06 pelo ticket
+        // (o slot do cliente é sempre menor que MB_TCP_PORT_MAX_CONN)
+        if (ticket.client < MB_TCP_PORT_MAX_CONN) {
+            portENTER_CRITICAL(&g_gateway.busy_lock);
+            g_gateway.busy_ticket[ticket.client] = ticket;
+            g_gateway.busy_function[ticket.client] = pdu[0];
+            g_gateway.busy_pending[ticket.client] = true;
+            portEXIT_CRITICAL(&g_gateway.busy_lock);
+        }
+        GW_STATS_INC(rejected);
+        return true;
+    }
+
+    uint8_t used = (uint8_t)(g_gateway.queue_depth - uxQueueSpacesAvailable(g_gateway.queue));
+    portENTER_CRITICAL(&g_gateway.stats_lock);
+    g_gateway.stats.forwarded++;
+    if (used > g_gateway.stats.queue_high_water) {
+        g_gateway.stats.queue_high_water = used;
+    }
+    portEXIT_CRITICAL(&g_gateway.stats_lock);
+    return true;
+}
+
+/* ============================================================================
+ * FUNÇÕES INTERNAS - MASTER SERIAL
+ * ============================================================================ */
+
+/**
+ * @brief Instala o master serial na UART do barramento
+ */
+static esp_err_t start_master(const modbus_gateway_config_t *config) {
+    // O slave RTU instala o driver da mesma UART
+    if (uart_is_driver_installed(config->uart_port)) {
+        ESP_LOGE(TAG, "❌ UART%d em uso, pare o slave RTU antes do gateway", config->uart_port);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = mbc_master_init(MB_PORT_SERIAL_MASTER, &g_gateway.master_handler);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Falha ao inicializar master RTU: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    mb_communication_info_t comm_info = {
+        .mode = MB_MODE_RTU,
+        .port = config->uart_port,
+        .baudrate = config->baudrate,
+        .parity = config->parity,
+    };
+    ret = mbc_master_setup(&comm_info);
+    if (ret == ESP_OK) {
+        ret = uart_set_pin(config->uart_port, CONFIG_MB_UART_TXD, CONFIG_MB_UART_RXD,
+                           CONFIG_MB_UART_RTS, UART_PIN_NO_CHANGE);
+    }
+    if (ret == ESP_OK) {
+        ret = mbc_master_start();
+    }
+    if (ret == ESP_OK) {
+        ret = uart_set_mode(config->uart_port, UART_MODE_RS485_HALF_DUPLEX);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Falha ao iniciar master RTU: %s", esp_err_to_name(ret));
+        mbc_master_destroy();
+        g_gateway.master_handler = NULL;
+    }
+    return ret;
+}
+
+/**
+ * @brief Libera recursos alocados pelo start
+ */
+static void release_resources(void) {
+    if (g_gateway.master_handler != NULL) {
+        mbc_master_destroy();
+        g_gateway.master_handler = NULL;
+    }
+    if (g_gateway.queue != NULL) {
+        vQueueDelete(g_gateway.queue);
+        g_gateway.queue = NULL;
+    }
+    if (g_gateway.task_done != NULL) {
+        vSemaphoreDelete(g_gateway.task_done);
+        g_gateway.task_done = NULL;
+    }
+    g_gateway.tcp_handle = NULL;
+}
+
+/* ============================================================================
+ * API PÚBLICA
+ * ============================================================================ */
+
+esp_err_t modbus_gateway_start(modbus_tcp_handle_t tcp_handle, const modbus_gateway_config_t *config) {
+    if (tcp_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (g_gateway.is_running || g_gateway.task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    modbus_gateway_config_t gw_config = MODBUS_GATEWAY_DEFAULT_CONFIG();
+    if (config != NULL) {
+        gw_config = *config;
+    }
+    if (gw_config.queue_depth == 0) {
+        // Uma requisição encaminhada por cliente: a fila nunca enche
+        gw_config.queue_depth = MB_TCP_PORT_MAX_CONN;
+    }
+
+    ESP_LOGI(TAG, "🚀 Iniciando gateway TCP → RTU (UART%d, %lu bps, fila %u)",
+             gw_config.uart_port, (unsigned long)gw_config.baudrate, gw_config.queue_depth);
+
+    esp_err_t ret = start_master(&gw_config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    g_gateway.tcp_handle = tcp_handle;
+    g_gateway.queue_depth = gw_config.queue_depth;
+    g_gateway.queue = xQueueCreate(gw_config.queue_depth, sizeof(gateway_request_t));
+    g_gateway.task_done = xSemaphoreCreateBinary();
+    if ((g_gateway.queue == NULL) || (g_gateway.task_done == NULL)) {
+        release_resources();
+        return ESP_ERR_NO_MEM;
+    }
+
+    g_gateway.is_running = true;
+    if (xTaskCreate(gateway_task, "Modbus Gateway", MODBUS_GATEWAY_TASK_STACK_SIZE, NULL,
+                    MODBUS_GATEWAY_TASK_PRIORITY, &g_gateway.task_handle) != pdTRUE) {
+        g_gateway.is_running = false;
+        g_gateway.task_handle = NULL;
+        release_resources();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ret = modbus_tcp_set_forward(tcp_handle, gateway_forward_cb, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Falha ao registrar encaminhamento: %s", esp_err_to_name(ret));
+        modbus_gateway_stop();
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "✅ Gateway ativo");
+    return ESP_OK;
+}
+
+esp_err_t modbus_gateway_stop(void) {
+    if (g_gateway.task_handle == NULL) {
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "🛑 Parando gateway...");
+
+    // Após o retorno a porta TCP não chama mais o callback
+    modbus_tcp_set_forward(g_gateway.tcp_handle, NULL, NULL);
+
+    g_gateway.is_running = false;
+    if (xSemaphoreTake(g_gateway.task_done, pdMS_TO_TICKS(GW_STOP_TIMEOUT_MS)) != pdTRUE) {
+        // A task ainda usa o master e a fila, os recursos não podem ser liberados
+        ESP_LOGE(TAG, "❌ Task do gateway não finalizou");
+        return ESP_ERR_TIMEOUT;
+    }
+    g_gateway.task_handle = NULL;
+    release_resources();
+
+    ESP_LOGI(TAG, "✅ Gateway parado");
+    return ESP_OK;
+}
+
+bool modbus_gateway_is_running(void) {
+    return g_gateway.is_running;
+}
+
+esp_err_t modbus_gateway_get_stats(modbus_gateway_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&g_gateway.stats_lock);
+    *stats = g_gateway.stats;
+    portEXIT_CRITICAL(&g_gateway.stats_lock);
+    return ESP_OK;
+}
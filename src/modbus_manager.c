@@ -2,19 +2,19 @@
  * @file modbus_manager.c
  * @brief Implementação do sistema de gerenciamento e alternância Modbus RTU/TCP
  * 
- * Este módulo implementa a lógica de alternância dinâmica entre Modbus RTU e TCP,
- * mantendo sincronização de registradores e fornecendo uma interface unificada.
+ * Este módulo controla os transportes Modbus RTU e TCP, que atendem ao mesmo
+ * tempo sobre a mesma memória de registradores, com uma interface unificada.
  * 
  * FUNCIONAMENTO:
  * -------------
  * 1. Task principal monitora configuração de modo
- * 2. Detecta mudanças e executa transições
- * 3. Mantém registradores sincronizados entre implementações
- * 4. Fornece fallback automático RTU quando WiFi falha
+ * 2. Detecta mudanças e liga/desliga só o transporte que mudou
+ * 3. O slave RTU continua atendendo enquanto o TCP sobe ou cai
+ * 4. Para o TCP quando o WiFi falha e o reinicia quando ele volta
  * 
  * MÁQUINA DE ESTADOS:
  * ------------------
- * IDLE → RTU/TCP → SWITCHING → RTU/TCP → IDLE
+ * IDLE → RTU/TCP/RTU+TCP → SWITCHING → RTU/TCP/RTU+TCP → IDLE
  *   ↓                                      ↑
  * ERROR ←────────────────────────────────────
  * 
@@ -26,9 +26,10 @@
 #include "modbus_params.h"       // Registradores compartilhados
 #include "modbus_config.h"       // Configurações Modbus
 #include "modbus_slave_task.h"   // Task RTU original
-#include "modbus_register_sync.h" // Funções de sincronização
+#include "modbus_gateway.h"      // Gateway TCP → RTU
 #include "wifi_manager.h"        // Status WiFi
 #include "config_manager.h"      // Leitura/escrita config.json
+#include "mbstats.h"             // Histogramas de latência do stack
 
 #include "esp_log.h"
 #include "esp_netif.h"
@@ -44,7 +45,7 @@ static const char *TAG = "MODBUS_MANAGER";
 
 // Estados de log para debug
 static const char* STATE_NAMES[] = {
-    "INITIALIZING", "IDLE", "RUNNING_RTU", "RUNNING_TCP", "SWITCHING", "ERROR"
+    "INITIALIZING", "IDLE", "RUNNING_RTU", "RUNNING_TCP", "SWITCHING", "ERROR", "RUNNING_RTU_TCP"
 };
 
 static const char* MODE_NAMES[] = {
@@ -68,14 +69,15 @@ typedef struct {
     // Handles das implementações
     TaskHandle_t rtu_task_handle;        // Handle da task RTU
     TaskHandle_t tcp_task_handle;        // Handle da task TCP (se usar)
-    void* rtu_handler;                   // Handler ESP-IDF RTU
+    void* rtu_handler;                   // Controlador serial, publicado pela task RTU
     modbus_tcp_handle_t tcp_handle;      // Handle biblioteca TCP
     
     // Controle de estado
     bool is_initialized;                 // Se foi inicializado
     bool is_running;                     // Se algum protocolo está ativo
+    bool gateway_enabled;                // Se o gateway deve rodar junto com o TCP
+    volatile bool config_save_pending;   // Escrita do master TCP nos blocos 1000/6000 a gravar
     uint32_t uptime_start_ms;           // Timestamp da última alternância
-    uint32_t last_sync_ms;              // Timestamp da última sincronização
     uint32_t last_wifi_check_ms;        // Timestamp da última verificação WiFi
     
     // Estatísticas e debug
@@ -166,15 +168,28 @@ static esp_err_t stop_rtu_implementation(void) {
         ESP_LOGI(TAG, "✅ Task RTU finalizada");
     }
     
-    // Finaliza handler Modbus RTU se ativo
+    // Destrói o controlador serial, libera a UART e deixa o TCP intacto
+    esp_err_t ret = ESP_OK;
     if (g_manager.rtu_handler != NULL) {
-        // NOTA: ESP-IDF pode não ter função específica de cleanup
-        // Dependendo da implementação, pode ser necessário chamadas específicas
+        ret = mbc_slave_destroy_hdl(g_manager.rtu_handler);
         g_manager.rtu_handler = NULL;
-        ESP_LOGI(TAG, "✅ Handler RTU limpo");
+        ESP_LOGI(TAG, "✅ Controlador RTU destruído: %s", esp_err_to_name(ret));
     }
     
-    return ESP_OK;
+    return ret;
+}
+
+/**
+ * @brief Watch dos blocos gravados no config.json (1000 e 6000)
+ *
+ * Roda na task de eventos da biblioteca: só marca a gravação, que é feita
+ * no loop do manager como a task RTU faz nas escritas do master serial.
+ */
+static void on_persisted_regs_write(void *ctx, modbus_reg_type_t reg_type, uint16_t addr, uint16_t count,
+                                    const uint16_t *old_values, const uint16_t *new_values) {
+    if (memcmp(old_values, new_values, count * sizeof(uint16_t)) != 0) {
+        g_manager.config_save_pending = true;
+    }
 }
 
 /**
@@ -183,8 +198,12 @@ static esp_err_t stop_rtu_implementation(void) {
 static esp_err_t stop_tcp_implementation(void) {
     ESP_LOGI(TAG, "🛑 Parando implementação TCP...");
     
+    // O gateway responde pelo servidor TCP, para antes dele
+    modbus_gateway_stop();
+    
     // Para biblioteca TCP customizada
     if (g_manager.tcp_handle != NULL) {
+        modbus_tcp_unwatch_range(g_manager.tcp_handle, on_persisted_regs_write, NULL);
         esp_err_t ret = modbus_tcp_slave_stop(g_manager.tcp_handle);
         if (ret != ESP_OK) {
             ESP_LOGW(TAG, "⚠️ Aviso ao parar TCP: %s", esp_err_to_name(ret));
@@ -216,7 +235,7 @@ static esp_err_t start_rtu_implementation(void) {
         modbus_slave_task,           // Função da task existente
         "Modbus RTU Task",           // Nome da task
         4096,                        // Tamanho da pilha
-        NULL,                        // Parâmetros (não usado)
+        &g_manager.rtu_handler,      // Recebe o controlador serial criado pela task
         3,                           // Prioridade
         &g_manager.rtu_task_handle   // Handle para controle
     );
@@ -228,9 +247,6 @@ static esp_err_t start_rtu_implementation(void) {
     
     ESP_LOGI(TAG, "✅ Task RTU criada com sucesso");
     
-    // Aguarda um tempo para task inicializar
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    
     return ESP_OK;
 }
 
@@ -329,43 +345,91 @@ static esp_err_t start_tcp_implementation(void) {
     modbus_tcp_get_connection_info(g_manager.tcp_handle, &connection_count, &port);
     
     ESP_LOGI(TAG, "✅ Servidor TCP iniciado - Porta: %d, Conexões: %d", port, connection_count);
+
     ESP_LOGI(TAG, "🌐 IP do servidor: %s", wifi_get_status().ip_address);
+
+    // Configuração escrita pelo master TCP é gravada como a do master RTU
+    if ((modbus_tcp_watch_range(g_manager.tcp_handle, MODBUS_REG_HOLDING, REG_CONFIG_START, REG_CONFIG_SIZE,
+                                on_persisted_regs_write, NULL) != ESP_OK) ||
+        (modbus_tcp_watch_range(g_manager.tcp_handle, MODBUS_REG_HOLDING, REG_6000_START, REG_6000_SIZE,
+                                on_persisted_regs_write, NULL) != ESP_OK)) {
+        ESP_LOGW(TAG, "⚠️ Escritas TCP em 1000/6000 não serão gravadas");
+    }
+    
+    // Falha do gateway não impede o slave TCP local
+    if (g_manager.gateway_enabled) {
+        ret = modbus_gateway_start(g_manager.tcp_handle, NULL);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "⚠️ Gateway TCP → RTU não iniciado: %s", esp_err_to_name(ret));
+        }
+    }
     
     return ESP_OK;
 }
 
 /* ============================================================================
- * FUNÇÕES INTERNAS - SINCRONIZAÇÃO DE REGISTRADORES
+ * FUNÇÕES INTERNAS - TRANSIÇÕES DE ESTADO
  * ============================================================================ */
 
 /**
- * @brief Sincroniza registradores RTU → TCP
+ * @brief Atualiza o estado conforme os transportes ativos
  */
-static esp_err_t sync_registers_rtu_to_tcp(void) {
-    if (g_manager.tcp_handle == NULL) {
-        return ESP_ERR_INVALID_STATE;
+static void update_running_state(void) {
+    bool rtu = (g_manager.rtu_task_handle != NULL);
+    bool tcp = (g_manager.tcp_handle != NULL);
+    
+    g_manager.is_running = rtu || tcp;
+    if (rtu && tcp) {
+        g_manager.state = MANAGER_STATE_RUNNING_RTU_TCP;
+    } else if (tcp) {
+        g_manager.state = MANAGER_STATE_RUNNING_TCP;
+    } else if (rtu) {
+        g_manager.state = MANAGER_STATE_RUNNING_RTU;
+    } else {
+        g_manager.state = MANAGER_STATE_IDLE;
     }
-    
-    // Usa função de sincronização dedicada
-    return modbus_sync_all_registers_rtu_to_tcp(g_manager.tcp_handle);
 }
 
 /**
- * @brief Sincroniza registradores TCP → RTU
+ * @brief Liga e desliga os transportes do modo
+ * 
+ * Só o transporte que o modo não usa é parado, o outro continua atendendo.
+ * O slave RTU roda em todos os modos exceto DISABLED, o TCP nos modos TCP e
+ * AUTO enquanto há WiFi. O gateway usa a UART do slave RTU como master, então
+ * com o gateway habilitado o slave RTU para antes de o TCP subir.
  */
-static esp_err_t sync_registers_tcp_to_rtu(void) {
-    if (g_manager.tcp_handle == NULL) {
-        return ESP_ERR_INVALID_STATE;
+static esp_err_t apply_mode_transports(modbus_mode_t mode, bool wifi_connected) {
+    esp_err_t result = ESP_OK;
+    bool want_tcp = (mode == MODBUS_MODE_TCP || mode == MODBUS_MODE_AUTO) && wifi_connected;
+    
+    if (!want_tcp && g_manager.tcp_handle != NULL) {
+        stop_tcp_implementation();
+    }
+    
+    bool line_for_gateway = want_tcp && g_manager.gateway_enabled && (g_manager.tcp_handle == NULL);
+    if ((mode == MODBUS_MODE_DISABLED || line_for_gateway) && g_manager.rtu_task_handle != NULL) {
+        result = stop_rtu_implementation();
+    }
+    
+    if (want_tcp && g_manager.tcp_handle == NULL) {
+        esp_err_t tcp_result = start_tcp_implementation();
+        if (result == ESP_OK) {
+            result = tcp_result;
+        }
     }
     
-    // Usa função de sincronização dedicada
-    return modbus_sync_all_registers_tcp_to_rtu(g_manager.tcp_handle);
+    // Sem o gateway na linha, o slave RTU volta a atender
+    if (mode != MODBUS_MODE_DISABLED && !modbus_gateway_is_running() && g_manager.rtu_task_handle == NULL) {
+        esp_err_t rtu_result = start_rtu_implementation();
+        if (result == ESP_OK) {
+            result = rtu_result;
+        }
+    }
+    
+    update_running_state();
+    return result;
 }
 
-/* ============================================================================
- * FUNÇÕES INTERNAS - TRANSIÇÕES DE ESTADO
- * ============================================================================ */
-
 /**
  * @brief Executa transição para modo especificado
  */
@@ -374,70 +438,21 @@ static esp_err_t execute_mode_transition(modbus_mode_t new_mode) {
              MODE_NAMES[g_manager.current_mode], MODE_NAMES[new_mode]);
     
     g_manager.state = MANAGER_STATE_SWITCHING;
-    esp_err_t result = ESP_OK;
     
-    // Para implementação atual
-    switch (g_manager.current_mode) {
-        case MODBUS_MODE_RTU:
-            result = stop_rtu_implementation();
-            break;
-        case MODBUS_MODE_TCP:
-            result = stop_tcp_implementation();
-            break;
-        default:
-            break;
+    bool wifi_connected = (new_mode == MODBUS_MODE_TCP || new_mode == MODBUS_MODE_AUTO) && is_wifi_connected();
+    if (new_mode == MODBUS_MODE_TCP && !wifi_connected) {
+        ESP_LOGW(TAG, "⚠️ WiFi não conectado, o TCP inicia quando conectar");
     }
     
+    esp_err_t result = apply_mode_transports(new_mode, wifi_connected);
     if (result != ESP_OK) {
-        ESP_LOGE(TAG, "❌ Falha ao parar modo atual: %s", esp_err_to_name(result));
-        g_manager.state = MANAGER_STATE_ERROR;
-        return result;
+        log_error(result, "Transição de modo incompleta");
     }
     
-    // Aguarda estabilização
-    vTaskDelay(pdMS_TO_TICKS(500));
-    
-    // Inicia nova implementação
-    switch (new_mode) {
-        case MODBUS_MODE_DISABLED:
-            g_manager.state = MANAGER_STATE_IDLE;
-            g_manager.is_running = false;
-            break;
-            
-        case MODBUS_MODE_RTU:
-            result = start_rtu_implementation();
-            if (result == ESP_OK) {
-                g_manager.state = MANAGER_STATE_RUNNING_RTU;
-                g_manager.is_running = true;
-            }
-            break;
-            
-        case MODBUS_MODE_TCP:
-            result = start_tcp_implementation();
-            if (result == ESP_OK) {
-                g_manager.state = MANAGER_STATE_RUNNING_TCP;
-                g_manager.is_running = true;
-            }
-            break;
-            
-        case MODBUS_MODE_AUTO:
-            // Decide automaticamente com base na conectividade
-            if (is_wifi_connected()) {
-                result = execute_mode_transition(MODBUS_MODE_TCP);
-            } else {
-                result = execute_mode_transition(MODBUS_MODE_RTU);
-            }
-            return result; // Evita processamento duplo
-            
-        default:
-            result = ESP_ERR_INVALID_ARG;
-            break;
-    }
-    
-    if (result != ESP_OK) {
+    // Falha só quando nenhum transporte do modo ficou ativo
+    if (new_mode != MODBUS_MODE_DISABLED && !g_manager.is_running) {
         ESP_LOGE(TAG, "❌ Falha ao iniciar novo modo: %s", esp_err_to_name(result));
         g_manager.state = MANAGER_STATE_ERROR;
-        log_error(result, "Transição de modo falhada");
         return result;
     }
     
@@ -445,15 +460,18 @@ static esp_err_t execute_mode_transition(modbus_mode_t new_mode) {
     modbus_mode_t old_mode = g_manager.current_mode;
     g_manager.current_mode = new_mode;
     g_manager.uptime_start_ms = get_timestamp_ms();
-    clear_error_state();
+    if (result == ESP_OK) {
+        clear_error_state();
+    }
     
     // Chama callback se registrado
     if (g_manager.mode_callback != NULL) {
         g_manager.mode_callback(old_mode, new_mode);
     }
     
-    ESP_LOGI(TAG, "✅ Transição concluída com sucesso: %s ativo", MODE_NAMES[new_mode]);
-    return ESP_OK;
+    ESP_LOGI(TAG, "✅ Transição concluída: %s ativo (%s)", MODE_NAMES[new_mode],
+             STATE_NAMES[g_manager.state]);
+    return result;
 }
 
 /* ============================================================================
@@ -488,35 +506,33 @@ static void process_state_machine(void) {
             
         case MANAGER_STATE_RUNNING_RTU:
         case MANAGER_STATE_RUNNING_TCP:
-            // Sincroniza registradores periodicamente
-            if (g_manager.config.register_sync_enabled && 
-                current_time_ms - g_manager.last_sync_ms >= g_manager.config.sync_interval_ms) {
-                
-                if (g_manager.state == MANAGER_STATE_RUNNING_RTU) {
-                    sync_registers_rtu_to_tcp();
-                } else {
-                    sync_registers_tcp_to_rtu();
+        case MANAGER_STATE_RUNNING_RTU_TCP:
+            // RTU e TCP servem a mesma memória de registradores, não há o que copiar
+            if (g_manager.config_save_pending) {
+                g_manager.config_save_pending = false;
+                if (save_config() != ESP_OK) {
+                    ESP_LOGW(TAG, "⚠️ Falha ao gravar configuração escrita pelo master TCP");
                 }
-                
-                g_manager.last_sync_ms = current_time_ms;
             }
             
-            // Verifica conectividade WiFi para modo AUTO
-            if (g_manager.desired_mode == MODBUS_MODE_AUTO &&
+            // Verifica conectividade WiFi nos modos com TCP, o RTU segue atendendo
+            if ((g_manager.current_mode == MODBUS_MODE_TCP || g_manager.current_mode == MODBUS_MODE_AUTO) &&
                 current_time_ms - g_manager.last_wifi_check_ms >= g_manager.config.wifi_check_interval_ms) {
                 
                 bool wifi_connected = is_wifi_connected();
+                bool tcp_running = (g_manager.tcp_handle != NULL);
                 
-                // Fallback automático se WiFi caiu durante TCP
-                if (g_manager.state == MANAGER_STATE_RUNNING_TCP && !wifi_connected && 
-                    g_manager.config.auto_fallback_enabled) {
-                    ESP_LOGW(TAG, "⚠️ WiFi desconectado, fazendo fallback para RTU");
-                    execute_mode_transition(MODBUS_MODE_RTU);
+                // Para o TCP se o WiFi caiu
+                if (tcp_running && !wifi_connected && g_manager.config.auto_fallback_enabled) {
+                    ESP_LOGW(TAG, "⚠️ WiFi desconectado, parando TCP (RTU continua)");
+                    apply_mode_transports(g_manager.current_mode, false);
                 }
-                // Upgrade automático se WiFi voltou durante RTU  
-                else if (g_manager.state == MANAGER_STATE_RUNNING_RTU && wifi_connected) {
-                    ESP_LOGI(TAG, "📶 WiFi conectado, alternando para TCP");
-                    execute_mode_transition(MODBUS_MODE_TCP);
+                // Inicia o TCP junto com o RTU quando o WiFi volta
+                else if (!tcp_running && wifi_connected) {
+                    ESP_LOGI(TAG, "📶 WiFi conectado, iniciando TCP junto com o RTU");
+                    if (apply_mode_transports(g_manager.current_mode, true) != ESP_OK) {
+                        log_error(g_manager.last_error, "TCP não iniciado com WiFi conectado");
+                    }
                 }
                 
                 g_manager.last_wifi_check_ms = current_time_ms;
@@ -576,10 +592,10 @@ esp_err_t modbus_manager_init(const modbus_manager_config_t *config) {
     // Inicializa timestamps
     uint32_t now = get_timestamp_ms();
     g_manager.uptime_start_ms = now;
-    g_manager.last_sync_ms = now;
     g_manager.last_wifi_check_ms = now;
     
     // Lê modo inicial da configuração
+    g_manager.gateway_enabled = (config != NULL) && config->gateway_enabled;
     g_manager.desired_mode = modbus_manager_read_config_mode();
     g_manager.current_mode = MODBUS_MODE_DISABLED;
     g_manager.state = MANAGER_STATE_INITIALIZING;
@@ -685,6 +701,88 @@ esp_err_t modbus_manager_get_status(modbus_status_t *status) {
     return ESP_ERR_TIMEOUT;
 }
 
+esp_err_t modbus_manager_get_latency_stats(modbus_latency_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if MB_STATS_ENABLED
+    const UCHAR *codes = NULL;
+    USHORT count = usMBStatsGetFunctions(&codes);
+    
+    memset(stats, 0, sizeof(*stats));
+    stats->function_count = (count < MODBUS_LATENCY_MAX_FUNCTIONS) ? count : MODBUS_LATENCY_MAX_FUNCTIONS;
+    
+    for (int f = 0; f < stats->function_count; f++) {
+        modbus_fc_latency_t *entry = &stats->functions[f];
+        entry->function_code = codes[f];
+        for (int stage = 0; stage < MODBUS_LATENCY_STAGE_COUNT; stage++) {
+            xMBStatsSummary summary;
+            // Os estágios do manager seguem a mesma ordem de eMBStatsStage
+            if (xMBStatsGetSummary(MB_STATS_TRANSPORT_SERIAL, codes[f], (eMBStatsStage)stage, &summary)) {
+                entry->rtu[stage] = (modbus_latency_summary_t){
+                    summary.ulCount, summary.ulP50Us, summary.ulP99Us, summary.ulMaxUs
+                };
+            }
+            if (xMBStatsGetSummary(MB_STATS_TRANSPORT_TCP, codes[f], (eMBStatsStage)stage, &summary)) {
+                entry->tcp[stage] = (modbus_latency_summary_t){
+                    summary.ulCount, summary.ulP50Us, summary.ulP99Us, summary.ulMaxUs
+                };
+            }
+        }
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t modbus_manager_reset_latency_stats(void) {
+#if MB_STATS_ENABLED
+    vMBStatsReset();
+    ESP_LOGI(TAG, "📊 Histogramas de latência zerados");
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t modbus_manager_set_gateway(bool enable) {
+    if (!g_manager.is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    esp_err_t result = ESP_OK;
+    
+    if (xSemaphoreTake(g_manager.mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        g_manager.gateway_enabled = enable;
+        
+        // Sem o TCP o gateway inicia quando ele subir
+        if (g_manager.tcp_handle != NULL) {
+            if (enable && !modbus_gateway_is_running()) {
+                // O gateway assume a UART do slave RTU
+                stop_rtu_implementation();
+                result = modbus_gateway_start(g_manager.tcp_handle, NULL);
+            } else if (!enable) {
+                result = modbus_gateway_stop();
+            }
+            
+            if (g_manager.current_mode != MODBUS_MODE_DISABLED && !modbus_gateway_is_running() &&
+                g_manager.rtu_task_handle == NULL) {
+                start_rtu_implementation();
+            }
+            update_running_state();
+        }
+        
+        xSemaphoreGive(g_manager.mutex);
+    } else {
+        result = ESP_ERR_TIMEOUT;
+    }
+    
+    ESP_LOGI(TAG, "🔀 Gateway TCP → RTU %s: %s", enable ? "habilitado" : "desabilitado",
+             esp_err_to_name(result));
+    return result;
+}
+
 modbus_mode_t modbus_manager_read_config_mode(void) {
     modbus_mode_t mode = MODBUS_MODE_RTU; // Padrão seguro
     
@@ -747,27 +845,8 @@ esp_err_t modbus_manager_sync_registers(void) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    esp_err_t result = ESP_OK;
-    
-    if (xSemaphoreTake(g_manager.mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        switch (g_manager.current_mode) {
-            case MODBUS_MODE_RTU:
-                result = sync_registers_rtu_to_tcp();
-                break;
-            case MODBUS_MODE_TCP:
-                result = sync_registers_tcp_to_rtu();
-                break;
-            default:
-                result = ESP_ERR_INVALID_STATE;
-                break;
-        }
-        
-        xSemaphoreGive(g_manager.mutex);
-    } else {
-        result = ESP_ERR_TIMEOUT;
-    }
-    
-    return result;
+    // RTU e TCP servem a mesma memória ao mesmo tempo, não há cópia a fazer
+    return ESP_OK;
 }
 
 esp_err_t modbus_manager_set_mode_callback(modbus_mode_change_callback_t callback) {
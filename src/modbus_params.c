@@ -14,4 +14,6 @@ uint16_t reg7000[REG_7000_SIZE];
 uint16_t reg8000[REG_8000_SIZE];
 uint16_t reg9000[REG_UNITSPECS_SIZE];
 coil_reg_params_t     coil_reg_params;
-input_reg_params_t    input_reg_params;
\ No newline at end of file
+input_reg_params_t    input_reg_params;
+mb_seqlock_t          holding_reg_params_lock;
+mb_seqlock_t          input_reg_params_lock;
\ No newline at end of file
@@ -10,9 +10,6 @@
 #include "modbus_slave_task.h"
 
 #include "config_manager.h"
-// Adicionados para uso de Wi-Fi, cJSON e funções de string
-#include "wifi_manager.h"
-#include "cJSON.h"
 #include <string.h>
 // Incluído para acesso às variáveis globais da sonda
 #include "globalvar.h"
@@ -33,8 +30,11 @@ static void setup_registers(void) {
 
     discrete_reg_params.discrete_input0 = 1;
     discrete_reg_params.discrete_input1 = 0;
+    // Floats compartilhados com o slave TCP: escrita sob o seqlock do banco
+    mb_seqlock_write_begin(&holding_reg_params_lock);
     holding_reg_params.holding_data0 = 123;
     holding_reg_params.holding_data1 = 321;
+    mb_seqlock_write_end(&holding_reg_params_lock);
     coil_reg_params.coils_port0 = 0x00;
 
     holding_reg1000_params.reg1000[baudrate] = 9600;
@@ -105,7 +105,7 @@ static void setup_registers(void) {
 void modbus_slave_task(void *pvParameters) {
     mb_param_info_t reg_info;
     mb_communication_info_t comm_info;
-    mb_register_area_descriptor_t reg_area;
+    mb_register_area_descriptor_t reg_area = {0};
 
     void* mbc_slave_handler = NULL;
 
@@ -114,82 +114,20 @@ void modbus_slave_task(void *pvParameters) {
     // // Inicializa os registradores antes de registrar
     setup_registers();
 
-    // Lê modo do Modbus de config.json
-    char modbus_mode[8] = "rtu";
-    {
-        FILE *f = fopen("/spiffs/config.json", "r");
-        if (f) {
-            fseek(f, 0, SEEK_END);
-            long size = ftell(f);
-            rewind(f);
-            char *data = malloc(size + 1);
-            if (data) {
-                fread(data, 1, size, f);
-                data[size] = '\0';
-                cJSON *root = cJSON_Parse(data);
-                if (root) {
-                    cJSON *mode_item = cJSON_GetObjectItem(root, "modbus_mode");
-                    if (mode_item && cJSON_IsString(mode_item)) {
-                        strncpy(modbus_mode, mode_item->valuestring, sizeof(modbus_mode)-1);
-                        modbus_mode[sizeof(modbus_mode)-1] = '\0';
-                    }
-                    cJSON_Delete(root);
-                }
-                free(data);
-            }
-            fclose(f);
-        }
-    }
-
-    wifi_status_t wifi_st = wifi_get_status();
-
-    if (strcmp(modbus_mode, "tcp") == 0) {
-        // Only start TCP if Wi-Fi STA is connected and has IP
-        if (wifi_st.is_connected && wifi_st.ip_address[0] != '\0') {
-            ESP_LOGI(TAG, "Inicializando Modbus TCP (Wi-Fi conectado, IP: %s)", wifi_st.ip_address);
-            ESP_ERROR_CHECK(mbc_slave_init(MB_PORT_TCP, &mbc_slave_handler));
-            comm_info.mode = MB_MODE_TCP;
-            comm_info.slave_addr = MB_SLAVE_ADDR;
-            comm_info.port = 502; // or read from config.json
-            comm_info.baudrate = 0;
-            comm_info.parity = MB_PARITY_NONE;
-            ESP_ERROR_CHECK(mbc_slave_setup(&comm_info));
-        } else {
-            ESP_LOGW(TAG, "Modo Modbus TCP selecionado, mas Wi-Fi não está conectado ou sem IP. Modbus TCP não será iniciado.");
-            vTaskDelete(NULL);
-            return;
-        }
-    } else if (strcmp(modbus_mode, "ambos") == 0) {
-        // Prefer TCP when Wi-Fi available, otherwise fall back to RTU
-        if (wifi_st.is_connected && wifi_st.ip_address[0] != '\0') {
-            ESP_LOGI(TAG, "Modo AMBOS: Inicializando Modbus TCP (Wi-Fi conectado, IP: %s)", wifi_st.ip_address);
-            ESP_ERROR_CHECK(mbc_slave_init(MB_PORT_TCP, &mbc_slave_handler));
-            comm_info.mode = MB_MODE_TCP;
-            comm_info.slave_addr = MB_SLAVE_ADDR;
-            comm_info.port = 502;
-            comm_info.baudrate = 0;
-            comm_info.parity = MB_PARITY_NONE;
-            ESP_ERROR_CHECK(mbc_slave_setup(&comm_info));
-        } else {
-            ESP_LOGI(TAG, "Modo AMBOS: Wi-Fi indisponível, iniciando Modbus RTU (Serial)");
-            ESP_ERROR_CHECK(mbc_slave_init(MB_PORT_SERIAL_SLAVE, &mbc_slave_handler));
-            comm_info.mode = MB_MODE_RTU;
-            comm_info.slave_addr = MB_SLAVE_ADDR;
-            comm_info.port = MB_PORT_NUM;
-            comm_info.baudrate = MB_DEV_SPEED;
-            comm_info.parity = MB_PARITY_NONE;
-            ESP_ERROR_CHECK(mbc_slave_setup(&comm_info));
-        }
-    } else {
-        ESP_LOGI(TAG, "Inicializando Modbus RTU (Serial)");
-        ESP_ERROR_CHECK(mbc_slave_init(MB_PORT_SERIAL_SLAVE, &mbc_slave_handler));
-        comm_info.mode = MB_MODE_RTU;
-        comm_info.slave_addr = MB_SLAVE_ADDR;
-        comm_info.port = MB_PORT_NUM;
-        comm_info.baudrate = MB_DEV_SPEED;
-        comm_info.parity = MB_PARITY_NONE;
-        ESP_ERROR_CHECK(mbc_slave_setup(&comm_info));
+    // O TCP é servido pela biblioteca com o seu próprio controlador, esta task
+    // serve só o barramento serial e os dois rodam ao mesmo tempo
+    ESP_LOGI(TAG, "Inicializando Modbus RTU (Serial)");
+    ESP_ERROR_CHECK(mbc_slave_init(MB_PORT_SERIAL_SLAVE, &mbc_slave_handler));
+    if (pvParameters != NULL) {
+        // Devolve o controlador a quem criou a task, que o destrói ao parar o RTU
+        *(void**)pvParameters = mbc_slave_handler;
     }
+    comm_info.mode = MB_MODE_RTU;
+    comm_info.slave_addr = MB_SLAVE_ADDR;
+    comm_info.port = MB_PORT_NUM;
+    comm_info.baudrate = MB_DEV_SPEED;
+    comm_info.parity = MB_PARITY_NONE;
+    ESP_ERROR_CHECK(mbc_slave_setup_hdl(mbc_slave_handler, &comm_info));
     ESP_LOGI(TAG, "Modbus handler initialized: %p", mbc_slave_handler);
     ESP_LOGI(TAG, "Modbus communication setup done.");
     ESP_LOGI(TAG, "Meu log1: %d",comm_info.slave_addr);
@@ -197,70 +135,94 @@ void modbus_slave_task(void *pvParameters) {
     ESP_LOGI(TAG, "Meu log3: %ld",(long)comm_info.baudrate);
     ESP_LOGI(TAG, "Meu log4: %d",comm_info.parity);
     // // // Configura área de registradores
+    // Floats compartilhados (0-7): mesmo formato do slave TCP, lidos e escritos
+    // pelo stack com o seqlock do banco
+    reg_area.elem_type = MB_ELEM_FLOAT;
+    reg_area.word_order = MB_WORD_ORDER_CDAB;
+    reg_area.type = MB_PARAM_HOLDING;
+    reg_area.start_offset = REG_HOLDING_FLOAT_START;
+    reg_area.address = (void*)&holding_reg_params;
+    reg_area.size = sizeof(holding_reg_params);
+    reg_area.seqlock = &holding_reg_params_lock;
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
+    ESP_LOGI(TAG, "Holding float registers descriptor set.");
+
+    reg_area.type = MB_PARAM_INPUT;
+    reg_area.start_offset = REG_INPUT_FLOAT_START;
+    reg_area.address = (void*)&input_reg_params;
+    reg_area.size = sizeof(input_reg_params);
+    reg_area.seqlock = &input_reg_params_lock;
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
+    ESP_LOGI(TAG, "Input float registers descriptor set.");
+
+    // Demais áreas são registradores sem tipo, sem seqlock
+    reg_area.elem_type = MB_ELEM_U16;
+    reg_area.word_order = MB_WORD_ORDER_ABCD;
+    reg_area.seqlock = NULL;
     reg_area.type = MB_PARAM_HOLDING;
     reg_area.start_offset = 1000;
     reg_area.address = (void*)&holding_reg1000_params.reg1000;
     reg_area.size = sizeof(holding_reg1000_params);
-    ESP_ERROR_CHECK(mbc_slave_set_descriptor(reg_area));
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
     ESP_LOGI(TAG, "Holding registers descriptor set.");
 
     reg_area.type = MB_PARAM_HOLDING;
     reg_area.start_offset = REG_DATA_START;
     reg_area.address = (void*)&reg2000;
     reg_area.size = sizeof(reg2000);
-    ESP_ERROR_CHECK(mbc_slave_set_descriptor(reg_area));
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
     ESP_LOGI(TAG, "Holding registers descriptor set.");
 
     reg_area.type = MB_PARAM_HOLDING;
     reg_area.start_offset = REG_3000_START;
     reg_area.address = (void*)&reg3000;
     reg_area.size = sizeof(reg3000);
-    ESP_ERROR_CHECK(mbc_slave_set_descriptor(reg_area));
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
     ESP_LOGI(TAG, "Holding registers descriptor set.");
 
     reg_area.type = MB_PARAM_HOLDING;
     reg_area.start_offset = REG_4000_START;
     reg_area.address = (void*)&reg4000;
     reg_area.size = sizeof(reg4000);
-    ESP_ERROR_CHECK(mbc_slave_set_descriptor(reg_area));
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
     ESP_LOGI(TAG, "Holding registers descriptor set.");
 
     reg_area.type = MB_PARAM_HOLDING;
     reg_area.start_offset = REG_5000_START;
     reg_area.address = (void*)&reg5000;
     reg_area.size = sizeof(reg5000);
-    ESP_ERROR_CHECK(mbc_slave_set_descriptor(reg_area));
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
     ESP_LOGI(TAG, "Holding registers descriptor set.");
 
     reg_area.type = MB_PARAM_HOLDING;
     reg_area.start_offset = REG_6000_START;
     reg_area.address = (void*)&reg6000;
     reg_area.size = sizeof(reg6000);
-    ESP_ERROR_CHECK(mbc_slave_set_descriptor(reg_area));
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
     ESP_LOGI(TAG, "Holding registers descriptor set.");
 
     reg_area.type = MB_PARAM_HOLDING;
     reg_area.start_offset = REG_7000_START;
     reg_area.address = (void*)&reg7000;
     reg_area.size = sizeof(reg7000);
-    ESP_ERROR_CHECK(mbc_slave_set_descriptor(reg_area));
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
     ESP_LOGI(TAG, "Holding registers descriptor set.");
 
     reg_area.type = MB_PARAM_HOLDING;
     reg_area.start_offset = REG_8000_START;
     reg_area.address = (void*)&reg8000;
     reg_area.size = sizeof(reg8000);
-    ESP_ERROR_CHECK(mbc_slave_set_descriptor(reg_area));
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
     ESP_LOGI(TAG, "Holding registers descriptor set.");
 
     reg_area.type = MB_PARAM_HOLDING;
     reg_area.start_offset = REG_UNITSPECS_START;
     reg_area.address = (void*)&reg9000;
     reg_area.size = sizeof(reg9000);
-    ESP_ERROR_CHECK(mbc_slave_set_descriptor(reg_area));
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(mbc_slave_handler, reg_area));
 
     // // // Inicia Modbus
-    ESP_ERROR_CHECK(mbc_slave_start());
+    ESP_ERROR_CHECK(mbc_slave_start_hdl(mbc_slave_handler));
     ESP_LOGI(TAG, "Modbus slave started.");
 
     // Set UART pin numbers
@@ -374,10 +336,10 @@ void modbus_slave_task(void *pvParameters) {
                      modbus_cycle_count, messages_processed);
         }
 
-        (void)mbc_slave_check_event(MB_READ_WRITE_MASK);
+        (void)mbc_slave_check_event_hdl(mbc_slave_handler, MB_READ_WRITE_MASK);
 
         // // Obtém informações de eventos (com timeout seguro)
-        ESP_ERROR_CHECK_WITHOUT_ABORT(mbc_slave_get_param_info(&reg_info, MB_PAR_INFO_GET_TOUT));
+        ESP_ERROR_CHECK_WITHOUT_ABORT(mbc_slave_get_param_info_hdl(mbc_slave_handler, &reg_info, MB_PAR_INFO_GET_TOUT));
 
         if (reg_info.type & (MB_EVENT_HOLDING_REG_WR | MB_EVENT_HOLDING_REG_RD)) {
             ESP_LOGI(TAG, "HOLDING REG EVENT: ADDR=%u TYPE=%u", 
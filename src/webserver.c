@@ -106,6 +106,7 @@ esp_err_t config_download_handler(httpd_req_t *req);
 esp_err_t modbus_mode_api_handler(httpd_req_t *req);         // GET/POST /api/modbus/mode
 esp_err_t modbus_status_api_handler(httpd_req_t *req);       // GET /api/modbus/status  
 esp_err_t modbus_restart_api_handler(httpd_req_t *req);      // POST /api/modbus/restart
+esp_err_t modbus_stats_api_handler(httpd_req_t *req);        // GET /api/modbus/stats
 
 // Helper function para páginas de confirmação
 esp_err_t send_confirmation_page(httpd_req_t *req, const char *page_title, 
@@ -2572,6 +2573,86 @@ esp_err_t modbus_status_api_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+/**
+ * @brief Adiciona ao objeto JSON os resumos de latência de um transporte
+ */
+static void add_latency_stages(cJSON *parent, const char *name, const modbus_latency_summary_t *stages) {
+    static const char *stage_names[MODBUS_LATENCY_STAGE_COUNT] = {"queue", "exec", "send", "total"};
+    
+    cJSON *transport = cJSON_AddObjectToObject(parent, name);
+    if (transport == NULL) {
+        return;
+    }
+    for (int stage = 0; stage < MODBUS_LATENCY_STAGE_COUNT; stage++) {
+        cJSON *item = cJSON_AddObjectToObject(transport, stage_names[stage]);
+        if (item == NULL) {
+            return;
+        }
+        cJSON_AddNumberToObject(item, "count", stages[stage].count);
+        cJSON_AddNumberToObject(item, "p50_us", stages[stage].p50_us);
+        cJSON_AddNumberToObject(item, "p99_us", stages[stage].p99_us);
+        cJSON_AddNumberToObject(item, "max_us", stages[stage].max_us);
+    }
+}
+
+/**
+ * @brief Handler para GET /api/modbus/stats
+ * 
+ * Retorna as latências (p50, p99 e máximo) por código de função,
+ * separadas por transporte (RTU/TCP) e estágio de processamento.
+ */
+esp_err_t modbus_stats_api_handler(httpd_req_t *req) {
+    ESP_LOGI(TAG, "📊 Modbus Stats API");
+    
+    // Estrutura grande demais para a pilha da task HTTP
+    modbus_latency_stats_t *stats = malloc(sizeof(modbus_latency_stats_t));
+    if (stats == NULL) {
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"error\":\"Out of memory\"}");
+        return ESP_OK;
+    }
+    
+    esp_err_t result = modbus_manager_get_latency_stats(stats);
+    if (result != ESP_OK) {
+        free(stats);
+        httpd_resp_set_status(req, (result == ESP_ERR_NOT_SUPPORTED) ? "501 Not Implemented" : "500 Internal Server Error");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"error\":\"Latency statistics not available\"}");
+        return ESP_OK;
+    }
+    
+    cJSON *root = cJSON_CreateObject();
+    cJSON *functions = cJSON_AddArrayToObject(root, "functions");
+    for (int f = 0; f < stats->function_count; f++) {
+        cJSON *entry = cJSON_CreateObject();
+        if (stats->functions[f].function_code) {
+            cJSON_AddNumberToObject(entry, "fc", stats->functions[f].function_code);
+        } else {
+            cJSON_AddStringToObject(entry, "fc", "other");
+        }
+        add_latency_stages(entry, "rtu", stats->functions[f].rtu);
+        add_latency_stages(entry, "tcp", stats->functions[f].tcp);
+        cJSON_AddItemToArray(functions, entry);
+    }
+    free(stats);
+    
+    char *out = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (out == NULL) {
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"error\":\"Out of memory\"}");
+        return ESP_OK;
+    }
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, out);
+    free(out);
+    
+    return ESP_OK;
+}
+
 /**
  * @brief Handler para POST /api/modbus/restart
  */
@@ -2693,6 +2774,7 @@ esp_err_t start_web_server() {
     httpd_register_uri_handler(server_handle, &(httpd_uri_t){ .uri = "/api/modbus/mode", .method = HTTP_POST, .handler = modbus_mode_api_handler });
     httpd_register_uri_handler(server_handle, &(httpd_uri_t){ .uri = "/api/modbus/status", .method = HTTP_GET, .handler = modbus_status_api_handler });
     httpd_register_uri_handler(server_handle, &(httpd_uri_t){ .uri = "/api/modbus/restart", .method = HTTP_POST, .handler = modbus_restart_api_handler });
+    httpd_register_uri_handler(server_handle, &(httpd_uri_t){ .uri = "/api/modbus/stats", .method = HTTP_GET, .handler = modbus_stats_api_handler });
     
     // Registra handlers para gerenciamento de configurações (somente root)
     ESP_LOGI(TAG, "Registering config management handlers");
@@ -0,0 +1,823 @@
+/*
+ * Host build: FreeRTOS and ESP-IDF system services on POSIX threads.
+ *
+ * The goal is to run the Modbus stack and its port tasks unchanged on a Linux
+ * host, not to emulate the scheduler: tasks are threads, priorities and core
+ * affinity are ignored and every blocking call has the FreeRTOS semantics of
+ * the calls the stack uses.
+ *
+ * Suspension: a suspended task stops at its next blocking call and waits there
+ * until vTaskResume(). vTaskDelete() of another task ends it the same way.
+ */
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "esp_err.h"
+#include "sys/lock.h"
+
+#define HOST_TASK_NAME_LEN      (16)
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t func;
+    void *arg;
+    char name[HOST_TASK_NAME_LEN];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify_value;
+    bool notify_pending;
+    atomic_bool suspended;
+    atomic_bool deleted;
+};
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+};
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+static __thread struct host_task *s_current_task;
+
+/* ----------------------- Time --------------------------------------------*/
+
+static struct timespec host_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec now = host_now();
+    return (int64_t)now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / (1000 * portTICK_PERIOD_MS));
+}
+
+// Absolute deadline of a wait of the given ticks
+static struct timespec host_deadline(TickType_t ticks)
+{
+    struct timespec deadline = host_now();
+    uint64_t ns = (uint64_t)ticks * portTICK_PERIOD_MS * 1000000ULL;
+    deadline.tv_sec += (time_t)(ns / 1000000000ULL);
+    deadline.tv_nsec += (long)(ns % 1000000000ULL);
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+static void host_cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Waits on the condition, returns false once the deadline has passed
+static bool host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks,
+                           const struct timespec *deadline)
+{
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return (pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT);
+}
+
+/* ----------------------- Critical sections and locks ---------------------*/
+
+void host_mux_init(portMUX_TYPE *mux)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mux->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void host_mux_enter(portMUX_TYPE *mux)
+{
+    pthread_mutex_lock(&mux->mutex);
+}
+
+void host_mux_exit(portMUX_TYPE *mux)
+{
+    pthread_mutex_unlock(&mux->mutex);
+}
+
+static pthread_mutex_t *host_lock_get(_lock_t *plock)
+{
+    pthread_mutex_t *mutex = (pthread_mutex_t *)__atomic_load_n(plock, __ATOMIC_ACQUIRE);
+    if (!mutex) {
+        pthread_mutex_t *created = malloc(sizeof(pthread_mutex_t));
+        configASSERT(created);
+        pthread_mutex_init(created, NULL);
+        intptr_t expected = 0;
+        if (__atomic_compare_exchange_n(plock, &expected, (intptr_t)created, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            mutex = created;
+        } else {
+            pthread_mutex_destroy(created);
+            free(created);
+            mutex = (pthread_mutex_t *)expected;
+        }
+    }
+    return mutex;
+}
+
+void _lock_init(_lock_t *plock)
+{
+    *plock = 0;
+}
+
+void _lock_close(_lock_t *plock)
+{
+    pthread_mutex_t *mutex = (pthread_mutex_t *)__atomic_exchange_n(plock, 0, __ATOMIC_ACQ_REL);
+    if (mutex) {
+        pthread_mutex_destroy(mutex);
+        free(mutex);
+    }
+}
+
+void _lock_acquire(_lock_t *plock)
+{
+    pthread_mutex_lock(host_lock_get(plock));
+}
+
+void _lock_release(_lock_t *plock)
+{
+    pthread_mutex_unlock(host_lock_get(plock));
+}
+
+BaseType_t xPortInIsrContext(void)
+{
+    return pdFALSE;
+}
+
+/* ----------------------- Tasks -------------------------------------------*/
+
+static struct host_task *host_task_alloc(const char *name)
+{
+    struct host_task *task = calloc(1, sizeof(struct host_task));
+    configASSERT(task);
+    snprintf(task->name, sizeof(task->name), "%s", name ? name : "");
+    pthread_mutex_init(&task->lock, NULL);
+    host_cond_init(&task->cond);
+    return task;
+}
+
+// The threads not created by xTaskCreate() (main, test threads) get a handle on first use
+static struct host_task *host_task_self(void)
+{
+    if (!s_current_task) {
+        s_current_task = host_task_alloc("host");
+        s_current_task->thread = pthread_self();
+    }
+    return s_current_task;
+}
+
+// Called by the blocking calls: holds a suspended task, ends a deleted one
+static void host_task_checkpoint(void)
+{
+    struct host_task *self = host_task_self();
+    if (atomic_load(&self->suspended) || atomic_load(&self->deleted)) {
+        pthread_mutex_lock(&self->lock);
+        while (atomic_load(&self->suspended) && !atomic_load(&self->deleted)) {
+            pthread_cond_wait(&self->cond, &self->lock);
+        }
+        pthread_mutex_unlock(&self->lock);
+        if (atomic_load(&self->deleted)) {
+            pthread_exit(NULL);
+        }
+    }
+}
+
+static void *host_task_entry(void *arg)
+{
+    struct host_task *task = (struct host_task *)arg;
+    s_current_task = task;
+    task->func(task->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask,
+                                   BaseType_t xCoreID)
+{
+    (void)usStackDepth;
+    (void)uxPriority;
+    (void)xCoreID;
+    struct host_task *task = host_task_alloc(pcName);
+    task->func = pxTaskCode;
+    task->arg = pvParameters;
+    if (pxCreatedTask) {
+        *pxCreatedTask = task;
+    }
+    if (pthread_create(&task->thread, NULL, host_task_entry, task) != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint32_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+    return xTaskCreatePinnedToCore(pxTaskCode, pcName, usStackDepth, pvParameters,
+                                   uxPriority, pxCreatedTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTask)
+{
+    struct host_task *task = xTask ? xTask : host_task_self();
+    atomic_store(&task->deleted, true);
+    if (task == host_task_self()) {
+        pthread_exit(NULL);
+    }
+    pthread_mutex_lock(&task->lock);
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+}
+
+void vTaskSuspend(TaskHandle_t xTask)
+{
+    struct host_task *task = xTask ? xTask : host_task_self();
+    atomic_store(&task->suspended, true);
+    if (task == host_task_self()) {
+        host_task_checkpoint();
+    }
+}
+
+void vTaskResume(TaskHandle_t xTask)
+{
+    if (!xTask) {
+        return;
+    }
+    pthread_mutex_lock(&xTask->lock);
+    atomic_store(&xTask->suspended, false);
+    pthread_cond_broadcast(&xTask->cond);
+    pthread_mutex_unlock(&xTask->lock);
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+    host_task_checkpoint();
+    struct timespec delay = {
+        .tv_sec = (time_t)(xTicksToDelay * portTICK_PERIOD_MS / 1000),
+        .tv_nsec = (long)(xTicksToDelay * portTICK_PERIOD_MS % 1000) * 1000000L
+    };
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+    host_task_checkpoint();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return host_task_self();
+}
+
+/* ----------------------- Task notifications ------------------------------*/
+
+BaseType_t xTaskNotify(TaskHandle_t xTask, uint32_t ulValue, eNotifyAction eAction)
+{
+    BaseType_t result = pdPASS;
+    pthread_mutex_lock(&xTask->lock);
+    switch (eAction) {
+        case eSetBits:
+            xTask->notify_value |= ulValue;
+            break;
+        case eIncrement:
+            xTask->notify_value++;
+            break;
+        case eSetValueWithOverwrite:
+            xTask->notify_value = ulValue;
+            break;
+        case eSetValueWithoutOverwrite:
+            if (xTask->notify_pending) {
+                result = pdFAIL;
+            } else {
+                xTask->notify_value = ulValue;
+            }
+            break;
+        default:
+            break;
+    }
+    xTask->notify_pending = true;
+    pthread_cond_broadcast(&xTask->cond);
+    pthread_mutex_unlock(&xTask->lock);
+    return result;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t xTask, uint32_t ulValue, eNotifyAction eAction,
+                              BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken) {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+    return xTaskNotify(xTask, ulValue, eAction);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTask)
+{
+    return xTaskNotify(xTask, 0, eIncrement);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit,
+                           uint32_t *pulNotificationValue, TickType_t xTicksToWait)
+{
+    struct host_task *self = host_task_self();
+    struct timespec deadline = host_deadline(xTicksToWait);
+    BaseType_t result = pdFALSE;
+
+    host_task_checkpoint();
+    pthread_mutex_lock(&self->lock);
+    if (!self->notify_pending) {
+        self->notify_value &= ~ulBitsToClearOnEntry;
+    }
+    while (!self->notify_pending && (xTicksToWait != 0)) {
+        if (!host_cond_wait(&self->cond, &self->lock, xTicksToWait, &deadline)) {
+            break;
+        }
+    }
+    if (pulNotificationValue) {
+        *pulNotificationValue = self->notify_value;
+    }
+    if (self->notify_pending) {
+        self->notify_value &= ~ulBitsToClearOnExit;
+        self->notify_pending = false;
+        result = pdTRUE;
+    }
+    pthread_mutex_unlock(&self->lock);
+    host_task_checkpoint();
+    return result;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    struct host_task *self = host_task_self();
+    struct timespec deadline = host_deadline(xTicksToWait);
+
+    host_task_checkpoint();
+    pthread_mutex_lock(&self->lock);
+    while ((self->notify_value == 0) && (xTicksToWait != 0)) {
+        if (!host_cond_wait(&self->cond, &self->lock, xTicksToWait, &deadline)) {
+            break;
+        }
+    }
+    uint32_t value = self->notify_value;
+    if (value) {
+        self->notify_value = xClearCountOnExit ? 0 : (value - 1);
+    }
+    self->notify_pending = false;
+    pthread_mutex_unlock(&self->lock);
+    host_task_checkpoint();
+    return value;
+}
+
+uint32_t ulTaskNotifyValueClear(TaskHandle_t xTask, uint32_t ulBitsToClear)
+{
+    struct host_task *task = xTask ? xTask : host_task_self();
+    pthread_mutex_lock(&task->lock);
+    uint32_t value = task->notify_value;
+    task->notify_value &= ~ulBitsToClear;
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+/* ----------------------- Queues and semaphores ---------------------------*/
+
+static struct host_queue *host_queue_create(UBaseType_t length, UBaseType_t item_size, UBaseType_t count)
+{
+    struct host_queue *queue = calloc(1, sizeof(struct host_queue));
+    if (!queue) {
+        return NULL;
+    }
+    if (item_size) {
+        queue->items = calloc(length, item_size);
+        if (!queue->items) {
+            free(queue);
+            return NULL;
+        }
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->count = count;
+    pthread_mutex_init(&queue->lock, NULL);
+    host_cond_init(&queue->not_empty);
+    host_cond_init(&queue->not_full);
+    return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    return host_queue_create(uxQueueLength, uxItemSize, 0);
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    if (xQueue) {
+        pthread_mutex_destroy(&xQueue->lock);
+        pthread_cond_destroy(&xQueue->not_empty);
+        pthread_cond_destroy(&xQueue->not_full);
+        free(xQueue->items);
+        free(xQueue);
+    }
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    struct timespec deadline = host_deadline(xTicksToWait);
+    BaseType_t result = pdFALSE;
+
+    if (xTicksToWait) {
+        host_task_checkpoint();
+    }
+    pthread_mutex_lock(&xQueue->lock);
+    while ((xQueue->count == xQueue->length) && (xTicksToWait != 0)) {
+        if (!host_cond_wait(&xQueue->not_full, &xQueue->lock, xTicksToWait, &deadline)) {
+            break;
+        }
+    }
+    if (xQueue->count < xQueue->length) {
+        if (xQueue->item_size && pvItemToQueue) {
+            UBaseType_t tail = (xQueue->head + xQueue->count) % xQueue->length;
+            memcpy(&xQueue->items[tail * xQueue->item_size], pvItemToQueue, xQueue->item_size);
+        }
+        xQueue->count++;
+        pthread_cond_signal(&xQueue->not_empty);
+        result = pdTRUE;
+    }
+    pthread_mutex_unlock(&xQueue->lock);
+    return result;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken) {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+    return xQueueSend(xQueue, pvItemToQueue, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    struct host_task *self = host_task_self();
+    struct timespec deadline = host_deadline(xTicksToWait);
+    BaseType_t result = pdFALSE;
+
+    host_task_checkpoint();
+    pthread_mutex_lock(&xQueue->lock);
+    for (;;) {
+        if (atomic_load(&self->suspended) || atomic_load(&self->deleted)) {
+            // A suspended task does not take items, it waits for vTaskResume() first
+            pthread_mutex_unlock(&xQueue->lock);
+            host_task_checkpoint();
+            pthread_mutex_lock(&xQueue->lock);
+            continue;
+        }
+        if (xQueue->count || (xTicksToWait == 0)) {
+            break;
+        }
+        if (!host_cond_wait(&xQueue->not_empty, &xQueue->lock, xTicksToWait, &deadline)) {
+            break;
+        }
+    }
+    if (xQueue->count) {
+        if (xQueue->item_size && pvBuffer) {
+            memcpy(pvBuffer, &xQueue->items[xQueue->head * xQueue->item_size], xQueue->item_size);
+        }
+        xQueue->head = (xQueue->head + 1) % xQueue->length;
+        xQueue->count--;
+        pthread_cond_signal(&xQueue->not_full);
+        result = pdTRUE;
+    }
+    pthread_mutex_unlock(&xQueue->lock);
+    return result;
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+    pthread_mutex_lock(&xQueue->lock);
+    xQueue->count = 0;
+    xQueue->head = 0;
+    pthread_cond_broadcast(&xQueue->not_full);
+    pthread_mutex_unlock(&xQueue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+    pthread_mutex_lock(&xQueue->lock);
+    UBaseType_t count = xQueue->count;
+    pthread_mutex_unlock(&xQueue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue)
+{
+    pthread_mutex_lock(&xQueue->lock);
+    UBaseType_t spaces = xQueue->length - xQueue->count;
+    pthread_mutex_unlock(&xQueue->lock);
+    return spaces;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return host_queue_create(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return host_queue_create(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+    return host_queue_create(uxMaxCount, 0, uxInitialCount);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore)
+{
+    vQueueDelete(xSemaphore);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    return xQueueReceive(xSemaphore, NULL, xBlockTime);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    return xQueueSend(xSemaphore, NULL, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    return xQueueSendFromISR(xSemaphore, NULL, pxHigherPriorityTaskWoken);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore)
+{
+    return uxQueueMessagesWaiting(xSemaphore);
+}
+
+/* ----------------------- Event groups ------------------------------------*/
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct host_event_group *group = calloc(1, sizeof(struct host_event_group));
+    if (group) {
+        pthread_mutex_init(&group->lock, NULL);
+        host_cond_init(&group->cond);
+    }
+    return group;
+}
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup)
+{
+    if (xEventGroup) {
+        pthread_mutex_destroy(&xEventGroup->lock);
+        pthread_cond_destroy(&xEventGroup->cond);
+        free(xEventGroup);
+    }
+}
+
+static bool host_bits_ready(EventBits_t bits, EventBits_t wait_for, BaseType_t wait_all)
+{
+    return wait_all ? ((bits & wait_for) == wait_for) : ((bits & wait_for) != 0);
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, EventBits_t uxBitsToWaitFor,
+                                BaseType_t xClearOnExit, BaseType_t xWaitForAllBits, TickType_t xTicksToWait)
+{
+    struct timespec deadline = host_deadline(xTicksToWait);
+
+    host_task_checkpoint();
+    pthread_mutex_lock(&xEventGroup->lock);
+    while (!host_bits_ready(xEventGroup->bits, uxBitsToWaitFor, xWaitForAllBits) && (xTicksToWait != 0)) {
+        if (!host_cond_wait(&xEventGroup->cond, &xEventGroup->lock, xTicksToWait, &deadline)) {
+            break;
+        }
+    }
+    EventBits_t bits = xEventGroup->bits;
+    if (xClearOnExit && host_bits_ready(bits, uxBitsToWaitFor, xWaitForAllBits)) {
+        xEventGroup->bits &= ~uxBitsToWaitFor;
+    }
+    pthread_mutex_unlock(&xEventGroup->lock);
+    host_task_checkpoint();
+    return bits;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, EventBits_t uxBitsToSet)
+{
+    pthread_mutex_lock(&xEventGroup->lock);
+    xEventGroup->bits |= uxBitsToSet;
+    EventBits_t bits = xEventGroup->bits;
+    pthread_cond_broadcast(&xEventGroup->cond);
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t xEventGroup, EventBits_t uxBitsToSet,
+                                     BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if (pxHigherPriorityTaskWoken) {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+    (void)xEventGroupSetBits(xEventGroup, uxBitsToSet);
+    return pdPASS;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, EventBits_t uxBitsToClear)
+{
+    pthread_mutex_lock(&xEventGroup->lock);
+    EventBits_t bits = xEventGroup->bits;
+    xEventGroup->bits &= ~uxBitsToClear;
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup)
+{
+    pthread_mutex_lock(&xEventGroup->lock);
+    EventBits_t bits = xEventGroup->bits;
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
+
+/* ----------------------- esp_timer ---------------------------------------*/
+
+// One-shot timers served by a single thread, like the esp_timer task
+struct host_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t expiry_us;
+    bool armed;
+    struct host_timer *next;
+};
+
+static pthread_mutex_t s_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_timer_cond;
+static pthread_once_t s_timer_once = PTHREAD_ONCE_INIT;
+static struct host_timer *s_timers;
+
+static void *host_timer_thread(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&s_timer_lock);
+    for (;;) {
+        struct host_timer *next = NULL;
+        for (struct host_timer *timer = s_timers; timer; timer = timer->next) {
+            if (timer->armed && (!next || (timer->expiry_us < next->expiry_us))) {
+                next = timer;
+            }
+        }
+        if (!next) {
+            pthread_cond_wait(&s_timer_cond, &s_timer_lock);
+            continue;
+        }
+        int64_t now = esp_timer_get_time();
+        if (next->expiry_us > now) {
+            struct timespec deadline = host_now();
+            int64_t wait_ns = (next->expiry_us - now) * 1000;
+            deadline.tv_sec += (time_t)(wait_ns / 1000000000LL);
+            deadline.tv_nsec += (long)(wait_ns % 1000000000LL);
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&s_timer_cond, &s_timer_lock, &deadline);
+            continue;
+        }
+        next->armed = false;
+        esp_timer_cb_t callback = next->callback;
+        void *callback_arg = next->arg;
+        pthread_mutex_unlock(&s_timer_lock);
+        callback(callback_arg);
+        pthread_mutex_lock(&s_timer_lock);
+    }
+    return NULL;
+}
+
+static void host_timer_start_thread(void)
+{
+    pthread_t thread;
+    host_cond_init(&s_timer_cond);
+    pthread_create(&thread, NULL, host_timer_thread, NULL);
+    pthread_detach(thread);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_once(&s_timer_once, host_timer_start_thread);
+    struct host_timer *timer = calloc(1, sizeof(struct host_timer));
+    if (!timer) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    pthread_mutex_lock(&s_timer_lock);
+    timer->next = s_timers;
+    s_timers = timer;
+    pthread_mutex_unlock(&s_timer_lock);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s_timer_lock);
+    if (timer->armed) {
+        err = ESP_ERR_INVALID_STATE;
+    } else {
+        timer->expiry_us = esp_timer_get_time() + (int64_t)timeout_us;
+        timer->armed = true;
+        pthread_cond_signal(&s_timer_cond);
+    }
+    pthread_mutex_unlock(&s_timer_lock);
+    return err;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s_timer_lock);
+    if (!timer->armed) {
+        err = ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    pthread_mutex_unlock(&s_timer_lock);
+    return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&s_timer_lock);
+    for (struct host_timer **link = &s_timers; *link; link = &(*link)->next) {
+        if (*link == timer) {
+            *link = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_timer_lock);
+    free(timer);
+    return ESP_OK;
+}
+
+void esp_timer_isr_dispatch_need_yield(void)
+{
+}
+
+/* ----------------------- Errors ------------------------------------------*/
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_NOT_FINISHED: return "ESP_ERR_NOT_FINISHED";
+        default: return "UNKNOWN ERROR";
+    }
+}
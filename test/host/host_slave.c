@@ -0,0 +1,356 @@
+/*
+ * Host tests: loopback and pty slaves, Modbus TCP/UDP and RTU clients of the tests.
+ */
+
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_modbus_slave.h"
+#include "host_test.h"
+
+#define HOST_MBAP_SIZE          (7)
+#define HOST_CONNECT_RETRIES    (500)
+
+uint16_t host_holding_regs[HOST_SLAVE_REGS];
+uint16_t host_input_regs[HOST_SLAVE_REGS];
+uint8_t host_coils[HOST_SLAVE_BITS / 8];
+static uint8_t host_discrete[HOST_SLAVE_BITS / 8];
+
+// Any non NULL interface, the host port binds to the loopback through the socket API
+static int host_netif_dummy;
+
+static int host_compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+uint64_t host_percentile(uint64_t *samples, size_t count, unsigned p)
+{
+    if (!count) {
+        return 0;
+    }
+    qsort(samples, count, sizeof(uint64_t), host_compare_u64);
+    size_t idx = (count * p) / 100;
+    return samples[(idx < count) ? idx : (count - 1)];
+}
+
+static void host_slave_fill(void)
+{
+    for (int i = 0; i < HOST_SLAVE_REGS; i++) {
+        host_holding_regs[i] = (uint16_t)i;
+        host_input_regs[i] = (uint16_t)(0x8000 | i);
+    }
+    for (int i = 0; i < HOST_SLAVE_BITS; i++) {
+        if ((i % 3) == 0) {
+            host_coils[i / 8] |= (uint8_t)(1 << (i % 8));
+            host_discrete[i / 8] |= (uint8_t)(1 << (i % 8));
+        }
+    }
+}
+
+static void host_slave_set_areas(void *handler)
+{
+    mb_register_area_descriptor_t area = { 0 };
+    area.start_offset = 0;
+    area.type = MB_PARAM_HOLDING;
+    area.address = host_holding_regs;
+    area.size = sizeof(host_holding_regs);
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(handler, area));
+    area.type = MB_PARAM_INPUT;
+    area.address = host_input_regs;
+    area.size = sizeof(host_input_regs);
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(handler, area));
+    area.type = MB_PARAM_COIL;
+    area.address = host_coils;
+    area.size = sizeof(host_coils);
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(handler, area));
+    area.type = MB_PARAM_DISCRETE;
+    area.address = host_discrete;
+    area.size = sizeof(host_discrete);
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(handler, area));
+}
+
+void *host_slave_start_ip(mb_mode_type_t mode, uint16_t port)
+{
+    void *handler = NULL;
+    host_slave_fill();
+    ESP_ERROR_CHECK(mbc_slave_init_tcp(&handler));
+
+    mb_communication_info_t comm_info = { 0 };
+    comm_info.ip_mode = mode;
+    comm_info.slave_uid = HOST_SLAVE_UID;
+    comm_info.ip_port = port;
+    comm_info.ip_addr_type = MB_IPV4;
+    comm_info.ip_addr = NULL;
+    comm_info.ip_netif_ptr = &host_netif_dummy;
+    ESP_ERROR_CHECK(mbc_slave_setup_hdl(handler, &comm_info));
+    host_slave_set_areas(handler);
+    ESP_ERROR_CHECK(mbc_slave_start_hdl(handler));
+    return handler;
+}
+
+void *host_slave_start_rtu(int fd, uint32_t baudrate)
+{
+    void *handler = NULL;
+    host_slave_fill();
+    ESP_ERROR_CHECK(host_uart_attach(HOST_SLAVE_UART, fd));
+    ESP_ERROR_CHECK(mbc_slave_init(MB_PORT_SERIAL_SLAVE, &handler));
+
+    mb_communication_info_t comm_info = { 0 };
+    comm_info.mode = MB_MODE_RTU;
+    comm_info.slave_addr = HOST_SLAVE_UID;
+    comm_info.port = HOST_SLAVE_UART;
+    comm_info.baudrate = baudrate;
+    comm_info.parity = UART_PARITY_DISABLE;
+    ESP_ERROR_CHECK(mbc_slave_setup_hdl(handler, &comm_info));
+    host_slave_set_areas(handler);
+    ESP_ERROR_CHECK(mbc_slave_start_hdl(handler));
+    return handler;
+}
+
+void host_slave_wait_ready(mb_mode_type_t mode, uint16_t port)
+{
+    // The server is up once it answers a request
+    for (int retry = 0; retry < HOST_CONNECT_RETRIES; retry++) {
+        int fd = host_client_connect(mode, port);
+        if (fd >= 0) {
+            uint8_t adu[32];
+            size_t length = host_build_request(adu, 1, 0x03, 0, 1);
+            host_client_send(fd, adu, length);
+            length = host_client_recv(fd, adu, sizeof(adu), 20);
+            close(fd);
+            if (length) {
+                return;
+            }
+        }
+        usleep(10000);
+    }
+    fprintf(stderr, "slave on port %u did not start\n", (unsigned)port);
+    exit(1);
+}
+
+pid_t host_slave_fork_ip(mb_mode_type_t mode, uint16_t port)
+{
+    pid_t pid = fork();
+    HOST_CHECK(pid >= 0);
+    if (pid == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        host_slave_start_ip(mode, port);
+        for (;;) {
+            pause();
+        }
+    }
+    host_slave_wait_ready(mode, port);
+    return pid;
+}
+
+void host_pty_open(int *client_fd, int *uart_fd)
+{
+    HOST_CHECK(openpty(client_fd, uart_fd, NULL, NULL, NULL) == 0);
+    // Raw both ends: no echo, no line discipline on the binary frames
+    for (int i = 0; i < 2; i++) {
+        int fd = i ? *uart_fd : *client_fd;
+        struct termios tio;
+        HOST_CHECK(tcgetattr(fd, &tio) == 0);
+        cfmakeraw(&tio);
+        HOST_CHECK(tcsetattr(fd, TCSANOW, &tio) == 0);
+    }
+}
+
+void host_slave_wait_ready_rtu(int client_fd)
+{
+    // The slave is up once it answers a request
+    for (int retry = 0; retry < HOST_CONNECT_RETRIES; retry++) {
+        uint8_t adu[32];
+        host_rtu_send(client_fd, adu, host_rtu_build_request(adu, 0x03, 0, 1));
+        if (host_rtu_recv(client_fd, adu, 7, 20) == 7) {
+            return;
+        }
+        tcflush(client_fd, TCIFLUSH);
+    }
+    fprintf(stderr, "RTU slave did not start\n");
+    exit(1);
+}
+
+pid_t host_slave_fork_rtu(uint32_t baudrate, int *client_fd)
+{
+    int uart_fd = -1;
+    host_pty_open(client_fd, &uart_fd);
+    pid_t pid = fork();
+    HOST_CHECK(pid >= 0);
+    if (pid == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        close(*client_fd);
+        host_slave_start_rtu(uart_fd, baudrate);
+        for (;;) {
+            pause();
+        }
+    }
+    close(uart_fd);
+    host_slave_wait_ready_rtu(*client_fd);
+    return pid;
+}
+
+void host_slave_kill(pid_t pid)
+{
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+int host_client_connect(mb_mode_type_t mode, uint16_t port)
+{
+    struct sockaddr_in addr = { 0 };
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = socket(AF_INET, (mode == MB_MODE_UDP) ? SOCK_DGRAM : SOCK_STREAM, 0);
+    HOST_CHECK(fd >= 0);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (mode == MB_MODE_TCP) {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    return fd;
+}
+
+size_t host_build_request(uint8_t *adu, uint16_t tid, uint8_t function, uint16_t addr, uint16_t count)
+{
+    adu[0] = (uint8_t)(tid >> 8);
+    adu[1] = (uint8_t)tid;
+    adu[2] = 0;
+    adu[3] = 0;
+    adu[4] = 0;
+    adu[5] = 6;
+    adu[6] = HOST_SLAVE_UID;
+    adu[7] = function;
+    adu[8] = (uint8_t)(addr >> 8);
+    adu[9] = (uint8_t)addr;
+    adu[10] = (uint8_t)(count >> 8);
+    adu[11] = (uint8_t)count;
+    return 12;
+}
+
+uint16_t host_crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+size_t host_rtu_build_request(uint8_t *adu, uint8_t function, uint16_t addr, uint16_t count)
+{
+    adu[0] = HOST_SLAVE_UID;
+    adu[1] = function;
+    adu[2] = (uint8_t)(addr >> 8);
+    adu[3] = (uint8_t)addr;
+    adu[4] = (uint8_t)(count >> 8);
+    adu[5] = (uint8_t)count;
+    uint16_t crc = host_crc16(adu, 6);
+    adu[6] = (uint8_t)crc;
+    adu[7] = (uint8_t)(crc >> 8);
+    return 8;
+}
+
+void host_client_send(int fd, const uint8_t *adu, size_t length)
+{
+    HOST_CHECK(send(fd, adu, length, MSG_NOSIGNAL) == (ssize_t)length);
+}
+
+static bool host_wait_readable(int fd, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    return (poll(&pfd, 1, timeout_ms) > 0);
+}
+
+size_t host_client_recv(int fd, uint8_t *adu, size_t size, int timeout_ms)
+{
+    int type = 0;
+    socklen_t len = sizeof(type);
+    getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len);
+
+    if (type == SOCK_DGRAM) {
+        if (!host_wait_readable(fd, timeout_ms)) {
+            return 0;
+        }
+        ssize_t count = recv(fd, adu, size, 0);
+        return (count > 0) ? (size_t)count : 0;
+    }
+    // TCP: the MBAP header first, then the rest of the frame it announces
+    size_t have = 0;
+    size_t need = HOST_MBAP_SIZE;
+    while (have < need) {
+        if (!host_wait_readable(fd, timeout_ms)) {
+            return 0;
+        }
+        ssize_t count = recv(fd, &adu[have], need - have, 0);
+        if (count <= 0) {
+            return 0;
+        }
+        have += (size_t)count;
+        if ((need == HOST_MBAP_SIZE) && (have == HOST_MBAP_SIZE)) {
+            need = 6 + (((size_t)adu[4] << 8) | adu[5]);
+            HOST_CHECK(need <= size);
+        }
+    }
+    return have;
+}
+
+void host_rtu_send(int fd, const uint8_t *adu, size_t length)
+{
+    HOST_CHECK(write(fd, adu, length) == (ssize_t)length);
+}
+
+size_t host_rtu_recv(int fd, uint8_t *adu, size_t length, int timeout_ms)
+{
+    size_t have = 0;
+    while (have < length) {
+        if (!host_wait_readable(fd, timeout_ms)) {
+            break;
+        }
+        ssize_t count = read(fd, &adu[have], length - have);
+        if (count <= 0) {
+            break;
+        }
+        have += (size_t)count;
+    }
+    return have;
+}
+
+uint64_t host_client_read_holding(int fd, uint16_t tid, uint16_t addr, uint16_t count)
+{
+    uint8_t adu[260];
+    size_t length = host_build_request(adu, tid, 0x03, addr, count);
+    uint64_t start = host_now_ns();
+    host_client_send(fd, adu, length);
+    length = host_client_recv(fd, adu, sizeof(adu), 1000);
+    uint64_t elapsed = host_now_ns() - start;
+    HOST_CHECK(length == (size_t)(9 + count * 2));
+    HOST_CHECK((((uint16_t)adu[0] << 8) | adu[1]) == tid);
+    HOST_CHECK(adu[7] == 0x03);
+    for (uint16_t i = 0; i < count; i++) {
+        HOST_CHECK((((uint16_t)adu[9 + i * 2] << 8) | adu[10 + i * 2]) == (uint16_t)(addr + i));
+    }
+    return elapsed;
+}
@@ -0,0 +1,102 @@
+/*
+ * Host tests: checks, timing and the loopback Modbus client shared by the tests.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "esp_modbus_common.h"
+
+#define HOST_CHECK(cond) do {                                                       \
+        if (!(cond)) {                                                              \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+// Monotonic time in nanoseconds
+static inline uint64_t host_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+// Keeps the compiler from dropping the result of a measured call
+#define HOST_KEEP(value)    __asm__ volatile("" : : "g"(value) : "memory")
+
+// Percentile of the sorted samples, p in 0..100
+uint64_t host_percentile(uint64_t *samples, size_t count, unsigned p);
+
+/*
+ * Slave served by the stack of the host build.
+ * The areas are filled with a known pattern: holding register N holds N,
+ * input register N holds 0x8000 | N, coil N is set when N % 3 == 0.
+ */
+#define HOST_SLAVE_REGS     (1024)
+#define HOST_SLAVE_BITS     (2048)
+#define HOST_SLAVE_UID      (1)
+#define HOST_SLAVE_UART     (UART_NUM_1)
+
+extern uint16_t host_holding_regs[HOST_SLAVE_REGS];
+extern uint16_t host_input_regs[HOST_SLAVE_REGS];
+extern uint8_t host_coils[HOST_SLAVE_BITS / 8];
+
+// Starts the TCP or UDP slave on the loopback port, returns the controller handler
+void *host_slave_start_ip(mb_mode_type_t mode, uint16_t port);
+
+// Returns once the slave answers on the port
+void host_slave_wait_ready(mb_mode_type_t mode, uint16_t port);
+
+// Starts the TCP or UDP slave in a child process, returns when the port answers
+pid_t host_slave_fork_ip(mb_mode_type_t mode, uint16_t port);
+void host_slave_kill(pid_t pid);
+
+// Starts the RTU slave on HOST_SLAVE_UART served by the descriptor, returns the controller handler
+void *host_slave_start_rtu(int fd, uint32_t baudrate);
+
+// Opens a raw pty, one end for the client and the other one for the UART of the slave
+void host_pty_open(int *client_fd, int *uart_fd);
+
+// Waits until the RTU slave answers on the client end of the pty
+void host_slave_wait_ready_rtu(int client_fd);
+
+// Starts the RTU slave on a pty in a child process, returns the client end once the slave answers
+pid_t host_slave_fork_rtu(uint32_t baudrate, int *client_fd);
+
+/*
+ * Modbus TCP/UDP client of the tests, blocking sockets on the loopback.
+ */
+int host_client_connect(mb_mode_type_t mode, uint16_t port);
+
+// Builds a request ADU, returns its length
+size_t host_build_request(uint8_t *adu, uint16_t tid, uint8_t function, uint16_t addr, uint16_t count);
+
+// Sends the request ADU
+void host_client_send(int fd, const uint8_t *adu, size_t length);
+
+// Receives one response ADU, returns its length or 0 on timeout
+size_t host_client_recv(int fd, uint8_t *adu, size_t size, int timeout_ms);
+
+/*
+ * Modbus RTU client of the tests, on the client end of the pty.
+ */
+// CRC16 of Modbus computed bit by bit, 0 over a frame with its CRC
+uint16_t host_crc16(const uint8_t *data, size_t length);
+
+// Builds a request ADU addressed to HOST_SLAVE_UID with the CRC, returns its length
+size_t host_rtu_build_request(uint8_t *adu, uint8_t function, uint16_t addr, uint16_t count);
+
+// Sends the request ADU
+void host_rtu_send(int fd, const uint8_t *adu, size_t length);
+
+// Reads the response of the given length, returns the number of bytes read before the timeout
+size_t host_rtu_recv(int fd, uint8_t *adu, size_t length, int timeout_ms);
+
+// Reads holding registers and checks the pattern, returns the transaction time in ns
+uint64_t host_client_read_holding(int fd, uint16_t tid, uint16_t addr, uint16_t count);
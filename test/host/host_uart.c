@@ -0,0 +1,327 @@
+/*
+ * Host build: UART driver of ESP-IDF served over a file descriptor.
+ *
+ * A reader thread moves the bytes of the descriptor to the RX buffer and
+ * posts UART_DATA with timeout_flag set once the line has been idle for the
+ * configured RX timeout (in symbols of 11 bits), as the TOUT interrupt does.
+ * The writer side is a plain write(), uart_wait_tx_done() drains a tty.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+#include "esp_timer.h"
+
+#define HOST_UART_POLL_US       (20000)
+#define HOST_UART_TOUT_MIN_US   (200)
+#define HOST_UART_BITS_PER_SYM  (11)
+
+typedef struct {
+    int fd;
+    bool installed;
+    atomic_bool running;
+    pthread_t reader;
+    pthread_mutex_t lock;
+    pthread_cond_t rx_cond;
+    QueueHandle_t events;
+    uint8_t *rx_buf;
+    size_t rx_size;
+    size_t rx_len;
+    int baud_rate;
+    uint8_t tout_symbols;
+} host_uart_t;
+
+static host_uart_t s_uarts[UART_NUM_MAX] = {
+    [0 ... UART_NUM_MAX - 1] = { .fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER, .baud_rate = 115200, .tout_symbols = 3 }
+};
+
+static host_uart_t *host_uart_get(uart_port_t uart_num)
+{
+    return ((uart_num >= 0) && (uart_num < UART_NUM_MAX)) ? &s_uarts[uart_num] : NULL;
+}
+
+static int64_t host_uart_tout_us(const host_uart_t *uart)
+{
+    int64_t tout_us = (int64_t)uart->tout_symbols * HOST_UART_BITS_PER_SYM * 1000000LL / uart->baud_rate;
+    return (tout_us < HOST_UART_TOUT_MIN_US) ? HOST_UART_TOUT_MIN_US : tout_us;
+}
+
+static void host_uart_post(host_uart_t *uart, uart_event_type_t type, size_t size, bool timeout_flag)
+{
+    uart_event_t event = { .type = type, .size = size, .timeout_flag = timeout_flag };
+    if (uart->events) {
+        (void)xQueueSend(uart->events, &event, 0);
+    }
+}
+
+static void *host_uart_reader(void *arg)
+{
+    host_uart_t *uart = (host_uart_t *)arg;
+    int64_t last_rx_us = 0;
+    bool idle_pending = false;
+
+    while (atomic_load(&uart->running)) {
+        int64_t wait_us = HOST_UART_POLL_US;
+        if (idle_pending) {
+            wait_us = last_rx_us + host_uart_tout_us(uart) - esp_timer_get_time();
+            wait_us = (wait_us < 0) ? 0 : wait_us;
+        }
+        struct pollfd pfd = { .fd = uart->fd, .events = POLLIN };
+        struct timespec timeout = { .tv_sec = 0, .tv_nsec = (long)wait_us * 1000 };
+        int ready = ppoll(&pfd, 1, &timeout, NULL);
+        if ((ready > 0) && (pfd.revents & POLLIN)) {
+            pthread_mutex_lock(&uart->lock);
+            size_t space = uart->rx_size - uart->rx_len;
+            ssize_t count = space ? read(uart->fd, &uart->rx_buf[uart->rx_len], space) : 0;
+            if (count > 0) {
+                uart->rx_len += (size_t)count;
+                pthread_cond_broadcast(&uart->rx_cond);
+            }
+            bool full = (uart->rx_len == uart->rx_size);
+            size_t len = uart->rx_len;
+            pthread_mutex_unlock(&uart->lock);
+            if (count > 0) {
+                last_rx_us = esp_timer_get_time();
+                idle_pending = true;
+            }
+            if (full) {
+                host_uart_post(uart, UART_BUFFER_FULL, len, false);
+                idle_pending = false;
+            }
+        } else if ((ready > 0) && (pfd.revents & (POLLHUP | POLLERR))) {
+            // The other end is closed (pty master not opened yet or gone), retry later
+            struct timespec pause = { .tv_sec = 0, .tv_nsec = HOST_UART_POLL_US * 1000L };
+            nanosleep(&pause, NULL);
+        } else if (idle_pending && (esp_timer_get_time() - last_rx_us >= host_uart_tout_us(uart))) {
+            pthread_mutex_lock(&uart->lock);
+            size_t len = uart->rx_len;
+            pthread_mutex_unlock(&uart->lock);
+            host_uart_post(uart, UART_DATA, len, true);
+            idle_pending = false;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t host_uart_attach(uart_port_t uart_num, int fd)
+{
+    host_uart_t *uart = host_uart_get(uart_num);
+    if (!uart || uart->installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uart->fd = fd;
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    host_uart_t *uart = host_uart_get(uart_num);
+    if (!uart || !uart_config || (uart_config->baud_rate <= 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart->baud_rate = uart_config->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    (void)tx_buffer_size;
+    (void)intr_alloc_flags;
+    host_uart_t *uart = host_uart_get(uart_num);
+    if (!uart || (rx_buffer_size <= 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (uart->installed || (uart->fd < 0)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uart->rx_buf = malloc((size_t)rx_buffer_size);
+    if (!uart->rx_buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    uart->rx_size = (size_t)rx_buffer_size;
+    uart->rx_len = 0;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&uart->rx_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    uart->events = NULL;
+    if (uart_queue && queue_size) {
+        uart->events = xQueueCreate((UBaseType_t)queue_size, sizeof(uart_event_t));
+        *uart_queue = uart->events;
+    }
+    uart->installed = true;
+    atomic_store(&uart->running, true);
+    if (pthread_create(&uart->reader, NULL, host_uart_reader, uart) != 0) {
+        uart->installed = false;
+        free(uart->rx_buf);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+    host_uart_t *uart = host_uart_get(uart_num);
+    if (!uart || !uart->installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    atomic_store(&uart->running, false);
+    pthread_join(uart->reader, NULL);
+    if (uart->events) {
+        vQueueDelete(uart->events);
+        uart->events = NULL;
+    }
+    pthread_cond_destroy(&uart->rx_cond);
+    free(uart->rx_buf);
+    uart->rx_buf = NULL;
+    uart->installed = false;
+    return ESP_OK;
+}
+
+bool uart_is_driver_installed(uart_port_t uart_num)
+{
+    host_uart_t *uart = host_uart_get(uart_num);
+    return uart && uart->installed;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    host_uart_t *uart = host_uart_get(uart_num);
+    if (!uart || !uart->installed || !buf) {
+        return -1;
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += ticks_to_wait / 1000;
+    deadline.tv_nsec += (long)(ticks_to_wait % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&uart->lock);
+    while ((uart->rx_len < length) && (ticks_to_wait != 0)) {
+        if (pthread_cond_timedwait(&uart->rx_cond, &uart->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    size_t count = (uart->rx_len < length) ? uart->rx_len : length;
+    memcpy(buf, uart->rx_buf, count);
+    memmove(uart->rx_buf, &uart->rx_buf[count], uart->rx_len - count);
+    uart->rx_len -= count;
+    pthread_mutex_unlock(&uart->lock);
+    return (int)count;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    host_uart_t *uart = host_uart_get(uart_num);
+    if (!uart || !uart->installed || !src) {
+        return -1;
+    }
+    const uint8_t *data = (const uint8_t *)src;
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t count = write(uart->fd, &data[sent], size - sent);
+        if (count < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return -1;
+        }
+        sent += (size_t)count;
+    }
+    return (int)sent;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+    host_uart_t *uart = host_uart_get(uart_num);
+    if (!uart || !uart->installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pthread_mutex_lock(&uart->lock);
+    uart->rx_len = 0;
+    pthread_mutex_unlock(&uart->lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    host_uart_t *uart = host_uart_get(uart_num);
+    if (!uart || !uart->installed || !size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&uart->lock);
+    *size = uart->rx_len;
+    pthread_mutex_unlock(&uart->lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    host_uart_t *uart = host_uart_get(uart_num);
+    if (!uart || !uart->installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (isatty(uart->fd)) {
+        (void)tcdrain(uart->fd);
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_set_rx_timeout(uart_port_t uart_num, const uint8_t tout_thresh)
+{
+    host_uart_t *uart = host_uart_get(uart_num);
+    if (!uart) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart->tout_symbols = tout_thresh ? tout_thresh : 1;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_always_rx_timeout(uart_port_t uart_num, bool always_rx_timeout_en)
+{
+    (void)always_rx_timeout_en;
+    return host_uart_get(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_rx_full_threshold(uart_port_t uart_num, int threshold)
+{
+    (void)threshold;
+    return host_uart_get(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_mode(uart_port_t uart_num, uart_mode_t mode)
+{
+    (void)mode;
+    return host_uart_get(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+    (void)tx_io_num;
+    (void)rx_io_num;
+    (void)rts_io_num;
+    (void)cts_io_num;
+    return host_uart_get(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_enable_rx_intr(uart_port_t uart_num)
+{
+    return host_uart_get(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_disable_rx_intr(uart_port_t uart_num)
+{
+    return host_uart_get(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
@@ -0,0 +1,103 @@
+/*
+ * Host build: UART driver of ESP-IDF over a file descriptor (host_uart.c).
+ * A test attaches a pty or socket to a port with host_uart_attach(). The
+ * reader thread posts UART_DATA with timeout_flag once the line has been
+ * idle for the RX timeout, like the TOUT interrupt of the hardware.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef int uart_port_t;
+
+#define UART_NUM_0              (0)
+#define UART_NUM_1              (1)
+#define UART_NUM_2              (2)
+#define UART_NUM_MAX            (3)
+#define UART_PIN_NO_CHANGE      (-1)
+
+typedef enum {
+    UART_DATA,
+    UART_BREAK,
+    UART_BUFFER_FULL,
+    UART_FIFO_OVF,
+    UART_FRAME_ERR,
+    UART_PARITY_ERR,
+    UART_DATA_BREAK,
+    UART_PATTERN_DET,
+    UART_EVENT_MAX
+} uart_event_type_t;
+
+typedef struct {
+    uart_event_type_t type;
+    size_t size;
+    bool timeout_flag;
+} uart_event_t;
+
+typedef enum {
+    UART_PARITY_DISABLE = 0x0,
+    UART_PARITY_EVEN = 0x2,
+    UART_PARITY_ODD = 0x3
+} uart_parity_t;
+
+typedef enum {
+    UART_DATA_5_BITS,
+    UART_DATA_6_BITS,
+    UART_DATA_7_BITS,
+    UART_DATA_8_BITS
+} uart_word_length_t;
+
+typedef enum {
+    UART_STOP_BITS_1 = 0x1,
+    UART_STOP_BITS_1_5 = 0x2,
+    UART_STOP_BITS_2 = 0x3
+} uart_stop_bits_t;
+
+typedef enum {
+    UART_HW_FLOWCTRL_DISABLE = 0x0
+} uart_hw_flowcontrol_t;
+
+typedef enum {
+    UART_MODE_UART = 0x0,
+    UART_MODE_RS485_HALF_DUPLEX = 0x1
+} uart_mode_t;
+
+typedef enum {
+    UART_SCLK_DEFAULT = 0,
+    UART_SCLK_APB = 0
+} uart_sclk_t;
+
+typedef struct {
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+    uart_sclk_t source_clk;
+} uart_config_t;
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config);
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags);
+esp_err_t uart_driver_delete(uart_port_t uart_num);
+bool uart_is_driver_installed(uart_port_t uart_num);
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait);
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size);
+esp_err_t uart_flush_input(uart_port_t uart_num);
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size);
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait);
+esp_err_t uart_set_rx_timeout(uart_port_t uart_num, const uint8_t tout_thresh);
+esp_err_t uart_set_always_rx_timeout(uart_port_t uart_num, bool always_rx_timeout_en);
+esp_err_t uart_set_rx_full_threshold(uart_port_t uart_num, int threshold);
+esp_err_t uart_set_mode(uart_port_t uart_num, uart_mode_t mode);
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+esp_err_t uart_enable_rx_intr(uart_port_t uart_num);
+esp_err_t uart_disable_rx_intr(uart_port_t uart_num);
+
+// Host only: serve the port over the given descriptor (pty, socket or pipe)
+esp_err_t host_uart_attach(uart_port_t uart_num, int fd);
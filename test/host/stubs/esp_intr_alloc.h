@@ -0,0 +1,4 @@
+#pragma once
+
+#define ESP_INTR_FLAG_LOWMED    (1 << 1)
+#define ESP_INTR_FLAG_IRAM      (1 << 10)
@@ -0,0 +1,51 @@
+/*
+ * Host build: ESP-IDF logging to stderr. The level is fixed at build time by
+ * HOST_LOG_LEVEL (warnings by default) so the hot paths do not print.
+ */
+#pragma once
+
+#include <stdio.h>
+#include <inttypes.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+#ifndef HOST_LOG_LEVEL
+#define HOST_LOG_LEVEL              ESP_LOG_WARN
+#endif
+
+#ifndef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL             HOST_LOG_LEVEL
+#endif
+
+#define HOST_LOG(level, letter, tag, format, ...) do {                              \
+        if (HOST_LOG_LEVEL >= (level)) {                                            \
+            fprintf(stderr, letter " (%s) " format "\n", tag, ##__VA_ARGS__);       \
+        }                                                                           \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...)  HOST_LOG(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)  HOST_LOG(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)  HOST_LOG(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)  HOST_LOG(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)  HOST_LOG(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
+
+#define ESP_EARLY_LOGE(tag, format, ...)    ESP_LOGE(tag, format, ##__VA_ARGS__)
+#define ESP_EARLY_LOGW(tag, format, ...)    ESP_LOGW(tag, format, ##__VA_ARGS__)
+#define ESP_EARLY_LOGD(tag, format, ...)    ESP_LOGD(tag, format, ##__VA_ARGS__)
+#define ESP_EARLY_LOGV(tag, format, ...)    ESP_LOGV(tag, format, ##__VA_ARGS__)
+
+#define ESP_LOG_BUFFER_HEX_LEVEL(tag, buffer, len, level)   do { (void)(buffer); (void)(len); } while (0)
+#define ESP_LOG_BUFFER_HEX(tag, buffer, len)                do { (void)(buffer); (void)(len); } while (0)
+
+static inline void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    (void)level;
+}
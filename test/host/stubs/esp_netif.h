@@ -0,0 +1,6 @@
+/*
+ * Host build: the TCP slave binds to every interface, the netif is not used.
+ */
+#pragma once
+
+typedef struct esp_netif_obj esp_netif_t;
@@ -0,0 +1,71 @@
+/*
+ * Host build: FreeRTOS subset implemented on POSIX threads (host_rtos.c).
+ * Only what the Modbus stack and the tests use is provided.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <assert.h>
+#include "sdkconfig.h"
+#include "esp_bit_defs.h"
+#include "esp_heap_caps.h"
+#include "esp_intr_alloc.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t EventBits_t;
+
+typedef struct host_task *TaskHandle_t;
+typedef struct host_queue *QueueHandle_t;
+typedef struct host_queue *SemaphoreHandle_t;
+typedef struct host_event_group *EventGroupHandle_t;
+
+// Critical section of the port: recursive mutex (the ESP32 spinlock nests on one core)
+typedef struct {
+    pthread_mutex_t mutex;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP }
+#define portMUX_INITIALIZE(mux)         host_mux_init(mux)
+
+void host_mux_init(portMUX_TYPE *mux);
+void host_mux_enter(portMUX_TYPE *mux);
+void host_mux_exit(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)         host_mux_enter(mux)
+#define portEXIT_CRITICAL(mux)          host_mux_exit(mux)
+#define portENTER_CRITICAL_ISR(mux)     host_mux_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux)      host_mux_exit(mux)
+#define portENTER_CRITICAL_SAFE(mux)    host_mux_enter(mux)
+#define portEXIT_CRITICAL_SAFE(mux)     host_mux_exit(mux)
+
+#define pdTRUE                          1
+#define pdFALSE                         0
+#define pdPASS                          pdTRUE
+#define pdFAIL                          pdFALSE
+
+// One tick per millisecond
+#define configTICK_RATE_HZ              1000
+#define portTICK_PERIOD_MS              1
+#define portTICK_RATE_MS                portTICK_PERIOD_MS
+#define portMAX_DELAY                   ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)               ((TickType_t)(ms))
+
+#define portYIELD_FROM_ISR(...)         do { } while (0)
+#define configASSERT(x)                 do { if (!(x)) abort(); } while (0)
+#define tskNO_AFFINITY                  0x7FFFFFFF
+#define IRAM_ATTR
+
+BaseType_t xPortInIsrContext(void);
+
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
@@ -0,0 +1,16 @@
+/*
+ * Host build: FreeRTOS semaphores as queues of zero size items, as in FreeRTOS.
+ * Mutexes are not recursive and have no priority inheritance.
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount);
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t *pxHigherPriorityTaskWoken);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore);
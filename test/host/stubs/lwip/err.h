@@ -0,0 +1,9 @@
+#pragma once
+
+typedef signed char err_t;
+
+#define ERR_OK          0
+#define ERR_MEM         -1
+#define ERR_BUF         -2
+#define ERR_TIMEOUT     -3
+#define ERR_CLSD        -15
@@ -0,0 +1,27 @@
+/*
+ * Host build: lwIP socket API mapped to the POSIX sockets.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+
+#define inet_ntoa_r(addr, buf, buflen)      inet_ntop(AF_INET, &(addr), (buf), (buflen))
+#define inet6_ntoa_r(addr, buf, buflen)     inet_ntop(AF_INET6, &(addr), (buf), (buflen))
+
+// lwIP ignores unknown send flags (the port passes TCP_NODELAY), Linux would
+// read them as MSG_OOB. Only MSG_DONTWAIT is kept, SIGPIPE is never raised.
+static inline ssize_t host_lwip_send(int s, const void *data, size_t size, int flags)
+{
+    return send(s, data, size, (flags & MSG_DONTWAIT) | MSG_NOSIGNAL);
+}
+#define send(s, data, size, flags)          host_lwip_send((s), (data), (size), (flags))
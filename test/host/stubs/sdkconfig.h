@@ -0,0 +1,39 @@
+/*
+ * Host build: Kconfig options. The FreeModbus options come from config_fmb.h
+ * like in the firmware build, the rest are the Kconfig defaults. A test can
+ * override any option with a compile definition.
+ */
+#pragma once
+
+#include "config_fmb.h"
+
+#ifndef CONFIG_FMB_CONTROLLER_STACK_SIZE
+#define CONFIG_FMB_CONTROLLER_STACK_SIZE            4096
+#endif
+#ifndef CONFIG_FMB_MASTER_TIMEOUT_MS_RESPOND
+#define CONFIG_FMB_MASTER_TIMEOUT_MS_RESPOND        3000
+#endif
+#ifndef CONFIG_FMB_MASTER_DELAY_MS_CONVERT
+#define CONFIG_FMB_MASTER_DELAY_MS_CONVERT          200
+#endif
+#ifndef CONFIG_FMB_QUEUE_LENGTH
+#define CONFIG_FMB_QUEUE_LENGTH                     20
+#endif
+#ifndef CONFIG_FMB_SERIAL_BUF_SIZE
+#define CONFIG_FMB_SERIAL_BUF_SIZE                  256
+#endif
+#ifndef CONFIG_FMB_SERIAL_ASCII_BITS_PER_SYMB
+#define CONFIG_FMB_SERIAL_ASCII_BITS_PER_SYMB       8
+#endif
+#ifndef CONFIG_FMB_SERIAL_ASCII_TIMEOUT_RESPOND_MS
+#define CONFIG_FMB_SERIAL_ASCII_TIMEOUT_RESPOND_MS  1000
+#endif
+#ifndef CONFIG_FMB_CONTROLLER_SLAVE_ID_SUPPORT
+#define CONFIG_FMB_CONTROLLER_SLAVE_ID_SUPPORT      1
+#endif
+#ifndef CONFIG_FMB_CONTROLLER_SLAVE_ID
+#define CONFIG_FMB_CONTROLLER_SLAVE_ID              0x00112233
+#endif
+#ifndef CONFIG_FMB_CONTROLLER_SLAVE_ID_MAX_SIZE
+#define CONFIG_FMB_CONTROLLER_SLAVE_ID_MAX_SIZE     32
+#endif
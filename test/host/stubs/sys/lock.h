@@ -0,0 +1,14 @@
+/*
+ * Host build: newlib locks of ESP-IDF. The lock is created on first use,
+ * so a zero initialized _lock_t is ready, as on target.
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef intptr_t _lock_t;
+
+void _lock_init(_lock_t *plock);
+void _lock_close(_lock_t *plock);
+void _lock_acquire(_lock_t *plock);
+void _lock_release(_lock_t *plock);
@@ -0,0 +1,159 @@
+/*
+ * Bit range copy of the coil and discrete input callbacks (vMBUtilCopyBits).
+ *
+ * Checks the copy against a bit by bit reference for random lengths and
+ * offsets, without touching the destination bits outside the range. Then
+ * reads and writes coils and discrete inputs of a slave over TCP at unaligned
+ * addresses, the unused bits of the last response byte must be 0. The copy
+ * of 2000 coils is compared with the per-bit xMBUtilGetBits/xMBUtilSetBits
+ * loop used before.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "port.h"
+#include "mbutils.h"
+#include "host_test.h"
+
+#define TEST_PORT           (15030)
+#define TEST_RANDOM_COPIES  (200000)
+#define TEST_MAX_BITS       (2100)
+#define TEST_GUARD          (8)
+#define TEST_BENCH_BITS     (2000)
+#define TEST_BENCH_COPIES   (100000)
+
+static int test_get_bit(const uint8_t *buf, unsigned bit)
+{
+    return (buf[bit / 8] >> (bit % 8)) & 1;
+}
+
+static void test_set_bit(uint8_t *buf, unsigned bit, int value)
+{
+    buf[bit / 8] = (uint8_t)((buf[bit / 8] & ~(1 << (bit % 8))) | (value << (bit % 8)));
+}
+
+static void test_random_copies(void)
+{
+    static uint8_t src[TEST_MAX_BITS / 8 + 8];
+    static uint8_t dst[TEST_MAX_BITS / 8 + 8 + TEST_GUARD];
+    static uint8_t ref[sizeof(dst)];
+    srand(1);
+    for (int i = 0; i < TEST_RANDOM_COPIES; i++) {
+        unsigned bits = 1 + (unsigned)rand() % TEST_MAX_BITS;
+        unsigned src_offset = (unsigned)rand() % 40;
+        unsigned dst_offset = (unsigned)rand() % 40;
+        for (size_t b = 0; b < sizeof(src); b++) {
+            src[b] = (uint8_t)rand();
+        }
+        for (size_t b = 0; b < sizeof(dst); b++) {
+            dst[b] = ref[b] = (uint8_t)rand();
+        }
+        for (unsigned b = 0; b < bits; b++) {
+            test_set_bit(ref, dst_offset + b, test_get_bit(src, src_offset + b));
+        }
+        vMBUtilCopyBits(dst, (USHORT)dst_offset, src, (USHORT)src_offset, (USHORT)bits);
+        // The whole buffer is compared, the bytes after the range included
+        if (memcmp(dst, ref, sizeof(dst)) != 0) {
+            fprintf(stderr, "copy of %u bits from %u to %u differs\n", bits, src_offset, dst_offset);
+            exit(1);
+        }
+    }
+}
+
+// Reads count bits with FC01 or FC02 and checks them against the coil pattern of the slave
+static void test_read_bits(int fd, uint8_t function, uint16_t addr, uint16_t count)
+{
+    uint8_t adu[260];
+    host_client_send(fd, adu, host_build_request(adu, addr, function, addr, count));
+    size_t bytes = (count + 7) / 8;
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 9 + bytes);
+    HOST_CHECK((adu[7] == function) && (adu[8] == bytes));
+    for (unsigned i = 0; i < count; i++) {
+        HOST_CHECK(test_get_bit(&adu[9], i) == (((addr + i) % 3) == 0));
+    }
+    for (unsigned i = count; i < bytes * 8; i++) {
+        HOST_CHECK(test_get_bit(&adu[9], i) == 0);
+    }
+}
+
+static void test_write_coils(int fd, uint16_t addr, uint16_t count, const uint8_t *values)
+{
+    uint8_t adu[260];
+    size_t bytes = (count + 7) / 8;
+    size_t length = host_build_request(adu, addr, 0x0F, addr, count);
+    adu[5] = (uint8_t)(7 + bytes);
+    adu[length++] = (uint8_t)bytes;
+    memcpy(&adu[length], values, bytes);
+    host_client_send(fd, adu, length + bytes);
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+    HOST_CHECK((adu[7] == 0x0F) && (((adu[10] << 8) | adu[11]) == count));
+}
+
+static void test_slave_bits(void)
+{
+    pid_t slave = host_slave_fork_ip(MB_MODE_TCP, TEST_PORT);
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+    // The handlers accept less than 0x07D0 bits, as in FreeModbus
+    const uint16_t counts[] = { 1, 7, 8, 9, 31, 33, 100, 1999 };
+    for (uint16_t addr = 0; addr < 40; addr += 3) {
+        for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+            test_read_bits(fd, 0x01, addr, counts[i]);
+            test_read_bits(fd, 0x02, addr, counts[i]);
+        }
+    }
+
+    // FC15 at an unaligned address, the coils around the range keep the pattern
+    const uint16_t addr = 1003, count = 45;
+    uint8_t values[8];
+    for (unsigned i = 0; i < count; i++) {
+        test_set_bit(values, i, (i % 3) != 0);
+    }
+    test_write_coils(fd, addr, count, values);
+    uint8_t adu[260];
+    host_client_send(fd, adu, host_build_request(adu, 1, 0x01, addr - 10, count + 20));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 9 + (count + 20 + 7) / 8);
+    for (unsigned i = 0; i < count + 20; i++) {
+        unsigned coil = addr - 10 + i;
+        int expected = ((coil >= addr) && (coil < addr + count)) ? ((coil - addr) % 3) != 0 : (coil % 3) == 0;
+        HOST_CHECK(test_get_bit(&adu[9], i) == expected);
+    }
+    close(fd);
+    host_slave_kill(slave);
+}
+
+static void bench(void)
+{
+    static uint8_t src[TEST_BENCH_BITS / 8 + 8];
+    static uint8_t dst[TEST_BENCH_BITS / 8 + 8];
+    for (size_t i = 0; i < sizeof(src); i++) {
+        src[i] = (uint8_t)rand();
+    }
+    printf("%d coils from an unaligned bit offset, ns per copy:\n", TEST_BENCH_BITS);
+    uint64_t start = host_now_ns();
+    for (int i = 0; i < TEST_BENCH_COPIES; i++) {
+        vMBUtilCopyBits(dst, 0, src, (USHORT)(1 + (i & 6)), TEST_BENCH_BITS);
+        HOST_KEEP(dst);
+    }
+    double copy = (double)(host_now_ns() - start) / TEST_BENCH_COPIES;
+
+    start = host_now_ns();
+    for (int i = 0; i < TEST_BENCH_COPIES / 10; i++) {
+        for (USHORT bit = 0; bit < TEST_BENCH_BITS; bit++) {
+            xMBUtilSetBits(dst, bit, 1, xMBUtilGetBits(src, (USHORT)(1 + (i & 6) + bit), 1));
+        }
+        HOST_KEEP(dst);
+    }
+    double per_bit = (double)(host_now_ns() - start) / (TEST_BENCH_COPIES / 10);
+    printf("  vMBUtilCopyBits %8.0f\n  per-bit loop    %8.0f\n", copy, per_bit);
+}
+
+int main(void)
+{
+    test_random_copies();
+    test_slave_bits();
+    bench();
+    printf("OK\n");
+    return 0;
+}
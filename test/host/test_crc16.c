@@ -0,0 +1,111 @@
+/*
+ * CRC16 of the RTU frames (mbcrc.c), built for each table variant.
+ *
+ * Checks usMBCRC16(), the running form over random block splits and the byte
+ * update against the bitwise CRC of the tests, then exchanges a few requests
+ * with the RTU slave of the same stack over a pty. The throughput of the
+ * variant is reported by frame length, the variants are compared across the
+ * test_crc16* executables.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "port.h"
+#include "mbconfig.h"
+#include "mbcrc.h"
+#include "host_test.h"
+
+#define TEST_FRAMES         (20000)
+#define TEST_MAX_LENGTH     (256)
+#define TEST_BAUDRATE       (115200)
+#define TEST_BENCH_BYTES    (64 * 1024 * 1024)
+
+static void test_values(void)
+{
+    static UCHAR frame[TEST_MAX_LENGTH + 2];
+    srand(1);
+    for (int i = 0; i < TEST_FRAMES; i++) {
+        USHORT length = (USHORT)(rand() % (TEST_MAX_LENGTH + 1));
+        for (USHORT b = 0; b < length; b++) {
+            frame[b] = (UCHAR)rand();
+        }
+        USHORT crc = usMBCRC16(frame, length);
+        HOST_CHECK(crc == host_crc16(frame, length));
+
+        USHORT running = MB_CRC16_INIT;
+        for (USHORT b = 0; b < length; b++) {
+            running = usMBCRC16UpdateByte(running, frame[b]);
+        }
+        HOST_CHECK(running == crc);
+
+        // Up to 4 blocks of any length, empty ones included
+        running = MB_CRC16_INIT;
+        USHORT done = 0;
+        for (int block = 0; block < 3; block++) {
+            USHORT size = (USHORT)(rand() % (length - done + 1));
+            running = usMBCRC16Update(running, &frame[done], size);
+            done += size;
+        }
+        running = usMBCRC16Update(running, &frame[done], length - done);
+        HOST_CHECK(running == crc);
+
+        // The frame with its CRC appended, low byte first, checks to 0
+        frame[length] = (UCHAR)(crc & 0xFF);
+        frame[length + 1] = (UCHAR)(crc >> 8);
+        HOST_CHECK(usMBCRC16(frame, length + 2) == 0);
+    }
+}
+
+static void test_rtu_slave(void)
+{
+    int fd = -1;
+    pid_t slave = host_slave_fork_rtu(TEST_BAUDRATE, &fd);
+    for (uint16_t i = 0; i < 20; i++) {
+        uint8_t adu[260];
+        uint16_t count = (uint16_t)(1 + i * 6);
+        host_rtu_send(fd, adu, host_rtu_build_request(adu, 0x04, i, count));
+        size_t length = 5 + count * 2;
+        HOST_CHECK(host_rtu_recv(fd, adu, length, 1000) == length);
+        HOST_CHECK(host_crc16(adu, length) == 0);
+        HOST_CHECK(((adu[3] << 8) | adu[4]) == (0x8000 | i));
+    }
+    close(fd);
+    host_slave_kill(slave);
+}
+
+static void bench(void)
+{
+    static UCHAR data[TEST_MAX_LENGTH];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (UCHAR)rand();
+    }
+    printf("CRC16 with MB_CRC16_SLICE %d, MB/s:\n", MB_CRC16_SLICE);
+    const USHORT lengths[] = { 8, 64, 256 };
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        int frames = TEST_BENCH_BYTES / lengths[i];
+        uint64_t start = host_now_ns();
+        for (int f = 0; f < frames; f++) {
+            USHORT crc = usMBCRC16(data, lengths[i]);
+            HOST_KEEP(crc);
+        }
+        double table = (double)TEST_BENCH_BYTES * 1000 / (double)(host_now_ns() - start);
+
+        start = host_now_ns();
+        for (int f = 0; f < frames / 16; f++) {
+            uint16_t crc = host_crc16(data, lengths[i]);
+            HOST_KEEP(crc);
+        }
+        double bitwise = (double)TEST_BENCH_BYTES / 16 * 1000 / (double)(host_now_ns() - start);
+        printf("  frames of %3u bytes: usMBCRC16 %7.1f, bitwise %6.1f\n", lengths[i], table, bitwise);
+    }
+}
+
+int main(void)
+{
+    test_values();
+    test_rtu_slave();
+    bench();
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Lookup index of the slave area descriptors (white box, includes esp_modbus_slave.c).
+ *
+ * Builds dense layouts, which get the page index, and sparse layouts over the
+ * whole address space, which are searched by the sorted ranges only. Every
+ * address and several request lengths are looked up before and after the
+ * freeze and compared with a linear scan of the descriptor list. Then measures
+ * the lookups per second of the scan, the binary search and the page index by
+ * the number of descriptors.
+ */
+
+#include "esp_modbus_slave.c"
+
+#include "host_test.h"
+
+#define TEST_LAYOUTS        (6)
+#define TEST_BENCH_ADDRS    (4096)
+#define TEST_BENCH_LOOKUPS  (1000000)
+
+static const size_t test_lengths[] = { 1, 2, 7, 64, 125 };
+
+static mb_slave_interface_t test_iface;
+static uint16_t test_data[MB_INST_MAX_SIZE / 2];
+
+// The descriptor list scan the controller had before the index
+static __attribute__((noinline)) mb_descr_entry_t *test_linear_find(mb_slave_options_t *opts, uint16_t addr, size_t regs)
+{
+    mb_descr_entry_t *it;
+    LIST_FOREACH(it, &opts->mbs_area_descriptors[MB_PARAM_HOLDING], entries) {
+        if ((addr >= it->start_offset) && ((addr + regs) <= mbc_slave_descr_end(it))) {
+            return it;
+        }
+    }
+    return NULL;
+}
+
+static __attribute__((noinline)) mb_descr_entry_t *test_index_find(mb_slave_options_t *opts, uint16_t addr, size_t regs)
+{
+    return mbc_slave_find_reg_descriptor(opts, MB_PARAM_HOLDING, addr, regs);
+}
+
+static void test_add_area(uint16_t start, uint16_t regs)
+{
+    mb_register_area_descriptor_t area = { 0 };
+    area.type = MB_PARAM_HOLDING;
+    area.start_offset = start;
+    area.address = test_data;
+    area.size = (size_t)regs << 1;
+    HOST_CHECK(mbc_slave_set_descriptor_hdl(&test_iface, area) == ESP_OK);
+}
+
+// Adds the areas from the base with random lengths and gaps, returns the number of areas
+// and the end of the last one
+static int test_add_layout(uint32_t base, int areas, unsigned max_regs, unsigned max_gap, uint32_t *end)
+{
+    uint32_t addr = base;
+    int added = 0;
+    for (; added < areas; added++) {
+        uint32_t regs = 1 + (unsigned)rand() % max_regs;
+        if ((addr + regs) > 0x10000) {
+            break;
+        }
+        test_add_area((uint16_t)addr, (uint16_t)regs);
+        *end = addr + regs;
+        addr += regs + (unsigned)rand() % (max_gap + 1);
+    }
+    return added;
+}
+
+// Checks the lookup of every address and request length against the scan
+static void test_compare(mb_slave_options_t *opts)
+{
+    for (uint32_t addr = 0; addr < 0x10000; addr++) {
+        for (size_t i = 0; i < sizeof(test_lengths) / sizeof(test_lengths[0]); i++) {
+            mb_descr_entry_t *expected = test_linear_find(opts, (uint16_t)addr, test_lengths[i]);
+            if (test_index_find(opts, (uint16_t)addr, test_lengths[i]) != expected) {
+                fprintf(stderr, "lookup of %zu registers at %u differs (frozen %d)\n",
+                        test_lengths[i], addr, (int)opts->mbs_descr_frozen);
+                exit(1);
+            }
+        }
+    }
+    HOST_CHECK(test_index_find(opts, 0, 0) == NULL);
+}
+
+// Returns true if the layout got the page index
+static bool test_layout(uint32_t base, int areas, unsigned max_regs, unsigned max_gap)
+{
+    mb_slave_options_t *opts = &test_iface.opts;
+    uint32_t end = 0;
+    int added = test_add_layout(base, areas, max_regs, max_gap, &end);
+    HOST_CHECK(added > 0);
+    bool paged = (((end - base + 63) >> MB_DESCR_PAGE_SHIFT) <= MB_DESCR_PAGES_MAX);
+    test_compare(opts);
+
+    HOST_CHECK(mbc_slave_freeze_descriptors(opts) == ESP_OK);
+    const mb_descr_index_t *index = &opts->mbs_descr_index[MB_PARAM_HOLDING];
+    HOST_CHECK(index->count == added);
+    HOST_CHECK((index->pages != NULL) == paged);
+    test_compare(opts);
+
+    // The areas can not be added once frozen
+    mb_register_area_descriptor_t area = { .type = MB_PARAM_HOLDING, .start_offset = 0xFFFF,
+                                           .address = test_data, .size = 2 };
+    HOST_CHECK(mbc_slave_set_descriptor_hdl(&test_iface, area) == ESP_ERR_INVALID_STATE);
+    mbc_slave_free_descriptors(opts);
+    return paged;
+}
+
+static void test_layouts(void)
+{
+    int paged = 0;
+    srand(1);
+    for (int i = 0; i < TEST_LAYOUTS; i++) {
+        // Small areas close to each other, within the page limit
+        HOST_CHECK(test_layout((unsigned)rand() % 0x8000, 1 + rand() % 60, 40, 16));
+        // Areas spread over the whole address space
+        paged += test_layout((unsigned)rand() % 64, 20 + rand() % 60, 200, 2000);
+    }
+    HOST_CHECK(paged < TEST_LAYOUTS);
+
+    // The first and the last register of the address space
+    mb_slave_options_t *opts = &test_iface.opts;
+    test_add_area(0, 1);
+    test_add_area(100, 10);
+    test_add_area(0xFFF0, 16);
+    HOST_CHECK(mbc_slave_freeze_descriptors(opts) == ESP_OK);
+    test_compare(opts);
+    HOST_CHECK(test_index_find(opts, 0xFFFF, 1) != NULL);
+    HOST_CHECK(test_index_find(opts, 0xFFF0, 16) != NULL);
+    HOST_CHECK(test_index_find(opts, 0xFFFF, 2) == NULL);
+    mbc_slave_free_descriptors(opts);
+}
+
+static double bench_lookup(mb_descr_entry_t *(*find)(mb_slave_options_t *, uint16_t, size_t),
+                           const uint16_t *addrs)
+{
+    mb_slave_options_t *opts = &test_iface.opts;
+    uint64_t start = host_now_ns();
+    for (int i = 0; i < TEST_BENCH_LOOKUPS; i++) {
+        mb_descr_entry_t *descr = find(opts, addrs[i % TEST_BENCH_ADDRS], 1);
+        HOST_KEEP(descr);
+    }
+    return (double)TEST_BENCH_LOOKUPS * 1e9 / (double)(host_now_ns() - start);
+}
+
+static void bench(void)
+{
+    static const int counts[] = { 10, 30, 100, 300, 1000 };
+    static uint16_t addrs[TEST_BENCH_ADDRS];
+    mb_slave_options_t *opts = &test_iface.opts;
+    mb_descr_index_t *index = &opts->mbs_descr_index[MB_PARAM_HOLDING];
+
+    printf("descriptor lookup of one register, Mlookups/s:\n");
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        // Areas of 4 registers with gaps of 2, the 1000 areas span 94 pages
+        for (int i = 0; i < counts[c]; i++) {
+            test_add_area((uint16_t)(i * 6), 4);
+        }
+        for (int i = 0; i < TEST_BENCH_ADDRS; i++) {
+            addrs[i] = (uint16_t)((rand() % counts[c]) * 6 + rand() % 4);
+        }
+        double scan = bench_lookup(test_linear_find, addrs);
+        HOST_CHECK(mbc_slave_freeze_descriptors(opts) == ESP_OK);
+        HOST_CHECK(index->pages != NULL);
+        double paged = bench_lookup(test_index_find, addrs);
+        // The same ranges searched without the page index
+        free(index->pages);
+        index->pages = NULL;
+        double sorted = bench_lookup(test_index_find, addrs);
+        printf("  %4d areas: scan %7.1f, binary search %7.1f, page index %7.1f\n",
+               counts[c], scan / 1e6, sorted / 1e6, paged / 1e6);
+        mbc_slave_free_descriptors(opts);
+    }
+}
+
+int main(void)
+{
+    test_iface.opts.port_type = MB_PORT_COUNT;
+    mbc_slave_init_iface(&test_iface);
+    test_layouts();
+    bench();
+    printf("OK\n");
+    return 0;
+}
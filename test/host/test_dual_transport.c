@@ -0,0 +1,196 @@
+/*
+ * RTU and TCP slaves served at the same time by one process.
+ *
+ * Each transport has its own controller with its own areas: the holding
+ * registers of the RTU slave hold N, the ones of the TCP slave 0xA000 | N.
+ * Requests of both clients run concurrently and every response must carry
+ * the areas of its own transport. The write notifications go to the
+ * controller of the transport which received the write only. Destroying the
+ * TCP controller leaves the RTU slave serving.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_modbus_slave.h"
+#include "host_test.h"
+
+#define TEST_PORT           (15040)
+#define TEST_BAUDRATE       (115200)
+#define TEST_REGS           (64)
+#define TEST_READ_REGS      (16)
+#define TEST_CONCURRENT_MS  (1000)
+
+static uint16_t test_tcp_holding[TEST_REGS];
+static int test_netif_dummy;
+static volatile bool test_stop;
+
+typedef struct {
+    int fd;
+    unsigned served;
+} test_client_t;
+
+static void *test_tcp_start(void)
+{
+    void *handler = NULL;
+    for (int i = 0; i < TEST_REGS; i++) {
+        test_tcp_holding[i] = (uint16_t)(0xA000 | i);
+    }
+    ESP_ERROR_CHECK(mbc_slave_init_tcp(&handler));
+
+    mb_communication_info_t comm_info = { 0 };
+    comm_info.ip_mode = MB_MODE_TCP;
+    comm_info.slave_uid = HOST_SLAVE_UID;
+    comm_info.ip_port = TEST_PORT;
+    comm_info.ip_addr_type = MB_IPV4;
+    comm_info.ip_addr = NULL;
+    comm_info.ip_netif_ptr = &test_netif_dummy;
+    ESP_ERROR_CHECK(mbc_slave_setup_hdl(handler, &comm_info));
+
+    mb_register_area_descriptor_t area = { 0 };
+    area.type = MB_PARAM_HOLDING;
+    area.start_offset = 0;
+    area.address = test_tcp_holding;
+    area.size = sizeof(test_tcp_holding);
+    ESP_ERROR_CHECK(mbc_slave_set_descriptor_hdl(handler, area));
+    ESP_ERROR_CHECK(mbc_slave_start_hdl(handler));
+    return handler;
+}
+
+static bool test_rtu_read(int fd, uint16_t addr)
+{
+    uint8_t adu[64];
+    host_rtu_send(fd, adu, host_rtu_build_request(adu, 0x03, addr, TEST_READ_REGS));
+    size_t length = 5 + TEST_READ_REGS * 2;
+    if ((host_rtu_recv(fd, adu, length, 1000) != length) || (host_crc16(adu, length) != 0)) {
+        return false;
+    }
+    for (uint16_t i = 0; i < TEST_READ_REGS; i++) {
+        if (((adu[3 + i * 2] << 8) | adu[4 + i * 2]) != (uint16_t)(addr + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool test_tcp_read(int fd, uint16_t tid, uint16_t addr)
+{
+    uint8_t adu[64];
+    host_client_send(fd, adu, host_build_request(adu, tid, 0x03, addr, TEST_READ_REGS));
+    if (host_client_recv(fd, adu, sizeof(adu), 1000) != (size_t)(9 + TEST_READ_REGS * 2)) {
+        return false;
+    }
+    for (uint16_t i = 0; i < TEST_READ_REGS; i++) {
+        if (((adu[9 + i * 2] << 8) | adu[10 + i * 2]) != (uint16_t)(0xA000 | (addr + i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void *test_rtu_client(void *arg)
+{
+    test_client_t *client = (test_client_t *)arg;
+    while (!test_stop) {
+        HOST_CHECK(test_rtu_read(client->fd, (uint16_t)(client->served % 32)));
+        client->served++;
+    }
+    return NULL;
+}
+
+static void *test_tcp_client(void *arg)
+{
+    test_client_t *client = (test_client_t *)arg;
+    while (!test_stop) {
+        HOST_CHECK(test_tcp_read(client->fd, (uint16_t)client->served, (uint16_t)(client->served % 32)));
+        client->served++;
+    }
+    return NULL;
+}
+
+static void test_concurrent(int rtu_fd, int tcp_fd)
+{
+    test_client_t rtu = { .fd = rtu_fd };
+    test_client_t tcp = { .fd = tcp_fd };
+    pthread_t threads[2];
+    test_stop = false;
+    HOST_CHECK(pthread_create(&threads[0], NULL, test_rtu_client, &rtu) == 0);
+    HOST_CHECK(pthread_create(&threads[1], NULL, test_tcp_client, &tcp) == 0);
+    usleep(TEST_CONCURRENT_MS * 1000);
+    test_stop = true;
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+    HOST_CHECK((rtu.served > 0) && (tcp.served > 0));
+    printf("%d ms of concurrent requests: %u RTU and %u TCP transactions\n",
+           TEST_CONCURRENT_MS, rtu.served, tcp.served);
+}
+
+// Writes one holding register over each transport, the notification goes to its controller only
+static void test_notifications(void *rtu_handler, void *tcp_handler, int rtu_fd, int tcp_fd)
+{
+    mb_param_info_t info;
+    size_t count = 0;
+    // Drop the read notifications of the previous requests
+    while (mbc_slave_get_param_info_batch_hdl(rtu_handler, &info, 1, &count, 0) == ESP_OK) {
+    }
+    while (mbc_slave_get_param_info_batch_hdl(tcp_handler, &info, 1, &count, 0) == ESP_OK) {
+    }
+
+    uint8_t adu[64];
+    size_t length = host_build_request(adu, 1, 0x06, 5, 0x1234);
+    host_client_send(tcp_fd, adu, length);
+    HOST_CHECK(host_client_recv(tcp_fd, adu, sizeof(adu), 1000) == 12);
+    HOST_CHECK(test_tcp_holding[5] == 0x1234);
+    HOST_CHECK(mbc_slave_get_param_info_hdl(tcp_handler, &info, 100) == ESP_OK);
+    HOST_CHECK((info.type == MB_EVENT_HOLDING_REG_WR) && (info.mb_offset == 5));
+    HOST_CHECK(info.address == (uint8_t *)&test_tcp_holding[5]);
+    HOST_CHECK(mbc_slave_get_param_info_batch_hdl(rtu_handler, &info, 1, &count, 50) == ESP_ERR_TIMEOUT);
+
+    length = host_rtu_build_request(adu, 0x06, 7, 0x4321);
+    host_rtu_send(rtu_fd, adu, length);
+    HOST_CHECK(host_rtu_recv(rtu_fd, adu, 8, 1000) == 8);
+    HOST_CHECK(host_holding_regs[7] == 0x4321);
+    HOST_CHECK(mbc_slave_get_param_info_hdl(rtu_handler, &info, 100) == ESP_OK);
+    HOST_CHECK((info.type == MB_EVENT_HOLDING_REG_WR) && (info.mb_offset == 7));
+    HOST_CHECK(info.address == (uint8_t *)&host_holding_regs[7]);
+    HOST_CHECK(mbc_slave_get_param_info_batch_hdl(tcp_handler, &info, 1, &count, 50) == ESP_ERR_TIMEOUT);
+    host_holding_regs[7] = 7;
+}
+
+int main(void)
+{
+    int rtu_fd = -1;
+    int uart_fd = -1;
+    host_pty_open(&rtu_fd, &uart_fd);
+    void *rtu_handler = host_slave_start_rtu(uart_fd, TEST_BAUDRATE);
+    host_slave_wait_ready_rtu(rtu_fd);
+    void *tcp_handler = test_tcp_start();
+    HOST_CHECK(rtu_handler != tcp_handler);
+
+    int tcp_fd = -1;
+    for (int retry = 0; (tcp_fd < 0) && (retry < 500); retry++) {
+        tcp_fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+        if (tcp_fd < 0) {
+            usleep(10000);
+        }
+    }
+    HOST_CHECK(tcp_fd >= 0);
+
+    // Each transport answers from its own areas
+    HOST_CHECK(test_rtu_read(rtu_fd, 0));
+    HOST_CHECK(test_tcp_read(tcp_fd, 1, 0));
+
+    test_concurrent(rtu_fd, tcp_fd);
+    test_notifications(rtu_handler, tcp_handler, rtu_fd, tcp_fd);
+
+    // The RTU slave keeps serving without the TCP controller
+    close(tcp_fd);
+    HOST_CHECK(mbc_slave_destroy_hdl(tcp_handler) == ESP_OK);
+    HOST_CHECK(test_rtu_read(rtu_fd, 8));
+    close(rtu_fd);
+    printf("dual transport: ok\n");
+    return 0;
+}
@@ -0,0 +1,266 @@
+/*
+ * Event task of the ModbusTcpSlave library under a master write flood.
+ *
+ * Starts the library slave on the loopback and checks the accesses given
+ * to the callbacks: single writes carry their old and new contents, the
+ * coils as a bitmap. The writes queued while a callback is busy are taken
+ * in full batches. Then a client writes the block 4000 back to back with
+ * requests in flight: the old contents of each write access are the new
+ * contents of the previous one, the last access carries the last written
+ * values and every master write is counted in the event statistics, in
+ * the hits of a merged event or in the dropped notifications. The request
+ * rate and the processing time of the task are reported. Last, stop and
+ * destroy are called while a callback is busy and from a callback: stop
+ * waits for the task and the instance is not freed before it exits.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "modbus_tcp_slave.c"
+#include "host_test.h"
+
+#define TEST_PORT           (15033)
+#define TEST_FLOOD_WRITES   (20000)
+#define TEST_IN_FLIGHT      (8)
+#define TEST_REGS           (REG_4000_SIZE)
+#define TEST_DRAIN_MS       (2000)
+
+static volatile uint32_t test_write_hits;       // Hits of the write accesses to the block 4000
+static volatile uint32_t test_write_accesses;
+static volatile uint32_t test_batches;
+static volatile uint32_t test_coil_writes;
+static uint16_t test_last[TEST_REGS];           // New contents of the last write access to 4000
+static volatile uint32_t test_single_value;
+static volatile bool test_stall;                // The next batch waits for the test
+static volatile bool test_stalled;
+static volatile uint32_t test_unit_writes;      // Write accesses to the block 9000
+static modbus_tcp_handle_t test_handle;
+static volatile bool test_stop_in_cb;           // The next batch calls stop and destroy
+static volatile esp_err_t test_cb_stop;
+static volatile esp_err_t test_cb_destroy;
+static volatile bool test_stop_done;
+static volatile esp_err_t test_stop_result;
+
+static void test_on_batch(const modbus_tcp_access_t *accesses, size_t count)
+{
+    HOST_CHECK(count && count <= MB_EVENT_BATCH_MAX);
+    if (test_stop_in_cb) {
+        test_cb_stop = modbus_tcp_slave_stop(test_handle);
+        test_cb_destroy = modbus_tcp_slave_destroy(test_handle);
+        test_stop_in_cb = false;
+    }
+    if (test_stall) {
+        test_stalled = true;
+        while (test_stall) {
+            usleep(1000);
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        const modbus_tcp_access_t *access = &accesses[i];
+        if (!access->write) {
+            HOST_CHECK(access->old_values == access->new_values);
+            continue;
+        }
+        if (access->reg_type == MODBUS_REG_COIL) {
+            HOST_CHECK(access->addr == 3 && access->count == 1);
+            HOST_CHECK((access->old_values[0] & 1) == 0 && (access->new_values[0] & 1) == 1);
+            test_coil_writes++;
+        } else if ((access->reg_type == MODBUS_REG_HOLDING) && (access->addr == REG_4000_START)) {
+            HOST_CHECK(access->count == TEST_REGS);
+            HOST_CHECK(memcmp(access->old_values, test_last, sizeof(test_last)) == 0);
+            memcpy(test_last, access->new_values, sizeof(test_last));
+            test_write_hits += access->hits;
+            test_write_accesses++;
+        } else if ((access->reg_type == MODBUS_REG_HOLDING) && (access->addr >= REG_UNITSPECS_START)) {
+            HOST_CHECK(access->count == 1 && access->new_values[0] == access->addr);
+            test_unit_writes++;
+        }
+    }
+    test_batches++;
+}
+
+static void test_on_write(uint16_t addr, modbus_reg_type_t type, uint32_t value)
+{
+    if ((type == MODBUS_REG_HOLDING) && (addr == REG_4000_START + 3)) {
+        test_single_value = value;
+    }
+}
+
+static size_t test_build_write(uint8_t *adu, uint16_t tid, uint16_t first)
+{
+    size_t length = host_build_request(adu, tid, 0x10, REG_4000_START, TEST_REGS);
+    adu[5] = (uint8_t)(7 + TEST_REGS * 2);
+    adu[length++] = (uint8_t)(TEST_REGS * 2);
+    for (uint16_t r = 0; r < TEST_REGS; r++) {
+        adu[length++] = (uint8_t)((first + r) >> 8);
+        adu[length++] = (uint8_t)(first + r);
+    }
+    return length;
+}
+
+// Waits until the condition holds, the event task runs on its own
+#define TEST_WAIT(cond) do {                                                        \
+        for (int ms = 0; !(cond) && (ms < TEST_DRAIN_MS); ms++) {                   \
+            usleep(1000);                                                           \
+        }                                                                           \
+        HOST_CHECK(cond);                                                           \
+    } while (0)
+
+static void test_single_writes(int fd)
+{
+    uint8_t adu[260];
+    // FC06: the access of one register, the old contents are the previous ones
+    uint16_t old = reg4000[3];
+    host_client_send(fd, adu, host_build_request(adu, 1, 0x06, REG_4000_START + 3, 0x1234));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+    TEST_WAIT(test_single_value == 0x1234);
+    HOST_CHECK(old != 0x1234);
+
+    // FC05 of the coil 3, 0 in the initial pattern 0x55
+    HOST_CHECK((coil_reg_params.coils_port0 & 0x08) == 0);
+    host_client_send(fd, adu, host_build_request(adu, 2, 0x05, 3, 0xFF00));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+    TEST_WAIT(test_coil_writes == 1);
+}
+
+// Writes queued while a callback is busy are taken together, MB_EVENT_BATCH_MAX at a time
+static void test_slow_callback(modbus_tcp_handle_t handle, int fd)
+{
+    uint8_t adu[260];
+    test_stall = true;
+    host_client_send(fd, adu, host_build_request(adu, 3, 0x06, REG_UNITSPECS_START, REG_UNITSPECS_START));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+    TEST_WAIT(test_stalled);
+    for (uint16_t r = 1; r < REG_UNITSPECS_SIZE; r++) {
+        host_client_send(fd, adu, host_build_request(adu, r, 0x06, REG_UNITSPECS_START + r, REG_UNITSPECS_START + r));
+        HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+    }
+    test_stall = false;
+    TEST_WAIT(test_unit_writes == REG_UNITSPECS_SIZE);
+
+    modbus_tcp_event_stats_t stats;
+    HOST_CHECK(modbus_tcp_get_event_stats(handle, &stats) == ESP_OK);
+    HOST_CHECK(stats.max_batch == MB_EVENT_BATCH_MAX);
+}
+
+static void test_flood(modbus_tcp_handle_t handle, int fd)
+{
+    // The chain of old contents starts at the block as the task last saw it
+    HOST_CHECK(modbus_tcp_read_holding_range(handle, REG_4000_START, TEST_REGS, test_last) == ESP_OK);
+    modbus_tcp_event_stats_t before, after;
+    HOST_CHECK(modbus_tcp_get_event_stats(handle, &before) == ESP_OK);
+    test_write_hits = 0;
+    test_write_accesses = 0;
+
+    uint8_t adu[260];
+    int sent = 0, received = 0;
+    uint64_t start = host_now_ns();
+    for (; sent < TEST_IN_FLIGHT; sent++) {
+        host_client_send(fd, adu, test_build_write(adu, (uint16_t)sent, (uint16_t)(sent * TEST_REGS)));
+    }
+    while (received < TEST_FLOOD_WRITES) {
+        HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+        HOST_CHECK((((adu[0] << 8) | adu[1]) == (uint16_t)received) && (adu[7] == 0x10));
+        received++;
+        if (sent < TEST_FLOOD_WRITES) {
+            host_client_send(fd, adu, test_build_write(adu, (uint16_t)sent, (uint16_t)(sent * TEST_REGS)));
+            sent++;
+        }
+    }
+    double seconds = (double)(host_now_ns() - start) / 1e9;
+
+    // Every write reaches the task, merged with others or counted as dropped
+    TEST_WAIT((modbus_tcp_get_event_stats(handle, &after) == ESP_OK)
+              && (after.accesses - before.accesses + after.dropped - before.dropped == TEST_FLOOD_WRITES));
+    HOST_CHECK(test_write_hits == after.accesses - before.accesses);
+    uint16_t last = (uint16_t)((TEST_FLOOD_WRITES - 1) * TEST_REGS);
+    if (after.dropped == before.dropped) {
+        for (uint16_t r = 0; r < TEST_REGS; r++) {
+            HOST_CHECK(test_last[r] == (uint16_t)(last + r));
+        }
+    }
+
+    uint32_t events = after.events - before.events;
+    uint32_t batches = after.batches - before.batches;
+    printf("%d FC16 x %d registers, %d in flight:\n", TEST_FLOOD_WRITES, TEST_REGS, TEST_IN_FLIGHT);
+    printf("  master writes   %8.0f /s\n", (double)TEST_FLOOD_WRITES / seconds);
+    printf("  events          %8u (%.2f writes per event), %u dropped\n", (unsigned)events,
+           (double)(after.accesses - before.accesses) / (events ? events : 1),
+           (unsigned)(after.dropped - before.dropped));
+    printf("  batches         %8u (%.2f events per batch)\n", (unsigned)batches,
+           (double)events / (batches ? batches : 1));
+    printf("  task busy       %8.2f us per event\n",
+           (double)(after.busy_us - before.busy_us) / (events ? events : 1));
+}
+
+static void *test_stop_thread(void *arg)
+{
+    test_stop_result = modbus_tcp_slave_stop(test_handle);
+    test_stop_done = true;
+    return NULL;
+}
+
+// Stop and destroy while the task runs a callback: neither frees what the task uses
+static void test_stop_busy(modbus_tcp_handle_t handle, int fd)
+{
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    uint8_t adu[260];
+
+    // From a callback: rejected at once, the task goes on
+    test_cb_stop = test_cb_destroy = ESP_OK;
+    test_stop_in_cb = true;
+    host_client_send(fd, adu, host_build_request(adu, 1, 0x06, REG_4000_START + 3, 0x4321));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+    TEST_WAIT(!test_stop_in_cb);
+    HOST_CHECK(test_cb_stop == ESP_ERR_INVALID_STATE && test_cb_destroy == ESP_ERR_INVALID_STATE);
+    HOST_CHECK(modbus_tcp_slave_get_state(handle) == MODBUS_TCP_STATE_RUNNING);
+
+    // From another task while the callback is busy for longer than the event wait
+    test_stalled = false;
+    test_stall = true;
+    host_client_send(fd, adu, host_build_request(adu, 2, 0x06, REG_4000_START + 3, 0x1234));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+    TEST_WAIT(test_stalled);
+    pthread_t thread;
+    HOST_CHECK(pthread_create(&thread, NULL, test_stop_thread, NULL) == 0);
+    usleep(1500 * 1000);
+    HOST_CHECK(!test_stop_done && atomic_load(&instance->task_alive));
+    HOST_CHECK(modbus_tcp_slave_destroy(handle) == ESP_ERR_INVALID_STATE);
+
+    test_stall = false;
+    TEST_WAIT(test_stop_done);
+    pthread_join(thread, NULL);
+    HOST_CHECK(test_stop_result == ESP_OK && !atomic_load(&instance->task_alive));
+    HOST_CHECK(modbus_tcp_slave_get_state(handle) == MODBUS_TCP_STATE_STOPPED);
+}
+
+int main(void)
+{
+    static int netif;
+    modbus_tcp_config_t config = { .port = TEST_PORT, .netif = (esp_netif_t*)&netif };
+    modbus_tcp_handle_t handle = NULL;
+    modbus_tcp_callbacks_t callbacks = {
+        .on_register_write = test_on_write,
+        .on_access_batch = test_on_batch,
+    };
+    HOST_CHECK(modbus_tcp_slave_init(&config, &handle) == ESP_OK);
+    test_handle = handle;
+    HOST_CHECK(modbus_tcp_register_callbacks(handle, &callbacks) == ESP_OK);
+    HOST_CHECK(modbus_tcp_slave_start(handle) == ESP_OK);
+    host_slave_wait_ready(MB_MODE_TCP, TEST_PORT);
+
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+    test_single_writes(fd);
+    test_slow_callback(handle, fd);
+    test_flood(handle, fd);
+    HOST_CHECK(test_batches > 0);
+    test_stop_busy(handle, fd);
+    close(fd);
+
+    HOST_CHECK(modbus_tcp_slave_destroy(handle) == ESP_OK);
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * Seqlock of the float registers shared by the application and the stack.
+ *
+ * A writer task stores the same value in the 8 holding floats while the
+ * test reads them as one snapshot: every snapshot must hold a single value.
+ * The library accessors are read against the writer with the seqlock and
+ * with the instance mutex used before, the read rate of both is reported.
+ * Then the library slave is started on the loopback and the floats are read
+ * with FC03 in CDAB order while the writer runs: the 8 floats are one area
+ * of the stack, copied under one pass of the seqlock of its descriptor.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "modbus_tcp_slave.c"
+#include "host_test.h"
+
+#define TEST_PORT           (15032)
+#define TEST_FLOATS         (8)
+#define TEST_RUN_MS         (300)
+#define TEST_MODBUS_READS   (2000)
+
+typedef enum {
+    TEST_LOCK_SEQLOCK,
+    TEST_LOCK_MUTEX,
+    TEST_LOCK_NONE,
+} test_lock_t;
+
+static modbus_tcp_instance_t *test_instance;
+static volatile bool test_stop;
+static volatile test_lock_t test_lock;
+static volatile uint32_t test_writes;
+static SemaphoreHandle_t test_writer_done;
+
+static void test_write(float value)
+{
+    float values[TEST_FLOATS];
+    for (int i = 0; i < TEST_FLOATS; i++) {
+        values[i] = value;
+    }
+    const modbus_map_range_t *range = map_lookup_range(holding_map, 0, TEST_FLOATS);
+    switch (test_lock) {
+    case TEST_LOCK_SEQLOCK:
+        HOST_CHECK(map_write_values(test_instance, holding_map, 0, TEST_FLOATS, values) == ESP_OK);
+        break;
+    case TEST_LOCK_MUTEX:
+        HOST_CHECK(xSemaphoreTake(test_instance->mutex, portMAX_DELAY) == pdTRUE);
+        map_store(range, 0, TEST_FLOATS, values);
+        xSemaphoreGive(test_instance->mutex);
+        break;
+    case TEST_LOCK_NONE:
+        map_store(range, 0, TEST_FLOATS, values);
+        break;
+    }
+}
+
+static void test_read(float *values)
+{
+    const modbus_map_range_t *range = map_lookup_range(holding_map, 0, TEST_FLOATS);
+    switch (test_lock) {
+    case TEST_LOCK_SEQLOCK:
+        HOST_CHECK(map_read_values(test_instance, holding_map, 0, TEST_FLOATS, values) == ESP_OK);
+        break;
+    case TEST_LOCK_MUTEX:
+        HOST_CHECK(xSemaphoreTake(test_instance->mutex, portMAX_DELAY) == pdTRUE);
+        map_load(range, 0, TEST_FLOATS, values);
+        xSemaphoreGive(test_instance->mutex);
+        break;
+    case TEST_LOCK_NONE:
+        map_load(range, 0, TEST_FLOATS, values);
+        break;
+    }
+}
+
+// The control task: the 8 floats always change together
+static void test_writer_task(void *arg)
+{
+    (void)arg;
+    // Values below 2^24 are exact in a float
+    for (uint32_t value = 1; !test_stop; value = (value + 1) & 0xFFFFFF) {
+        test_write((float)value);
+        test_writes++;
+    }
+    xSemaphoreGive(test_writer_done);
+    vTaskDelete(NULL);
+}
+
+static void test_writer_start(test_lock_t lock)
+{
+    test_lock = lock;
+    test_stop = false;
+    test_writes = 0;
+    // The snapshots hold a single value from the first one on, before the task runs
+    test_write(0);
+    HOST_CHECK(xTaskCreate(test_writer_task, "writer", 4096, NULL, 5, NULL) == pdPASS);
+}
+
+static void test_writer_join(void)
+{
+    test_stop = true;
+    HOST_CHECK(xSemaphoreTake(test_writer_done, pdMS_TO_TICKS(1000)) == pdTRUE);
+}
+
+static bool test_torn(const float *values)
+{
+    for (int i = 1; i < TEST_FLOATS; i++) {
+        if (values[i] != values[0]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void bench_accessors(const char *name, test_lock_t lock)
+{
+    uint64_t reads = 0, torn = 0;
+    test_writer_start(lock);
+    uint64_t start = host_now_ns(), end = start + (uint64_t)TEST_RUN_MS * 1000000;
+    while (host_now_ns() < end) {
+        float values[TEST_FLOATS] = { 0 };
+        test_read(values);
+        torn += test_torn(values);
+        reads++;
+    }
+    test_writer_join();
+    double seconds = (double)(host_now_ns() - start) / 1e9;
+    printf("  %-18s %6.2f M reads/s, %6.2f M writes/s, %llu torn\n", name, (double)reads / seconds / 1e6,
+           (double)test_writes / seconds / 1e6, (unsigned long long)torn);
+    // Without a lock the torn snapshots are only reported
+    if (lock != TEST_LOCK_NONE) {
+        HOST_CHECK(torn == 0);
+    }
+}
+
+// FC03 or FC04 of the 8 floats, CDAB: the low word of each float first
+static void test_modbus_snapshot(int fd, uint8_t function, uint16_t tid, float *values)
+{
+    uint8_t adu[64];
+    host_client_send(fd, adu, host_build_request(adu, tid, function, 0, TEST_FLOATS * 2));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 9 + TEST_FLOATS * 4);
+    HOST_CHECK(adu[7] == function);
+    for (int i = 0; i < TEST_FLOATS; i++) {
+        const uint8_t *regs = &adu[9 + i * 4];
+        uint32_t bits = ((uint32_t)((regs[2] << 8) | regs[3]) << 16) | (uint32_t)((regs[0] << 8) | regs[1]);
+        memcpy(&values[i], &bits, sizeof(float));
+    }
+}
+
+static void test_modbus_reads(void)
+{
+    static int netif;
+    modbus_tcp_config_t config = { .port = TEST_PORT, .netif = (esp_netif_t*)&netif };
+    modbus_tcp_handle_t handle = NULL;
+    HOST_CHECK(modbus_tcp_slave_init(&config, &handle) == ESP_OK);
+    HOST_CHECK(modbus_tcp_slave_start(handle) == ESP_OK);
+    host_slave_wait_ready(MB_MODE_TCP, TEST_PORT);
+    test_instance = get_instance(handle);
+
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+    float values[TEST_FLOATS];
+    test_modbus_snapshot(fd, 0x03, 0, values);
+    HOST_CHECK(values[0] == 1.34f && values[7] == 8.80f);
+
+    test_writer_start(TEST_LOCK_SEQLOCK);
+    for (uint16_t i = 0; i < TEST_MODBUS_READS; i++) {
+        test_modbus_snapshot(fd, 0x03, i, values);
+        HOST_CHECK(!test_torn(values));
+    }
+    test_writer_join();
+    printf("  FC03 of the 8 floats against the writer: %d snapshots, %u writes\n",
+           TEST_MODBUS_READS, (unsigned)test_writes);
+    HOST_CHECK(test_writes > 0);
+
+    // The input floats are served from the same kind of area with their own seqlock
+    float inputs[TEST_FLOATS];
+    HOST_CHECK(map_read_values(test_instance, input_map, 0, TEST_FLOATS, inputs) == ESP_OK);
+    test_modbus_snapshot(fd, 0x04, 0, values);
+    HOST_CHECK(memcmp(values, inputs, sizeof(values)) == 0);
+
+    close(fd);
+    HOST_CHECK(modbus_tcp_slave_stop(handle) == ESP_OK);
+    HOST_CHECK(modbus_tcp_slave_destroy(handle) == ESP_OK);
+}
+
+int main(void)
+{
+    modbus_tcp_config_t config = { 0 };
+    modbus_tcp_handle_t handle = NULL;
+    test_writer_done = xSemaphoreCreateBinary();
+    HOST_CHECK(test_writer_done && (modbus_tcp_slave_init(&config, &handle) == ESP_OK));
+    test_instance = get_instance(handle);
+
+    printf("8 holding floats read against a writer task for %d ms:\n", TEST_RUN_MS);
+    bench_accessors("seqlock", TEST_LOCK_SEQLOCK);
+    bench_accessors("instance mutex", TEST_LOCK_MUTEX);
+    bench_accessors("no lock", TEST_LOCK_NONE);
+    HOST_CHECK(modbus_tcp_slave_destroy(handle) == ESP_OK);
+
+    test_modbus_reads();
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * Event channel of the slave stack and the frame to response latency.
+ *
+ * Checks the notification based events of portevent.c: events posted before
+ * the polling task is known are kept, repeated events merge and they are
+ * returned in the order of their values. The wake-up of the polling task is
+ * compared with the queue of events used before, where a received frame
+ * took a second pass through the queue (EV_EXECUTE). Then the stop and wait
+ * latency of FC03 requests is reported for TCP and for RTU over a pty.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "mb.h"
+#include "mbport.h"
+#include "port.h"
+#include "host_test.h"
+
+#define TEST_PORT           (15029)
+#define TEST_BAUDRATE       (115200)
+#define TEST_BENCH_WAKES    (20000)
+#define TEST_BENCH_TRANS    (5000)
+#define TEST_REGS           (16)
+
+static xMBPortEvent test_event;
+static QueueHandle_t test_queue;
+static SemaphoreHandle_t test_done;
+
+static void test_events_order(void)
+{
+    HOST_CHECK(xMBPortEventInit(&test_event));
+    // Posted before the first wait: kept for the polling task, the duplicate merges
+    HOST_CHECK(xMBPortEventPost(&test_event, EV_FRAME_SENT));
+    HOST_CHECK(xMBPortEventPost(&test_event, EV_FRAME_RECEIVED));
+    HOST_CHECK(xMBPortEventPost(&test_event, EV_FRAME_SENT));
+
+    eMBEventType event;
+    HOST_CHECK(xMBPortEventGet(&test_event, &event) && (event == EV_FRAME_RECEIVED));
+    HOST_CHECK(xMBPortEventGet(&test_event, &event) && (event == EV_FRAME_SENT));
+
+    HOST_CHECK(xMBPortEventPost(&test_event, EV_FRAME_TRANSMIT));
+    HOST_CHECK(xMBPortEventPost(&test_event, EV_READY));
+    HOST_CHECK(xMBPortEventGet(&test_event, &event) && (event == EV_READY));
+    HOST_CHECK(xMBPortEventGet(&test_event, &event) && (event == EV_FRAME_TRANSMIT));
+    vMBPortEventClose(&test_event);
+
+    // A closed channel refuses the events
+    HOST_CHECK(!xMBPortEventPost(&test_event, EV_READY));
+}
+
+// The polling task of the stack, one wake-up per received frame
+static void test_notify_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        eMBEventType event;
+        (void)xMBPortEventGet(&test_event, &event);
+        xSemaphoreGive(test_done);
+    }
+}
+
+// The polling task with the queue of events: the frame is executed on the second event
+static void test_queue_task(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        eMBEventType event;
+        (void)xQueueReceive(test_queue, &event, portMAX_DELAY);
+        if (event == EV_FRAME_RECEIVED) {
+            event = EV_EXECUTE;
+            (void)xQueueSend(test_queue, &event, 0);
+        } else {
+            xSemaphoreGive(test_done);
+        }
+    }
+}
+
+static void bench_wake(const char *name, bool queue)
+{
+    static uint64_t samples[TEST_BENCH_WAKES];
+    for (int i = 0; i < TEST_BENCH_WAKES; i++) {
+        eMBEventType event = EV_FRAME_RECEIVED;
+        uint64_t start = host_now_ns();
+        if (queue) {
+            HOST_CHECK(xQueueSend(test_queue, &event, 0) == pdTRUE);
+        } else {
+            HOST_CHECK(xMBPortEventPost(&test_event, event));
+        }
+        HOST_CHECK(xSemaphoreTake(test_done, pdMS_TO_TICKS(1000)) == pdTRUE);
+        samples[i] = host_now_ns() - start;
+    }
+    printf("  %-28s p50 %5.1f us, p99 %5.1f us\n", name,
+           (double)host_percentile(samples, TEST_BENCH_WAKES, 50) / 1000,
+           (double)host_percentile(samples, TEST_BENCH_WAKES, 99) / 1000);
+}
+
+static void bench_events(void)
+{
+    test_done = xSemaphoreCreateBinary();
+    test_queue = xQueueCreate(CONFIG_FMB_QUEUE_LENGTH, sizeof(eMBEventType));
+    HOST_CHECK(test_done && test_queue);
+    HOST_CHECK(xMBPortEventInit(&test_event));
+    HOST_CHECK(xTaskCreate(test_notify_task, "notify", 4096, NULL, 5, NULL) == pdPASS);
+    HOST_CHECK(xTaskCreate(test_queue_task, "queue", 4096, NULL, 5, NULL) == pdPASS);
+
+    printf("frame received to frame executed in the polling task:\n");
+    bench_wake("queue, two events", true);
+    bench_wake("task notification, one", false);
+}
+
+static void bench_tcp(void)
+{
+    static uint64_t samples[TEST_BENCH_TRANS];
+    pid_t slave = host_slave_fork_ip(MB_MODE_TCP, TEST_PORT);
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+    for (int i = 0; i < TEST_BENCH_TRANS; i++) {
+        samples[i] = host_client_read_holding(fd, (uint16_t)i, (uint16_t)(i % 512), TEST_REGS);
+    }
+    close(fd);
+    host_slave_kill(slave);
+    printf("  TCP:                 p50 %5.1f us, p99 %5.1f us\n",
+           (double)host_percentile(samples, TEST_BENCH_TRANS, 50) / 1000,
+           (double)host_percentile(samples, TEST_BENCH_TRANS, 99) / 1000);
+}
+
+static void bench_rtu(void)
+{
+    static uint64_t samples[TEST_BENCH_TRANS];
+    int fd = -1;
+    pid_t slave = host_slave_fork_rtu(TEST_BAUDRATE, &fd);
+    const size_t rsp_length = 5 + TEST_REGS * 2;
+    for (int i = 0; i < TEST_BENCH_TRANS; i++) {
+        uint8_t adu[64];
+        uint16_t addr = (uint16_t)(i % 512);
+        size_t length = host_rtu_build_request(adu, 0x03, addr, TEST_REGS);
+        uint64_t start = host_now_ns();
+        host_rtu_send(fd, adu, length);
+        HOST_CHECK(host_rtu_recv(fd, adu, rsp_length, 1000) == rsp_length);
+        samples[i] = host_now_ns() - start;
+        HOST_CHECK(host_crc16(adu, rsp_length) == 0);
+        HOST_CHECK(((adu[3] << 8) | adu[4]) == addr);
+    }
+    close(fd);
+    host_slave_kill(slave);
+    printf("  RTU over a pty:      p50 %5.1f us, p99 %5.1f us (silence of 3.5 chars included)\n",
+           (double)host_percentile(samples, TEST_BENCH_TRANS, 50) / 1000,
+           (double)host_percentile(samples, TEST_BENCH_TRANS, 99) / 1000);
+}
+
+int main(void)
+{
+    // The slaves are forked before the tasks of the event benchmark are created
+    printf("FC03 x %d registers, %d transactions stop and wait:\n", TEST_REGS, TEST_BENCH_TRANS);
+    bench_tcp();
+    bench_rtu();
+
+    test_events_order();
+    bench_events();
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Function code dispatch of the slave core (white box, includes mb.c).
+ *
+ * Checks that the direct-indexed table holds the handlers of the enabled
+ * function codes, that eMBRegisterCB() overrides, adds and removes entries
+ * and rejects the codes out of range. Then compares the lookup with the
+ * linear scan of the handler list used before.
+ */
+
+#include "mb.c"
+
+#include "host_test.h"
+
+#define TEST_BENCH_LOOKUPS  (20000000)
+
+static eMBException test_custom_handler(UCHAR *pucFrame, USHORT *pusLength)
+{
+    (void)pucFrame;
+    (void)pusLength;
+    return MB_EX_NONE;
+}
+
+static void test_table(void)
+{
+    const struct {
+        UCHAR code;
+        pxMBFunctionHandler handler;
+    } builtin[] = {
+        { MB_FUNC_OTHER_REPORT_SLAVEID, eMBFuncReportSlaveID },
+        { MB_FUNC_READ_INPUT_REGISTER, eMBFuncReadInputRegister },
+        { MB_FUNC_READ_HOLDING_REGISTER, eMBFuncReadHoldingRegister },
+        { MB_FUNC_WRITE_MULTIPLE_REGISTERS, eMBFuncWriteMultipleHoldingRegister },
+        { MB_FUNC_WRITE_REGISTER, eMBFuncWriteHoldingRegister },
+        { MB_FUNC_READWRITE_MULTIPLE_REGISTERS, eMBFuncReadWriteMultipleHoldingRegister },
+        { MB_FUNC_READ_COILS, eMBFuncReadCoils },
+        { MB_FUNC_WRITE_SINGLE_COIL, eMBFuncWriteCoil },
+        { MB_FUNC_WRITE_MULTIPLE_COILS, eMBFuncWriteMultipleCoils },
+        { MB_FUNC_READ_DISCRETE_INPUTS, eMBFuncReadDiscreteInputs },
+    };
+    int found = 0;
+    for (int code = 0; code < 256; code++) {
+        pxMBFunctionHandler expected = NULL;
+        for (size_t i = 0; i < sizeof(builtin) / sizeof(builtin[0]); i++) {
+            if (builtin[i].code == code) {
+                expected = builtin[i].handler;
+            }
+        }
+        HOST_CHECK(prxMBGetHandler((UCHAR)code) == expected);
+        found += (expected != NULL);
+    }
+    HOST_CHECK(found == sizeof(builtin) / sizeof(builtin[0]));
+
+    // A custom code, a replaced built-in handler and a removed one
+    HOST_CHECK(eMBRegisterCB(0x41, test_custom_handler) == MB_ENOERR);
+    HOST_CHECK(prxMBGetHandler(0x41) == test_custom_handler);
+    HOST_CHECK(eMBRegisterCB(MB_FUNC_READ_HOLDING_REGISTER, test_custom_handler) == MB_ENOERR);
+    HOST_CHECK(prxMBGetHandler(MB_FUNC_READ_HOLDING_REGISTER) == test_custom_handler);
+    HOST_CHECK(eMBRegisterCB(MB_FUNC_READ_HOLDING_REGISTER, eMBFuncReadHoldingRegister) == MB_ENOERR);
+    HOST_CHECK(prxMBGetHandler(MB_FUNC_READ_HOLDING_REGISTER) == eMBFuncReadHoldingRegister);
+    HOST_CHECK(eMBRegisterCB(0x41, NULL) == MB_ENOERR);
+    HOST_CHECK(prxMBGetHandler(0x41) == NULL);
+    HOST_CHECK(eMBRegisterCB(MB_FUNC_CODE_MAX, test_custom_handler) == MB_ENOERR);
+    HOST_CHECK(prxMBGetHandler(MB_FUNC_CODE_MAX) == test_custom_handler);
+    HOST_CHECK(eMBRegisterCB(MB_FUNC_CODE_MAX, NULL) == MB_ENOERR);
+
+    HOST_CHECK(eMBRegisterCB(0, test_custom_handler) == MB_EINVAL);
+    HOST_CHECK(eMBRegisterCB(MB_FUNC_CODE_MAX + 1, test_custom_handler) == MB_EINVAL);
+    HOST_CHECK(prxMBGetHandler(MB_FUNC_CODE_MAX + 1) == NULL);
+}
+
+// The handler list and its scan as the core had them before the table
+typedef struct {
+    UCHAR ucFunctionCode;
+    pxMBFunctionHandler pxHandler;
+} test_list_entry_t;
+
+static test_list_entry_t test_list[MB_FUNC_HANDLERS_MAX] = {
+    { MB_FUNC_OTHER_REPORT_SLAVEID, eMBFuncReportSlaveID },
+    { MB_FUNC_READ_INPUT_REGISTER, eMBFuncReadInputRegister },
+    { MB_FUNC_READ_HOLDING_REGISTER, eMBFuncReadHoldingRegister },
+    { MB_FUNC_WRITE_MULTIPLE_REGISTERS, eMBFuncWriteMultipleHoldingRegister },
+    { MB_FUNC_WRITE_REGISTER, eMBFuncWriteHoldingRegister },
+    { MB_FUNC_READWRITE_MULTIPLE_REGISTERS, eMBFuncReadWriteMultipleHoldingRegister },
+    { MB_FUNC_READ_COILS, eMBFuncReadCoils },
+    { MB_FUNC_WRITE_SINGLE_COIL, eMBFuncWriteCoil },
+    { MB_FUNC_WRITE_MULTIPLE_COILS, eMBFuncWriteMultipleCoils },
+    { MB_FUNC_READ_DISCRETE_INPUTS, eMBFuncReadDiscreteInputs },
+};
+
+static __attribute__((noinline)) pxMBFunctionHandler test_list_lookup(UCHAR ucFunctionCode)
+{
+    for (int i = 0; (i < MB_FUNC_HANDLERS_MAX) && (test_list[i].ucFunctionCode != 0); i++) {
+        if (test_list[i].ucFunctionCode == ucFunctionCode) {
+            return test_list[i].pxHandler;
+        }
+    }
+    return NULL;
+}
+
+static __attribute__((noinline)) pxMBFunctionHandler test_table_lookup(UCHAR ucFunctionCode)
+{
+    return prxMBGetHandler(ucFunctionCode);
+}
+
+static double bench_lookup(pxMBFunctionHandler (*lookup)(UCHAR), UCHAR code)
+{
+    volatile UCHAR input = code;
+    uint64_t start = host_now_ns();
+    for (int i = 0; i < TEST_BENCH_LOOKUPS; i++) {
+        pxMBFunctionHandler handler = lookup(input);
+        HOST_KEEP(handler);
+    }
+    return (double)(host_now_ns() - start) / TEST_BENCH_LOOKUPS;
+}
+
+static void bench(void)
+{
+    const struct {
+        const char *name;
+        UCHAR code;
+    } cases[] = {
+        { "FC03, third in the list", MB_FUNC_READ_HOLDING_REGISTER },
+        { "FC02, last in the list", MB_FUNC_READ_DISCRETE_INPUTS },
+        { "FC41, not supported", 0x41 },
+    };
+    printf("handler lookup, ns per request:\n");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        HOST_CHECK(test_list_lookup(cases[i].code) == test_table_lookup(cases[i].code));
+        double list = bench_lookup(test_list_lookup, cases[i].code);
+        double table = bench_lookup(test_table_lookup, cases[i].code);
+        printf("  %-24s list %5.2f, table %5.2f\n", cases[i].name, list, table);
+    }
+}
+
+int main(void)
+{
+    test_table();
+    bench();
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,424 @@
+/*
+ * TCP to RTU gateway (white box, includes src/modbus_gateway.c).
+ *
+ * The serial master and the forward hooks of the TCP slave are replaced by a
+ * fake bus line: it answers the reads with unit << 8 | address, can be held
+ * by the test, can stay silent or answer an exception. The requests are put
+ * through the forward callback the TCP port calls. Several clients forward
+ * at the same time: each response carries its own ticket and data and the
+ * line serves one request at a time. Requests waiting behind a line held
+ * past the TCP response timeout are answered with 0x0B without reaching the
+ * line, with a short queue the extra ones get 0x06. Last, the stop answers
+ * the queued requests with 0x0A.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+// Kconfig options of the application, not in the host sdkconfig.h
+#define CONFIG_MB_UART_PORT_NUM     (UART_NUM_1)
+#define CONFIG_MB_UART_BAUD_RATE    (115200)
+#define CONFIG_MB_UART_TXD          (17)
+#define CONFIG_MB_UART_RXD          (16)
+#define CONFIG_MB_UART_RTS          (18)
+
+#include "modbus_gateway.c"
+
+#include "host_test.h"
+
+#define TEST_CLIENTS        (8)
+#define TEST_REQUESTS       (500)   // Requests of each concurrent client
+#define TEST_WAIT_MS        (1000)
+#define TEST_EXCEPTION      (0x02)  // Answered by the line in exception mode
+
+typedef enum {
+    TEST_LINE_ANSWER,
+    TEST_LINE_SILENT,
+    TEST_LINE_EXCEPTION,
+} test_line_mode_t;
+
+typedef struct {
+    bool ready;
+    modbus_tcp_forward_ticket_t ticket;
+    uint16_t len;
+    uint8_t pdu[MODBUS_GATEWAY_PDU_MAX];
+} test_response_t;
+
+static pthread_mutex_t test_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t test_cond = PTHREAD_COND_INITIALIZER;
+
+// Fake bus line
+static test_line_mode_t test_line_mode;
+static bool test_line_hold;
+static unsigned test_line_calls;
+static unsigned test_line_active;
+static uint32_t test_line_timeout_ms;
+static unsigned test_master_destroyed;
+
+// Fake TCP slave
+static int test_tcp_dummy;
+static modbus_tcp_forward_cb_t test_forward;
+static test_response_t test_responses[TEST_CLIENTS];
+static int test_refused_client = -1;
+
+/* ----------------------- Serial master ------------------------------------*/
+
+esp_err_t mbc_master_init(mb_port_type_t port_type, void **handler)
+{
+    HOST_CHECK(port_type == MB_PORT_SERIAL_MASTER);
+    *handler = &test_line_calls;
+    return ESP_OK;
+}
+
+esp_err_t mbc_master_setup(void *comm_info)
+{
+    const mb_communication_info_t *comm = (const mb_communication_info_t *)comm_info;
+    HOST_CHECK((comm->mode == MB_MODE_RTU) && (comm->port == CONFIG_MB_UART_PORT_NUM));
+    return ESP_OK;
+}
+
+esp_err_t mbc_master_start(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t mbc_master_destroy(void)
+{
+    test_master_destroyed++;
+    return ESP_OK;
+}
+
+esp_err_t mbc_master_set_response_timeout(uint32_t timeout_ms)
+{
+    test_line_timeout_ms = timeout_ms;
+    return ESP_OK;
+}
+
+esp_err_t mbc_master_get_transaction_info(mb_trans_info_t *ptinfo)
+{
+    ptinfo->exception = TEST_EXCEPTION;
+    return ESP_OK;
+}
+
+esp_err_t mbc_master_send_request(mb_param_request_t *request, void *data_ptr)
+{
+    pthread_mutex_lock(&test_lock);
+    test_line_calls++;
+    HOST_CHECK(++test_line_active == 1);
+    HOST_CHECK((test_line_timeout_ms > 0) && (test_line_timeout_ms <= MB_TCP_RESP_TIMEOUT_MS));
+    pthread_cond_broadcast(&test_cond);
+    while (test_line_hold) {
+        pthread_cond_wait(&test_cond, &test_lock);
+    }
+    test_line_mode_t mode = test_line_mode;
+    test_line_active--;
+    pthread_mutex_unlock(&test_lock);
+
+    switch (mode) {
+        case TEST_LINE_SILENT:
+            // The master gives up at once, the timeout itself is not waited
+            return ESP_ERR_TIMEOUT;
+        case TEST_LINE_EXCEPTION:
+            return ESP_ERR_INVALID_RESPONSE;
+        default:
+            break;
+    }
+    if ((request->command == GW_FC_READ_HOLDING) || (request->command == GW_FC_READ_INPUT)) {
+        uint16_t *data = (uint16_t *)data_ptr;
+        for (uint16_t i = 0; i < request->reg_size; i++) {
+            data[i] = (uint16_t)((request->slave_addr << 8) | (uint8_t)(request->reg_start + i));
+        }
+    }
+    return ESP_OK;
+}
+
+/* ----------------------- TCP slave ----------------------------------------*/
+
+esp_err_t modbus_tcp_set_forward(modbus_tcp_handle_t handle, modbus_tcp_forward_cb_t cb, void *ctx)
+{
+    HOST_CHECK(handle == &test_tcp_dummy);
+    (void)ctx;
+    pthread_mutex_lock(&test_lock);
+    test_forward = cb;
+    pthread_mutex_unlock(&test_lock);
+    return ESP_OK;
+}
+
+esp_err_t modbus_tcp_forward_response(modbus_tcp_handle_t handle, modbus_tcp_forward_ticket_t ticket,
+                                      const uint8_t *pdu, uint16_t pdu_len)
+{
+    HOST_CHECK(handle == &test_tcp_dummy);
+    HOST_CHECK((ticket.client < TEST_CLIENTS) && (pdu_len >= 2) && (pdu_len <= MODBUS_GATEWAY_PDU_MAX));
+    pthread_mutex_lock(&test_lock);
+    test_response_t *response = &test_responses[ticket.client];
+    // One request of each client is forwarded at a time: one response
+    HOST_CHECK(!response->ready);
+    bool refused = (ticket.client == test_refused_client);
+    if (!refused) {
+        response->ready = true;
+        response->ticket = ticket;
+        response->len = pdu_len;
+        memcpy(response->pdu, pdu, pdu_len);
+        pthread_cond_broadcast(&test_cond);
+    }
+    pthread_mutex_unlock(&test_lock);
+    return refused ? ESP_FAIL : ESP_OK;
+}
+
+/* ----------------------- Helpers ------------------------------------------*/
+
+static void test_deadline(struct timespec *deadline, uint32_t timeout_ms)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static void test_forward_read(uint16_t client, uint16_t tid, uint8_t unit_id, uint16_t start, uint16_t count)
+{
+    modbus_tcp_forward_ticket_t ticket = { .client = client, .tid = tid };
+    uint8_t pdu[5] = { GW_FC_READ_HOLDING };
+    put_be16(&pdu[1], start);
+    put_be16(&pdu[3], count);
+    HOST_CHECK(test_forward != NULL);
+    HOST_CHECK(test_forward(NULL, ticket, unit_id, pdu, sizeof(pdu)));
+}
+
+// Waits the response to the client, returns false on timeout
+static bool test_wait_response(uint16_t client, test_response_t *response)
+{
+    struct timespec deadline;
+    test_deadline(&deadline, TEST_WAIT_MS);
+    pthread_mutex_lock(&test_lock);
+    int rc = 0;
+    while (!test_responses[client].ready && (rc == 0)) {
+        rc = pthread_cond_timedwait(&test_cond, &test_lock, &deadline);
+    }
+    bool ready = test_responses[client].ready;
+    *response = test_responses[client];
+    test_responses[client].ready = false;
+    pthread_mutex_unlock(&test_lock);
+    return ready;
+}
+
+// Checks the read response of the client against the data of the fake line
+static void test_check_read(uint16_t client, uint16_t tid, uint8_t unit_id, uint16_t start, uint16_t count)
+{
+    test_response_t response;
+    HOST_CHECK(test_wait_response(client, &response));
+    HOST_CHECK((response.ticket.client == client) && (response.ticket.tid == tid));
+    HOST_CHECK((response.len == 2 + count * 2) && (response.pdu[0] == GW_FC_READ_HOLDING));
+    HOST_CHECK(response.pdu[1] == count * 2);
+    for (uint16_t i = 0; i < count; i++) {
+        HOST_CHECK(get_be16(&response.pdu[2 + i * 2]) == (uint16_t)((unit_id << 8) | (uint8_t)(start + i)));
+    }
+}
+
+static void test_check_exception(uint16_t client, uint16_t tid, uint8_t exception)
+{
+    test_response_t response;
+    HOST_CHECK(test_wait_response(client, &response));
+    HOST_CHECK((response.ticket.client == client) && (response.ticket.tid == tid));
+    HOST_CHECK((response.len == 2) && (response.pdu[0] == (GW_FC_READ_HOLDING | 0x80)));
+    HOST_CHECK(response.pdu[1] == exception);
+}
+
+static void test_line_set_hold(bool hold)
+{
+    pthread_mutex_lock(&test_lock);
+    test_line_hold = hold;
+    pthread_cond_broadcast(&test_cond);
+    pthread_mutex_unlock(&test_lock);
+}
+
+// Waits the task to be on the line with the given number of requests sent to it
+static void test_wait_line(unsigned calls)
+{
+    struct timespec deadline;
+    test_deadline(&deadline, TEST_WAIT_MS);
+    pthread_mutex_lock(&test_lock);
+    while (test_line_calls < calls) {
+        HOST_CHECK(pthread_cond_timedwait(&test_cond, &test_lock, &deadline) == 0);
+    }
+    pthread_mutex_unlock(&test_lock);
+}
+
+static modbus_gateway_stats_t test_stats(void)
+{
+    modbus_gateway_stats_t stats;
+    HOST_CHECK(modbus_gateway_get_stats(&stats) == ESP_OK);
+    return stats;
+}
+
+static void test_start(uint8_t queue_depth)
+{
+    modbus_gateway_config_t config = MODBUS_GATEWAY_DEFAULT_CONFIG();
+    config.queue_depth = queue_depth;
+    HOST_CHECK(modbus_gateway_start(&test_tcp_dummy, &config) == ESP_OK);
+    HOST_CHECK(modbus_gateway_is_running() && (test_forward == gateway_forward_cb));
+}
+
+/* ----------------------- Tests --------------------------------------------*/
+
+static void *test_client(void *arg)
+{
+    uint16_t client = (uint16_t)(uintptr_t)arg;
+    uint8_t unit_id = (uint8_t)(2 + client);
+    for (uint16_t tid = 0; tid < TEST_REQUESTS; tid++) {
+        uint16_t start = (uint16_t)(client * 1000 + tid);
+        uint16_t count = (uint16_t)(1 + tid % GW_MAX_READ_REGS);
+        test_forward_read(client, tid, unit_id, start, count);
+        test_check_read(client, tid, unit_id, start, count);
+    }
+    return NULL;
+}
+
+// Clients forwarding at the same time, each with one request in flight as the TCP port does
+static void test_concurrent(void)
+{
+    pthread_t threads[TEST_CLIENTS];
+    modbus_gateway_stats_t before = test_stats();
+    unsigned calls = test_line_calls;
+    uint64_t start = host_now_ns();
+    for (uintptr_t i = 0; i < TEST_CLIENTS; i++) {
+        HOST_CHECK(pthread_create(&threads[i], NULL, test_client, (void *)i) == 0);
+    }
+    for (int i = 0; i < TEST_CLIENTS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed_s = (double)(host_now_ns() - start) / 1e9;
+
+    modbus_gateway_stats_t stats = test_stats();
+    HOST_CHECK(stats.forwarded - before.forwarded == TEST_CLIENTS * TEST_REQUESTS);
+    HOST_CHECK(stats.completed - before.completed == TEST_CLIENTS * TEST_REQUESTS);
+    HOST_CHECK(test_line_calls - calls == TEST_CLIENTS * TEST_REQUESTS);
+    HOST_CHECK((stats.exceptions == before.exceptions) && (stats.rejected == before.rejected));
+    HOST_CHECK((stats.queue_high_water >= 1) && (stats.queue_high_water <= TEST_CLIENTS));
+    printf("%d clients: %d forwarded requests in %.2f s, queue high water %u\n",
+           TEST_CLIENTS, TEST_CLIENTS * TEST_REQUESTS, elapsed_s, stats.queue_high_water);
+}
+
+// Requests waiting behind a line held past the TCP response timeout, a silent device and an exception
+static void test_expiry(void)
+{
+    modbus_gateway_stats_t before = test_stats();
+    unsigned calls = test_line_calls;
+
+    test_line_set_hold(true);
+    test_forward_read(0, 100, 2, 0, 4);
+    test_wait_line(calls + 1);
+    HOST_CHECK(test_line_timeout_ms > MB_TCP_RESP_TIMEOUT_MS - 500);
+    for (uint16_t client = 1; client < 4; client++) {
+        test_forward_read(client, (uint16_t)(100 + client), 2, 0, 4);
+    }
+    usleep((MB_TCP_RESP_TIMEOUT_MS + 50) * 1000);
+    test_line_set_hold(false);
+
+    // The request on the line is answered, the ones in the queue expired without reaching the line
+    test_check_read(0, 100, 2, 0, 4);
+    for (uint16_t client = 1; client < 4; client++) {
+        test_check_exception(client, (uint16_t)(100 + client), GW_EX_TARGET_NO_RESPONSE);
+    }
+    HOST_CHECK(test_line_calls == calls + 1);
+    modbus_gateway_stats_t stats = test_stats();
+    HOST_CHECK((stats.expired - before.expired == 3) && (stats.timeouts == before.timeouts));
+
+    // A silent device: 0x0B, and the exception of a device goes back to the client
+    test_line_mode = TEST_LINE_SILENT;
+    test_forward_read(0, 110, 2, 0, 1);
+    test_check_exception(0, 110, GW_EX_TARGET_NO_RESPONSE);
+    test_line_mode = TEST_LINE_EXCEPTION;
+    test_forward_read(0, 111, 2, 0, 1);
+    test_check_exception(0, 111, TEST_EXCEPTION);
+    test_line_mode = TEST_LINE_ANSWER;
+    stats = test_stats();
+    HOST_CHECK((stats.timeouts - before.timeouts == 1) && (stats.expired - before.expired == 3));
+    HOST_CHECK(stats.exceptions - before.exceptions == 5);
+}
+
+// A queue of two requests while the line is held: the extra requests are answered busy
+static void test_busy(void)
+{
+    HOST_CHECK(modbus_gateway_stop() == ESP_OK);
+    test_start(2);
+    modbus_gateway_stats_t before = test_stats();
+    unsigned calls = test_line_calls;
+
+    test_line_set_hold(true);
+    test_forward_read(0, 200, 3, 10, 2);
+    test_wait_line(calls + 1);
+    for (uint16_t client = 1; client < 6; client++) {
+        test_forward_read(client, (uint16_t)(200 + client), 3, 10, 2);
+    }
+    modbus_gateway_stats_t stats = test_stats();
+    HOST_CHECK((stats.rejected - before.rejected == 3) && (stats.forwarded - before.forwarded == 3));
+    HOST_CHECK(stats.queue_high_water >= 2);
+
+    // The busy response of a client gone is dropped
+    test_refused_client = 4;
+    test_line_set_hold(false);
+    test_check_read(0, 200, 3, 10, 2);
+    test_check_read(1, 201, 3, 10, 2);
+    test_check_read(2, 202, 3, 10, 2);
+    test_check_exception(3, 203, GW_EX_DEVICE_BUSY);
+    test_check_exception(5, 205, GW_EX_DEVICE_BUSY);
+    HOST_CHECK(test_line_calls == calls + 3);
+    stats = test_stats();
+    HOST_CHECK(stats.dropped - before.dropped == 1);
+    HOST_CHECK(stats.exceptions - before.exceptions == 3);
+    test_refused_client = -1;
+}
+
+static void *test_stop_thread(void *arg)
+{
+    *(esp_err_t *)arg = modbus_gateway_stop();
+    return NULL;
+}
+
+// The stop answers the requests still in the queue with 0x0A
+static void test_stop(void)
+{
+    unsigned calls = test_line_calls;
+    unsigned destroyed = test_master_destroyed;
+    esp_err_t stopped = ESP_FAIL;
+    pthread_t thread;
+
+    test_line_set_hold(true);
+    test_forward_read(0, 300, 4, 0, 1);
+    test_wait_line(calls + 1);
+    test_forward_read(1, 301, 4, 0, 1);
+    test_forward_read(2, 302, 4, 0, 1);
+    HOST_CHECK(pthread_create(&thread, NULL, test_stop_thread, &stopped) == 0);
+    while (modbus_gateway_is_running()) {
+        usleep(1000);
+    }
+    HOST_CHECK(test_forward == NULL);
+    test_line_set_hold(false);
+
+    test_check_read(0, 300, 4, 0, 1);
+    test_check_exception(1, 301, GW_EX_PATH_UNAVAILABLE);
+    test_check_exception(2, 302, GW_EX_PATH_UNAVAILABLE);
+    pthread_join(thread, NULL);
+    HOST_CHECK(stopped == ESP_OK);
+    HOST_CHECK((test_line_calls == calls + 1) && (test_master_destroyed == destroyed + 1));
+    HOST_CHECK(g_gateway.queue == NULL);
+}
+
+int main(void)
+{
+    HOST_CHECK(modbus_gateway_start(NULL, NULL) == ESP_ERR_INVALID_ARG);
+    test_start(0);
+    HOST_CHECK(g_gateway.queue_depth == MB_TCP_PORT_MAX_CONN);
+    HOST_CHECK(modbus_gateway_start(&test_tcp_dummy, NULL) == ESP_ERR_INVALID_STATE);
+
+    test_concurrent();
+    test_expiry();
+    test_busy();
+    test_stop();
+    printf("OK\n");
+    return 0;
+}
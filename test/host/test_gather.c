@@ -0,0 +1,211 @@
+/*
+ * Register requests spanning several slave areas (white box, includes esp_modbus_slave.c).
+ *
+ * The holding areas 100-109, 110-119, 130-139 and 140-149 hold their
+ * address in each register. Reads and writes across the adjacent areas are
+ * served as one request, the register at each area boundary included. A
+ * request touching an unmapped register fails with the illegal address
+ * error and writes nothing, also through the FC03 and FC16 handlers. With
+ * the gap fill, the reads between two areas return the fill value while the
+ * registers before the first area and the reads of a gap only stay illegal,
+ * the writes into a gap still fail. Last, the areas ending at the top of the
+ * address space and the input registers.
+ */
+
+#include "esp_modbus_slave.c"
+
+#include "mbframe.h"
+#include "mbproto.h"
+#include "mbfunc.h"
+#include "host_test.h"
+
+#define TEST_FILL           (0xDEAD)
+#define TEST_REGS_MAX       (125)   // Registers of a read request
+
+static mb_slave_interface_t test_iface;
+static uint16_t test_holding[4][10];
+static uint16_t test_top[2][8];
+static uint16_t test_input[2][4];
+
+static const uint16_t test_holding_start[4] = { 100, 110, 130, 140 };
+
+static bool test_mapped(uint32_t addr)
+{
+    return ((addr >= 100) && (addr < 120)) || ((addr >= 130) && (addr < 150)) || (addr >= 0xFFF0);
+}
+
+static void test_add_area(mb_param_type_t type, uint16_t start, uint16_t *data, size_t size)
+{
+    mb_register_area_descriptor_t area = { 0 };
+    area.type = type;
+    area.start_offset = start;
+    area.address = data;
+    area.size = size;
+    HOST_CHECK(mbc_slave_set_descriptor_hdl(&test_iface, area) == ESP_OK);
+}
+
+static void test_reset(void)
+{
+    for (int a = 0; a < 4; a++) {
+        for (int i = 0; i < 10; i++) {
+            test_holding[a][i] = (uint16_t)(test_holding_start[a] + i);
+        }
+    }
+}
+
+static eMBErrorCode test_read(uint16_t addr, uint16_t count, uint16_t *values)
+{
+    UCHAR buffer[2 * TEST_REGS_MAX];
+    // The stack passes the address + 1
+    eMBErrorCode status = eMBRegHoldingCB(buffer, (USHORT)(addr + 1), count, MB_REG_READ);
+    for (uint16_t i = 0; (status == MB_ENOERR) && (i < count); i++) {
+        values[i] = (uint16_t)((buffer[i * 2] << 8) | buffer[i * 2 + 1]);
+    }
+    return status;
+}
+
+static eMBErrorCode test_write(uint16_t addr, uint16_t count, uint16_t base)
+{
+    UCHAR buffer[2 * TEST_REGS_MAX];
+    for (uint16_t i = 0; i < count; i++) {
+        buffer[i * 2] = (UCHAR)((base + i) >> 8);
+        buffer[i * 2 + 1] = (UCHAR)(base + i);
+    }
+    return eMBRegHoldingCB(buffer, (USHORT)(addr + 1), count, MB_REG_WRITE);
+}
+
+// Checks the read of count registers at the address against the map. The gaps after the first
+// area read as the fill value if enabled, a read of the unmapped registers only is illegal.
+static void test_check_read(uint16_t addr, uint16_t count, bool fill)
+{
+    uint16_t values[TEST_REGS_MAX];
+    bool all = true;
+    bool any = false;
+    for (uint32_t reg = addr; reg < (uint32_t)addr + count; reg++) {
+        all = all && test_mapped(reg);
+        any = any || test_mapped(reg);
+    }
+    bool legal = all || (fill && any && (addr >= 100));
+    eMBErrorCode status = test_read(addr, count, values);
+    if (status != (legal ? MB_ENOERR : MB_ENOREG)) {
+        fprintf(stderr, "read of %u registers at %u: status %d\n", count, addr, (int)status);
+        exit(1);
+    }
+    for (uint16_t i = 0; legal && (i < count); i++) {
+        HOST_CHECK(values[i] == (test_mapped(addr + i) ? (uint16_t)(addr + i) : TEST_FILL));
+    }
+}
+
+static void test_holding_reads(bool fill)
+{
+    HOST_CHECK(mbc_slave_set_gap_fill_hdl(&test_iface, MB_PARAM_HOLDING, fill, TEST_FILL) == ESP_OK);
+    for (uint16_t addr = 90; addr < 160; addr++) {
+        for (uint16_t count = 1; count <= 70; count++) {
+            test_check_read(addr, count, fill);
+        }
+    }
+}
+
+static void test_holding_writes(void)
+{
+    uint16_t values[40];
+
+    // Across the boundary of two areas, the last register of one and the first of the other
+    HOST_CHECK(test_write(109, 2, 0x1000) == MB_ENOERR);
+    HOST_CHECK((test_holding[0][9] == 0x1000) && (test_holding[1][0] == 0x1001));
+    HOST_CHECK(test_write(100, 20, 0x2000) == MB_ENOERR);
+    HOST_CHECK(test_read(100, 20, values) == MB_ENOERR);
+    for (uint16_t i = 0; i < 20; i++) {
+        HOST_CHECK(values[i] == 0x2000 + i);
+    }
+    test_reset();
+
+    // A write into a gap writes nothing, with the gap fill as well
+    for (int fill = 0; fill < 2; fill++) {
+        HOST_CHECK(mbc_slave_set_gap_fill_hdl(&test_iface, MB_PARAM_HOLDING, fill, TEST_FILL) == ESP_OK);
+        HOST_CHECK(test_write(115, 20, 0x3000) == MB_ENOREG);
+        HOST_CHECK(test_write(119, 2, 0x3000) == MB_ENOREG);
+        HOST_CHECK(test_write(145, 10, 0x3000) == MB_ENOREG);
+        HOST_CHECK(test_read(100, 20, values) == MB_ENOERR);
+        HOST_CHECK(test_read(130, 20, &values[20]) == MB_ENOERR);
+        for (uint16_t i = 0; i < 20; i++) {
+            HOST_CHECK((values[i] == 100 + i) && (values[20 + i] == 130 + i));
+        }
+    }
+    HOST_CHECK(mbc_slave_set_gap_fill_hdl(&test_iface, MB_PARAM_HOLDING, false, 0) == ESP_OK);
+}
+
+// The FC03 and FC16 handlers answer the requests touching a gap with the illegal address exception
+static void test_handlers(void)
+{
+    UCHAR frame[MB_PDU_SIZE_MAX];
+    USHORT length;
+
+    const UCHAR read_across[] = { MB_FUNC_READ_HOLDING_REGISTER, 0, 105, 0, 10 };
+    memcpy(frame, read_across, sizeof(read_across));
+    length = sizeof(read_across);
+    HOST_CHECK(eMBFuncReadHoldingRegister(frame, &length) == MB_EX_NONE);
+    HOST_CHECK((length == 2 + 20) && (frame[1] == 20) && (frame[2 + 19] == 114));
+
+    const UCHAR read_gap[] = { MB_FUNC_READ_HOLDING_REGISTER, 0, 115, 0, 10 };
+    memcpy(frame, read_gap, sizeof(read_gap));
+    length = sizeof(read_gap);
+    HOST_CHECK(eMBFuncReadHoldingRegister(frame, &length) == MB_EX_ILLEGAL_DATA_ADDRESS);
+
+    const UCHAR write_gap[] = { MB_FUNC_WRITE_MULTIPLE_REGISTERS, 0, 118, 0, 3, 6, 0, 1, 0, 2, 0, 3 };
+    memcpy(frame, write_gap, sizeof(write_gap));
+    length = sizeof(write_gap);
+    HOST_CHECK(eMBFuncWriteMultipleHoldingRegister(frame, &length) == MB_EX_ILLEGAL_DATA_ADDRESS);
+    HOST_CHECK((test_holding[1][8] == 118) && (test_holding[1][9] == 119));
+}
+
+static void test_top_and_input(void)
+{
+    uint16_t values[16];
+
+    // The adjacent areas at the top of the address space
+    for (int i = 0; i < 8; i++) {
+        test_top[0][i] = (uint16_t)(0xFFF0 + i);
+        test_top[1][i] = (uint16_t)(0xFFF8 + i);
+    }
+    HOST_CHECK(test_read(0xFFF4, 12, values) == MB_ENOERR);
+    for (uint16_t i = 0; i < 12; i++) {
+        HOST_CHECK(values[i] == 0xFFF4 + i);
+    }
+    HOST_CHECK(test_read(0xFFFF, 1, values) == MB_ENOERR);
+    HOST_CHECK(values[0] == 0xFFFF);
+    HOST_CHECK(test_read(0xFFFA, 8, values) == MB_ENOREG);
+
+    // The input registers are gathered the same way
+    UCHAR buffer[16];
+    HOST_CHECK(eMBRegInputCB(buffer, 3 + 1, 4) == MB_ENOERR);
+    HOST_CHECK((buffer[1] == 3) && (buffer[3] == 0x10) && (buffer[7] == 0x12));
+    HOST_CHECK(eMBRegInputCB(buffer, 3 + 1, 6) == MB_ENOREG);
+}
+
+int main(void)
+{
+    test_iface.opts.port_type = MB_PORT_COUNT;
+    mbc_slave_init_iface(&test_iface);
+    test_reset();
+    for (int a = 0; a < 4; a++) {
+        test_add_area(MB_PARAM_HOLDING, test_holding_start[a], test_holding[a], sizeof(test_holding[a]));
+    }
+    test_add_area(MB_PARAM_HOLDING, 0xFFF0, test_top[0], sizeof(test_top[0]));
+    test_add_area(MB_PARAM_HOLDING, 0xFFF8, test_top[1], sizeof(test_top[1]));
+    for (int i = 0; i < 4; i++) {
+        test_input[0][i] = (uint16_t)i;
+        test_input[1][i] = (uint16_t)(0x10 + i);
+    }
+    test_add_area(MB_PARAM_INPUT, 0, test_input[0], sizeof(test_input[0]));
+    test_add_area(MB_PARAM_INPUT, 4, test_input[1], sizeof(test_input[1]));
+    HOST_CHECK(mbc_slave_freeze_descriptors(&test_iface.opts) == ESP_OK);
+
+    test_holding_reads(false);
+    test_holding_reads(true);
+    test_holding_writes();
+    test_handlers();
+    test_top_and_input();
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Address map of the ModbusTcpSlave accessors (holding_map/input_map).
+ *
+ * Checks the page indexed lookup against the blocks of modbus_map.h for
+ * every 16-bit address, the bounds of the range lookup and the accessors of
+ * an instance on the first and last address of each block. Then compares
+ * the cost of the lookup with the scan of the blocks in order, as the chain
+ * of address comparisons of the accessors did, for an address in the first,
+ * a middle and the last block.
+ */
+
+#include <string.h>
+
+#include "modbus_tcp_slave.c"
+#include "host_test.h"
+
+#define TEST_BENCH_LOOKUPS  (20000000)
+
+typedef struct {
+    uint16_t start;
+    uint16_t size;
+    mb_elem_type_t type;
+    void *data;
+} test_block_t;
+
+#define TEST_BLOCK(start, size, data, type, seqlock) { (start), (size), (type), (void*)(data) },
+
+static const test_block_t test_holding[] = { MODBUS_MAP_HOLDING_RANGES(TEST_BLOCK) };
+static const test_block_t test_input[] = { MODBUS_MAP_INPUT_RANGES(TEST_BLOCK) };
+
+#define TEST_COUNT(blocks)  (sizeof(blocks) / sizeof((blocks)[0]))
+
+// Block of the address by the scan of the blocks in the order of modbus_map.h
+static __attribute__((noinline)) const test_block_t *test_scan(const test_block_t *blocks, size_t count,
+                                                              uint16_t addr)
+{
+    for (size_t i = 0; i < count; i++) {
+        if ((addr >= blocks[i].start) && (addr < blocks[i].start + blocks[i].size)) {
+            return &blocks[i];
+        }
+    }
+    return NULL;
+}
+
+static __attribute__((noinline)) const modbus_map_range_t *test_lookup(const modbus_map_range_t *map,
+                                                                      uint16_t addr)
+{
+    return map_lookup(map, addr);
+}
+
+static void test_every_address(const modbus_map_range_t *map, const test_block_t *blocks, size_t count)
+{
+    unsigned mapped = 0, expected = 0;
+    for (size_t i = 0; i < count; i++) {
+        expected += blocks[i].size;
+    }
+    for (uint32_t addr = 0; addr <= UINT16_MAX; addr++) {
+        const modbus_map_range_t *range = map_lookup(map, (uint16_t)addr);
+        const test_block_t *block = test_scan(blocks, count, (uint16_t)addr);
+        HOST_CHECK(!range == !block);
+        if (range) {
+            HOST_CHECK((range->start == block->start) && (range->size == block->size));
+            HOST_CHECK((range->type == block->type) && (range->data == block->data));
+            mapped++;
+        }
+    }
+    HOST_CHECK(mapped == expected);
+}
+
+static void test_ranges(const modbus_map_range_t *map, const test_block_t *blocks, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const test_block_t *block = &blocks[i];
+        uint16_t end = block->start + block->size;
+        HOST_CHECK(map_lookup_range(map, block->start, block->size) != NULL);
+        HOST_CHECK(map_lookup_range(map, end - 1, 1) != NULL);
+        HOST_CHECK(map_lookup_range(map, block->start, block->size + 1) == NULL);
+        HOST_CHECK(map_lookup_range(map, end - 1, 2) == NULL);
+        HOST_CHECK(map_lookup_range(map, end, 1) == NULL);
+        HOST_CHECK(map_lookup_range(map, block->start, 0) == NULL);
+        if (block->start) {
+            HOST_CHECK(map_lookup_range(map, block->start - 1, 2) == NULL);
+        }
+    }
+    // The end of the range does not wrap around to the first page
+    HOST_CHECK(map_lookup_range(map, UINT16_MAX, 2) == NULL);
+    HOST_CHECK(map_lookup_range(map, UINT16_MAX, UINT16_MAX) == NULL);
+}
+
+static void test_accessors(void)
+{
+    modbus_tcp_config_t config = { 0 };
+    modbus_tcp_handle_t handle = NULL;
+    HOST_CHECK(modbus_tcp_slave_init(&config, &handle) == ESP_OK);
+
+    for (size_t i = 0; i < TEST_COUNT(test_holding); i++) {
+        const test_block_t *block = &test_holding[i];
+        uint16_t last = block->start + block->size - 1;
+        uint16_t first = (uint16_t)(((block->size == 1) ? 200 : 100) + i), value = 0;
+        HOST_CHECK(modbus_tcp_set_holding_register(handle, block->start, (uint16_t)(100 + i)) == ESP_OK);
+        HOST_CHECK(modbus_tcp_set_holding_register(handle, last, (uint16_t)(200 + i)) == ESP_OK);
+        HOST_CHECK(modbus_tcp_get_holding_register(handle, last, &value) == ESP_OK && value == 200 + i);
+        if (block->type == MB_ELEM_FLOAT) {
+            HOST_CHECK(((float*)block->data)[0] == first);
+            HOST_CHECK(((float*)block->data)[block->size - 1] == 200 + i);
+        } else {
+            HOST_CHECK(((uint16_t*)block->data)[0] == first);
+            HOST_CHECK(((uint16_t*)block->data)[block->size - 1] == 200 + i);
+        }
+        HOST_CHECK(modbus_tcp_set_holding_register(handle, last + 1, 1) == ESP_ERR_INVALID_ARG);
+        HOST_CHECK(modbus_tcp_get_holding_register(handle, last + 1, &value) == ESP_ERR_INVALID_ARG);
+    }
+    HOST_CHECK(modbus_tcp_set_holding_reg_float(handle, 7, 2.5f) == ESP_OK);
+    HOST_CHECK(holding_reg_params.holding_data7 == 2.5f);
+
+    float value = 0;
+    input_reg_params.input_data7 = 4.25f;
+    HOST_CHECK(modbus_tcp_get_input_reg_float(handle, 7, &value) == ESP_OK && value == 4.25f);
+    HOST_CHECK(modbus_tcp_get_input_reg_float(handle, 8, &value) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_set_input_reg_float(handle, 1000, 1.0f) == ESP_ERR_INVALID_ARG);
+
+    HOST_CHECK(modbus_tcp_slave_destroy(handle) == ESP_OK);
+}
+
+static double bench_lookup(uint16_t addr, bool scan)
+{
+    volatile uint16_t source = addr;
+    uint64_t start = host_now_ns();
+    for (int i = 0; i < TEST_BENCH_LOOKUPS; i++) {
+        if (scan) {
+            const test_block_t *block = test_scan(test_holding, TEST_COUNT(test_holding), source);
+            HOST_KEEP(block);
+        } else {
+            const modbus_map_range_t *range = test_lookup(holding_map, source);
+            HOST_KEEP(range);
+        }
+    }
+    return (double)(host_now_ns() - start) / TEST_BENCH_LOOKUPS;
+}
+
+static void bench(void)
+{
+    printf("holding address lookup over %zu blocks, ns per lookup:\n", TEST_COUNT(test_holding));
+    const uint16_t addrs[] = { REG_HOLDING_FLOAT_START, REG_4000_START + 3, REG_UNITSPECS_START + 19 };
+    for (size_t i = 0; i < sizeof(addrs) / sizeof(addrs[0]); i++) {
+        double scan = bench_lookup(addrs[i], true);
+        double table = bench_lookup(addrs[i], false);
+        printf("  address %5u: scan of the blocks %5.1f, map_lookup %5.1f\n", addrs[i], scan, table);
+    }
+}
+
+int main(void)
+{
+    test_every_address(holding_map, test_holding, TEST_COUNT(test_holding));
+    test_every_address(input_map, test_input, TEST_COUNT(test_input));
+    test_ranges(holding_map, test_holding, TEST_COUNT(test_holding));
+    test_ranges(input_map, test_input, TEST_COUNT(test_input));
+    test_accessors();
+    bench();
+    printf("OK\n");
+    return 0;
+}
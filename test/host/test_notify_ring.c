@@ -0,0 +1,197 @@
+/*
+ * Parameter notification ring of the slave controller (white box, includes esp_modbus_slave.c).
+ *
+ * Puts the accesses as the register callbacks do and takes them as the
+ * application task does. Repeated accesses to an area are merged into its
+ * pending entry within the coalescing depth, an entry taken by the consumer
+ * is not merged anymore. A full ring drops the new areas but still merges
+ * the pending ones. Then a producer thread floods the ring while a consumer
+ * thread takes it: every access is counted once, in the hits of the taken
+ * entries or in the overflows, and the entries keep the order of the puts.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "esp_modbus_slave.c"
+
+#include "host_test.h"
+
+#define TEST_RING_SIZE      (8)
+#define TEST_FLOOD_ACCESSES (150000)
+#define TEST_FLOOD_REPEAT   (3)     // Consecutive accesses to each area of the flood
+#define TEST_BATCH          (16)
+#define TEST_FLOOD_BURST    (30)    // Accesses put before the producer yields, to more areas than the ring holds
+
+static mb_slave_options_t test_opts;
+static uint8_t test_data[256];
+
+static esp_err_t test_put(mb_event_group_t type, uint16_t offset, uint16_t size)
+{
+    return mbc_slave_send_param_info(&test_opts, type, offset, &test_data[offset % 128], size);
+}
+
+static size_t test_get(mb_param_info_t *info, size_t max_count, uint32_t timeout)
+{
+    return mbc_slave_notify_ring_get(&test_opts.mbs_notify_ring, info, max_count, timeout);
+}
+
+static void test_order_and_coalescing(void)
+{
+    mb_param_ring_t *ring = &test_opts.mbs_notify_ring;
+    mb_param_info_t info[TEST_BATCH];
+
+    // Distinct areas are taken in the order of the puts
+    for (uint16_t i = 0; i < 5; i++) {
+        HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_WR, i, 2) == ESP_OK);
+    }
+    HOST_CHECK(test_get(info, TEST_BATCH, 0) == 5);
+    for (uint16_t i = 0; i < 5; i++) {
+        HOST_CHECK((info[i].mb_offset == i) && (info[i].hits == 1) && (info[i].size == 2));
+        HOST_CHECK(info[i].address == &test_data[i]);
+    }
+
+    // The accesses to a pending area are merged, also with other areas put in between
+    HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_WR, 10, 2) == ESP_OK);
+    HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_WR, 10, 2) == ESP_OK);
+    HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_RD, 10, 2) == ESP_OK);
+    HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_WR, 11, 2) == ESP_OK);
+    HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_WR, 10, 2) == ESP_OK);
+    HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_WR, 10, 4) == ESP_OK);
+    HOST_CHECK(test_get(info, TEST_BATCH, 0) == 4);
+    HOST_CHECK((info[0].type == MB_EVENT_HOLDING_REG_WR) && (info[0].hits == 3));
+    HOST_CHECK((info[1].type == MB_EVENT_HOLDING_REG_RD) && (info[1].hits == 1));
+    HOST_CHECK((info[2].mb_offset == 11) && (info[2].hits == 1));
+    HOST_CHECK((info[3].size == 4) && (info[3].hits == 1));
+    HOST_CHECK(atomic_load(&ring->coalesced) == 2);
+
+    // An area older than the coalescing depth gets a new entry
+    HOST_CHECK(test_put(MB_EVENT_COILS_WR, 20, 1) == ESP_OK);
+    for (uint16_t i = 0; i < MB_NOTIFY_COALESCE_DEPTH; i++) {
+        HOST_CHECK(test_put(MB_EVENT_COILS_WR, (uint16_t)(21 + i), 1) == ESP_OK);
+    }
+    HOST_CHECK(test_put(MB_EVENT_COILS_WR, 20, 1) == ESP_OK);
+    HOST_CHECK(test_get(info, TEST_BATCH, 0) == MB_NOTIFY_COALESCE_DEPTH + 2);
+    HOST_CHECK((info[0].mb_offset == 20) && (info[MB_NOTIFY_COALESCE_DEPTH + 1].mb_offset == 20));
+
+    // The entry taken by the consumer is not merged anymore
+    HOST_CHECK(test_put(MB_EVENT_INPUT_REG_RD, 30, 1) == ESP_OK);
+    HOST_CHECK(test_get(info, 1, 0) == 1);
+    HOST_CHECK(test_put(MB_EVENT_INPUT_REG_RD, 30, 1) == ESP_OK);
+    HOST_CHECK((test_get(info, TEST_BATCH, 0) == 1) && (info[0].hits == 1));
+
+    // The events out of the mask are not put
+    atomic_store(&ring->event_mask, (unsigned)MB_EVENT_HOLDING_REG_WR);
+    HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_RD, 40, 1) == ESP_OK);
+    HOST_CHECK(test_get(info, TEST_BATCH, 0) == 0);
+    atomic_store(&ring->event_mask, (unsigned)MB_EVENT_ACCESS_MASK);
+}
+
+static void test_overflow(void)
+{
+    mb_param_ring_t *ring = &test_opts.mbs_notify_ring;
+    mb_param_info_t info[TEST_BATCH];
+    unsigned overflows = atomic_load(&ring->overflows);
+
+    for (uint16_t i = 0; i < TEST_RING_SIZE; i++) {
+        HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_WR, (uint16_t)(50 + i), 1) == ESP_OK);
+    }
+    // A new area is dropped, the pending one is still merged
+    HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_WR, 70, 1) == ESP_FAIL);
+    HOST_CHECK(atomic_load(&ring->overflows) == overflows + 1);
+    HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_WR, 50 + TEST_RING_SIZE - 1, 1) == ESP_OK);
+
+    // The entry taken frees its slot
+    HOST_CHECK(test_get(info, 1, 0) == 1);
+    HOST_CHECK(info[0].mb_offset == 50);
+    HOST_CHECK(test_put(MB_EVENT_HOLDING_REG_WR, 70, 1) == ESP_OK);
+    HOST_CHECK(test_get(info, TEST_BATCH, 0) == TEST_RING_SIZE);
+    HOST_CHECK(info[TEST_RING_SIZE - 2].hits == 2);
+    HOST_CHECK(info[TEST_RING_SIZE - 1].mb_offset == 70);
+
+    // The empty ring waits up to the timeout
+    uint64_t start = host_now_ns();
+    HOST_CHECK(test_get(info, TEST_BATCH, 50) == 0);
+    HOST_CHECK((host_now_ns() - start) >= 40000000ULL);
+}
+
+static volatile bool test_consumer_ready;
+static volatile bool test_producer_done;
+
+static void *test_producer(void *arg)
+{
+    (void)arg;
+    while (!test_consumer_ready) {
+        sched_yield();
+    }
+    for (uint32_t i = 0; i < TEST_FLOOD_ACCESSES; i++) {
+        (void)test_put(MB_EVENT_HOLDING_REG_WR, (uint16_t)(i / TEST_FLOOD_REPEAT), 1);
+        // Lets the consumer run on a single core as well
+        if ((i % TEST_FLOOD_BURST) == (TEST_FLOOD_BURST - 1)) {
+            sched_yield();
+        }
+    }
+    test_producer_done = true;
+    return NULL;
+}
+
+static void test_flood(void)
+{
+    mb_param_ring_t *ring = &test_opts.mbs_notify_ring;
+    mb_param_info_t info[TEST_BATCH];
+    unsigned queued = atomic_load(&ring->queued);
+    unsigned coalesced = atomic_load(&ring->coalesced);
+    unsigned overflows = atomic_load(&ring->overflows);
+    uint64_t hits = 0;
+    uint32_t taken = 0;
+    int last_offset = -1;
+    pthread_t producer;
+
+    test_producer_done = false;
+    uint64_t start = host_now_ns();
+    HOST_CHECK(pthread_create(&producer, NULL, test_producer, NULL) == 0);
+    test_consumer_ready = true;
+    for (;;) {
+        bool done = test_producer_done;
+        // The consumer polls to keep up with the producer
+        size_t count = test_get(info, TEST_BATCH, 0);
+        for (size_t i = 0; i < count; i++) {
+            // The offsets wrap every 65536 areas, the flood stays below
+            HOST_CHECK((int)info[i].mb_offset >= last_offset);
+            HOST_CHECK(info[i].hits >= 1);
+            last_offset = info[i].mb_offset;
+            hits += info[i].hits;
+        }
+        taken += (uint32_t)count;
+        if (done && !count) {
+            break;
+        }
+        if (!count) {
+            sched_yield();
+        }
+    }
+    pthread_join(producer, NULL);
+    double elapsed_s = (double)(host_now_ns() - start) / 1e9;
+
+    queued = atomic_load(&ring->queued) - queued;
+    coalesced = atomic_load(&ring->coalesced) - coalesced;
+    overflows = atomic_load(&ring->overflows) - overflows;
+    HOST_CHECK(taken == queued);
+    HOST_CHECK(queued + coalesced + overflows == TEST_FLOOD_ACCESSES);
+    HOST_CHECK(hits + overflows == TEST_FLOOD_ACCESSES);
+    printf("%d accesses in %.2f s: %u entries, %u merged, %u dropped\n",
+           TEST_FLOOD_ACCESSES, elapsed_s, queued, coalesced, overflows);
+}
+
+int main(void)
+{
+    HOST_CHECK(TEST_FLOOD_ACCESSES / TEST_FLOOD_REPEAT < 0x10000);
+    HOST_CHECK(mbc_slave_notify_ring_create(&test_opts.mbs_notify_ring, TEST_RING_SIZE - 1) == ESP_OK);
+    HOST_CHECK(test_opts.mbs_notify_ring.mask == TEST_RING_SIZE - 1);
+    test_order_and_coalescing();
+    test_overflow();
+    test_flood();
+    mbc_slave_notify_ring_delete(&test_opts.mbs_notify_ring);
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ * Range accessors of the ModbusTcpSlave library (modbus_tcp_*_range).
+ *
+ * Checks that a range is validated as a whole before anything is copied,
+ * the register words of the float blocks (two per value, the addresses the
+ * master uses, without conversion), the copy from the block memory itself
+ * and the coil and discrete bitmaps at every bit offset against a bit by bit
+ * reference. The locks taken by the accessors are counted: one per call.
+ * Then compares a sync of the holding blocks and discrete inputs done with
+ * the single accessors against one range call per block.
+ */
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "host_test.h"
+
+// Every lock taken by the library is counted
+static unsigned test_takes;
+
+static BaseType_t test_take(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    test_takes++;
+    return (xSemaphoreTake)(semaphore, ticks);
+}
+
+#define xSemaphoreTake(semaphore, ticks)    test_take((semaphore), (ticks))
+
+#include "modbus_tcp_slave.c"
+
+#define TEST_BENCH_SYNCS    (200000)
+
+static modbus_tcp_handle_t test_handle;
+
+static int test_get_bit(const uint8_t *buf, unsigned bit)
+{
+    return (buf[bit / 8] >> (bit % 8)) & 1;
+}
+
+static void test_registers(void)
+{
+    uint16_t src[REG_UNITSPECS_SIZE + 1], dst[REG_UNITSPECS_SIZE + 1];
+    for (int i = 0; i < REG_UNITSPECS_SIZE + 1; i++) {
+        src[i] = (uint16_t)(100 + i);
+    }
+
+    test_takes = 0;
+    HOST_CHECK(modbus_tcp_write_holding_range(test_handle, REG_UNITSPECS_START, REG_UNITSPECS_SIZE, src) == ESP_OK);
+    HOST_CHECK(test_takes == 1);
+    HOST_CHECK(memcmp(reg9000, src, sizeof(reg9000)) == 0);
+    HOST_CHECK(modbus_tcp_read_holding_range(test_handle, REG_UNITSPECS_START + 5, 15, dst) == ESP_OK);
+    HOST_CHECK(test_takes == 2);
+    HOST_CHECK(memcmp(dst, &src[5], 15 * sizeof(uint16_t)) == 0);
+
+    // Out of the block in part: rejected and nothing is written
+    memset(reg4000, 0, sizeof(reg4000));
+    HOST_CHECK(modbus_tcp_write_holding_range(test_handle, REG_UNITSPECS_START + 1, REG_UNITSPECS_SIZE, src) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_write_holding_range(test_handle, REG_4000_START + 7, 2, src) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_write_holding_range(test_handle, REG_4000_START - 1, 2, src) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_write_holding_range(test_handle, REG_4000_START, 0, src) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_read_holding_range(test_handle, REG_4000_START, 9, dst) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_write_holding_range(test_handle, REG_4000_START, 2, NULL) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_write_input_range(test_handle, REG_INPUT_FLOAT_START, REG_INPUT_FLOAT_SIZE * 2 + 1, src) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(test_takes == 2);
+    HOST_CHECK(reg4000[7] == 0 && reg9000[0] == 100);
+
+    // Float blocks hold two registers per value, the words are copied as the master sees them,
+    // under their seqlock instead of the mutex
+    const float *holding_floats = &holding_reg_params.holding_data0;
+    HOST_CHECK(modbus_tcp_read_holding_range(test_handle, REG_HOLDING_FLOAT_START, REG_HOLDING_FLOAT_SIZE * 2, dst) == ESP_OK);
+    HOST_CHECK(memcmp(dst, holding_floats, REG_HOLDING_FLOAT_SIZE * sizeof(float)) == 0);
+    holding_reg_params.holding_data1 = 1.0f;   // 0x3F800000, the low word first
+    HOST_CHECK(modbus_tcp_read_holding_range(test_handle, 3, 1, dst) == ESP_OK);
+    HOST_CHECK(dst[0] == 0x3F80);
+    // The second word of a value and the first word of the next one
+    const uint16_t halves[2] = { 0x4040, 0x0000 };
+    holding_reg_params.holding_data2 = -2.0f;  // 0xC0000000
+    holding_reg_params.holding_data3 = 1.5f;   // 0x3FC00000
+    HOST_CHECK(modbus_tcp_write_holding_range(test_handle, 5, 2, halves) == ESP_OK);
+    HOST_CHECK(holding_reg_params.holding_data2 == 3.0f && holding_reg_params.holding_data3 == 1.5f);
+    float value = 0.0f;
+    HOST_CHECK(modbus_tcp_get_holding_reg_float(test_handle, 2, &value) == ESP_OK && value == 3.0f);
+    const uint16_t words[2] = { 0x0000, 0x42C8 };  // 100.0f
+    HOST_CHECK(modbus_tcp_write_input_range(test_handle, REG_INPUT_FLOAT_SIZE * 2 - 2, 2, words) == ESP_OK);
+    HOST_CHECK(input_reg_params.input_data7 == 100.0f);
+    HOST_CHECK(modbus_tcp_read_input_range(test_handle, REG_INPUT_FLOAT_SIZE * 2 - 1, 1, dst) == ESP_OK);
+    HOST_CHECK(dst[0] == 0x42C8);
+    HOST_CHECK(test_takes == 2);
+
+    // The source can be the memory of the block itself
+    reg3000[0] = 0x1234;
+    reg3000[1] = 0x5678;
+    HOST_CHECK(modbus_tcp_write_holding_range(test_handle, REG_3000_START, REG_3000_SIZE, reg3000) == ESP_OK);
+    HOST_CHECK(reg3000[0] == 0x1234 && reg3000[1] == 0x5678);
+}
+
+// Writes and reads every range of the bit area against the bits kept by the test
+static void test_bit_area(uint8_t *area, unsigned bits, bool coils)
+{
+    uint8_t ref[4] = { 0 }, values[4], read[4];
+    memcpy(ref, area, (bits + 7) / 8);
+    srand(1);
+    for (unsigned start = 0; start < bits; start++) {
+        for (unsigned count = 1; start + count <= bits; count++) {
+            for (size_t b = 0; b < sizeof(values); b++) {
+                values[b] = (uint8_t)rand();
+            }
+            test_takes = 0;
+            esp_err_t err = coils ? modbus_tcp_write_coil_range(test_handle, start, count, values)
+                                  : modbus_tcp_write_discrete_range(test_handle, start, count, values);
+            HOST_CHECK(err == ESP_OK && test_takes == 1);
+            for (unsigned b = 0; b < count; b++) {
+                ref[(start + b) / 8] &= (uint8_t)~(1 << ((start + b) % 8));
+                ref[(start + b) / 8] |= (uint8_t)(test_get_bit(values, b) << ((start + b) % 8));
+            }
+            HOST_CHECK(memcmp(area, ref, (bits + 7) / 8) == 0);
+
+            memset(read, 0xFF, sizeof(read));
+            err = coils ? modbus_tcp_read_coil_range(test_handle, start, count, read)
+                        : modbus_tcp_read_discrete_range(test_handle, start, count, read);
+            HOST_CHECK(err == ESP_OK);
+            for (unsigned b = 0; b < count; b++) {
+                HOST_CHECK(test_get_bit(read, b) == test_get_bit(values, b));
+            }
+        }
+        // One bit past the end of the area: rejected, nothing is written
+        HOST_CHECK((coils ? modbus_tcp_write_coil_range(test_handle, start, bits - start + 1, values)
+                          : modbus_tcp_write_discrete_range(test_handle, start, bits - start + 1, values))
+                   == ESP_ERR_INVALID_ARG);
+        HOST_CHECK(memcmp(area, ref, (bits + 7) / 8) == 0);
+    }
+}
+
+static void test_bits(void)
+{
+    modbus_tcp_instance_t *instance = get_instance(test_handle);
+    test_bit_area((uint8_t*)&coil_reg_params, MB_COIL_COUNT, true);
+    test_bit_area((uint8_t*)&instance->discrete_regs, MB_DISCRETE_COUNT, false);
+
+    uint8_t bits = 0x81;
+    bool value = false;
+    HOST_CHECK(modbus_tcp_read_coil_range(test_handle, 0, 0, &bits) == ESP_ERR_INVALID_ARG);
+
+    // The single accessors see the bits of the ranges
+    HOST_CHECK(modbus_tcp_write_coil_range(test_handle, 8, 8, &bits) == ESP_OK);
+    HOST_CHECK(modbus_tcp_get_coil(test_handle, 15, &value) == ESP_OK && value);
+    HOST_CHECK(modbus_tcp_get_coil(test_handle, 14, &value) == ESP_OK && !value);
+    HOST_CHECK(modbus_tcp_write_discrete_range(test_handle, 0, 8, &bits) == ESP_OK);
+    HOST_CHECK(modbus_tcp_get_discrete_input(test_handle, 7, &value) == ESP_OK && value);
+}
+
+// The holding blocks 1000-4000 and the discrete inputs, as the RTU -> TCP sync
+static void test_sync(bool range)
+{
+    static const struct {
+        uint16_t start;
+        uint16_t size;
+        uint16_t *data;
+    } blocks[] = {
+        { REG_CONFIG_START, REG_CONFIG_SIZE, holding_reg1000_params.reg1000 },
+        { REG_DATA_START, REG_DATA_SIZE, reg2000 },
+        { REG_3000_START, REG_3000_SIZE, reg3000 },
+        { REG_4000_START, REG_4000_SIZE, reg4000 },
+    };
+    uint8_t bits = 0x5A;
+    for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+        if (range) {
+            HOST_CHECK(modbus_tcp_write_holding_range(test_handle, blocks[i].start, blocks[i].size, blocks[i].data) == ESP_OK);
+        } else {
+            for (uint16_t r = 0; r < blocks[i].size; r++) {
+                HOST_CHECK(modbus_tcp_set_holding_register(test_handle, blocks[i].start + r, blocks[i].data[r]) == ESP_OK);
+            }
+        }
+    }
+    if (range) {
+        HOST_CHECK(modbus_tcp_write_discrete_range(test_handle, 0, 8, &bits) == ESP_OK);
+    } else {
+        for (uint16_t b = 0; b < 8; b++) {
+            HOST_CHECK(modbus_tcp_set_discrete_input(test_handle, b, (bits >> b) & 1) == ESP_OK);
+        }
+    }
+}
+
+static void bench(void)
+{
+    printf("sync of the holding blocks 1000-4000 and the discrete inputs:\n");
+    for (int range = 0; range < 2; range++) {
+        test_takes = 0;
+        uint64_t start = host_now_ns();
+        for (int i = 0; i < TEST_BENCH_SYNCS; i++) {
+            test_sync(range);
+        }
+        double ns = (double)(host_now_ns() - start) / TEST_BENCH_SYNCS;
+        printf("  %-18s %2u locks, %6.0f ns per sync\n", range ? "range accessors" : "single accessors",
+               test_takes / TEST_BENCH_SYNCS, ns);
+    }
+}
+
+int main(void)
+{
+    modbus_tcp_config_t config = { 0 };
+    HOST_CHECK(modbus_tcp_slave_init(&config, &test_handle) == ESP_OK);
+    test_registers();
+    test_bits();
+    bench();
+    HOST_CHECK(modbus_tcp_slave_destroy(test_handle) == ESP_OK);
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * RTU slave over a pty: frames taken as a whole on the UART TOUT event.
+ *
+ * Checks the requests of the slave at 2400 baud, where the t3.5 silence is
+ * long enough to be placed by the test despite the scheduling delays: a frame written in pieces inside the
+ * silence is one request (the attempts with a pause measured longer than half
+ * the silence are repeated), a pause longer than t3.5 splits it into two damaged
+ * frames. Frames with a CRC error, for another address, broadcast and longer
+ * than the buffer are not answered and the next request is. Then compares
+ * the latency of the whole frame path with the per byte receive state
+ * machine used before (the port falls back to it without the frame callback).
+ */
+
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <termios.h>
+
+#include "port.h"
+#include "mbport.h"
+#include "host_test.h"
+
+#define TEST_BAUDRATE       (2400)
+#define TEST_T35_US         (3 * 11 * 1000000 / TEST_BAUDRATE)  // RX timeout of the port: 3 symbols of 11 bits
+#define TEST_BENCH_BAUDRATE (115200)
+#define TEST_NO_RESPONSE_MS (100)
+#define TEST_BENCH_TRANS    (2000)
+#define TEST_PIECE_SIZE     (7)
+#define TEST_PIECE_PAUSE_US (1000)
+#define TEST_PIECE_GAP_US   (TEST_T35_US / 2)
+#define TEST_PIECE_ATTEMPTS (50)
+
+static size_t test_add_crc(uint8_t *adu, size_t length)
+{
+    uint16_t crc = host_crc16(adu, length);
+    adu[length] = (uint8_t)crc;
+    adu[length + 1] = (uint8_t)(crc >> 8);
+    return length + 2;
+}
+
+// FC16 request of count registers holding first + i, returns its length
+static size_t test_build_write(uint8_t *adu, uint16_t addr, uint16_t count, uint16_t first)
+{
+    size_t length = host_rtu_build_request(adu, 0x10, addr, count) - 2;
+    adu[length++] = (uint8_t)(count * 2);
+    for (uint16_t i = 0; i < count; i++) {
+        adu[length++] = (uint8_t)((first + i) >> 8);
+        adu[length++] = (uint8_t)(first + i);
+    }
+    return test_add_crc(adu, length);
+}
+
+static void test_read(int fd, uint16_t addr, uint16_t count, uint16_t first)
+{
+    uint8_t adu[260];
+    host_rtu_send(fd, adu, host_rtu_build_request(adu, 0x03, addr, count));
+    size_t length = 5 + count * 2;
+    HOST_CHECK(host_rtu_recv(fd, adu, length, 1000) == length);
+    HOST_CHECK((adu[0] == HOST_SLAVE_UID) && (adu[1] == 0x03) && (host_crc16(adu, length) == 0));
+    for (uint16_t i = 0; i < count; i++) {
+        HOST_CHECK(((adu[3 + i * 2] << 8) | adu[4 + i * 2]) == (uint16_t)(first + i));
+    }
+}
+
+static void test_no_response(int fd)
+{
+    uint8_t adu[260];
+    HOST_CHECK(host_rtu_recv(fd, adu, 1, TEST_NO_RESPONSE_MS) == 0);
+}
+
+// Writes the frame in pieces until every pause between them stayed within TEST_PIECE_GAP_US.
+// A longer pause (the test descheduled) may split the frame: that attempt is discarded.
+static void test_write_pieces(int fd, const uint8_t *adu, size_t length)
+{
+    for (int attempt = 0; attempt < TEST_PIECE_ATTEMPTS; attempt++) {
+        uint64_t max_gap_ns = 0;
+        uint64_t last_ns = 0;
+        for (size_t done = 0; done < length; done += TEST_PIECE_SIZE) {
+            uint64_t now_ns = host_now_ns();
+            if (done && ((now_ns - last_ns) > max_gap_ns)) {
+                max_gap_ns = now_ns - last_ns;
+            }
+            host_rtu_send(fd, &adu[done], (length - done < TEST_PIECE_SIZE) ? length - done : TEST_PIECE_SIZE);
+            last_ns = host_now_ns();
+            usleep(TEST_PIECE_PAUSE_US);
+        }
+        if (max_gap_ns <= TEST_PIECE_GAP_US * 1000ULL) {
+            return;
+        }
+        // Drops the response, if any, of the frame written with a long pause
+        uint8_t rsp[8];
+        (void)host_rtu_recv(fd, rsp, sizeof(rsp), TEST_NO_RESPONSE_MS);
+        tcflush(fd, TCIFLUSH);
+    }
+    fprintf(stderr, "no frame written in pieces within %d us\n", TEST_PIECE_GAP_US);
+    exit(1);
+}
+
+static void test_requests(void)
+{
+    int fd = -1;
+    pid_t slave = host_slave_fork_rtu(TEST_BAUDRATE, &fd);
+    uint8_t adu[300];
+
+    test_read(fd, 0, 1, 0);
+    test_read(fd, 200, 125, 200);
+    size_t length = test_build_write(adu, 300, 120, 0x5000);
+    host_rtu_send(fd, adu, length);
+    HOST_CHECK(host_rtu_recv(fd, adu, 8, 1000) == 8);
+    HOST_CHECK((adu[1] == 0x10) && (((adu[4] << 8) | adu[5]) == 120) && (host_crc16(adu, 8) == 0));
+    test_read(fd, 300, 120, 0x5000);
+    test_read(fd, 299, 1, 299);
+    test_read(fd, 420, 1, 420);
+
+    // CRC error: dropped, the next frame is served
+    length = host_rtu_build_request(adu, 0x03, 10, 2);
+    adu[length - 1] ^= 0x01;
+    host_rtu_send(fd, adu, length);
+    test_no_response(fd);
+    test_read(fd, 10, 2, 10);
+
+    // Another slave address, then a broadcast write which is applied without a response
+    length = host_rtu_build_request(adu, 0x03, 10, 2);
+    adu[0] = HOST_SLAVE_UID + 1;
+    host_rtu_send(fd, adu, test_add_crc(adu, length - 2));
+    test_no_response(fd);
+    length = host_rtu_build_request(adu, 0x06, 20, 0x1234);
+    adu[0] = 0;
+    host_rtu_send(fd, adu, test_add_crc(adu, length - 2));
+    test_no_response(fd);
+    test_read(fd, 20, 1, 0x1234);
+
+    // Written in pieces inside the t3.5 silence: one frame
+    length = test_build_write(adu, 400, 10, 0x6000);
+    test_write_pieces(fd, adu, length);
+    HOST_CHECK(host_rtu_recv(fd, adu, 8, 1000) == 8);
+    HOST_CHECK(adu[1] == 0x10);
+    test_read(fd, 400, 10, 0x6000);
+
+    // A pause longer than t3.5 inside the frame: two damaged frames, nothing is written
+    length = test_build_write(adu, 400, 10, 0x7000);
+    host_rtu_send(fd, adu, 9);
+    usleep(TEST_T35_US * 4);
+    host_rtu_send(fd, &adu[9], length - 9);
+    test_no_response(fd);
+    test_read(fd, 400, 10, 0x6000);
+
+    // Longer than the receive buffer: dropped with the buffer, the slave recovers
+    memset(adu, 0x55, sizeof(adu));
+    host_rtu_send(fd, adu, sizeof(adu));
+    test_no_response(fd);
+    tcflush(fd, TCIFLUSH);
+    test_read(fd, 10, 2, 10);
+
+    close(fd);
+    host_slave_kill(slave);
+}
+
+// Forks the RTU slave, without the frame callback the port runs the receive state machine per byte
+static pid_t test_fork_slave(bool byte_path, int *fd)
+{
+    int uart_fd = -1;
+    host_pty_open(fd, &uart_fd);
+    pid_t pid = fork();
+    HOST_CHECK(pid >= 0);
+    if (pid == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        close(*fd);
+        host_slave_start_rtu(uart_fd, TEST_BENCH_BAUDRATE);
+        if (byte_path) {
+            pxMBSerialFrameCB()->pxFrameReceived = NULL;
+        }
+        for (;;) {
+            pause();
+        }
+    }
+    close(uart_fd);
+    host_slave_wait_ready_rtu(*fd);
+    return pid;
+}
+
+static void bench_path(bool byte_path)
+{
+    static uint64_t samples[TEST_BENCH_TRANS];
+    int fd = -1;
+    pid_t slave = test_fork_slave(byte_path, &fd);
+    const uint16_t counts[] = { 1, 120 };
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        for (int i = 0; i < TEST_BENCH_TRANS; i++) {
+            uint8_t adu[260];
+            size_t length = test_build_write(adu, 500, counts[c], (uint16_t)i);
+            uint64_t start = host_now_ns();
+            host_rtu_send(fd, adu, length);
+            HOST_CHECK(host_rtu_recv(fd, adu, 8, 1000) == 8);
+            samples[i] = host_now_ns() - start;
+            HOST_CHECK((adu[1] == 0x10) && (host_crc16(adu, 8) == 0));
+        }
+        printf("  %-18s FC16 x %3u: p50 %6.1f us, p99 %6.1f us\n",
+               byte_path ? "per byte FSM" : "whole frame", counts[c],
+               (double)host_percentile(samples, TEST_BENCH_TRANS, 50) / 1000,
+               (double)host_percentile(samples, TEST_BENCH_TRANS, 99) / 1000);
+    }
+    test_read(fd, 500, counts[1], (uint16_t)(TEST_BENCH_TRANS - 1));
+    close(fd);
+    host_slave_kill(slave);
+}
+
+int main(void)
+{
+    test_requests();
+    printf("FC16 at %d baud over a pty, %d transactions stop and wait:\n", TEST_BENCH_BAUDRATE, TEST_BENCH_TRANS);
+    bench_path(false);
+    bench_path(true);
+    printf("OK\n");
+    return 0;
+}
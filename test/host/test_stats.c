@@ -0,0 +1,148 @@
+/*
+ * Request latency histograms of the slave stack (mbstats.c).
+ *
+ * Checks the bucket bounds and percentiles of the summary on recorded values,
+ * then runs the TCP slave in process and checks that every request is counted
+ * once per stage under its function code, the exception responses with the
+ * request code and the unlisted codes in the shared slot. The cost of a
+ * record call is reported at the end.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "port.h"
+#include "mbproto.h"
+#include "mbstats.h"
+#include "host_test.h"
+
+#define TEST_PORT           (15026)
+#define TEST_REQUESTS       (500)
+#define TEST_BENCH_RECORDS  (2000000)
+
+static xMBStatsSummary test_summary(eMBStatsTransport transport, UCHAR function, eMBStatsStage stage)
+{
+    xMBStatsSummary summary;
+    HOST_CHECK(xMBStatsGetSummary(transport, function, stage, &summary));
+    return summary;
+}
+
+// The stack records the request after the response is sent, the client may see the response first
+static void test_wait_recorded(UCHAR function, ULONG count)
+{
+    for (int retry = 0; retry < 100; retry++) {
+        if (test_summary(MB_STATS_TRANSPORT_TCP, function, MB_STATS_STAGE_TOTAL).ulCount >= count) {
+            return;
+        }
+        usleep(1000);
+    }
+}
+
+static void test_buckets(void)
+{
+    vMBStatsReset();
+    // 98 requests of 5 us, one of 1000 us and one beyond the last bucket
+    for (int i = 0; i < 98; i++) {
+        vMBStatsRecord(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_READ_COILS, 0, 1, 3, 5);
+    }
+    vMBStatsRecord(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_READ_COILS, 0, 0, 1000, 1000);
+    vMBStatsRecord(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_READ_COILS, 0, 0, 0, 1LL << 40);
+
+    xMBStatsSummary total = test_summary(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_READ_COILS, MB_STATS_STAGE_TOTAL);
+    HOST_CHECK(total.ulCount == 100);
+    // 5 us falls into [4, 8), the percentile is the upper bound of the bucket
+    HOST_CHECK(total.ulP50Us == 7);
+    HOST_CHECK(total.ulP99Us == 1023);
+    HOST_CHECK(total.ulMaxUs == UINT32_MAX);
+
+    xMBStatsSummary exec = test_summary(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_READ_COILS, MB_STATS_STAGE_EXEC);
+    HOST_CHECK((exec.ulCount == 100) && (exec.ulP50Us == 3) && (exec.ulMaxUs == 1000));
+    xMBStatsSummary queue = test_summary(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_READ_COILS, MB_STATS_STAGE_QUEUE);
+    HOST_CHECK((queue.ulCount == 100) && (queue.ulP50Us == 1) && (queue.ulMaxUs == 1));
+
+    // A bound above the maximum is limited by the maximum, time going back counts as 0
+    vMBStatsRecord(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_WRITE_REGISTER, 10, 5, 20, 22);
+    xMBStatsSummary write = test_summary(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_WRITE_REGISTER, MB_STATS_STAGE_TOTAL);
+    HOST_CHECK((write.ulCount == 1) && (write.ulP50Us == 12) && (write.ulMaxUs == 12));
+    HOST_CHECK(test_summary(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_WRITE_REGISTER, MB_STATS_STAGE_QUEUE).ulMaxUs == 0);
+
+    // The exception responses count with the request, the unlisted codes share one slot
+    vMBStatsRecord(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_WRITE_REGISTER | MB_FUNC_ERROR, 0, 0, 0, 1);
+    HOST_CHECK(test_summary(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_WRITE_REGISTER, MB_STATS_STAGE_TOTAL).ulCount == 2);
+    vMBStatsRecord(MB_STATS_TRANSPORT_SERIAL, 0x41, 0, 0, 0, 1);
+    vMBStatsRecord(MB_STATS_TRANSPORT_SERIAL, 0x64, 0, 0, 0, 1);
+    HOST_CHECK(test_summary(MB_STATS_TRANSPORT_SERIAL, MB_STATS_FUNC_OTHER, MB_STATS_STAGE_TOTAL).ulCount == 2);
+    HOST_CHECK(test_summary(MB_STATS_TRANSPORT_SERIAL, 0x41, MB_STATS_STAGE_TOTAL).ulCount == 2);
+    HOST_CHECK(test_summary(MB_STATS_TRANSPORT_TCP, MB_FUNC_READ_COILS, MB_STATS_STAGE_TOTAL).ulCount == 0);
+
+    xMBStatsSummary summary;
+    HOST_CHECK(!xMBStatsGetSummary(MB_STATS_TRANSPORT_COUNT, MB_FUNC_READ_COILS, MB_STATS_STAGE_TOTAL, &summary));
+    HOST_CHECK(!xMBStatsGetSummary(MB_STATS_TRANSPORT_TCP, MB_FUNC_READ_COILS, MB_STATS_STAGE_COUNT, &summary));
+
+    vMBStatsReset();
+    HOST_CHECK(test_summary(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_READ_COILS, MB_STATS_STAGE_TOTAL).ulCount == 0);
+}
+
+static void test_slave_requests(void)
+{
+    host_slave_start_ip(MB_MODE_TCP, TEST_PORT);
+    host_slave_wait_ready(MB_MODE_TCP, TEST_PORT);
+    test_wait_recorded(MB_FUNC_READ_HOLDING_REGISTER, 1);
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+    vMBStatsReset();
+
+    uint8_t adu[260];
+    for (int i = 0; i < TEST_REQUESTS; i++) {
+        (void)host_client_read_holding(fd, (uint16_t)i, (uint16_t)i, 8);
+        host_client_send(fd, adu, host_build_request(adu, (uint16_t)i, MB_FUNC_WRITE_REGISTER, 900, 900));
+        HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+    }
+    // Illegal data address, and a function code the slave does not implement
+    host_client_send(fd, adu, host_build_request(adu, 1, MB_FUNC_READ_HOLDING_REGISTER, HOST_SLAVE_REGS, 1));
+    HOST_CHECK((host_client_recv(fd, adu, sizeof(adu), 1000) == 9) && (adu[7] == 0x83));
+    host_client_send(fd, adu, host_build_request(adu, 2, 0x41, 0, 1));
+    HOST_CHECK((host_client_recv(fd, adu, sizeof(adu), 1000) == 9) && (adu[7] == 0xC1));
+    close(fd);
+    test_wait_recorded(MB_STATS_FUNC_OTHER, 1);
+
+    for (int stage = 0; stage < MB_STATS_STAGE_COUNT; stage++) {
+        xMBStatsSummary read = test_summary(MB_STATS_TRANSPORT_TCP, MB_FUNC_READ_HOLDING_REGISTER, stage);
+        HOST_CHECK(read.ulCount == TEST_REQUESTS + 1);
+        HOST_CHECK((read.ulP50Us <= read.ulP99Us) && (read.ulP99Us <= read.ulMaxUs));
+        HOST_CHECK(test_summary(MB_STATS_TRANSPORT_TCP, MB_FUNC_WRITE_REGISTER, stage).ulCount == TEST_REQUESTS);
+        HOST_CHECK(test_summary(MB_STATS_TRANSPORT_TCP, MB_STATS_FUNC_OTHER, stage).ulCount == 1);
+        HOST_CHECK(test_summary(MB_STATS_TRANSPORT_SERIAL, MB_FUNC_READ_HOLDING_REGISTER, stage).ulCount == 0);
+    }
+
+    printf("FC03 over TCP, %d requests, p50/p99/max us:\n", TEST_REQUESTS + 1);
+    const char *stages[MB_STATS_STAGE_COUNT] = { "queue", "exec", "send", "total" };
+    for (int stage = 0; stage < MB_STATS_STAGE_COUNT; stage++) {
+        xMBStatsSummary read = test_summary(MB_STATS_TRANSPORT_TCP, MB_FUNC_READ_HOLDING_REGISTER, stage);
+        printf("  %-5s %5lu %5lu %5lu\n", stages[stage], (unsigned long)read.ulP50Us,
+               (unsigned long)read.ulP99Us, (unsigned long)read.ulMaxUs);
+    }
+}
+
+static void bench_record(void)
+{
+    vMBStatsReset();
+    uint64_t start = host_now_ns();
+    for (int i = 0; i < TEST_BENCH_RECORDS; i++) {
+        int64_t t = i & 0xFFFF;
+        vMBStatsRecord(MB_STATS_TRANSPORT_TCP, MB_FUNC_READ_HOLDING_REGISTER, t, t + 3, t + 20, t + 25);
+    }
+    uint64_t elapsed = host_now_ns() - start;
+    HOST_CHECK(test_summary(MB_STATS_TRANSPORT_TCP, MB_FUNC_READ_HOLDING_REGISTER, MB_STATS_STAGE_TOTAL).ulCount
+                    == TEST_BENCH_RECORDS);
+    printf("vMBStatsRecord: %.1f ns per request (4 stages)\n", (double)elapsed / TEST_BENCH_RECORDS);
+}
+
+int main(void)
+{
+    test_buckets();
+    test_slave_requests();
+    bench_record();
+    printf("OK\n");
+    return 0;
+}
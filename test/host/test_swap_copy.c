@@ -0,0 +1,133 @@
+/*
+ * Register copy with the byte swap of the register transfers (mb_swap_copy_regs).
+ *
+ * Checks the copy against a per register reference for every alignment of
+ * both buffers, odd counts and the copy in place, without writing past the
+ * registers. Then writes holding registers with FC16 and reads them back
+ * with FC03 from a slave over TCP. The copy of 125 registers is compared
+ * with the _XFER_2_RD loop used before.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "mb_endianness_utils.h"
+#include "host_test.h"
+
+#define TEST_PORT           (15031)
+#define TEST_MAX_REGS       (130)
+#define TEST_GUARD          (8)
+#define TEST_BENCH_REGS     (125)
+#define TEST_BENCH_COPIES   (2000000)
+
+static void test_alignments(void)
+{
+    static uint8_t src[4 + TEST_MAX_REGS * 2] __attribute__((aligned(4)));
+    static uint8_t dst[4 + TEST_MAX_REGS * 2 + TEST_GUARD] __attribute__((aligned(4)));
+    static uint8_t ref[sizeof(dst)];
+    srand(1);
+    for (size_t count = 0; count <= TEST_MAX_REGS; count++) {
+        for (size_t src_offset = 0; src_offset < 4; src_offset++) {
+            for (size_t dst_offset = 0; dst_offset < 4; dst_offset++) {
+                for (size_t i = 0; i < sizeof(src); i++) {
+                    src[i] = (uint8_t)rand();
+                }
+                for (size_t i = 0; i < sizeof(dst); i++) {
+                    dst[i] = ref[i] = (uint8_t)rand();
+                }
+                for (size_t r = 0; r < count; r++) {
+                    ref[dst_offset + r * 2] = src[src_offset + r * 2 + 1];
+                    ref[dst_offset + r * 2 + 1] = src[src_offset + r * 2];
+                }
+                mb_swap_copy_regs(&dst[dst_offset], &src[src_offset], count);
+                HOST_CHECK(memcmp(dst, ref, sizeof(dst)) == 0);
+
+                // In place, as the typed conversions do
+                memcpy(ref, src, sizeof(src));
+                mb_swap_copy_regs(&src[src_offset], &src[src_offset], count);
+                mb_swap_copy_regs(&src[src_offset], &src[src_offset], count);
+                HOST_CHECK(memcmp(ref, src, sizeof(src)) == 0);
+            }
+        }
+    }
+}
+
+static void test_slave_registers(void)
+{
+    pid_t slave = host_slave_fork_ip(MB_MODE_TCP, TEST_PORT);
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+    // FC16 of FreeModbus takes up to 0x78 registers
+    const uint16_t counts[] = { 1, 2, 3, 61, 120 };
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        uint16_t addr = (uint16_t)(101 + i * 130);
+        uint16_t count = counts[i];
+        uint8_t adu[260];
+        size_t length = host_build_request(adu, (uint16_t)i, 0x10, addr, count);
+        adu[5] = (uint8_t)(7 + count * 2);
+        adu[length++] = (uint8_t)(count * 2);
+        for (uint16_t r = 0; r < count; r++) {
+            adu[length++] = (uint8_t)(0xA0 + r);
+            adu[length++] = (uint8_t)r;
+        }
+        host_client_send(fd, adu, length);
+        HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+        HOST_CHECK((adu[7] == 0x10) && (((adu[10] << 8) | adu[11]) == count));
+
+        host_client_send(fd, adu, host_build_request(adu, (uint16_t)i, 0x03, addr - 1, count + 2));
+        HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == (size_t)(9 + (count + 2) * 2));
+        // The registers around the written range keep the pattern of the slave
+        HOST_CHECK(((adu[9] << 8) | adu[10]) == addr - 1);
+        for (uint16_t r = 0; r < count; r++) {
+            HOST_CHECK((adu[11 + r * 2] == (uint8_t)(0xA0 + r)) && (adu[12 + r * 2] == (uint8_t)r));
+        }
+        HOST_CHECK(((adu[11 + count * 2] << 8) | adu[12 + count * 2]) == addr + count);
+    }
+    close(fd);
+    host_slave_kill(slave);
+}
+
+static double bench_copy(uint8_t *dst, const uint8_t *src, bool kernel)
+{
+    uint64_t start = host_now_ns();
+    for (int i = 0; i < TEST_BENCH_COPIES; i++) {
+        if (kernel) {
+            mb_swap_copy_regs(dst, src, TEST_BENCH_REGS);
+        } else {
+            uint8_t *pdest = dst;
+            const uint8_t *psrc = src;
+            for (int r = 0; r < TEST_BENCH_REGS; r++) {
+                _XFER_2_RD(pdest, psrc);
+            }
+        }
+        HOST_KEEP(dst);
+    }
+    return (double)(host_now_ns() - start) / TEST_BENCH_COPIES;
+}
+
+static void bench(void)
+{
+    static uint16_t area[TEST_BENCH_REGS];
+    static uint8_t pdu[260] __attribute__((aligned(4)));
+    for (int i = 0; i < TEST_BENCH_REGS; i++) {
+        area[i] = (uint16_t)(i * 77);
+    }
+    printf("%d registers from the area to the response, ns per copy:\n", TEST_BENCH_REGS);
+    // The data of an FC03 response starts at the offset 2 of the PDU, after the MBAP header at 9
+    const size_t offsets[] = { 4, 9 };
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+        double macro = bench_copy(&pdu[offsets[i]], (const uint8_t *)area, false);
+        double kernel = bench_copy(&pdu[offsets[i]], (const uint8_t *)area, true);
+        printf("  destination offset %zu: _XFER_2_RD %6.1f, mb_swap_copy_regs %6.1f\n",
+               offsets[i], macro, kernel);
+    }
+}
+
+int main(void)
+{
+    test_alignments();
+    test_slave_registers();
+    bench();
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Pipelined MBAP transactions of the TCP slave port.
+ *
+ * Checks that back to back requests of a client are all answered in order,
+ * including bursts deeper than CONFIG_FMB_TCP_PIPELINE_DEPTH, requests
+ * coalesced in one segment and a client closed with requests in the stack.
+ * Then reports the loopback throughput by number of requests in flight,
+ * one in flight being the stop-and-wait behaviour of the old port.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "host_test.h"
+
+#define TEST_PORT           (15021)
+#define TEST_BURST          (3 * CONFIG_FMB_TCP_PIPELINE_DEPTH)
+#define TEST_BENCH_TRANS    (20000)
+#define TEST_REGS           (16)
+
+static void test_burst_in_order(void)
+{
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+    uint8_t adu[TEST_BURST * 12];
+    size_t length = 0;
+    for (int i = 0; i < TEST_BURST; i++) {
+        length += host_build_request(&adu[length], (uint16_t)(100 + i), 0x03, (uint16_t)i, TEST_REGS);
+    }
+    // One send: the requests reach the port coalesced in one segment
+    host_client_send(fd, adu, length);
+    for (int i = 0; i < TEST_BURST; i++) {
+        uint8_t rsp[260];
+        HOST_CHECK(host_client_recv(fd, rsp, sizeof(rsp), 1000) == 9 + TEST_REGS * 2);
+        HOST_CHECK(((rsp[0] << 8) | rsp[1]) == 100 + i);
+        HOST_CHECK(((rsp[9] << 8) | rsp[10]) == i);
+    }
+    close(fd);
+}
+
+static void test_clients_interleaved(void)
+{
+    int fds[4];
+    for (int c = 0; c < 4; c++) {
+        fds[c] = host_client_connect(MB_MODE_TCP, TEST_PORT);
+        HOST_CHECK(fds[c] >= 0);
+    }
+    for (int round = 0; round < 50; round++) {
+        for (int c = 0; c < 4; c++) {
+            for (int i = 0; i < CONFIG_FMB_TCP_PIPELINE_DEPTH; i++) {
+                uint8_t adu[12];
+                size_t length = host_build_request(adu, (uint16_t)(c * 1000 + i), 0x03, (uint16_t)(c + i), 2);
+                host_client_send(fds[c], adu, length);
+            }
+        }
+        for (int c = 0; c < 4; c++) {
+            for (int i = 0; i < CONFIG_FMB_TCP_PIPELINE_DEPTH; i++) {
+                uint8_t rsp[64];
+                HOST_CHECK(host_client_recv(fds[c], rsp, sizeof(rsp), 1000) == 13);
+                HOST_CHECK(((rsp[0] << 8) | rsp[1]) == c * 1000 + i);
+                HOST_CHECK(((rsp[9] << 8) | rsp[10]) == c + i);
+            }
+        }
+    }
+    for (int c = 0; c < 4; c++) {
+        close(fds[c]);
+    }
+}
+
+static void test_close_with_pending(void)
+{
+    // The slot of a client closed with requests in flight is released once they complete
+    for (int round = 0; round < 20; round++) {
+        int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+        HOST_CHECK(fd >= 0);
+        uint8_t adu[TEST_BURST * 12];
+        size_t length = 0;
+        for (int i = 0; i < TEST_BURST; i++) {
+            length += host_build_request(&adu[length], (uint16_t)i, 0x03, 0, 100);
+        }
+        host_client_send(fd, adu, length);
+        close(fd);
+    }
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+    (void)host_client_read_holding(fd, 7, 10, 4);
+    close(fd);
+}
+
+static double bench_in_flight(int in_flight)
+{
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+    uint8_t adu[12];
+    uint8_t rsp[260];
+    int sent = 0;
+    int received = 0;
+    uint64_t start = host_now_ns();
+    while ((sent < in_flight) && (sent < TEST_BENCH_TRANS)) {
+        host_client_send(fd, adu, host_build_request(adu, (uint16_t)sent, 0x03, 0, TEST_REGS));
+        sent++;
+    }
+    while (received < TEST_BENCH_TRANS) {
+        HOST_CHECK(host_client_recv(fd, rsp, sizeof(rsp), 1000) == 9 + TEST_REGS * 2);
+        HOST_CHECK(((rsp[0] << 8) | rsp[1]) == (uint16_t)received);
+        received++;
+        if (sent < TEST_BENCH_TRANS) {
+            host_client_send(fd, adu, host_build_request(adu, (uint16_t)sent, 0x03, 0, TEST_REGS));
+            sent++;
+        }
+    }
+    uint64_t elapsed = host_now_ns() - start;
+    close(fd);
+    return (double)TEST_BENCH_TRANS * 1e9 / (double)elapsed;
+}
+
+int main(void)
+{
+    pid_t slave = host_slave_fork_ip(MB_MODE_TCP, TEST_PORT);
+
+    test_burst_in_order();
+    test_clients_interleaved();
+    test_close_with_pending();
+
+    printf("pipeline depth %d, %d transactions of FC03 x %d registers\n",
+           CONFIG_FMB_TCP_PIPELINE_DEPTH, TEST_BENCH_TRANS, TEST_REGS);
+    const int in_flight[] = { 1, 2, 4, 8 };
+    for (size_t i = 0; i < sizeof(in_flight) / sizeof(in_flight[0]); i++) {
+        printf("  in flight %d: %8.0f trans/s\n", in_flight[i], bench_in_flight(in_flight[i]));
+    }
+
+    host_slave_kill(slave);
+    printf("OK\n");
+    return 0;
+}
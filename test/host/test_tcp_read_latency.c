@@ -0,0 +1,109 @@
+/*
+ * Register reads of the TCP slave: request to response latency.
+ *
+ * Built twice, with the default stack and with CONFIG_FMB_TCP_FAST_READ_EN
+ * where the port task answers the read holding and input registers requests
+ * itself. Both builds check the read values, the exception response and that
+ * a read queued behind a write sees the written value. Then the stop and wait
+ * latency of the reads is reported.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "host_test.h"
+
+#if CONFIG_FMB_TCP_FAST_READ_EN
+#define TEST_PORT           (15025)
+#define TEST_PATH           "port task fast path"
+#else
+#define TEST_PORT           (15024)
+#define TEST_PATH           "stack task"
+#endif
+#define TEST_BENCH_TRANS    (20000)
+#define TEST_REGS           (16)
+
+static uint16_t test_reg(const uint8_t *rsp, int i)
+{
+    return (uint16_t)((rsp[9 + 2 * i] << 8) | rsp[10 + 2 * i]);
+}
+
+static void test_reads(int fd)
+{
+    uint8_t adu[260];
+    host_client_send(fd, adu, host_build_request(adu, 1, 0x03, 100, TEST_REGS));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 9 + TEST_REGS * 2);
+    for (int i = 0; i < TEST_REGS; i++) {
+        HOST_CHECK(test_reg(adu, i) == 100 + i);
+    }
+
+    host_client_send(fd, adu, host_build_request(adu, 2, 0x04, 200, TEST_REGS));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 9 + TEST_REGS * 2);
+    for (int i = 0; i < TEST_REGS; i++) {
+        HOST_CHECK(test_reg(adu, i) == (0x8000 | (200 + i)));
+    }
+
+    // Out of the register area: illegal data address
+    host_client_send(fd, adu, host_build_request(adu, 3, 0x03, HOST_SLAVE_REGS - 4, TEST_REGS));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 9);
+    HOST_CHECK((adu[7] == 0x83) && (adu[8] == 0x02));
+}
+
+static void test_read_after_write(int fd)
+{
+    // The write is pending in the stack when the read arrives, the read must not overtake it
+    for (int round = 0; round < 200; round++) {
+        uint16_t value = (uint16_t)(0xA000 + round);
+        uint8_t adu[24];
+        size_t length = host_build_request(adu, (uint16_t)(2 * round), 0x06, 50, value);
+        length += host_build_request(&adu[length], (uint16_t)(2 * round + 1), 0x03, 50, 1);
+        host_client_send(fd, adu, length);
+
+        uint8_t rsp[64];
+        HOST_CHECK(host_client_recv(fd, rsp, sizeof(rsp), 1000) == 12);
+        HOST_CHECK(((rsp[0] << 8) | rsp[1]) == 2 * round);
+        HOST_CHECK(host_client_recv(fd, rsp, sizeof(rsp), 1000) == 11);
+        HOST_CHECK(((rsp[0] << 8) | rsp[1]) == 2 * round + 1);
+        HOST_CHECK(test_reg(rsp, 0) == value);
+    }
+    uint8_t adu[12];
+    host_client_send(fd, adu, host_build_request(adu, 0, 0x06, 50, 50));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+}
+
+static void bench_reads(int fd, uint8_t function)
+{
+    static uint64_t samples[TEST_BENCH_TRANS];
+    uint8_t adu[12];
+    uint8_t rsp[260];
+    for (int i = 0; i < TEST_BENCH_TRANS; i++) {
+        size_t length = host_build_request(adu, (uint16_t)i, function, (uint16_t)(i % 512), TEST_REGS);
+        uint64_t start = host_now_ns();
+        host_client_send(fd, adu, length);
+        HOST_CHECK(host_client_recv(fd, rsp, sizeof(rsp), 1000) == 9 + TEST_REGS * 2);
+        samples[i] = host_now_ns() - start;
+        HOST_CHECK(((rsp[0] << 8) | rsp[1]) == (uint16_t)i);
+    }
+    printf("  FC%02X x %d registers: p50 %llu us, p99 %llu us\n", function, TEST_REGS,
+           (unsigned long long)host_percentile(samples, TEST_BENCH_TRANS, 50) / 1000,
+           (unsigned long long)host_percentile(samples, TEST_BENCH_TRANS, 99) / 1000);
+}
+
+int main(void)
+{
+    pid_t slave = host_slave_fork_ip(MB_MODE_TCP, TEST_PORT);
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+
+    test_reads(fd);
+    test_read_after_write(fd);
+
+    printf("reads answered by the %s, %d transactions stop and wait:\n", TEST_PATH, TEST_BENCH_TRANS);
+    bench_reads(fd, 0x03);
+    bench_reads(fd, 0x04);
+
+    close(fd);
+    host_slave_kill(slave);
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Client slot pool of the TCP slave port under a reconnect storm.
+ *
+ * Clients connect, read once and close in a loop. The test reports the
+ * connect-to-response latency and checks the pool counters: every slot
+ * comes back, the high-water mark stays within the pool and the storm
+ * does not exhaust it. Then the pool is filled: the next connection waits
+ * in the backlog until a slot is released, and is served after that.
+ * Last, a client is dropped while its forwarded request is pending: the late
+ * response must not reach the connection accepted in the meantime.
+ */
+
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "port_tcp_slave.h"
+#include "host_test.h"
+
+#define TEST_PORT           (15023)
+#define TEST_STORM          (3000)
+#define TEST_FORWARD_UID    (0x11)
+
+static volatile bool test_forwarded = false;
+static MbForwardTicket_t test_ticket;
+
+static MbClientPoolStats_t test_pool_stats(void)
+{
+    MbClientPoolStats_t stats = { 0 };
+    HOST_CHECK(xMBTCPPortSlaveGetPoolStats(&stats));
+    return stats;
+}
+
+// The port task sees the closed connections asynchronously
+static MbClientPoolStats_t test_wait_idle_pool(void)
+{
+    MbClientPoolStats_t stats = test_pool_stats();
+    for (int retry = 0; (retry < 200) && stats.usInUse; retry++) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+        stats = test_pool_stats();
+    }
+    return stats;
+}
+
+static void test_storm(void)
+{
+    static uint64_t samples[TEST_STORM];
+    MbClientPoolStats_t before = test_wait_idle_pool();
+
+    uint64_t start = host_now_ns();
+    for (int i = 0; i < TEST_STORM; i++) {
+        uint64_t connect_start = host_now_ns();
+        int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+        HOST_CHECK(fd >= 0);
+        (void)host_client_read_holding(fd, (uint16_t)i, (uint16_t)(i % 100), 4);
+        samples[i] = host_now_ns() - connect_start;
+        close(fd);
+    }
+    uint64_t elapsed = host_now_ns() - start;
+
+    MbClientPoolStats_t after = test_wait_idle_pool();
+    HOST_CHECK(after.usInUse == 0);
+    HOST_CHECK(after.usHighWater <= after.usSize);
+    HOST_CHECK(after.ulExhausted == before.ulExhausted);
+    HOST_CHECK(after.ulDropped[MB_TCP_DROP_PEER_CLOSED] - before.ulDropped[MB_TCP_DROP_PEER_CLOSED] == TEST_STORM);
+
+    printf("storm of %d connections: %.0f conn/s, connect to response p50 %llu us, p99 %llu us\n",
+           TEST_STORM, (double)TEST_STORM * 1e9 / (double)elapsed,
+           (unsigned long long)host_percentile(samples, TEST_STORM, 50) / 1000,
+           (unsigned long long)host_percentile(samples, TEST_STORM, 99) / 1000);
+    printf("pool: size %u, high water %u, exhausted %lu\n",
+           (unsigned)after.usSize, (unsigned)after.usHighWater, (unsigned long)after.ulExhausted);
+}
+
+static void test_full_pool(void)
+{
+    MbClientPoolStats_t stats = test_pool_stats();
+    int fds[MB_TCP_PORT_MAX_CONN];
+    HOST_CHECK(stats.usSize <= MB_TCP_PORT_MAX_CONN);
+
+    // The held clients send a request, so none of them is idle enough to be replaced
+    for (int i = 0; i < stats.usSize; i++) {
+        fds[i] = host_client_connect(MB_MODE_TCP, TEST_PORT);
+        HOST_CHECK(fds[i] >= 0);
+        (void)host_client_read_holding(fds[i], (uint16_t)i, 0, 1);
+    }
+    HOST_CHECK(test_pool_stats().usInUse == stats.usSize);
+    HOST_CHECK(test_pool_stats().usHighWater == stats.usSize);
+
+    // The connection completes in the backlog, its request is not read until a slot is free
+    int extra = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(extra >= 0);
+    uint8_t adu[64];
+    host_client_send(extra, adu, host_build_request(adu, 0x77, 0x03, 5, 1));
+    HOST_CHECK(host_client_recv(extra, adu, sizeof(adu), 200) == 0);
+
+    close(fds[0]);
+    HOST_CHECK(host_client_recv(extra, adu, sizeof(adu), 1000) == 11);
+    HOST_CHECK(((adu[0] << 8) | adu[1]) == 0x77);
+    HOST_CHECK(((adu[9] << 8) | adu[10]) == 5);
+
+    close(extra);
+    for (int i = 1; i < stats.usSize; i++) {
+        close(fds[i]);
+    }
+    HOST_CHECK(test_wait_idle_pool().usInUse == 0);
+}
+
+// Called with the port lock taken, the request is answered later by the test
+static BOOL test_forward_cb(void *arg, MbForwardTicket_t ticket, UCHAR uid, const UCHAR *pdu, USHORT length)
+{
+    test_ticket = ticket;
+    test_forwarded = true;
+    return TRUE;
+}
+
+static void test_drop_forwarded(void)
+{
+    uint8_t adu[64];
+    vMBTCPPortSlaveSetForward(HOST_SLAVE_UID, test_forward_cb, NULL);
+
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+    size_t length = host_build_request(adu, 0x55, 0x03, 0, 1);
+    adu[6] = TEST_FORWARD_UID;
+    host_client_send(fd, adu, length);
+    for (int retry = 0; (retry < 200) && !test_forwarded; retry++) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    HOST_CHECK(test_forwarded);
+
+    // The slot of the dropped client and its socket are kept until the forwarded response
+    close(fd);
+    vTaskDelay(pdMS_TO_TICKS(50));
+    HOST_CHECK(test_pool_stats().usInUse == 1);
+
+    int next = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(next >= 0);
+    (void)host_client_read_holding(next, 0x66, 7, 1);
+
+    UCHAR pdu[] = { 0x03, 0x02, 0xAB, 0xCD };
+    HOST_CHECK(!xMBTCPPortSlaveForwardResponse(test_ticket, pdu, sizeof(pdu)));
+    HOST_CHECK(host_client_recv(next, adu, sizeof(adu), 200) == 0);
+    HOST_CHECK(test_pool_stats().usInUse == 1);
+
+    close(next);
+    HOST_CHECK(test_wait_idle_pool().usInUse == 0);
+    vMBTCPPortSlaveSetForward(HOST_SLAVE_UID, NULL, NULL);
+}
+
+int main(void)
+{
+    host_slave_start_ip(MB_MODE_TCP, TEST_PORT);
+    host_slave_wait_ready(MB_MODE_TCP, TEST_PORT);
+
+    test_storm();
+    test_full_pool();
+    test_drop_forwarded();
+
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * MBAP frame reassembly of the TCP slave port (white box, includes the port source).
+ *
+ * Frames written in random pieces to a socket pair must come out of the
+ * receive ring unchanged and in order. The benchmark then compares the ring
+ * (one recv per readiness event, frames parsed in place) with the previous
+ * scheme of two recv calls per frame, for one frame per segment and for
+ * frames coalesced into one segment. Both paths queue the frames as the
+ * port does.
+ */
+
+#include "port_tcp_slave.c"
+
+#include <sys/socket.h>
+
+#include "host_test.h"
+
+#define TEST_FRAMES         (4096)
+#define TEST_BENCH_FRAMES   (200000)
+#define TEST_MAX_FRAME      (7 + 6 + 2 * 100)
+
+typedef struct {
+    uint8_t data[TEST_MAX_FRAME];
+    size_t length;
+} test_frame_t;
+
+static test_frame_t frames[TEST_FRAMES];
+
+// FC03 reads and FC16 writes of 1 to 100 registers
+static size_t test_make_frame(uint8_t *adu, uint16_t tid, unsigned seed)
+{
+    if (seed % 3) {
+        return host_build_request(adu, tid, 0x03, (uint16_t)seed, (uint16_t)(1 + seed % 100));
+    }
+    uint16_t count = (uint16_t)(1 + seed % 100);
+    size_t length = host_build_request(adu, tid, 0x10, (uint16_t)seed, count);
+    adu[12] = (uint8_t)(count * 2);
+    for (int i = 0; i < count * 2; i++) {
+        adu[13 + i] = (uint8_t)(seed + i);
+    }
+    length += 1 + count * 2;
+    adu[4] = (uint8_t)((length - 6) >> 8);
+    adu[5] = (uint8_t)(length - 6);
+    return length;
+}
+
+static MbClientInfo_t *test_client(int fd)
+{
+    static BOOL pool_ready = FALSE;
+    if (!pool_ready) {
+        HOST_CHECK(xMBTCPPortPoolInit(&xConfig.xClientPool, 1));
+        pool_ready = TRUE;
+    }
+    MbClientInfo_t *client = NULL;
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        client = pxMBTCPPortPoolAcquire(&xConfig.xClientPool);
+    }
+    HOST_CHECK(client);
+    client->xSockId = fd;
+    return client;
+}
+
+static void test_client_release(MbClientInfo_t *client)
+{
+    CRITICAL_SECTION(xConfig.xTransLock) {
+        vMBTCPPortPoolRelease(&xConfig.xClientPool, client);
+    }
+}
+
+// Takes the queued transactions out as the stack does, checks them against the sent frames
+static size_t test_drain(MbClientInfo_t *client, size_t next, bool check)
+{
+    while (client->usTransCount) {
+        MbTransaction_t *trans = pxMBTCPPortTransHead(client);
+        if (check) {
+            HOST_CHECK(next < TEST_FRAMES);
+            HOST_CHECK(trans->usLength == frames[next].length);
+            HOST_CHECK(memcmp(trans->pucBuf, frames[next].data, frames[next].length) == 0);
+            HOST_CHECK(trans->usTid == (uint16_t)next);
+        }
+        CRITICAL_SECTION(xConfig.xTransLock) {
+            vMBTCPPortTransPop(client);
+        }
+        next++;
+    }
+    return next;
+}
+
+static void test_random_split(void)
+{
+    int sv[2];
+    HOST_CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    MbClientInfo_t *client = test_client(sv[0]);
+
+    static uint8_t stream[TEST_FRAMES * TEST_MAX_FRAME];
+    size_t stream_len = 0;
+    for (int i = 0; i < TEST_FRAMES; i++) {
+        frames[i].length = test_make_frame(frames[i].data, (uint16_t)i, (unsigned)rand());
+        memcpy(&stream[stream_len], frames[i].data, frames[i].length);
+        stream_len += frames[i].length;
+    }
+
+    size_t sent = 0;
+    size_t next = 0;
+    while (next < TEST_FRAMES) {
+        if (sent < stream_len) {
+            size_t piece = 1 + (size_t)rand() % 300;
+            piece = (piece > stream_len - sent) ? (stream_len - sent) : piece;
+            HOST_CHECK(write(sv[1], &stream[sent], piece) == (ssize_t)piece);
+            sent += piece;
+        }
+        // The queue fills after MB_TCP_PIPELINE_DEPTH frames, the rest stay in the ring
+        int ret;
+        do {
+            ret = xMBTCPPortRxPoll(client);
+            HOST_CHECK(ret >= 0);
+            next = test_drain(client, next, true);
+            ret += xMBTCPPortRxParse(client);
+            next = test_drain(client, next, true);
+        } while (ret > 0);
+    }
+    HOST_CHECK(client->usRxCount == 0);
+
+    // A length field out of range drops the connection
+    uint8_t bad[12];
+    host_build_request(bad, 1, 0x03, 0, 1);
+    bad[4] = 0x10;
+    HOST_CHECK(write(sv[1], bad, sizeof(bad)) == sizeof(bad));
+    HOST_CHECK(xMBTCPPortRxPoll(client) == ERR_BUF);
+
+    test_client_release(client);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+// Two recv calls per frame into the tail transaction buffer, MBAP header then the rest,
+// and the same commit into the queue, as the port did before the ring
+static int test_two_recv(MbClientInfo_t *client)
+{
+    int frames_read = 0;
+    for (;;) {
+        MbTransaction_t *trans = pxMBTCPPortTransTail(client);
+        ssize_t length = recv(client->xSockId, trans->pucBuf, MB_TCP_FUNC, MSG_DONTWAIT);
+        if (length <= 0) {
+            return frames_read;
+        }
+        HOST_CHECK(length == MB_TCP_FUNC);
+        size_t rest = MB_TCP_GET_FIELD(trans->pucBuf, MB_TCP_LEN) - 1;
+        HOST_CHECK(recv(client->xSockId, &trans->pucBuf[MB_TCP_FUNC], rest, MSG_DONTWAIT) == (ssize_t)rest);
+        vMBTCPPortTransCommit(client, trans, (USHORT)(MB_TCP_FUNC + rest));
+        (void)test_drain(client, 0, false);
+        frames_read++;
+    }
+}
+
+static double test_bench(bool ring, int per_segment)
+{
+    int sv[2];
+    HOST_CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    MbClientInfo_t *client = test_client(sv[0]);
+    uint8_t segment[64 * 12];
+    size_t segment_len = 0;
+    for (int i = 0; i < per_segment; i++) {
+        segment_len += host_build_request(&segment[segment_len], (uint16_t)i, 0x03, 0, 10);
+    }
+
+    int done = 0;
+    uint64_t start = host_now_ns();
+    while (done < TEST_BENCH_FRAMES) {
+        HOST_CHECK(write(sv[1], segment, segment_len) == (ssize_t)segment_len);
+        int pending = per_segment;
+        while (pending) {
+            int got;
+            if (ring) {
+                got = xMBTCPPortRxPoll(client);
+                (void)test_drain(client, 0, false);
+                got += xMBTCPPortRxParse(client);
+                (void)test_drain(client, 0, false);
+            } else {
+                got = test_two_recv(client);
+            }
+            pending -= got;
+        }
+        done += per_segment;
+    }
+    uint64_t elapsed = host_now_ns() - start;
+    test_client_release(client);
+    close(sv[0]);
+    close(sv[1]);
+    return (double)done * 1e9 / (double)elapsed;
+}
+
+int main(void)
+{
+    srand(1);
+    test_random_split();
+
+    printf("MBAP reassembly of FC03 frames (12 bytes), frames/s including the writer:\n");
+    const int per_segment[] = { 1, 4, 16 };
+    for (size_t i = 0; i < sizeof(per_segment) / sizeof(per_segment[0]); i++) {
+        double two_recv = test_bench(false, per_segment[i]);
+        double ring = test_bench(true, per_segment[i]);
+        printf("  %2d per segment: two recv %9.0f, ring %9.0f\n", per_segment[i], two_recv, ring);
+    }
+    printf("OK\n");
+    return 0;
+}
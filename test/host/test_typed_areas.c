@@ -0,0 +1,229 @@
+/*
+ * Typed register areas of the slave controller (white box, includes esp_modbus_slave.c).
+ *
+ * One holding area of three values for each element type and word order.
+ * The registers read from each area are compared with the wire bytes built
+ * by a reference of the word orders, the values written are read back from
+ * the area. Then every partial request is checked, the ones starting or
+ * ending in the middle of a value included (a float from its second
+ * register): the reads return the slice of the wire image and the writes
+ * change the registers of the request only. Last, a typed input area and
+ * the descriptors rejected by the typed checks.
+ */
+
+#include "esp_modbus_slave.c"
+
+#include "host_test.h"
+
+#define TEST_VALUES         (3)
+#define TEST_AREA_STRIDE    (16)    // Registers between the start of two areas
+
+static const char *const test_type_names[MB_ELEM_COUNT] = {
+    "U16", "I16", "U32", "I32", "FLOAT", "U64", "I64", "DOUBLE"
+};
+static const char *const test_order_names[MB_WORD_ORDER_COUNT] = { "ABCD", "CDAB", "BADC", "DCBA" };
+
+static mb_slave_interface_t test_iface;
+static uint64_t test_areas[MB_ELEM_COUNT][MB_WORD_ORDER_COUNT][TEST_VALUES];
+
+// Wire bytes of the native value of size bytes in the word order
+static void test_ref_encode(uint8_t *wire, const uint8_t *value, size_t size, mb_word_order_t order)
+{
+    uint8_t be[8];
+    size_t regs = size / 2;
+    // The value bytes from the most significant one (A)
+    for (size_t i = 0; i < size; i++) {
+        be[i] = value[size - 1 - i];
+    }
+    for (size_t r = 0; r < regs; r++) {
+        for (size_t b = 0; b < 2; b++) {
+            size_t src = 0;
+            switch (order) {
+                case MB_WORD_ORDER_ABCD: src = r * 2 + b; break;
+                case MB_WORD_ORDER_CDAB: src = (regs - 1 - r) * 2 + b; break;
+                case MB_WORD_ORDER_BADC: src = r * 2 + (1 - b); break;
+                default: src = size - 1 - (r * 2 + b); break;
+            }
+            wire[r * 2 + b] = be[src];
+        }
+    }
+}
+
+// Wire image of the whole area
+static void test_ref_image(uint8_t *wire, mb_elem_type_t type, mb_word_order_t order)
+{
+    size_t size = mb_get_elem_size(type);
+    for (int v = 0; v < TEST_VALUES; v++) {
+        test_ref_encode(&wire[v * size], (const uint8_t *)test_areas[type][order] + v * size, size, order);
+    }
+}
+
+static uint16_t test_start(mb_elem_type_t type, mb_word_order_t order)
+{
+    return (uint16_t)((type * MB_WORD_ORDER_COUNT + order) * TEST_AREA_STRIDE);
+}
+
+static void test_fill(mb_elem_type_t type, mb_word_order_t order, unsigned seed)
+{
+    void *values = test_areas[type][order];
+    for (int v = 0; v < TEST_VALUES; v++) {
+        float f = (float)seed * 1.25f - (float)v * 1000.5f;
+        double d = (double)seed * -3.0e100 + (double)v * 0.1;
+        switch (type) {
+            case MB_ELEM_FLOAT: memcpy((float *)values + v, &f, sizeof(f)); break;
+            case MB_ELEM_DOUBLE: memcpy((double *)values + v, &d, sizeof(d)); break;
+            default:
+                for (size_t b = 0; b < mb_get_elem_size(type); b++) {
+                    ((uint8_t *)values)[v * mb_get_elem_size(type) + b] = (uint8_t)rand();
+                }
+                break;
+        }
+    }
+}
+
+static void test_round_trip(mb_elem_type_t type, mb_word_order_t order)
+{
+    size_t size = mb_get_elem_size(type);
+    uint16_t regs = (uint16_t)(TEST_VALUES * size / 2);
+    uint16_t start = test_start(type, order);
+    uint8_t expected[TEST_VALUES * 8];
+    uint8_t wire[TEST_VALUES * 8];
+    uint64_t written[TEST_VALUES];
+
+    test_fill(type, order, 1);
+    test_ref_image(expected, type, order);
+    HOST_CHECK(eMBRegHoldingCB(wire, (USHORT)(start + 1), regs, MB_REG_READ) == MB_ENOERR);
+    if (memcmp(wire, expected, regs * 2) != 0) {
+        fprintf(stderr, "read of %s %s differs\n", test_type_names[type], test_order_names[order]);
+        exit(1);
+    }
+
+    // The wire image of other values is written, the area holds these values after
+    test_fill(type, order, 2);
+    memcpy(written, test_areas[type][order], TEST_VALUES * size);
+    test_ref_image(wire, type, order);
+    test_fill(type, order, 3);
+    HOST_CHECK(eMBRegHoldingCB(wire, (USHORT)(start + 1), regs, MB_REG_WRITE) == MB_ENOERR);
+    if (memcmp(test_areas[type][order], written, TEST_VALUES * size) != 0) {
+        fprintf(stderr, "write of %s %s differs\n", test_type_names[type], test_order_names[order]);
+        exit(1);
+    }
+}
+
+// Every request within the area, the values partially covered included
+static void test_partial(mb_elem_type_t type, mb_word_order_t order)
+{
+    size_t size = mb_get_elem_size(type);
+    uint16_t regs = (uint16_t)(TEST_VALUES * size / 2);
+    uint16_t start = test_start(type, order);
+    uint8_t image[TEST_VALUES * 8];
+    uint8_t expected[TEST_VALUES * 8];
+    uint8_t wire[TEST_VALUES * 8];
+
+    for (uint16_t first = 0; first < regs; first++) {
+        for (uint16_t count = 1; (first + count) <= regs; count++) {
+            test_fill(type, order, first * 16u + count);
+            test_ref_image(image, type, order);
+            HOST_CHECK(eMBRegHoldingCB(wire, (USHORT)(start + first + 1), count, MB_REG_READ) == MB_ENOERR);
+            HOST_CHECK(memcmp(wire, &image[first * 2], count * 2) == 0);
+
+            // Only the registers of the request change, the rest of the values is kept
+            memcpy(expected, image, regs * 2);
+            for (uint16_t i = 0; i < count * 2; i++) {
+                wire[i] = (uint8_t)rand();
+                expected[first * 2 + i] = wire[i];
+            }
+            HOST_CHECK(eMBRegHoldingCB(wire, (USHORT)(start + first + 1), count, MB_REG_WRITE) == MB_ENOERR);
+            test_ref_image(image, type, order);
+            if (memcmp(image, expected, regs * 2) != 0) {
+                fprintf(stderr, "write of %u registers at %u of %s %s differs\n",
+                        count, first, test_type_names[type], test_order_names[order]);
+                exit(1);
+            }
+        }
+    }
+}
+
+// Floats from their second register: the halves of two values in one request
+static void test_odd_floats(void)
+{
+    uint16_t start = test_start(MB_ELEM_FLOAT, MB_WORD_ORDER_ABCD);
+    float *values = (float *)test_areas[MB_ELEM_FLOAT][MB_WORD_ORDER_ABCD];
+    uint8_t wire[8];
+    values[0] = 1.0f;
+    values[1] = -2.0f;
+    values[2] = 0.5f;
+    // 1.0f is 0x3F800000, -2.0f is 0xC0000000
+    HOST_CHECK(eMBRegHoldingCB(wire, (USHORT)(start + 1 + 1), 2, MB_REG_READ) == MB_ENOERR);
+    HOST_CHECK((wire[0] == 0x00) && (wire[1] == 0x00) && (wire[2] == 0xC0) && (wire[3] == 0x00));
+    // The low register of the first value and the high one of the second value are written:
+    // 1.5f (0x3FC00000) is kept and -2.0f becomes 3.0f (0x40400000)
+    const uint8_t halves[] = { 0x00, 0x00, 0x40, 0x40 };
+    values[0] = 1.5f;
+    HOST_CHECK(eMBRegHoldingCB((UCHAR *)halves, (USHORT)(start + 1 + 1), 2, MB_REG_WRITE) == MB_ENOERR);
+    HOST_CHECK((values[0] == 1.5f) && (values[1] == 3.0f) && (values[2] == 0.5f));
+}
+
+static void test_input_and_checks(void)
+{
+    static float input[2] = { 12.5f, -0.25f };
+    mb_register_area_descriptor_t area = { 0 };
+    area.type = MB_PARAM_INPUT;
+    area.start_offset = 10;
+    area.address = input;
+    area.size = sizeof(input);
+    area.elem_type = MB_ELEM_FLOAT;
+    area.word_order = MB_WORD_ORDER_CDAB;
+    HOST_CHECK(mbc_slave_set_descriptor_hdl(&test_iface, area) == ESP_OK);
+
+    // The typed areas hold whole values of registers
+    area.start_offset = 20;
+    area.size = 6;
+    HOST_CHECK(mbc_slave_set_descriptor_hdl(&test_iface, area) == ESP_ERR_INVALID_ARG);
+    area.type = MB_PARAM_COIL;
+    area.size = sizeof(input);
+    HOST_CHECK(mbc_slave_set_descriptor_hdl(&test_iface, area) == ESP_ERR_INVALID_ARG);
+    area.type = MB_PARAM_INPUT;
+    area.elem_type = MB_ELEM_COUNT;
+    HOST_CHECK(mbc_slave_set_descriptor_hdl(&test_iface, area) == ESP_ERR_INVALID_ARG);
+    area.elem_type = MB_ELEM_FLOAT;
+    area.word_order = MB_WORD_ORDER_COUNT;
+    HOST_CHECK(mbc_slave_set_descriptor_hdl(&test_iface, area) == ESP_ERR_INVALID_ARG);
+
+    HOST_CHECK(mbc_slave_freeze_descriptors(&test_iface.opts) == ESP_OK);
+    // 12.5f is 0x41480000, -0.25f is 0xBE800000, the low register first
+    uint8_t wire[8];
+    HOST_CHECK(eMBRegInputCB(wire, 10 + 1, 4) == MB_ENOERR);
+    const uint8_t expected[] = { 0x00, 0x00, 0x41, 0x48, 0x00, 0x00, 0xBE, 0x80 };
+    HOST_CHECK(memcmp(wire, expected, sizeof(expected)) == 0);
+}
+
+int main(void)
+{
+    test_iface.opts.port_type = MB_PORT_COUNT;
+    mbc_slave_init_iface(&test_iface);
+    srand(1);
+    for (int type = 0; type < MB_ELEM_COUNT; type++) {
+        for (int order = 0; order < MB_WORD_ORDER_COUNT; order++) {
+            mb_register_area_descriptor_t area = { 0 };
+            area.type = MB_PARAM_HOLDING;
+            area.start_offset = test_start((mb_elem_type_t)type, (mb_word_order_t)order);
+            area.address = test_areas[type][order];
+            area.size = TEST_VALUES * mb_get_elem_size((mb_elem_type_t)type);
+            area.elem_type = (mb_elem_type_t)type;
+            area.word_order = (mb_word_order_t)order;
+            HOST_CHECK(mbc_slave_set_descriptor_hdl(&test_iface, area) == ESP_OK);
+        }
+    }
+    test_input_and_checks();
+
+    for (int type = 0; type < MB_ELEM_COUNT; type++) {
+        for (int order = 0; order < MB_WORD_ORDER_COUNT; order++) {
+            test_round_trip((mb_elem_type_t)type, (mb_word_order_t)order);
+            test_partial((mb_elem_type_t)type, (mb_word_order_t)order);
+        }
+    }
+    test_odd_floats();
+    printf("OK\n");
+    return 0;
+}
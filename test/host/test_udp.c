@@ -0,0 +1,149 @@
+/*
+ * Modbus/UDP transport of the slave port against Modbus TCP on the loopback.
+ *
+ * Checks that every datagram is answered to its sender, including several
+ * senders at once and bursts deeper than the transaction queue, and that an
+ * incorrect datagram is dropped without affecting the next one. Then
+ * compares the stop and wait latency and the pipelined throughput of both
+ * transports on the same requests.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "host_test.h"
+
+#define TEST_UDP_PORT       (15027)
+#define TEST_TCP_PORT       (15028)
+#define TEST_CLIENTS        (4)
+#define TEST_BURST          (3 * CONFIG_FMB_TCP_PIPELINE_DEPTH)
+#define TEST_BENCH_TRANS    (20000)
+#define TEST_REGS           (16)
+
+static uint16_t test_tid(const uint8_t *rsp)
+{
+    return (uint16_t)((rsp[0] << 8) | rsp[1]);
+}
+
+static void test_requests(void)
+{
+    int fd = host_client_connect(MB_MODE_UDP, TEST_UDP_PORT);
+    HOST_CHECK(fd >= 0);
+    (void)host_client_read_holding(fd, 1, 10, TEST_REGS);
+
+    uint8_t adu[260];
+    host_client_send(fd, adu, host_build_request(adu, 2, 0x06, 60, 0x1234));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+    host_client_send(fd, adu, host_build_request(adu, 3, 0x03, 60, 1));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 11);
+    HOST_CHECK((adu[9] == 0x12) && (adu[10] == 0x34));
+    host_client_send(fd, adu, host_build_request(adu, 4, 0x06, 60, 60));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+
+    // The length field does not match the datagram: no response, the next request is served
+    size_t length = host_build_request(adu, 5, 0x03, 0, 1);
+    adu[5] = 9;
+    host_client_send(fd, adu, length);
+    host_client_send(fd, adu, host_build_request(adu, 6, 0x03, 0, 1));
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 11);
+    HOST_CHECK(test_tid(adu) == 6);
+    close(fd);
+}
+
+static void test_senders(void)
+{
+    // Each sender gets the responses of its own datagrams, in order
+    int fds[TEST_CLIENTS];
+    for (int c = 0; c < TEST_CLIENTS; c++) {
+        fds[c] = host_client_connect(MB_MODE_UDP, TEST_UDP_PORT);
+        HOST_CHECK(fds[c] >= 0);
+    }
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < TEST_BURST; i++) {
+            for (int c = 0; c < TEST_CLIENTS; c++) {
+                uint8_t adu[12];
+                host_client_send(fds[c], adu, host_build_request(adu, (uint16_t)(c * 1000 + i), 0x03,
+                                                                  (uint16_t)(c * 100 + i), 1));
+            }
+        }
+        for (int c = 0; c < TEST_CLIENTS; c++) {
+            for (int i = 0; i < TEST_BURST; i++) {
+                uint8_t rsp[64];
+                HOST_CHECK(host_client_recv(fds[c], rsp, sizeof(rsp), 1000) == 11);
+                HOST_CHECK(test_tid(rsp) == c * 1000 + i);
+                HOST_CHECK(((rsp[9] << 8) | rsp[10]) == c * 100 + i);
+            }
+        }
+    }
+    for (int c = 0; c < TEST_CLIENTS; c++) {
+        close(fds[c]);
+    }
+}
+
+// Runs the requests with in_flight of them outstanding, returns trans/s and fills the latencies
+static double bench_transport(mb_mode_type_t mode, uint16_t port, int in_flight, uint64_t *samples)
+{
+    int fd = host_client_connect(mode, port);
+    HOST_CHECK(fd >= 0);
+    static uint64_t sent_at[TEST_BENCH_TRANS];
+    uint8_t adu[12];
+    uint8_t rsp[260];
+    int sent = 0;
+    uint64_t start = host_now_ns();
+    for (; sent < in_flight; sent++) {
+        sent_at[sent] = host_now_ns();
+        host_client_send(fd, adu, host_build_request(adu, (uint16_t)sent, 0x03, 0, TEST_REGS));
+    }
+    for (int received = 0; received < TEST_BENCH_TRANS; received++) {
+        HOST_CHECK(host_client_recv(fd, rsp, sizeof(rsp), 1000) == 9 + TEST_REGS * 2);
+        HOST_CHECK(test_tid(rsp) == (uint16_t)received);
+        samples[received] = host_now_ns() - sent_at[received];
+        if (sent < TEST_BENCH_TRANS) {
+            sent_at[sent] = host_now_ns();
+            host_client_send(fd, adu, host_build_request(adu, (uint16_t)sent, 0x03, 0, TEST_REGS));
+            sent++;
+        }
+    }
+    uint64_t elapsed = host_now_ns() - start;
+    close(fd);
+    return (double)TEST_BENCH_TRANS * 1e9 / (double)elapsed;
+}
+
+static void bench(void)
+{
+    static uint64_t samples[TEST_BENCH_TRANS];
+    printf("%d transactions of FC03 x %d registers on the loopback:\n", TEST_BENCH_TRANS, TEST_REGS);
+    const int in_flight[] = { 1, 4 };
+    for (size_t i = 0; i < sizeof(in_flight) / sizeof(in_flight[0]); i++) {
+        const struct {
+            const char *name;
+            mb_mode_type_t mode;
+            uint16_t port;
+        } transports[] = {
+            { "TCP", MB_MODE_TCP, TEST_TCP_PORT },
+            { "UDP", MB_MODE_UDP, TEST_UDP_PORT },
+        };
+        for (size_t t = 0; t < sizeof(transports) / sizeof(transports[0]); t++) {
+            double rate = bench_transport(transports[t].mode, transports[t].port, in_flight[i], samples);
+            printf("  %s, in flight %d: %8.0f trans/s, p50 %llu us, p99 %llu us\n",
+                   transports[t].name, in_flight[i], rate,
+                   (unsigned long long)host_percentile(samples, TEST_BENCH_TRANS, 50) / 1000,
+                   (unsigned long long)host_percentile(samples, TEST_BENCH_TRANS, 99) / 1000);
+        }
+    }
+}
+
+int main(void)
+{
+    pid_t udp_slave = host_slave_fork_ip(MB_MODE_UDP, TEST_UDP_PORT);
+    pid_t tcp_slave = host_slave_fork_ip(MB_MODE_TCP, TEST_TCP_PORT);
+
+    test_requests();
+    test_senders();
+    bench();
+
+    host_slave_kill(tcp_slave);
+    host_slave_kill(udp_slave);
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * Range watches of the ModbusTcpSlave library (modbus_tcp_watch_range).
+ *
+ * Checks the dispatch of random write accesses over random watches against
+ * a scan of every watch: each watch hit is called once with the part of the
+ * write inside it, the others are not called. Checks the coil bitmaps given
+ * to a watch, unwatch and the rejected arguments, then watches the DAC
+ * registers of the block 6000 on the library slave written by a master over
+ * the loopback, including a callback which tries to change the watches.
+ * The cost of a dispatch by number of watches is compared with the scan of
+ * every watch.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "modbus_tcp_slave.c"
+#include "host_test.h"
+
+#define TEST_PORT           (15034)
+#define TEST_TRIALS         (2000)
+#define TEST_WRITES         (50)
+#define TEST_BENCH_DISPATCH (5000000)
+#define TEST_WAIT_MS        (1000)
+
+typedef struct {
+    unsigned calls;
+    uint16_t addr;
+    uint16_t count;
+    const uint16_t *old_values;
+    const uint16_t *new_values;
+} test_call_t;
+
+static test_call_t test_calls[MODBUS_TCP_WATCH_MAX];
+static volatile unsigned test_total_calls;
+static uint16_t test_last_new[8];
+
+// The context is the number of the watch in test_calls
+static void test_watch_cb(void *ctx, modbus_reg_type_t reg_type, uint16_t addr, uint16_t count,
+                          const uint16_t *old_values, const uint16_t *new_values)
+{
+    test_call_t *call = &test_calls[(intptr_t)ctx];
+    call->calls++;
+    call->addr = addr;
+    call->count = count;
+    call->old_values = old_values;
+    call->new_values = new_values;
+    test_total_calls++;
+    if (count <= sizeof(test_last_new) / sizeof(test_last_new[0])) {
+        memcpy(test_last_new, new_values, count * sizeof(uint16_t));
+    }
+}
+
+static void test_random_dispatch(modbus_tcp_handle_t handle)
+{
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    static modbus_event_ctx_t ctx;
+    static uint16_t old_values[256], new_values[256];
+    uint16_t starts[MODBUS_TCP_WATCH_MAX], ends[MODBUS_TCP_WATCH_MAX];
+    srand(1);
+    for (int trial = 0; trial < TEST_TRIALS; trial++) {
+        int watches = 1 + rand() % MODBUS_TCP_WATCH_MAX;
+        for (int w = 0; w < watches; w++) {
+            starts[w] = (uint16_t)(rand() % 200);
+            ends[w] = (uint16_t)(starts[w] + 1 + rand() % 30);
+            HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, starts[w], ends[w] - starts[w],
+                                              test_watch_cb, (void*)(intptr_t)w) == ESP_OK);
+        }
+        for (int i = 0; i < TEST_WRITES; i++) {
+            modbus_tcp_access_t access = {
+                .reg_type = MODBUS_REG_HOLDING, .write = true,
+                .addr = (uint16_t)(rand() % 220), .count = (uint16_t)(1 + rand() % 40),
+                .old_values = old_values, .new_values = new_values,
+            };
+            memset(test_calls, 0, sizeof(test_calls));
+            watch_dispatch(&ctx, &instance->watches[0], &access);
+            uint16_t a = access.addr, b = access.addr + access.count;
+            for (int w = 0; w < watches; w++) {
+                const test_call_t *call = &test_calls[w];
+                if ((starts[w] >= b) || (ends[w] <= a)) {
+                    HOST_CHECK(call->calls == 0);
+                    continue;
+                }
+                uint16_t first = (starts[w] > a) ? starts[w] : a;
+                uint16_t end = (ends[w] < b) ? ends[w] : b;
+                HOST_CHECK(call->calls == 1 && call->addr == first && call->count == end - first);
+                HOST_CHECK(call->old_values == &old_values[first - a] && call->new_values == &new_values[first - a]);
+            }
+        }
+        for (int w = 0; w < watches; w++) {
+            HOST_CHECK(modbus_tcp_unwatch_range(handle, test_watch_cb, (void*)(intptr_t)w) == ESP_OK);
+        }
+        HOST_CHECK(instance->watches[0].count == 0);
+    }
+}
+
+static void test_coils_and_arguments(modbus_tcp_handle_t handle)
+{
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    static modbus_event_ctx_t ctx;
+
+    // Coils 5..7 of a write of the coils 2..11: the bitmap starts at the coil 5
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_COIL, 5, 3, test_watch_cb, (void*)0) == ESP_OK);
+    uint16_t old_bits = 0x0208, new_bits = 0x00F0;
+    modbus_tcp_access_t access = {
+        .reg_type = MODBUS_REG_COIL, .write = true, .addr = 2, .count = 10,
+        .old_values = &old_bits, .new_values = &new_bits,
+    };
+    memset(test_calls, 0, sizeof(test_calls));
+    watch_dispatch(&ctx, &instance->watches[1], &access);
+    HOST_CHECK(test_calls[0].calls == 1 && test_calls[0].addr == 5 && test_calls[0].count == 3);
+    HOST_CHECK(test_calls[0].old_values[0] == ((0x0208 >> 3) & 7) && test_calls[0].new_values[0] == ((0x00F0 >> 3) & 7));
+
+    // The holding watches are not called for the coils
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, 0, 100, test_watch_cb, (void*)1) == ESP_OK);
+    memset(test_calls, 0, sizeof(test_calls));
+    watch_dispatch(&ctx, &instance->watches[1], &access);
+    HOST_CHECK(test_calls[1].calls == 0);
+
+    HOST_CHECK(modbus_tcp_unwatch_range(handle, test_watch_cb, (void*)0) == ESP_OK);
+    HOST_CHECK(instance->watches[1].count == 0 && instance->watches[0].count == 1);
+    HOST_CHECK(modbus_tcp_unwatch_range(handle, test_watch_cb, (void*)0) == ESP_ERR_NOT_FOUND);
+    HOST_CHECK(modbus_tcp_unwatch_range(handle, test_watch_cb, (void*)1) == ESP_OK);
+
+    // Only the types written by the master, a range inside the 16-bit addresses
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_INPUT, 0, 1, test_watch_cb, NULL) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_DISCRETE, 0, 1, test_watch_cb, NULL) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, 0, 0, test_watch_cb, NULL) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, 0, 1, NULL, NULL) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, UINT16_MAX, 2, test_watch_cb, NULL) == ESP_ERR_INVALID_ARG);
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, UINT16_MAX, 1, test_watch_cb, NULL) == ESP_OK);
+
+    for (int w = 1; w < MODBUS_TCP_WATCH_MAX; w++) {
+        HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, 0, 1, test_watch_cb, NULL) == ESP_OK);
+    }
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, 0, 1, test_watch_cb, NULL) == ESP_ERR_NO_MEM);
+    HOST_CHECK(modbus_tcp_unwatch_range(handle, test_watch_cb, NULL) == ESP_OK);
+    HOST_CHECK(instance->watches[0].count == 0);
+}
+
+static void test_write_regs(int fd, uint16_t tid, uint16_t addr, uint16_t count, uint16_t first)
+{
+    uint8_t adu[260];
+    size_t length = host_build_request(adu, tid, 0x10, addr, count);
+    adu[5] = (uint8_t)(7 + count * 2);
+    adu[length++] = (uint8_t)(count * 2);
+    for (uint16_t r = 0; r < count; r++) {
+        adu[length++] = (uint8_t)((first + r) >> 8);
+        adu[length++] = (uint8_t)(first + r);
+    }
+    host_client_send(fd, adu, length);
+    HOST_CHECK(host_client_recv(fd, adu, sizeof(adu), 1000) == 12);
+    HOST_CHECK(adu[7] == 0x10);
+}
+
+static void test_wait_calls(unsigned calls)
+{
+    for (int ms = 0; (test_total_calls < calls) && (ms < TEST_WAIT_MS); ms++) {
+        usleep(1000);
+    }
+    HOST_CHECK(test_total_calls == calls);
+}
+
+static volatile esp_err_t test_nested_watch;
+static volatile esp_err_t test_nested_unwatch;
+
+// Registers and cancels watches from the operation task: both are rejected at once
+static void test_nested_cb(void *ctx, modbus_reg_type_t reg_type, uint16_t addr, uint16_t count,
+                           const uint16_t *old_values, const uint16_t *new_values)
+{
+    modbus_tcp_handle_t handle = ctx;
+    test_nested_watch = modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, 0, 1, test_watch_cb, NULL);
+    test_nested_unwatch = modbus_tcp_unwatch_range(handle, test_nested_cb, ctx);
+    test_total_calls++;
+}
+
+static void test_slave_writes(modbus_tcp_handle_t handle)
+{
+    HOST_CHECK(modbus_tcp_slave_start(handle) == ESP_OK);
+    host_slave_wait_ready(MB_MODE_TCP, TEST_PORT);
+    int fd = host_client_connect(MB_MODE_TCP, TEST_PORT);
+    HOST_CHECK(fd >= 0);
+
+    // forcaValorDAC..dACGain0 of the block 6000
+    memset(test_calls, 0, sizeof(test_calls));
+    test_total_calls = 0;
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, REG_6000_START + forcaValorDAC, 3,
+                                      test_watch_cb, (void*)0) == ESP_OK);
+    test_write_regs(fd, 1, REG_6000_START, REG_6000_SIZE, 0x100);
+    test_wait_calls(1);
+    HOST_CHECK(test_calls[0].addr == REG_6000_START + forcaValorDAC && test_calls[0].count == 3);
+    HOST_CHECK(test_last_new[0] == 0x101 && test_last_new[2] == 0x103);
+
+    // Outside of the watch: no call, the next write inside is
+    test_write_regs(fd, 2, REG_6000_START + dACOffset0, 1, 0x200);
+    test_write_regs(fd, 3, REG_6000_START + nada, 1, 0x300);
+    test_wait_calls(2);
+    HOST_CHECK(test_calls[0].addr == REG_6000_START + nada && test_calls[0].count == 1);
+    HOST_CHECK(test_last_new[0] == 0x300);
+
+    // No call once unwatched
+    HOST_CHECK(modbus_tcp_unwatch_range(handle, test_watch_cb, (void*)0) == ESP_OK);
+    test_write_regs(fd, 4, REG_6000_START, REG_6000_SIZE, 0x400);
+    usleep(100000);
+    HOST_CHECK(test_total_calls == 2 && reg6000[nada] == 0x402);
+
+    // A callback can not change the watches, the master write is answered without waiting
+    test_total_calls = 0;
+    HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, REG_6000_START, 1,
+                                      test_nested_cb, handle) == ESP_OK);
+    uint64_t start = host_now_ns();
+    test_write_regs(fd, 5, REG_6000_START, 1, 0x500);
+    test_wait_calls(1);
+    HOST_CHECK(host_now_ns() - start < 500000000ull);
+    HOST_CHECK(test_nested_watch == ESP_ERR_INVALID_STATE && test_nested_unwatch == ESP_ERR_INVALID_STATE);
+    HOST_CHECK(get_instance(handle)->watches[0].count == 1);
+    HOST_CHECK(modbus_tcp_unwatch_range(handle, test_nested_cb, handle) == ESP_OK);
+
+    close(fd);
+    HOST_CHECK(modbus_tcp_slave_stop(handle) == ESP_OK);
+}
+
+static void bench_cb(void *ctx, modbus_reg_type_t reg_type, uint16_t addr, uint16_t count,
+                     const uint16_t *old_values, const uint16_t *new_values)
+{
+    HOST_KEEP(addr);
+}
+
+// Calls every watch of the index which the write reaches, watch by watch
+static __attribute__((noinline)) void bench_scan(const modbus_watch_index_t *index,
+                                                 const modbus_tcp_access_t *access)
+{
+    uint32_t a = access->addr, b = a + access->count;
+    for (uint16_t i = 0; i < index->count; i++) {
+        const modbus_watch_t *watch = &index->items[i];
+        if ((watch->start < b) && (watch->end > a)) {
+            uint16_t first = (watch->start > a) ? watch->start : (uint16_t)a;
+            uint16_t count = (uint16_t)(((watch->end < b) ? watch->end : b) - first);
+            watch->cb(watch->ctx, access->reg_type, first, count,
+                      &access->old_values[first - a], &access->new_values[first - a]);
+        }
+    }
+}
+
+static void bench(modbus_tcp_handle_t handle)
+{
+    modbus_tcp_instance_t *instance = get_instance(handle);
+    static modbus_event_ctx_t ctx;
+    static uint16_t values[8];
+    printf("write of 1 register over watches of 10 registers, ns per dispatch:\n");
+    for (int watches = 1; watches <= MODBUS_TCP_WATCH_MAX; watches *= 2) {
+        for (int w = 0; w < watches; w++) {
+            HOST_CHECK(modbus_tcp_watch_range(handle, MODBUS_REG_HOLDING, (uint16_t)(w * 10), 10, bench_cb, NULL) == ESP_OK);
+        }
+        modbus_tcp_access_t access = {
+            .reg_type = MODBUS_REG_HOLDING, .write = true, .count = 1,
+            .old_values = values, .new_values = values,
+        };
+        double ns[2];
+        for (int scan = 0; scan < 2; scan++) {
+            uint64_t start = host_now_ns();
+            for (int i = 0; i < TEST_BENCH_DISPATCH; i++) {
+                // Most writes hit one watch, the last ones none
+                access.addr = (uint16_t)((i * 7) % (watches * 10 + 50));
+                if (scan) {
+                    bench_scan(&instance->watches[0], &access);
+                } else {
+                    watch_dispatch(&ctx, &instance->watches[0], &access);
+                }
+            }
+            ns[scan] = (double)(host_now_ns() - start) / TEST_BENCH_DISPATCH;
+        }
+        printf("  %2d watches: watch_dispatch %5.1f, scan of the watches %5.1f\n", watches, ns[0], ns[1]);
+        HOST_CHECK(modbus_tcp_unwatch_range(handle, bench_cb, NULL) == ESP_OK);
+    }
+}
+
+int main(void)
+{
+    static int netif;
+    modbus_tcp_config_t config = { .port = TEST_PORT, .netif = (esp_netif_t*)&netif };
+    modbus_tcp_handle_t handle = NULL;
+    HOST_CHECK(modbus_tcp_slave_init(&config, &handle) == ESP_OK);
+
+    test_random_dispatch(handle);
+    test_coils_and_arguments(handle);
+    test_slave_writes(handle);
+    bench(handle);
+
+    HOST_CHECK(modbus_tcp_slave_destroy(handle) == ESP_OK);
+    printf("OK\n");
+    return 0;
+}